@@ -23,10 +23,14 @@
  */
 
 #include "address.h"
+#include "misc.h"
 
 struct _address_t {
-    char ip[32];
-    int port;
+    socket_address_t addr;     /* 套接字地址 */
+    socket_len_t     len;      /* 套接字地址长度，0为没有设置 */
+    int              resolved; /* ip是否已经由addr转换 */
+    char             ip[128];  /* IP，UNIX域套接字为路径 */
+    int              port;
 };
 
 address_t* address_create() {
@@ -44,13 +48,39 @@ void address_destroy(address_t* address) {
 void address_set(address_t* address, const char* ip, int port) {
     assert(address);
     if (ip) {
-        strcpy(address->ip, ip);
+        strncpy(address->ip, ip, sizeof(address->ip) - 1);
+        address->ip[sizeof(address->ip) - 1] = 0;
+    }
+    address->port     = port;
+    address->resolved = 1;
+    /* 同时保留套接字地址，UNIX域路径及无法解析的字符串没有套接字地址 */
+    address->len = socket_make_address(ip, port, &address->addr);
+}
+
+void address_set_sockaddr(address_t* address, const struct sockaddr* sa, int len) {
+    assert(address);
+    assert(sa);
+    if ((len <= 0) || (len > (int)sizeof(address->addr))) {
+        return;
+    }
+    memcpy(&address->addr, sa, len);
+    address->len      = (socket_len_t)len;
+    address->resolved = 0;
+    address->ip[0]    = 0;
+    address->port     = 0;
+    if ((sa->sa_family == AF_INET) || (sa->sa_family == AF_INET6)) {
+        /* IPv4与IPv6的端口在相同偏移 */
+        address->port = ntohs(address->addr.sin.sin_port);
     }
-    address->port = port;
 }
 
 const char* address_get_ip(address_t* address) {
     assert(address);
+    if (!address->resolved) {
+        /* 第一次取得时才转换为字符串 */
+        socket_address_to_string(&address->addr, address->len, address->ip, sizeof(address->ip));
+        address->resolved = 1;
+    }
     return address->ip;
 }
 
@@ -58,3 +88,14 @@ int address_get_port(address_t* address) {
     assert(address);
     return address->port;
 }
+
+const struct sockaddr* address_get_sockaddr(address_t* address, int* len) {
+    assert(address);
+    if (len) {
+        *len = (int)address->len;
+    }
+    if (!address->len) {
+        return 0;
+    }
+    return &address->addr.sa;
+}
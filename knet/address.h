@@ -29,23 +29,31 @@
 #include "address_api.h"
 
 /*
- * һaddress_tʵ
- * @return address_tʵ
+ * 创建一个address_t实例
+ * @return address_t实例
  */
 address_t* address_create();
 
 /*
- * һaddress_tʵ
- * @param address address_tʵ
+ * 销毁一个address_t实例
+ * @param address address_t实例
  */
 void address_destroy(address_t* address);
 
 /*
- * IPͶ˿
- * @param address address_tʵ
+ * 设置IP和端口
+ * @param address address_t实例
  * @param ip IP
- * @param port ˿
+ * @param port 端口
  */
 void address_set(address_t* address, const char* ip, int port);
 
+/*
+ * 设置套接字地址，IP字符串在第一次调用address_get_ip时才转换
+ * @param address address_t实例
+ * @param sa 套接字地址
+ * @param len 套接字地址长度
+ */
+void address_set_sockaddr(address_t* address, const struct sockaddr* sa, int len);
+
 #endif /* ADDRESS_H */
@@ -26,17 +26,25 @@
 #define ADDRESS_API_H
 
 /*
- * ȡIP
- * @param address address_tʵ
- * @return IPַ
+ * 取得IP
+ * @param address address_t实例
+ * @return IP字符串，UNIX域套接字为路径（抽象命名空间以'@'开头）
  */
 const char* address_get_ip(address_t* address);
 
 /*
- * ȡport
- * @param address address_tʵ
- * @return ˿
+ * 取得port
+ * @param address address_t实例
+ * @return 端口
  */
 int address_get_port(address_t* address);
 
+/*
+ * 取得套接字地址，可直接用于channel_ref_connect_addr
+ * @param address address_t实例
+ * @param len 套接字地址长度
+ * @return 套接字地址，没有时返回0
+ */
+const struct sockaddr* address_get_sockaddr(address_t* address, int* len);
+
 #endif /* ADDRESS_API_H */
@@ -25,9 +25,11 @@
 #include "buffer.h"
 
 struct _buffer_t {
-    char*    ptr;
-    uint32_t len;
-    uint32_t pos;
+    char*     ptr;   /* 缓冲区指针 */
+    uint32_t  len;   /* 缓冲区长度 */
+    uint32_t  pos;   /* 写入位置 */
+    uint32_t  start; /* 数据起始位置 */
+    buffer_t* next;  /* 链表中的下一个缓冲区 */
 };
 
 buffer_t* buffer_create(uint32_t size) {
@@ -35,8 +37,10 @@ buffer_t* buffer_create(uint32_t size) {
     assert(sb);
     sb->ptr = create_raw(size);
     assert(sb->ptr);
-    sb->pos = 0;
-    sb->len = size;
+    sb->pos   = 0;
+    sb->start = 0;
+    sb->len   = size;
+    sb->next  = 0;
     return sb;
 }
 
@@ -60,15 +64,58 @@ uint32_t buffer_put(buffer_t* sb, const char* temp, uint32_t size) {
 
 uint32_t buffer_get_length(buffer_t* sb) {
     assert(sb);
-    return sb->pos;
+    return sb->pos - sb->start;
 }
 
 char* buffer_get_ptr(buffer_t* sb) {
     assert(sb);
-    return sb->ptr;
+    return sb->ptr + sb->start;
 }
 
 void buffer_adjust(buffer_t* sb, uint32_t gap) {
-    assert(sb); /* gapΪ0 */
-    sb->ptr += gap;
+    assert(sb); /* gap可以为0 */
+    assert(gap <= sb->pos - sb->start);
+    sb->start += gap;
+}
+
+uint32_t buffer_get_space(buffer_t* sb) {
+    assert(sb);
+    return sb->len - sb->pos;
+}
+
+char* buffer_get_write_ptr(buffer_t* sb) {
+    assert(sb);
+    return sb->ptr + sb->pos;
+}
+
+void buffer_commit(buffer_t* sb, uint32_t size) {
+    assert(sb);
+    assert(size <= sb->len - sb->pos);
+    sb->pos += size;
+}
+
+void buffer_set_next(buffer_t* sb, buffer_t* next) {
+    assert(sb);
+    sb->next = next;
+}
+
+buffer_t* buffer_get_next(buffer_t* sb) {
+    assert(sb);
+    return sb->next;
+}
+
+uint32_t buffer_chain_get_length(buffer_t* chain) {
+    uint32_t length = 0;
+    for (; chain; chain = chain->next) {
+        length += chain->pos - chain->start;
+    }
+    return length;
+}
+
+void buffer_chain_destroy(buffer_t* chain) {
+    buffer_t* next = 0;
+    for (; chain; chain = next) {
+        next = chain->next;
+        buffer_destroy(chain);
+    }
 }
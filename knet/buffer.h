@@ -26,49 +26,6 @@
 #define BUFFER_H
 
 #include "config.h"
-
-/*
- * һ̶ȵĻ
- * @param size ȣֽڣ
- * @return buffer_tʵ
- */
-buffer_t* buffer_create(uint32_t size);
-
-/*
- * ٻ
- * @param sb buffer_tʵ
- */
-void buffer_destroy(buffer_t* sb);
-
-/*
- * д
- * @param sb buffer_tʵ
- * @param temp ָֽ
- * @param size ֽ鳤
- * @retval 0 дʧ
- * @retval >0 ʵдֽ
- */
-uint32_t buffer_put(buffer_t* sb, const char* temp, uint32_t size);
-
-/*
- * ȡûݳ
- * @param sb buffer_tʵ
- * @return ݳ
- */
-uint32_t buffer_get_length(buffer_t* sb);
-
-/*
- * ȡûʼַ
- * @param sb buffer_tʵ
- * @return ݳ
- */
-char* buffer_get_ptr(buffer_t* sb);
-
-/*
- * ʼַ
- * @param sb buffer_tʵ
- * @param gap ĳ
- */
-void buffer_adjust(buffer_t* sb, uint32_t gap);
+#include "buffer_api.h"
 
 #endif /* BUFFER_H */
@@ -28,12 +28,19 @@
 #include "ringbuffer.h"
 #include "loop.h"
 #include "misc.h"
+#include "shm.h"
+#include "inproc.h"
 
 struct _channel_t {
-    dlist_t*      send_buffer_list;  /*  */
-    uint32_t      max_send_list_len; /* 󳤶 */
-    ringbuffer_t* recv_ringbuffer;   /* λ */
-    socket_t      socket_fd;         /* ׽ */
+    dlist_t*      send_buffer_list;  /* 发送链表 */
+    uint32_t      max_send_list_len; /* 发送链表最大长度 */
+    ringbuffer_t* recv_ringbuffer;   /* 读环形缓冲区 */
+    uint32_t      max_recv_ring_len; /* 读环形缓冲区可扩展的最大长度 */
+    uint32_t      recv_budget;       /* 每次读事件最多读取的字节数，0为不限制 */
+    int           fastopen;          /* TCP Fast Open，监听时为队列长度，连接时非0开启 */
+    socket_t      socket_fd;         /* 套接字 */
+    shm_t*        shm;               /* 共享内存管道，套接字为本端门铃 */
+    inproc_t*     inproc;            /* 进程内管道，没有套接字 */
 };
 
 channel_t* channel_create(uint32_t max_send_list_len, uint32_t recv_ring_len) {
@@ -50,81 +57,321 @@ channel_t* channel_create_exist_socket_fd(socket_t socket_fd, uint32_t max_send_
     channel->recv_ringbuffer = ringbuffer_create(recv_ring_len);
     assert(channel->recv_ringbuffer);
     channel->max_send_list_len = max_send_list_len;
+    channel->max_recv_ring_len = recv_ring_len;
+    channel->recv_budget = 0;
+    channel->fastopen = 0;
     channel->socket_fd = socket_fd;
-    /* Ϊ */
+    channel->shm = 0;
+    channel->inproc = 0;
+    /* 设置为非阻塞 */
     socket_set_non_blocking_on(channel->socket_fd);
-    /* رӳٷ */
+    /* 关闭延迟发送 */
     socket_set_nagle_off(channel->socket_fd);
-    /* رTIME_WAIT */
+    /* 关闭TIME_WAIT */
     socket_set_linger_off(channel->socket_fd);
-    /* رkeep alive */
+    /* 关闭keep alive */
     socket_set_keepalive_off(channel->socket_fd);
     return channel;
 }
 
+channel_t* channel_create_udp() {
+    channel_t* channel = create(channel_t);
+    assert(channel);
+    /* 数据报不经过发送链表和读缓冲区，只保留最小的读缓冲区 */
+    channel->send_buffer_list = dlist_create();
+    assert(channel->send_buffer_list);
+    channel->recv_ringbuffer = ringbuffer_create(1);
+    assert(channel->recv_ringbuffer);
+    channel->max_send_list_len = 0;
+    channel->max_recv_ring_len = 1;
+    channel->recv_budget = 0;
+    channel->fastopen = 0;
+    channel->socket_fd = socket_create_udp();
+    assert(channel->socket_fd > 0);
+    channel->shm = 0;
+    channel->inproc = 0;
+    /* 设置为非阻塞 */
+    socket_set_non_blocking_on(channel->socket_fd);
+    return channel;
+}
+
+channel_t* channel_create_shm(shm_t* shm, uint32_t max_send_list_len, uint32_t recv_ring_len) {
+    channel_t* channel = create(channel_t);
+    assert(channel);
+    assert(shm);
+    channel->send_buffer_list = dlist_create();
+    assert(channel->send_buffer_list);
+    channel->recv_ringbuffer = ringbuffer_create(recv_ring_len);
+    assert(channel->recv_ringbuffer);
+    channel->max_send_list_len = max_send_list_len;
+    channel->max_recv_ring_len = recv_ring_len;
+    channel->recv_budget = 0;
+    channel->fastopen = 0;
+    channel->socket_fd = shm_get_fd(shm);
+    channel->shm = shm;
+    channel->inproc = 0;
+    return channel;
+}
+
+channel_t* channel_create_inproc(inproc_t* inproc, uint32_t max_send_list_len, uint32_t recv_ring_len) {
+    channel_t* channel = create(channel_t);
+    assert(channel);
+    assert(inproc);
+    channel->send_buffer_list = dlist_create();
+    assert(channel->send_buffer_list);
+    channel->recv_ringbuffer = ringbuffer_create(recv_ring_len);
+    assert(channel->recv_ringbuffer);
+    channel->max_send_list_len = max_send_list_len;
+    channel->max_recv_ring_len = recv_ring_len;
+    channel->recv_budget = 0;
+    channel->fastopen = 0;
+    channel->socket_fd = 0;
+    channel->shm = 0;
+    channel->inproc = inproc;
+    return channel;
+}
+
 void channel_destroy(channel_t* channel) {
     dlist_node_t* node        = 0;
     dlist_node_t* temp        = 0;
     buffer_t*     send_buffer = 0;
     assert(channel);
-    /* δ͵ */
+    /* 销毁未发送的数据 */
     dlist_for_each_safe(channel->send_buffer_list, node, temp) {
         send_buffer = (buffer_t*)dlist_node_get_data(node);
         buffer_destroy(send_buffer);
     }
     dlist_destroy(channel->send_buffer_list);
-    /* ٽջ */
+    /* 销毁接收缓冲区 */
     ringbuffer_destroy(channel->recv_ringbuffer);
+    if (channel->shm) {
+        shm_destroy(channel->shm);
+    }
+    if (channel->inproc) {
+        inproc_destroy(channel->inproc);
+    }
     destroy(channel);
 }
 
+/*
+ * 将创建时的IPv4套接字替换为其他协议族的套接字，只能在连接或监听前调用
+ */
+static int channel_replace_socket(channel_t* channel, int family) {
+    socket_t socket_fd = 0;
+    if (family == AF_INET) {
+        return error_ok;
+    } else if (family == AF_INET6) {
+        socket_fd = socket_create_ipv6();
+    } else if (family == AF_UNIX) {
+        socket_fd = socket_create_unix();
+    }
+    if (!socket_fd) {
+        return error_fail;
+    }
+    socket_close(channel->socket_fd);
+    channel->socket_fd = socket_fd;
+    socket_set_non_blocking_on(channel->socket_fd);
+    if (family == AF_INET6) {
+        socket_set_nagle_off(channel->socket_fd);
+        socket_set_linger_off(channel->socket_fd);
+        socket_set_keepalive_off(channel->socket_fd);
+    }
+    return error_ok;
+}
+
 int channel_connect(channel_t* channel, const char* ip, int port) {
+    socket_address_t addr;
+    socket_len_t     len = 0;
     assert(channel);
     assert(ip);
-    return socket_connect(channel->socket_fd, ip, port);
+    if (socket_check_unix_path(ip)) {
+        if (error_ok != channel_replace_socket(channel, AF_UNIX)) {
+            return error_connect_fail;
+        }
+        return socket_connect_unix(channel->socket_fd, ip);
+    }
+    len = socket_make_address(ip, port, &addr);
+    if (!len) {
+        return error_connect_fail;
+    }
+    return channel_connect_addr(channel, &addr.sa, (int)len);
+}
+
+int channel_connect_addr(channel_t* channel, const struct sockaddr* addr, int len) {
+    assert(channel);
+    assert(addr);
+    if (error_ok != channel_replace_socket(channel, addr->sa_family)) {
+        return error_connect_fail;
+    }
+    if (channel->fastopen && (addr->sa_family != AF_UNIX)) {
+        /* 推迟到第一次发送时再发出SYN，数据随SYN发送，系统不支持时为普通连接 */
+        socket_set_fastopen_connect_on(channel->socket_fd);
+    }
+    return socket_connect_addr(channel->socket_fd, addr, (socket_len_t)len);
 }
 
 int channel_accept(channel_t* channel, const char* ip, int port, int backlog) {
+    int error = 0;
     assert(channel);
-    assert(port);
     assert(backlog);
+    if (socket_check_unix_path(ip)) {
+        if (error_ok != channel_replace_socket(channel, AF_UNIX)) {
+            return error_bind_fail;
+        }
+        return socket_bind_and_listen_unix(channel->socket_fd, ip, backlog);
+    }
+    assert(port);
     if (!ip) {
         ip = "0.0.0.0";
     }
-    /* Ϊ״̬ */
-    return socket_bind_and_listen(channel->socket_fd, ip, port, backlog);
+    if (strchr(ip, ':')) {
+        /* IPv6，"::"为双栈监听 */
+        if (error_ok != channel_replace_socket(channel, AF_INET6)) {
+            return error_bind_fail;
+        }
+    }
+    /* 设置为监听状态 */
+    error = socket_bind_and_listen(channel->socket_fd, ip, port, backlog);
+    if ((error == error_ok) && channel->fastopen) {
+        /* 接受SYN携带的数据，系统不支持时忽略 */
+        socket_set_fastopen_on(channel->socket_fd, channel->fastopen);
+    }
+    return error;
+}
+
+int channel_bind(channel_t* channel, const char* ip, int port) {
+    socket_t socket_fd = 0;
+    assert(channel);
+    if (!ip) {
+        ip = "0.0.0.0";
+    }
+    if (strchr(ip, ':')) {
+        /* IPv6地址，换成IPv6套接字 */
+        socket_fd = socket_create_udp_ipv6();
+        if (!socket_fd) {
+            return error_bind_fail;
+        }
+        socket_close(channel->socket_fd);
+        channel->socket_fd = socket_fd;
+        socket_set_non_blocking_on(channel->socket_fd);
+    }
+    return socket_bind(channel->socket_fd, ip, port);
 }
 
 int channel_send_buffer(channel_t* channel, buffer_t* send_buffer) {
+    buffer_t* next = 0;
     assert(channel);
     assert(send_buffer);
-    /* ͻӵβ */
-    dlist_add_tail_node(channel->send_buffer_list, send_buffer);
-    /* õд¼ */
+    /* 将发送缓冲区（链表）加到链表尾部 */
+    for (; send_buffer; send_buffer = next) {
+        next = buffer_get_next(send_buffer);
+        buffer_set_next(send_buffer, 0);
+        dlist_add_tail_node(channel->send_buffer_list, send_buffer);
+    }
+    /* 让调用者重新设置写事件 */
+    return error_send_patial;
+}
+
+int channel_send_chain(channel_t* channel, buffer_t* chain) {
+    int empty = 0;
+    assert(channel);
+    assert(chain);
+    empty = dlist_empty(channel->send_buffer_list);
+    if (channel->inproc && empty) {
+        /* 缓冲区链表直接移入对端读队列 */
+        return inproc_write_chain(channel->inproc, chain);
+    }
+    channel_send_buffer(channel, chain);
+    if (empty && (channel->shm || socket_check_send_ready(channel->socket_fd))) {
+        /* 尝试直接发送 */
+        return channel_update_send(channel);
+    }
     return error_send_patial;
 }
 
 int channel_send(channel_t* channel, const char* data, int size) {
     int       bytes       = 0;
+    uint32_t  length      = 0;
     buffer_t* send_buffer = 0;
     assert(channel);
     assert(data);
     assert(size);
+    if (channel->inproc) {
+        /* 拷贝一次后移入对端读队列 */
+        send_buffer = buffer_create(size);
+        buffer_put(send_buffer, data, size);
+        return channel_send_chain(channel, send_buffer);
+    }
     if (dlist_empty(channel->send_buffer_list)) {
-        /* ֱӷ */
-        if (socket_check_send_ready(channel->socket_fd)) {
+        /* 尝试直接发送 */
+        if (channel->shm) {
+            length = (uint32_t)size;
+            bytes  = shm_write_segments(channel->shm, &data, &length, 1);
+        } else if (socket_check_send_ready(channel->socket_fd)) {
             bytes = socket_send(channel->socket_fd, data, size);
         }
     }
     if (bytes < 0) {
         return error_send_fail;
     }
-    /* ֱӷʧܣûзϵֽڷ뷢ȴ´η */
+    /* 直接发送失败，或者没有发送完毕的字节放入发送链表等待下次发送 */
     if (size > bytes) {
         send_buffer = buffer_create(size - bytes);
         buffer_put(send_buffer, data + bytes, size - bytes);
         dlist_add_tail_node(channel->send_buffer_list, send_buffer);
-        /* ҪԺ */
+        /* 需要稍后发送 */
+        return error_send_patial;
+    }
+    return error_ok;
+}
+
+int channel_send_segments(channel_t* channel, const char* ptr[], uint32_t size[], int count) {
+    int       i           = 0;
+    int       bytes       = 0;
+    uint32_t  total       = 0;
+    uint32_t  skip        = 0;
+    buffer_t* send_buffer = 0;
+    assert(channel);
+    assert(ptr);
+    assert(size);
+    for (; i < count; i++) {
+        total += size[i];
+    }
+    if (channel->inproc) {
+        /* 合并到一个缓冲区后移入对端读队列 */
+        send_buffer = buffer_create(total ? total : 1);
+        for (i = 0; i < count; i++) {
+            if (size[i]) {
+                buffer_put(send_buffer, ptr[i], size[i]);
+            }
+        }
+        return channel_send_chain(channel, send_buffer);
+    }
+    if (dlist_empty(channel->send_buffer_list)) {
+        /* 尝试直接发送 */
+        if (channel->shm) {
+            bytes = shm_write_segments(channel->shm, ptr, size, count);
+        } else if (socket_check_send_ready(channel->socket_fd)) {
+            bytes = socket_send_segments(channel->socket_fd, ptr, size, count);
+        }
+    }
+    if (bytes < 0) {
+        return error_send_fail;
+    }
+    if (total > (uint32_t)bytes) {
+        /* 跳过已发送的部分，剩余部分合并到一个缓冲区 */
+        send_buffer = buffer_create(total - bytes);
+        skip = (uint32_t)bytes;
+        for (i = 0; i < count; i++) {
+            if (skip >= size[i]) {
+                skip -= size[i];
+                continue;
+            }
+            buffer_put(send_buffer, ptr[i] + skip, size[i] - skip);
+            skip = 0;
+        }
+        dlist_add_tail_node(channel->send_buffer_list, send_buffer);
+        /* 需要稍后发送 */
         return error_send_patial;
     }
     return error_ok;
@@ -135,57 +382,140 @@ int channel_update_send(channel_t* channel) {
     dlist_node_t* temp        = 0;
     buffer_t*     send_buffer = 0;
     int           bytes       = 0;
+    int           count       = 0;
+    int           i           = 0;
+    const char*   ptr[SOCKET_MAX_SEGMENTS];
+    uint32_t      size[SOCKET_MAX_SEGMENTS];
+    buffer_t*     chain = 0;
+    buffer_t*     last  = 0;
     assert(channel);
-    /*  */
-    dlist_for_each_safe(channel->send_buffer_list, node, temp) {
-        send_buffer = (buffer_t*)dlist_node_get_data(node);
-        bytes = socket_send(channel->socket_fd, buffer_get_ptr(send_buffer), buffer_get_length(send_buffer));
+    if (channel->inproc) {
+        /* 整个发送链表串成缓冲区链表，一次移入对端读队列 */
+        dlist_for_each_safe(channel->send_buffer_list, node, temp) {
+            send_buffer = (buffer_t*)dlist_node_get_data(node);
+            if (last) {
+                buffer_set_next(last, send_buffer);
+            } else {
+                chain = send_buffer;
+            }
+            last = send_buffer;
+            dlist_delete(channel->send_buffer_list, node);
+        }
+        return chain ? inproc_write_chain(channel->inproc, chain) : error_ok;
+    }
+    /* 发送链表内所有数据，每次系统调用最多发送SOCKET_MAX_SEGMENTS个节点 */
+    while (!dlist_empty(channel->send_buffer_list)) {
+        count = 0;
+        dlist_for_each_safe(channel->send_buffer_list, node, temp) {
+            if (count >= SOCKET_MAX_SEGMENTS) {
+                break;
+            }
+            send_buffer = (buffer_t*)dlist_node_get_data(node);
+            ptr[count]  = buffer_get_ptr(send_buffer);
+            size[count] = buffer_get_length(send_buffer);
+            count++;
+        }
+        if (channel->shm) {
+            bytes = shm_write_segments(channel->shm, ptr, size, count);
+        } else {
+            bytes = socket_send_segments(channel->socket_fd, ptr, size, count);
+        }
         if (bytes < 0) {
             return error_send_fail;
         }
-        if (buffer_get_length(send_buffer) > (uint32_t)bytes) {
-            /* δϣbufferȣȴ´η */
-            buffer_adjust(send_buffer, bytes);
-            /* ַ */
-            return error_send_patial;
-        } else {
-            /* ѷͽڵ */
+        i = 0;
+        dlist_for_each_safe(channel->send_buffer_list, node, temp) {
+            if (i++ >= count) {
+                break;
+            }
+            send_buffer = (buffer_t*)dlist_node_get_data(node);
+            if (buffer_get_length(send_buffer) > (uint32_t)bytes) {
+                /* 本次未发送完毕，调整buffer长度，等待下次发送 */
+                buffer_adjust(send_buffer, bytes);
+                /* 部分发送 */
+                return error_send_patial;
+            }
+            /* 销毁已发送节点 */
+            bytes -= (int)buffer_get_length(send_buffer);
             buffer_destroy(send_buffer);
             dlist_delete(channel->send_buffer_list, node);
         }
     }
-    /* ȫ */
+    /* 全部发送 */
     return error_ok;
 }
 
+int channel_expand_recv_ringbuffer(channel_t* channel) {
+    uint32_t size = 0;
+    assert(channel);
+    size = ringbuffer_get_max_size(channel->recv_ringbuffer);
+    if (size >= channel->max_recv_ring_len) {
+        /* 已达到最大长度 */
+        return error_recv_buffer_full;
+    }
+    /* 倍增，不超过最大长度 */
+    if (size > channel->max_recv_ring_len / 2) {
+        size = channel->max_recv_ring_len;
+    } else {
+        size *= 2;
+    }
+    return ringbuffer_resize(channel->recv_ringbuffer, size);
+}
+
 int channel_update_recv(channel_t* channel) {
     int      bytes      = 0;
     int      recv_bytes = 0;
-    uint32_t size       = 0;
-    char*    ptr        = 0;
+    int      count      = 0;
+    uint32_t total      = 0;
+    uint32_t size[2]    = {0};
+    char*    ptr[2]     = {0};
     assert(channel);
-    if (ringbuffer_full(channel->recv_ringbuffer)) {
-        /* ر, , ɸС */
-        return error_recv_buffer_full;
-    }
-    for (; (size = ringbuffer_write_lock_size(channel->recv_ringbuffer));) {
-        ptr = ringbuffer_write_lock_ptr(channel->recv_ringbuffer);
-        bytes = socket_recv(channel->socket_fd, ptr, size);
+    for (;;) {
+        count = ringbuffer_write_lock_segments(channel->recv_ringbuffer, ptr, size);
+        if (!count) {
+            /* 读缓冲区满，尝试扩展 */
+            if (error_ok != channel_expand_recv_ringbuffer(channel)) {
+                /* 已达到最大长度，由调用者暂停读事件, 防攻击, 可根据需求调整大小 */
+                return error_recv_buffer_full;
+            }
+            continue;
+        }
+        if (channel->recv_budget) {
+            /* 不超过剩余预算 */
+            total = channel->recv_budget - (uint32_t)recv_bytes;
+            size[0] = min(size[0], total);
+            if (size[0] == total) {
+                count = 1;
+            } else if (count > 1) {
+                size[1] = min(size[1], total - size[0]);
+            }
+        }
+        total = (count > 1) ? (size[0] + size[1]) : size[0];
+        /* 一次系统调用读入所有可写区域 */
+        if (channel->shm) {
+            bytes = shm_read_segments(channel->shm, ptr, size, count);
+        } else if (channel->inproc) {
+            bytes = inproc_read_segments(channel->inproc, ptr, size, count);
+        } else {
+            bytes = socket_recv_segments(channel->socket_fd, ptr, size, count);
+        }
         if (bytes < 0) {
-            /* 󣬹ر */
+            /* 错误，关闭 */
             return error_recv_fail;
-        } else if (bytes == 0) {
-            /* δյ, ´μ */
-            ringbuffer_write_commit(channel->recv_ringbuffer, 0);
-            return error_ok;
-        } else {
-            recv_bytes += bytes;
-            /* յ */
-            ringbuffer_write_commit(channel->recv_ringbuffer, (uint32_t)bytes);
+        }
+        ringbuffer_write_commit(channel->recv_ringbuffer, (uint32_t)bytes);
+        recv_bytes += bytes;
+        if ((uint32_t)bytes < total) {
+            /* 未填满可写区域，套接字已读空, 下次继续接收 */
+            break;
+        }
+        if (channel->recv_budget && ((uint32_t)recv_bytes >= channel->recv_budget)) {
+            /* 预算用尽，让出给其他管道 */
+            return error_recv_budget;
         }
     }
     if (!recv_bytes) {
-        /* βɽգǹر */
+        /* 本次不能完成接收，非关闭类错误 */
         return error_recv_nothing;
     }
     return error_ok;
@@ -193,6 +523,15 @@ int channel_update_recv(channel_t* channel) {
 
 void channel_close(channel_t* channel) {
     assert(channel);
+    if (channel->shm) {
+        /* 门铃由shm_t关闭 */
+        shm_close(channel->shm);
+        return;
+    }
+    if (channel->inproc) {
+        inproc_close(channel->inproc);
+        return;
+    }
     socket_close(channel->socket_fd);
 }
 
@@ -201,6 +540,16 @@ socket_t channel_get_socket_fd(channel_t* channel) {
     return channel->socket_fd;
 }
 
+shm_t* channel_get_shm(channel_t* channel) {
+    assert(channel);
+    return channel->shm;
+}
+
+inproc_t* channel_get_inproc(channel_t* channel) {
+    assert(channel);
+    return channel->inproc;
+}
+
 ringbuffer_t* channel_get_ringbuffer(channel_t* channel) {
     assert(channel);
     return channel->recv_ringbuffer;
@@ -210,3 +559,43 @@ uint32_t channel_get_max_send_list_len(channel_t* channel) {
     assert(channel);
     return channel->max_send_list_len;
 }
+
+int channel_send_list_empty(channel_t* channel) {
+    assert(channel);
+    return dlist_empty(channel->send_buffer_list);
+}
+
+int channel_send_list_full(channel_t* channel) {
+    assert(channel);
+    if (!channel->max_send_list_len) {
+        /* 不限制 */
+        return 0;
+    }
+    return ((uint32_t)dlist_get_count(channel->send_buffer_list) >= channel->max_send_list_len);
+}
+
+void channel_set_max_recv_ring_len(channel_t* channel, uint32_t max_recv_ring_len) {
+    assert(channel);
+    channel->max_recv_ring_len = max_recv_ring_len;
+}
+
+uint32_t channel_get_max_recv_ring_len(channel_t* channel) {
+    assert(channel);
+    return channel->max_recv_ring_len;
+}
+
+void channel_set_recv_budget(channel_t* channel, uint32_t recv_budget) {
+    assert(channel);
+    channel->recv_budget = recv_budget;
+}
+
+uint32_t channel_get_recv_budget(channel_t* channel) {
+    assert(channel);
+    return channel->recv_budget;
+}
+
+void channel_set_fastopen(channel_t* channel, int qlen) {
+    assert(channel);
+    assert(qlen >= 0);
+    channel->fastopen = qlen;
+}
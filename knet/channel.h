@@ -28,112 +28,249 @@
 #include "config.h"
 
 /*
- * һchannel_tʵ
- * @param max_send_list_len 󳤶
- * @param recv_ring_len ܻ󳤶
- * @return channel_tʵ
+ * 创建一个channel_t实例
+ * @param max_send_list_len 发送链表最大长度
+ * @param recv_ring_len 接受缓冲区最大长度
+ * @return channel_t实例
  */
 channel_t* channel_create(uint32_t max_send_list_len, uint32_t recv_ring_len);
 
 /*
- * һchannel_tʵ
- * socket_fd ѽ׽
- * @param max_send_list_len 󳤶
- * @param recv_ring_len ܻ󳤶
- * @return channel_tʵ
+ * 创建一个channel_t实例
+ * socket_fd 已建立的套接字
+ * @param max_send_list_len 发送链表最大长度
+ * @param recv_ring_len 接受缓冲区最大长度
+ * @return channel_t实例
  */
 channel_t* channel_create_exist_socket_fd(socket_t socket_fd, uint32_t max_send_list_len, uint32_t recv_ring_len);
 
 /*
- * channel_tʵ
- * @param channel_tʵ
+ * 创建一个UDP套接字的channel_t实例
+ * @return channel_t实例
+ */
+channel_t* channel_create_udp();
+
+/*
+ * 创建一个共享内存管道的channel_t实例
+ * 本端门铃作为套接字注册到选取器，读写不经过系统调用
+ * @param shm shm_t实例，所有权转移给管道
+ * @param max_send_list_len 发送链表最大长度
+ * @param recv_ring_len 接受缓冲区最大长度
+ * @return channel_t实例
+ */
+channel_t* channel_create_shm(shm_t* shm, uint32_t max_send_list_len, uint32_t recv_ring_len);
+
+/*
+ * 创建一个进程内管道的channel_t实例
+ * 没有套接字，不注册到选取器，写入的缓冲区直接移入对端读队列
+ * @param inproc inproc_t实例，所有权转移给管道
+ * @param max_send_list_len 发送链表最大长度
+ * @param recv_ring_len 接受缓冲区最大长度
+ * @return channel_t实例
+ */
+channel_t* channel_create_inproc(inproc_t* inproc, uint32_t max_send_list_len, uint32_t recv_ring_len);
+
+/*
+ * 销毁channel_t实例
+ * @param channel_t实例
  */
 void channel_destroy(channel_t* channel);
 
 /*
- * Ӽ
- * @param channel_tʵ
- * @param ip IP
- * @param port ˿
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 连接监听器
+ * @param channel_t实例
+ * @param ip IP，以'/'开头为UNIX域套接字路径，以'@'开头为抽象命名空间（Linux）
+ * @param port 端口，UNIX域套接字忽略
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int channel_connect(channel_t* channel, const char* ip, int port);
 
 /*
- * 
- * @param channel_tʵ
- * @param ip IP
- * @param port ˿
- * @param backlog ȴг
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 使用已解析的套接字地址连接，协议族不是IPv4时替换套接字
+ * @param channel_t实例
+ * @param addr 套接字地址（IPv4，IPv6或UNIX域）
+ * @param len 套接字地址长度
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int channel_connect_addr(channel_t* channel, const struct sockaddr* addr, int len);
+
+/*
+ * 监听
+ * @param channel_t实例
+ * @param ip IP，含有':'的为IPv6（"::"同时接受IPv4），以'/'开头为UNIX域套接字路径，以'@'开头为抽象命名空间（Linux）
+ * @param port 端口，UNIX域套接字忽略
+ * @param backlog 等待队列长度
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int channel_accept(channel_t* channel, const char* ip, int port, int backlog);
 
 /*
- * ر
- * @param channel_tʵ
+ * 绑定本地地址，不监听
+ * IP为IPv6地址时替换为IPv6套接字，绑定"::"时同时接收IPv4数据报
+ * @param channel_t实例
+ * @param ip IP，为0时绑定所有IPv4地址
+ * @param port 端口，为0时由系统分配
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int channel_bind(channel_t* channel, const char* ip, int port);
+
+/*
+ * 关闭
+ * @param channel_t实例
  */
 void channel_close(channel_t* channel);
 
 /*
- * 
- * Ϊյʱ򣬻ȳֱӷ͵׽ֻ(zero copy)ŵĩβȴ
- * ʵʱ.
- * @param channel_tʵ
- * @param data ָ
- * @param size ݳ
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 发送
+ * 当发送链表为空的时候，会首先尝试直接发送到套接字缓冲区(zero copy)，否则会放到发送链表末尾等待
+ * 适当时机发送.
+ * @param channel_t实例
+ * @param data 发送数据指针
+ * @param size 数据长度
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int channel_send(channel_t* channel, const char* data, int size);
 
 /*
- * 
- * ŵĩβȴʵʱ.
- * @param channel_tʵ
- * @param send_buffer ͻbuffer_tʵ
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 发送缓冲区链表
+ * 链表内缓冲区的所有权转移给管道，发送链表为空时尝试立即通过一次系统调用发送
+ * @param channel_t实例
+ * @param chain 缓冲区链表
+ * @retval error_ok 全部发送
+ * @retval error_send_patial 部分发送，需要设置写事件
+ * @retval 其他 失败
+ */
+int channel_send_chain(channel_t* channel, buffer_t* chain);
+
+/*
+ * 聚合发送
+ * 多个不连续的区域通过一次系统调用发送(writev)，未发送完毕的部分合并后放到发送链表末尾
+ * @param channel_t实例
+ * @param ptr 区域起始指针数组
+ * @param size 区域长度数组
+ * @param count 区域数量
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int channel_send_segments(channel_t* channel, const char* ptr[], uint32_t size[], int count);
+
+/*
+ * 发送
+ * 放到发送链表末尾等待适当时机发送.
+ * @param channel_t实例
+ * @param send_buffer 发送缓冲区buffer_t实例，可以是缓冲区链表
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int channel_send_buffer(channel_t* channel, buffer_t* send_buffer);
 
 /*
- * д¼֪ͨ
- * @param channel_tʵ
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 可写事件通知
+ * @param channel_t实例
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int channel_update_send(channel_t* channel);
 
 /*
- * ɶ¼֪ͨ
- * @param channel_tʵ
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 可读事件通知
+ * @param channel_t实例
+ * @retval error_ok 成功
+ * @retval error_recv_budget 已读取到预算上限，套接字内可能还有数据
+ * @retval 其他 失败
  */
 int channel_update_recv(channel_t* channel);
 
 /*
- * ȡ׽
- * @param channel_tʵ
- * @return ׽
+ * 取得套接字
+ * @param channel_t实例
+ * @return 套接字
  */
 socket_t channel_get_socket_fd(channel_t* channel_ref);
 
 /*
- * ȡö
- * @param channel_tʵ
- * @return ringbuffer_tʵ
+ * 取得共享内存
+ * @param channel_t实例
+ * @return shm_t实例，不是共享内存管道时返回0
+ */
+shm_t* channel_get_shm(channel_t* channel);
+
+/*
+ * 取得进程内管道
+ * @param channel_t实例
+ * @return inproc_t实例，不是进程内管道时返回0
+ */
+inproc_t* channel_get_inproc(channel_t* channel);
+
+/*
+ * 取得读缓冲区
+ * @param channel_t实例
+ * @return ringbuffer_t实例
  */
 ringbuffer_t* channel_get_ringbuffer(channel_t* channel);
 
 /*
- * ȡ÷󳤶
- * @param channel_tʵ
- * @return 󳤶
+ * 取得发送链表最大长度限制
+ * @param channel_t实例
+ * @return 发送链表最大长度限制
  */
 uint32_t channel_get_max_send_list_len(channel_t* channel);
 
+/*
+ * 检查发送链表是否为空
+ * @param channel_t实例
+ * @retval 1 为空
+ * @retval 0 有未发送的数据
+ */
+int channel_send_list_empty(channel_t* channel);
+
+/*
+ * 检查发送链表是否已达到最大长度限制
+ * @param channel_t实例
+ * @retval 1 已达到限制
+ * @retval 0 未达到限制或不限制(最大长度为0)
+ */
+int channel_send_list_full(channel_t* channel);
+
+/*
+ * 设置读缓冲区可扩展的最大长度
+ * 读缓冲区满时按倍数扩展，直至达到最大长度
+ * @param channel_t实例
+ * @param max_recv_ring_len 读缓冲区最大长度，小于当前长度时不扩展
+ */
+void channel_set_max_recv_ring_len(channel_t* channel, uint32_t max_recv_ring_len);
+
+/*
+ * 取得读缓冲区可扩展的最大长度
+ * @param channel_t实例
+ * @return 读缓冲区最大长度
+ */
+uint32_t channel_get_max_recv_ring_len(channel_t* channel);
+
+/*
+ * 设置每次读事件最多读取的字节数
+ * @param channel_t实例
+ * @param recv_budget 最多读取的字节数，0为不限制
+ */
+void channel_set_recv_budget(channel_t* channel, uint32_t recv_budget);
+
+/*
+ * 取得每次读事件最多读取的字节数
+ * @param channel_t实例
+ * @return 最多读取的字节数，0为不限制
+ */
+uint32_t channel_get_recv_budget(channel_t* channel);
+
+/*
+ * 设置TCP Fast Open，在channel_accept或channel_connect之前调用
+ * @param channel_t实例
+ * @param qlen 监听时为未完成握手的TFO请求队列长度，连接时非0开启，0关闭
+ */
+void channel_set_fastopen(channel_t* channel, int qlen);
+
 #endif /* CHANNEL_H */
\ No newline at end of file
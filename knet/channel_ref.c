@@ -31,28 +31,56 @@
 #include "buffer.h"
 #include "ringbuffer.h"
 #include "address.h"
+#include "frame.h"
+#include "filter.h"
+#include "crc32c.h"
+#include "http.h"
+#include "resp.h"
+#include "ws.h"
+#include "udp.h"
+#include "shm.h"
+#include "pool.h"
+#include "resolver.h"
 
 typedef struct _channel_ref_info_t {
-    int                      balance;         /* Ƿ񱻸ؾ־ */
-    channel_t*               channel;         /* ڲܵ */
-    dlist_node_t*            loop_node;       /* ܵڵ */
-    stream_t*                stream;          /* ܵ(/д) */
-    loop_t*                  loop;            /* ܵloop_t */
-    address_t*               peer_address;    /* Զ˵ַ */
-    address_t*               local_address;   /* صַ */
-    channel_event_e          event;           /* ܵͶ¼ */
-    volatile channel_state_e state;           /* ܵ״̬ */
-    atomic_counter_t         ref_count;       /* ü */
-    channel_ref_cb_t         cb;              /* ص */
-    time_t                   last_recv_ts;    /* һζʱ룩 */
-    time_t                   timeout;         /* гʱ룩 */
-    time_t                   connect_timeout; /* connect()ʱ룩 */
-    int                      flag;            /* ѡȡʹԶ־λ */
-    void*                    data;            /* ѡȡʹԶ */
+    int                      balance;         /* 是否被负载均衡标志 */
+    channel_t*               channel;         /* 内部管道 */
+    dlist_node_t*            loop_node;       /* 管道链表节点 */
+    dlist_node_t*            ready_node;      /* 就绪链表节点 */
+    stream_t*                stream;          /* 管道(读/写)数据流 */
+    loop_t*                  loop;            /* 管道所关联的loop_t */
+    address_t*               peer_address;    /* 对端地址 */
+    address_t*               local_address;   /* 本地地址 */
+    frame_t*                 frame;           /* 消息分帧器 */
+    filter_t*                in_filter;       /* 读方向过滤器链 */
+    filter_t*                out_filter;      /* 写方向过滤器链 */
+    int                      filter_running;  /* 正在运行的过滤器链层数（过滤函数或回调内可能再次写入），只在loop_t线程内修改 */
+    int                      filter_removed;  /* 运行期间有过滤器被删除，运行结束后销毁 */
+    http_t*                  http;            /* HTTP服务端 */
+    resp_t*                  resp;            /* RESP客户端 */
+    ws_t*                    ws;              /* WebSocket */
+    udp_t*                   udp;             /* UDP数据报收发器 */
+    pool_conn_t*             pool_conn;       /* 所属连接池 */
+    channel_event_e          event;           /* 管道投递事件 */
+    channel_event_e          migrate_event;   /* 迁出时保存的投递事件 */
+    dlist_t*                 migrate_list;    /* 迁移中暂存的跨线程事件 */
+    volatile channel_state_e state;           /* 管道状态 */
+    int                      recv_paused;     /* 读缓冲区已满，读事件暂停 */
+    int                      recv_again;      /* 读缓冲区内未取走的数据需要再次回调 */
+    int                      closing;         /* 发送链表内的数据发送完毕后关闭 */
+    uint32_t                 recv_lowat;      /* 读低水位，可读字节数达到后才回调 */
+    uint32_t                 recv_round;      /* 最后一次读取时loop_t的循环次数 */
+    atomic_counter_t         ref_count;       /* 引用计数 */
+    channel_ref_cb_t         cb;              /* 回调 */
+    time_t                   last_recv_ts;    /* 最后一次读操作时间戳（秒） */
+    time_t                   timeout;         /* 读空闲超时（秒） */
+    time_t                   connect_timeout; /* connect()超时（秒） */
+    int                      flag;            /* 选取器所使用自定义标志位 */
+    void*                    data;            /* 选取器所使用自定义数据 */
 } channel_ref_info_t;
 
 struct _channel_ref_t {
-    channel_ref_info_t* ref_info; /* ܵϢ */
+    channel_ref_info_t* ref_info; /* 管道信息 */
 };
 
 channel_ref_t* channel_ref_create(loop_t* loop, channel_t* channel) {
@@ -72,7 +100,7 @@ channel_ref_t* channel_ref_create(loop_t* loop, channel_t* channel) {
 
 int channel_ref_destroy(channel_ref_t* channel_ref) {
     assert(channel_ref);
-    /* ü */
+    /* 检测引用计数 */
     if (!atomic_counter_zero(&channel_ref->ref_info->ref_count)) {
         return error_ref_nonzero;
     }
@@ -86,8 +114,27 @@ int channel_ref_destroy(channel_ref_t* channel_ref) {
     if (channel_ref->ref_info->local_address) {
         address_destroy(channel_ref->ref_info->local_address);
     }
-    /* ֪ͨѡȡɾܵԴ */
-    impl_remove_channel_ref(channel_ref->ref_info->loop, channel_ref);
+    if (channel_ref->ref_info->frame) {
+        frame_destroy(channel_ref->ref_info->frame);
+    }
+    if (channel_ref->ref_info->http) {
+        http_destroy(channel_ref->ref_info->http);
+    }
+    if (channel_ref->ref_info->resp) {
+        resp_destroy(channel_ref->ref_info->resp);
+    }
+    if (channel_ref->ref_info->ws) {
+        ws_destroy(channel_ref->ref_info->ws);
+    }
+    if (channel_ref->ref_info->udp) {
+        udp_destroy(channel_ref->ref_info->udp);
+    }
+    filter_chain_destroy(channel_ref->ref_info->in_filter);
+    filter_chain_destroy(channel_ref->ref_info->out_filter);
+    if (!channel_get_inproc(channel_ref->ref_info->channel)) {
+        /* 通知选取器删除管道相关资源 */
+        impl_remove_channel_ref(channel_ref->ref_info->loop, channel_ref);
+    }
     channel_destroy(channel_ref->ref_info->channel);
     stream_destroy(channel_ref->ref_info->stream);
     destroy(channel_ref->ref_info);
@@ -96,29 +143,77 @@ int channel_ref_destroy(channel_ref_t* channel_ref) {
 }
 
 int channel_ref_connect(channel_ref_t* channel_ref, const char* ip, int port, int timeout) {
-    loop_t* loop = 0;
+    loop_t*          loop = 0;
+    socket_len_t     len  = 0;
+    socket_address_t addr;
     assert(channel_ref);
-    loop = channel_ref_choose_loop(channel_ref);
+    /* 与接受的连接相同，由负载均衡器选取loop_t，目的IP作为亲和键 */
+    if (ip && socket_check_unix_path(ip)) {
+        loop = channel_ref_choose_loop(channel_ref, ip, (int)strlen(ip));
+    } else {
+        /* 与channel_ref_connect_addr及接受的连接使用相同的二进制地址 */
+        len = ip ? socket_make_address(ip, port, &addr) : 0;
+        loop = channel_ref_choose_loop_addr(channel_ref, len ? &addr.sa : 0, (int)len);
+    }
+    if (!loop) {
+        loop = channel_ref->ref_info->loop;
+    }
+    return channel_ref_connect_in_loop(channel_ref, loop, ip, port, timeout);
+}
+
+int channel_ref_connect_addr(channel_ref_t* channel_ref, const struct sockaddr* addr, int len, int timeout) {
+    int     error = 0;
+    loop_t* loop  = 0;
+    assert(channel_ref);
+    assert(addr);
     if (channel_ref_check_state(channel_ref, channel_state_connect)) {
-        /* Ѿ״̬ */
+        /* 已经处于连接状态 */
         return error_ok;
     }
     if (timeout) {
-        /* óʱʱ */
+        /* 设置超时时间戳 */
         channel_ref->ref_info->connect_timeout = time(0) + timeout;
     }
-    /*  */
-    return channel_ref_connect_in_loop(channel_ref, ip, port);
+    /* 发起连接 */
+    error = channel_connect_addr(channel_ref->ref_info->channel, addr, len);
+    if (error == error_ok) {
+        /* 保留目的地址，取得对端地址时不再调用getpeername */
+        channel_ref_set_peer_sockaddr(channel_ref, addr, len);
+        loop = channel_ref_choose_loop_addr(channel_ref, addr, len);
+        channel_ref_start_connect(channel_ref, loop ? loop : channel_ref->ref_info->loop);
+    }
+    return error;
+}
+
+int channel_ref_connect_host(channel_ref_t* channel_ref, const char* host, int port, int timeout) {
+    socket_address_t addr;
+    socket_len_t     len      = 0;
+    resolver_t*      resolver = 0;
+    assert(channel_ref);
+    assert(host);
+    if (socket_check_unix_path(host)) {
+        return channel_ref_connect(channel_ref, host, port, timeout);
+    }
+    resolver = loop_get_resolver(channel_ref->ref_info->loop);
+    /* IP字符串或缓存命中时直接连接 */
+    len = resolver_get_address(resolver, host, port, &addr);
+    if (len) {
+        return channel_ref_connect_addr(channel_ref, &addr.sa, (int)len, timeout);
+    }
+    if (!resolver) {
+        return error_resolve_fail;
+    }
+    return resolver_connect(resolver, channel_ref, host, port, timeout);
 }
 
 int channel_ref_accept(channel_ref_t* channel_ref, const char* ip, int port, int backlog) {
     int error = 0;
     assert(channel_ref);
     if (channel_ref_check_state(channel_ref, channel_state_accept)) {
-        /* Ѿڼ״̬ */
+        /* 已经处于监听状态 */
         return error_ok;
     }
-    /*  */
+    /* 监听 */
     error = channel_accept(channel_ref->ref_info->channel, ip, port, backlog);
     if (error == error_ok) {
         loop_add_channel_ref(channel_ref->ref_info->loop, channel_ref);
@@ -128,23 +223,43 @@ int channel_ref_accept(channel_ref_t* channel_ref, const char* ip, int port, int
     return error;
 }
 
+int channel_ref_bind(channel_ref_t* channel_ref, const char* ip, int port) {
+    int error = 0;
+    assert(channel_ref);
+    if (!channel_ref->ref_info->udp) {
+        return error_bind_fail;
+    }
+    if (channel_ref_check_state(channel_ref, channel_state_active)) {
+        /* 已经绑定 */
+        return error_ok;
+    }
+    error = channel_bind(channel_ref->ref_info->channel, ip, port);
+    if (error == error_ok) {
+        udp_set_family(channel_ref->ref_info->udp, (ip && strchr(ip, ':')) ? AF_INET6 : AF_INET);
+        loop_add_channel_ref(channel_ref->ref_info->loop, channel_ref);
+        channel_ref_set_state(channel_ref, channel_state_active);
+        channel_ref_set_event(channel_ref, channel_event_recv);
+    }
+    return error;
+}
+
 channel_ref_t* channel_ref_share(channel_ref_t* channel_ref) {
     channel_ref_t* channel_ref_shared = 0;
     assert(channel_ref);
     channel_ref_shared = create(channel_ref_t);
     assert(channel_ref_shared);
-    /* ӹܵü */
+    /* 增加管道引用计数 */
     atomic_counter_inc(&channel_ref->ref_info->ref_count);
-    /* ܵϢָ */
+    /* 共享管道信息指针 */
     channel_ref_shared->ref_info = channel_ref->ref_info;
     return channel_ref_shared;
 }
 
 void channel_ref_leave(channel_ref_t* channel_ref) {
     assert(channel_ref);
-    /* ݼü */
+    /* 递减引用计数 */
     atomic_counter_dec(&channel_ref->ref_info->ref_count);
-    /* ܵϢloop_t */
+    /* 管道信息最终由loop_t销毁 */
     destroy(channel_ref);
 }
 
@@ -154,33 +269,92 @@ void channel_ref_update_close_in_loop(loop_t* loop, channel_ref_t* channel_ref)
     if (channel_ref_check_state(channel_ref, channel_state_close)) {
         return;
     }
+    if (channel_get_shm(channel_ref->ref_info->channel)) {
+        /* 对端持有本端门铃，关闭后不会自动从选取器内删除 */
+        impl_remove_channel_ref(loop, channel_ref);
+    }
     channel_ref_set_state(channel_ref, channel_state_close);
     channel_ref_clear_event(channel_ref, channel_event_recv | channel_event_send);
     channel_close(channel_ref->ref_info->channel);
+    /* 从就绪链表内删除 */
+    loop_remove_ready_channel_ref(channel_ref->ref_info->loop, channel_ref);
+    if (channel_get_inproc(channel_ref->ref_info->channel)) {
+        /* 关闭后对端不再投递，删除已投递的通知 */
+        loop_cancel_ready_channel_ref(loop, channel_ref);
+        if (!channel_ref->ref_info->loop_node) {
+            /* 尚未加入活跃链表 */
+            loop_add_channel_ref(loop, channel_ref);
+        }
+    }
+    if (channel_ref->ref_info->resp) {
+        /* 未收到应答的命令以空应答回调 */
+        resp_abort(channel_ref->ref_info->resp, channel_ref);
+    }
+    if (channel_ref->ref_info->pool_conn) {
+        /* 与连接池分离 */
+        pool_conn_close(channel_ref->ref_info->pool_conn);
+    }
     if (channel_ref->ref_info->cb) {
         channel_ref->ref_info->cb(channel_ref, channel_cb_event_close);
     }
     loop_close_channel_ref(channel_ref->ref_info->loop, channel_ref);
 }
 
+/*
+ * 检查是否需要转到管道所属线程处理
+ * 迁入中的管道尚未注册到目标loop_t，目标线程内的写入及关闭也要排在暂存事件之后
+ */
+static int channel_ref_check_notify(channel_ref_t* channel_ref) {
+    return (loop_get_thread_id(channel_ref->ref_info->loop) != thread_get_self_id()) ||
+           channel_ref->ref_info->migrate_list;
+}
+
+/*
+ * 读缓冲区内有数据时放入就绪链表，下次循环即使没有读到新数据也回调
+ */
+static void channel_ref_recv_again(channel_ref_t* channel_ref) {
+    if (!ringbuffer_available(channel_ref_get_ringbuffer(channel_ref))) {
+        return;
+    }
+    channel_ref->ref_info->recv_again = 1;
+    loop_add_ready_channel_ref(channel_ref->ref_info->loop, channel_ref);
+}
+
 void channel_ref_close(channel_ref_t* channel_ref) {
     loop_t* loop = 0;
     assert(channel_ref);
     loop = channel_ref->ref_info->loop;
-    if (loop_get_thread_id(loop) != thread_get_self_id()) {
-        /* ֪ͨܵ߳ */
+    if (channel_ref_check_notify(channel_ref)) {
+        /* 通知管道所属线程 */
         loop_notify_close(loop, channel_ref);
     } else {
-        /* ߳ڹر */
+        /* 本线程内关闭 */
         channel_ref_update_close_in_loop(loop, channel_ref);
     }
 }
 
+void channel_ref_close_after_send(channel_ref_t* channel_ref) {
+    assert(channel_ref);
+    if (channel_send_list_empty(channel_ref->ref_info->channel) &&
+        (!channel_ref->ref_info->udp || udp_send_empty(channel_ref->ref_info->udp))) {
+        channel_ref_close(channel_ref);
+        return;
+    }
+    /* 不再读取，等待发送完毕 */
+    channel_ref->ref_info->closing = 1;
+    channel_ref_clear_event(channel_ref, channel_event_recv);
+}
+
 void channel_ref_update_send_in_loop(loop_t* loop, channel_ref_t* channel_ref, buffer_t* send_buffer) {
     int error = 0;
     assert(loop);
     assert(channel_ref);
     assert(send_buffer);
+    if (channel_ref->ref_info->udp) {
+        /* 其他线程打包的数据报 */
+        channel_ref_queue_datagram(channel_ref, send_buffer);
+        return;
+    }
     error = channel_send_buffer(channel_ref->ref_info->channel, send_buffer);
     switch (error) {
     case error_send_patial:
@@ -194,6 +368,69 @@ void channel_ref_update_send_in_loop(loop_t* loop, channel_ref_t* channel_ref, b
     }
 }
 
+int channel_ref_queue_send(channel_ref_t* channel_ref, buffer_t* send_buffer) {
+    int empty = 0;
+    assert(channel_ref);
+    assert(send_buffer);
+    if (channel_send_list_full(channel_ref->ref_info->channel)) {
+        /* 对端不读取导致发送链表堆积，与发送失败一样关闭管道 */
+        buffer_chain_destroy(send_buffer);
+        channel_ref_close(channel_ref);
+        return error_send_fail;
+    }
+    empty = channel_send_list_empty(channel_ref->ref_info->channel);
+    channel_send_buffer(channel_ref->ref_info->channel, send_buffer);
+    if (empty) {
+        /* 发送链表不为空时写事件已经投递，不必重复投递 */
+        channel_ref_set_event(channel_ref, channel_event_send);
+    }
+    return error_ok;
+}
+
+int channel_ref_queue_datagram(channel_ref_t* channel_ref, buffer_t* datagram) {
+    int empty = 0;
+    assert(channel_ref);
+    assert(datagram);
+    if (!channel_ref_check_state(channel_ref, channel_state_active)) {
+        buffer_destroy(datagram);
+        return error_send_fail;
+    }
+    empty = udp_send_empty(channel_ref->ref_info->udp);
+    if (error_ok != udp_queue(channel_ref->ref_info->udp, datagram)) {
+        return error_udp_queue_full;
+    }
+    if (empty) {
+        /* 同一次循环内放入队列的数据报在写事件触发时批量发送 */
+        channel_ref_set_event(channel_ref, channel_event_send);
+    }
+    return error_ok;
+}
+
+int channel_ref_sendto(channel_ref_t* channel_ref, const char* data, uint32_t size, const char* ip, int port) {
+    loop_t*   loop     = 0;
+    buffer_t* datagram = 0;
+    assert(channel_ref);
+    assert(ip);
+    if (!channel_ref->ref_info->udp || (size > UDP_MAX_PAYLOAD)) {
+        return error_send_fail;
+    }
+    if (!channel_ref_check_state(channel_ref, channel_state_active)) {
+        /* 未绑定或已关闭 */
+        return error_send_fail;
+    }
+    datagram = udp_pack(channel_ref->ref_info->udp, data, size, ip, port);
+    if (!datagram) {
+        return error_udp_address;
+    }
+    loop = channel_ref->ref_info->loop;
+    if (channel_ref_check_notify(channel_ref)) {
+        /* 转到loop所在线程发送 */
+        loop_notify_send(loop, channel_ref, datagram);
+        return error_ok;
+    }
+    return channel_ref_queue_datagram(channel_ref, datagram);
+}
+
 int channel_ref_write(channel_ref_t* channel_ref, const char* data, int size) {
     loop_t*   loop        = 0;
     buffer_t* send_buffer = 0;
@@ -202,13 +439,13 @@ int channel_ref_write(channel_ref_t* channel_ref, const char* data, int size) {
     assert(data);
     assert(size);
     loop = channel_ref->ref_info->loop;
-    if (loop_get_thread_id(loop) != thread_get_self_id()) {
-        /* תloop̷߳ */
+    if (channel_ref_check_notify(channel_ref)) {
+        /* 转到loop所在线程发送 */
         send_buffer = buffer_create(size);
         buffer_put(send_buffer, data, size);
         loop_notify_send(loop, channel_ref, send_buffer);
     } else {
-        /* ǰ̷߳ */
+        /* 当前线程发送 */
         error = channel_send(channel_ref->ref_info->channel, data, size);
         switch (error) {
         case error_send_patial:
@@ -224,6 +461,324 @@ int channel_ref_write(channel_ref_t* channel_ref, const char* data, int size) {
     return error;
 }
 
+int channel_ref_write_segments(channel_ref_t* channel_ref, const char* ptr[], uint32_t size[], int count) {
+    loop_t*   loop        = 0;
+    buffer_t* send_buffer = 0;
+    uint32_t  total       = 0;
+    int       i           = 0;
+    int       error       = error_ok;
+    assert(channel_ref);
+    assert(ptr);
+    assert(size);
+    loop = channel_ref->ref_info->loop;
+    if (channel_ref_check_notify(channel_ref)) {
+        /* 合并后转到loop所在线程发送 */
+        for (; i < count; i++) {
+            total += size[i];
+        }
+        send_buffer = buffer_create(total);
+        for (i = 0; i < count; i++) {
+            if (size[i]) {
+                buffer_put(send_buffer, ptr[i], size[i]);
+            }
+        }
+        loop_notify_send(loop, channel_ref, send_buffer);
+    } else {
+        /* 当前线程发送 */
+        error = channel_send_segments(channel_ref->ref_info->channel, ptr, size, count);
+        switch (error) {
+        case error_send_patial:
+            channel_ref_set_event(channel_ref, channel_event_send);
+            break;
+        case error_send_fail:
+            channel_ref_close(channel_ref);
+            break;
+        default:
+            break;
+        }
+    }
+    return error;
+}
+
+int channel_ref_set_frame(channel_ref_t* channel_ref, frame_type_e type, int big_endian, uint32_t max_size, channel_ref_frame_cb_t cb) {
+    channel_t* channel = 0;
+    assert(channel_ref);
+    assert(cb);
+    if ((type != frame_type_2) && (type != frame_type_4) && (type != frame_type_8) && (type != frame_type_varint)) {
+        return error_frame_invalid;
+    }
+    if ((max_size > FRAME_MAX_SIZE) || ((type == frame_type_2) && (max_size > 0xffff))) {
+        /* 整个消息的长度必须能用uint32_t表示，2字节长度头不能表示更长的消息体 */
+        return error_frame_too_large;
+    }
+    channel = channel_ref->ref_info->channel;
+    if (channel_ref->ref_info->frame) {
+        frame_destroy(channel_ref->ref_info->frame);
+    }
+    channel_ref->ref_info->frame = frame_create(type, big_endian, max_size, cb);
+    /* 读缓冲区至少能容纳一个最大长度的消息 */
+    if (channel_get_max_recv_ring_len(channel) < max_size + FRAME_MAX_HEADER_SIZE + FRAME_CHECKSUM_SIZE) {
+        channel_set_max_recv_ring_len(channel, max_size + FRAME_MAX_HEADER_SIZE + FRAME_CHECKSUM_SIZE);
+    }
+    channel_ref_set_recv_lowat(channel_ref, frame_get_min_header_size(channel_ref->ref_info->frame));
+    return error_ok;
+}
+
+int channel_ref_set_frame_checksum(channel_ref_t* channel_ref, int checksum) {
+    assert(channel_ref);
+    if (!channel_ref->ref_info->frame) {
+        return error_frame_invalid;
+    }
+    frame_set_checksum(channel_ref->ref_info->frame, checksum);
+    return error_ok;
+}
+
+int channel_ref_write_frame(channel_ref_t* channel_ref, const char* data, uint32_t size) {
+    char        header[FRAME_MAX_HEADER_SIZE + FRAME_CHECKSUM_SIZE];
+    const char* ptr[2]  = {0};
+    uint32_t    len[2]  = {0};
+    frame_t*    frame   = 0;
+    buffer_t*   chain   = 0;
+    assert(channel_ref);
+    frame = channel_ref->ref_info->frame;
+    if (!frame) {
+        return error_frame_invalid;
+    }
+    if (channel_ref->ref_info->out_filter) {
+        /* 拷贝一次后交给过滤器链 */
+        chain = buffer_create(size ? size : 1);
+        if (size) {
+            buffer_put(chain, data, size);
+        }
+        return channel_ref_write_frame_buffer(channel_ref, chain);
+    }
+    if (size > frame_get_max_size(frame)) {
+        return error_frame_too_large;
+    }
+    /* 长度头和消息体一次发送 */
+    ptr[0] = header;
+    len[0] = frame_encode_header(frame, header, size);
+    if (frame_get_checksum(frame)) {
+        len[0] += frame_encode_checksum(frame, header + len[0], crc32c_update(0, data, size));
+    }
+    ptr[1] = data;
+    len[1] = size;
+    return channel_ref_write_segments(channel_ref, ptr, len, size ? 2 : 1);
+}
+
+/*
+ * 销毁过滤器链内已标记删除的过滤器
+ */
+static void channel_ref_purge_filter(filter_t** head) {
+    filter_t* prev   = 0;
+    filter_t* filter = *head;
+    filter_t* next   = 0;
+    for (; filter; filter = next) {
+        next = filter_get_next(filter);
+        if (!filter_check_removed(filter)) {
+            prev = filter;
+            continue;
+        }
+        if (prev) {
+            filter_set_next(prev, next);
+        } else {
+            *head = next;
+        }
+        filter_destroy(filter);
+    }
+}
+
+/*
+ * 运行过滤器链
+ * 过滤函数或分帧回调内删除的过滤器可能仍在调用栈上，最外层运行结束后才销毁
+ */
+static int channel_ref_run_filter(channel_ref_t* channel_ref, filter_t* filter, buffer_t* chain) {
+    int error = error_ok;
+    channel_ref->ref_info->filter_running++;
+    error = filter_run(filter, channel_ref, chain);
+    channel_ref->ref_info->filter_running--;
+    if (!channel_ref->ref_info->filter_running && channel_ref->ref_info->filter_removed) {
+        channel_ref->ref_info->filter_removed = 0;
+        channel_ref_purge_filter(&channel_ref->ref_info->in_filter);
+        channel_ref_purge_filter(&channel_ref->ref_info->out_filter);
+    }
+    return error;
+}
+
+/*
+ * 在loop_t线程内经过写方向过滤器链后发送
+ */
+static int channel_ref_write_frame_in_loop(channel_ref_t* channel_ref, buffer_t* chain) {
+    int error = error_ok;
+    if (channel_ref->ref_info->out_filter) {
+        error = channel_ref_run_filter(channel_ref, channel_ref->ref_info->out_filter, chain);
+    } else {
+        error = channel_ref_filter_done(channel_ref, filter_dir_out, chain);
+    }
+    if ((error != error_ok) && (error != error_send_patial) && (error != error_frame_too_large)) {
+        channel_ref_close(channel_ref);
+    }
+    return error;
+}
+
+int channel_ref_write_frame_buffer(channel_ref_t* channel_ref, buffer_t* chain) {
+    assert(channel_ref);
+    assert(chain);
+    if (!channel_ref->ref_info->frame) {
+        buffer_chain_destroy(chain);
+        return error_frame_invalid;
+    }
+    if (channel_ref->ref_info->out_filter && channel_ref_check_notify(channel_ref)) {
+        /* 过滤器链只在loop_t线程内运行，转到loop所在线程 */
+        loop_notify_send_frame(channel_ref->ref_info->loop, channel_ref, chain);
+        return error_ok;
+    }
+    return channel_ref_write_frame_in_loop(channel_ref, chain);
+}
+
+void channel_ref_update_send_frame_in_loop(loop_t* loop, channel_ref_t* channel_ref, buffer_t* chain) {
+    assert(loop);
+    assert(channel_ref);
+    assert(chain);
+    if (channel_ref_check_state(channel_ref, channel_state_close)) {
+        buffer_chain_destroy(chain);
+        return;
+    }
+    channel_ref_write_frame_in_loop(channel_ref, chain);
+}
+
+filter_t* channel_ref_add_filter(channel_ref_t* channel_ref, filter_dir_e dir, const char* name, filter_func_t func, void* data) {
+    filter_t** head   = 0;
+    filter_t*  last   = 0;
+    filter_t*  filter = 0;
+    assert(channel_ref);
+    assert(name);
+    assert(func);
+    head = (dir == filter_dir_in) ? &channel_ref->ref_info->in_filter : &channel_ref->ref_info->out_filter;
+    filter = filter_create(dir, name, func, data);
+    if (!*head) {
+        *head = filter;
+        return filter;
+    }
+    /* 添加到过滤器链末尾 */
+    for (last = *head; filter_get_next(last); last = filter_get_next(last));
+    filter_set_next(last, filter);
+    return filter;
+}
+
+int channel_ref_remove_filter(channel_ref_t* channel_ref, filter_dir_e dir, const char* name) {
+    filter_t** head   = 0;
+    filter_t*  prev   = 0;
+    filter_t*  filter = 0;
+    assert(channel_ref);
+    assert(name);
+    head = (dir == filter_dir_in) ? &channel_ref->ref_info->in_filter : &channel_ref->ref_info->out_filter;
+    for (filter = *head; filter; prev = filter, filter = filter_get_next(filter)) {
+        if (filter_check_removed(filter) || strcmp(filter_get_name(filter), name)) {
+            continue;
+        }
+        if (channel_ref->ref_info->filter_running) {
+            /* 过滤器可能仍在调用栈上，运行结束后销毁 */
+            filter_set_removed(filter);
+            channel_ref->ref_info->filter_removed = 1;
+            return error_ok;
+        }
+        if (prev) {
+            filter_set_next(prev, filter_get_next(filter));
+        } else {
+            *head = filter_get_next(filter);
+        }
+        filter_destroy(filter);
+        return error_ok;
+    }
+    return error_fail;
+}
+
+int channel_ref_dispatch_frame(channel_ref_t* channel_ref, const char* data, uint32_t size) {
+    buffer_t* chain = 0;
+    assert(channel_ref);
+    assert(channel_ref->ref_info->frame);
+    if (!channel_ref->ref_info->in_filter) {
+        /* 没有过滤器，直接回调 */
+        frame_get_cb(channel_ref->ref_info->frame)(channel_ref, data, size);
+        return error_ok;
+    }
+    /* 拷贝一次后交给过滤器链 */
+    chain = buffer_create(size ? size : 1);
+    if (size) {
+        buffer_put(chain, data, size);
+    }
+    return channel_ref_run_filter(channel_ref, channel_ref->ref_info->in_filter, chain);
+}
+
+int channel_ref_filter_done(channel_ref_t* channel_ref, filter_dir_e dir, buffer_t* chain) {
+    buffer_t* header = 0;
+    buffer_t* temp   = 0;
+    uint32_t  size   = 0;
+    frame_t*  frame  = 0;
+    assert(channel_ref);
+    assert(chain);
+    frame = channel_ref->ref_info->frame;
+    assert(frame);
+    size = buffer_chain_get_length(chain);
+    if (dir == filter_dir_in) {
+        if (!buffer_get_next(chain)) {
+            frame_get_cb(frame)(channel_ref, buffer_get_ptr(chain), size);
+        } else {
+            /* 多个缓冲区合并后回调 */
+            temp = buffer_create(size ? size : 1);
+            for (header = chain; header; header = buffer_get_next(header)) {
+                if (buffer_get_length(header)) {
+                    buffer_put(temp, buffer_get_ptr(header), buffer_get_length(header));
+                }
+            }
+            frame_get_cb(frame)(channel_ref, buffer_get_ptr(temp), size);
+            buffer_destroy(temp);
+        }
+        buffer_chain_destroy(chain);
+        return error_ok;
+    }
+    if (size > frame_get_max_size(frame)) {
+        buffer_chain_destroy(chain);
+        return error_frame_too_large;
+    }
+    /* 长度头作为链表内第一个缓冲区，整个链表通过一次系统调用发送 */
+    header = buffer_create(FRAME_MAX_HEADER_SIZE + FRAME_CHECKSUM_SIZE);
+    buffer_commit(header, frame_encode_header(frame, buffer_get_write_ptr(header), size));
+    if (frame_get_checksum(frame)) {
+        /* 逐个缓冲区增量计算，不拷贝 */
+        buffer_commit(header, frame_encode_checksum(frame, buffer_get_write_ptr(header),
+            crc32c_update_buffer_chain(0, chain)));
+    }
+    buffer_set_next(header, chain);
+    return channel_ref_write_chain(channel_ref, header);
+}
+
+int channel_ref_write_chain(channel_ref_t* channel_ref, buffer_t* chain) {
+    loop_t* loop  = 0;
+    int     error = error_ok;
+    assert(channel_ref);
+    assert(chain);
+    loop = channel_ref->ref_info->loop;
+    if (channel_ref_check_notify(channel_ref)) {
+        /* 转到loop所在线程发送 */
+        loop_notify_send(loop, channel_ref, chain);
+        return error_ok;
+    }
+    error = channel_send_chain(channel_ref->ref_info->channel, chain);
+    switch (error) {
+    case error_send_patial:
+        channel_ref_set_event(channel_ref, channel_event_send);
+        break;
+    case error_send_fail:
+        channel_ref_close(channel_ref);
+        break;
+    default:
+        break;
+    }
+    return error;
+}
+
 socket_t channel_ref_get_socket_fd(channel_ref_t* channel_ref) {
     assert(channel_ref);
     return channel_get_socket_fd(channel_ref->ref_info->channel);
@@ -240,7 +795,7 @@ loop_t* channel_ref_get_loop(channel_ref_t* channel_ref) {
 }
 
 void channel_ref_set_loop_node(channel_ref_t* channel_ref, dlist_node_t* node) {
-    assert(channel_ref); /* nodeΪ0 */
+    assert(channel_ref); /* node可以为0 */
     channel_ref->ref_info->loop_node = node;
 }
 
@@ -249,8 +804,31 @@ dlist_node_t* channel_ref_get_loop_node(channel_ref_t* channel_ref) {
     return channel_ref->ref_info->loop_node;
 }
 
+void channel_ref_set_ready_node(channel_ref_t* channel_ref, dlist_node_t* node) {
+    assert(channel_ref); /* node可以为0 */
+    channel_ref->ref_info->ready_node = node;
+}
+
+dlist_node_t* channel_ref_get_ready_node(channel_ref_t* channel_ref) {
+    assert(channel_ref);
+    return channel_ref->ref_info->ready_node;
+}
+
+uint32_t channel_ref_get_recv_round(channel_ref_t* channel_ref) {
+    assert(channel_ref);
+    return channel_ref->ref_info->recv_round;
+}
+
 void channel_ref_set_event(channel_ref_t* channel_ref, channel_event_e e) {
     assert(channel_ref);
+    if (channel_get_inproc(channel_ref->ref_info->channel)) {
+        /* 没有写事件，发送链表立即移入对端读队列，对端已关闭时由读事件关闭 */
+        if (e & channel_event_send) {
+            channel_update_send(channel_ref->ref_info->channel);
+        }
+        channel_ref->ref_info->event |= (e & channel_event_recv);
+        return;
+    }
     impl_event_add(channel_ref, e);
     channel_ref->ref_info->event |= e;
 }
@@ -262,7 +840,14 @@ channel_event_e channel_ref_get_event(channel_ref_t* channel_ref) {
 
 void channel_ref_clear_event(channel_ref_t* channel_ref, channel_event_e e) {
     assert(channel_ref);
-    impl_event_remove(channel_ref, e);
+    if (channel_get_shm(channel_ref->ref_info->channel)) {
+        /*
+         * 门铃同时用于通知有数据可读和写环有空间，暂停读取或等待发送完毕时仍需要唤醒，
+         * 保持在选取器内注册，只清除标志，关闭时由channel_ref_update_close_in_loop删除
+         */
+    } else if (!channel_get_inproc(channel_ref->ref_info->channel)) {
+        impl_event_remove(channel_ref, e);
+    }
     channel_ref->ref_info->event &= ~e;
 }
 
@@ -287,10 +872,22 @@ channel_ref_t* channel_ref_accept_from_socket_fd(channel_ref_t* channel_ref, loo
     uint32_t       max_ringbuffer_size = ringbuffer_get_max_size(channel_get_ringbuffer(acceptor_channel));
     channel_t*     client_channel      = channel_create_exist_socket_fd(client_fd, max_send_list_len, max_ringbuffer_size);
     channel_ref_t* client_ref          = channel_ref_create(loop, client_channel);
+    /* 继承读缓冲区最大长度和读预算 */
+    channel_set_max_recv_ring_len(client_channel, channel_get_max_recv_ring_len(acceptor_channel));
+    channel_set_recv_budget(client_channel, channel_get_recv_budget(acceptor_channel));
+    if (channel_ref->ref_info->http) {
+        /* 继承HTTP设置 */
+        client_ref->ref_info->http = http_clone(channel_ref->ref_info->http);
+    }
+    if (channel_ref->ref_info->frame) {
+        /* 继承分帧设置 */
+        client_ref->ref_info->frame = frame_clone(channel_ref->ref_info->frame);
+        client_ref->ref_info->recv_lowat = frame_get_min_header_size(client_ref->ref_info->frame);
+    }
     if (event) {
-        /* ӵǰ߳loop */
+        /* 添加到当前线程loop */
         loop_add_channel_ref(channel_ref->ref_info->loop, client_ref);
-        /* ͬʱ¼״̬ */
+        /* 创建的同时设置事件和状态 */
         channel_ref_set_state(client_ref, channel_state_active);
         channel_ref_set_event(client_ref, channel_event_recv);
     }
@@ -298,29 +895,35 @@ channel_ref_t* channel_ref_accept_from_socket_fd(channel_ref_t* channel_ref, loo
 }
 
 void channel_ref_update_accept(channel_ref_t* channel_ref) {
-    channel_ref_t* client_ref = 0;
-    loop_t*        loop       = 0;
-    socket_t       client_fd  = 0;
+    channel_ref_t*   client_ref = 0;
+    loop_t*          loop       = 0;
+    socket_t         client_fd  = 0;
+    socket_len_t     len        = 0;
+    socket_address_t addr;
     assert(channel_ref);
-    /* 鿴ѡȡǷԶʵ */
+    /* 查看选取器是否有自定义实现 */
     client_fd = impl_channel_accept(channel_ref);
     if (!client_fd) {
-        /* Ĭʵ */
-        client_fd = socket_accept(channel_get_socket_fd(channel_ref->ref_info->channel));
+        /* 默认实现，同时取得对端地址 */
+        client_fd = socket_accept(channel_get_socket_fd(channel_ref->ref_info->channel), &addr, &len);
     }
     channel_ref_set_state(channel_ref, channel_state_accept);
     channel_ref_set_event(channel_ref, channel_event_recv);
     if (client_fd) {
-        loop = channel_ref_choose_loop(channel_ref);
+        loop = channel_ref_choose_loop_addr(channel_ref, len ? &addr.sa : 0, (int)len);
         if (loop) {
             client_ref = channel_ref_accept_from_socket_fd(channel_ref, loop, client_fd, 0);
-            /* ûص */
+            channel_ref_set_peer_sockaddr(client_ref, &addr.sa, (int)len);
+            /* 设置回调 */
             channel_ref_set_cb(client_ref, channel_ref->ref_info->cb);
-            /* ӵloop */
+            /* 添加到其他loop */
             loop_notify_accept(loop, client_ref);
         } else {
             client_ref = channel_ref_accept_from_socket_fd(channel_ref, channel_ref->ref_info->loop, client_fd, 1);
-            /* ûص */
+            channel_ref_set_peer_sockaddr(client_ref, &addr.sa, (int)len);
+            /* 与添加到其他loop的连接相同，继承监听管道的回调 */
+            channel_ref_set_cb(client_ref, channel_ref->ref_info->cb);
+            /* 调用回调 */
             if (channel_ref->ref_info->cb) {
                 channel_ref->ref_info->cb(client_ref, channel_cb_event_accept);
             }
@@ -331,56 +934,220 @@ void channel_ref_update_accept(channel_ref_t* channel_ref) {
 void channel_ref_update_accept_in_loop(loop_t* loop, channel_ref_t* channel_ref) {
     assert(loop);
     assert(channel_ref);
-    /* ӵǰ߳loop */
+    /* 添加到当前线程loop */
     loop_add_channel_ref(loop, channel_ref);
     channel_ref_set_state(channel_ref, channel_state_active);
     channel_ref_set_event(channel_ref, channel_event_recv);
-    /* ûص */
+    /* 调用回调 */
     if (channel_ref->ref_info->cb) {
         channel_ref->ref_info->cb(channel_ref, channel_cb_event_accept);
     }
 }
 
 void channel_ref_update_connect(channel_ref_t* channel_ref) {  
+    if (socket_get_error(channel_get_socket_fd(channel_ref->ref_info->channel))) {
+        /* 连接失败（被拒绝或不可达）同样触发写事件，不能当作连接完成 */
+        channel_ref_close(channel_ref);
+        return;
+    }
     channel_ref_set_event(channel_ref, channel_event_recv);
     channel_ref_set_state(channel_ref, channel_state_active);
-    /* ûص */
+    if (channel_ref->ref_info->ws) {
+        /* 发送WebSocket握手请求 */
+        if (error_ok != ws_start(channel_ref->ref_info->ws, channel_ref)) {
+            channel_ref_close(channel_ref);
+            return;
+        }
+    }
+    /* 调用回调 */
     if (channel_ref->ref_info->cb) {
         channel_ref->ref_info->cb(channel_ref, channel_cb_event_connect);
     }
 }
 
 void channel_ref_update_recv(channel_ref_t* channel_ref) {
-    int error = 0;
+    int    error = 0;
+    shm_t* shm   = 0;
     assert(channel_ref);
+    /* 记录本次循环已读取，在就绪链表内时不再给第二次读预算 */
+    channel_ref->ref_info->recv_round = loop_get_round(channel_ref->ref_info->loop);
+    if (channel_ref->ref_info->udp) {
+        channel_ref_update_recv_udp(channel_ref);
+        return;
+    }
     error = channel_update_recv(channel_ref->ref_info->channel);
+    if ((error == error_recv_nothing) && channel_ref->ref_info->recv_again) {
+        /* 没有新数据，仍回调读缓冲区内已有的数据 */
+        error = error_ok;
+    }
+    channel_ref->ref_info->recv_again = 0;
     switch (error) {
         case error_recv_fail:
             channel_ref_close(channel_ref);
             break;
         case error_recv_buffer_full:
+            /* 读缓冲区已达到最大长度，暂停读事件，由TCP流量控制限制对端发送 */
+            channel_ref_pause_recv(channel_ref);
+            break;
+        case error_recv_budget:
+            /* 读预算用尽，放入就绪链表，下次循环继续读取 */
+            loop_add_ready_channel_ref(channel_ref->ref_info->loop, channel_ref);
+            break;
+        default:
+            break;
+    }
+    shm = channel_get_shm(channel_ref->ref_info->channel);
+    if ((error == error_ok) || (error == error_recv_buffer_full) || (error == error_recv_budget)) {
+        /* 读缓冲区满时无论是否达到低水位都回调 */
+        channel_ref_notify_recv(channel_ref, error == error_recv_buffer_full);
+        if (!channel_ref->ref_info->recv_paused && !channel_ref->ref_info->ready_node &&
+            !channel_ref->ref_info->closing) {
+            if (!shm || !channel_ref_check_event(channel_ref, channel_event_recv)) {
+                /* 共享内存管道的门铃保持注册，不必重新投递 */
+                channel_ref_set_event(channel_ref, channel_event_recv);
+            }
+        }
+    }
+    if (shm && shm_check_polling(shm) && !channel_ref->ref_info->recv_paused && !channel_ref->ref_info->closing &&
+        channel_ref_check_state(channel_ref, channel_state_active)) {
+        /* 轮询共享内存，放入就绪链表，下次循环继续读取 */
+        loop_add_ready_channel_ref(channel_ref->ref_info->loop, channel_ref);
+    }
+}
+
+void channel_ref_update_recv_udp(channel_ref_t* channel_ref) {
+    assert(channel_ref);
+    switch (udp_update_recv(channel_ref->ref_info->udp, channel_ref)) {
+        case error_recv_fail:
             channel_ref_close(channel_ref);
             break;
+        case error_recv_budget:
+            /* 读取次数用尽，放入就绪链表，下次循环继续读取 */
+            loop_add_ready_channel_ref(channel_ref->ref_info->loop, channel_ref);
+            break;
         default:
+            /* 边沿触发，读事件保持注册，不必重新投递 */
             break;
     }
-    if (error == error_ok) {
-        if (channel_ref->ref_info->cb) {
-            channel_ref->ref_info->cb(channel_ref, channel_cb_event_recv);
+}
+
+void channel_ref_notify_recv(channel_ref_t* channel_ref, int force) {
+    ringbuffer_t* rb        = 0;
+    uint32_t      available = 0;
+    uint32_t      lowat     = 0;
+    assert(channel_ref);
+    rb = channel_ref_get_ringbuffer(channel_ref);
+    if (channel_ref->ref_info->http) {
+        /* 解析出完整请求后回调 */
+        if (force || (ringbuffer_available(rb) >= channel_ref->ref_info->recv_lowat)) {
+            if (error_ok != http_update_recv(channel_ref->ref_info->http, channel_ref)) {
+                channel_ref_close(channel_ref);
+            }
         }
-        channel_ref_set_event(channel_ref, channel_event_recv);
+        if (!channel_ref->ref_info->ws || channel_ref_check_state(channel_ref, channel_state_close)) {
+            return;
+        }
+        /* 请求回调内已切换为WebSocket，剩余数据按帧处理 */
+        http_destroy(channel_ref->ref_info->http);
+        channel_ref->ref_info->http = 0;
+        force = 1;
+    }
+    if (channel_ref->ref_info->ws) {
+        /* 收齐完整消息后回调 */
+        if (force || (ringbuffer_available(rb) >= channel_ref->ref_info->recv_lowat)) {
+            if (error_ok != ws_update_recv(channel_ref->ref_info->ws, channel_ref)) {
+                channel_ref_close(channel_ref);
+            }
+        }
+        return;
+    }
+    if (channel_ref->ref_info->resp) {
+        /* 收齐完整应答后按命令顺序回调 */
+        if (force || (ringbuffer_available(rb) >= channel_ref->ref_info->recv_lowat)) {
+            if (error_ok != resp_update_recv(channel_ref->ref_info->resp, channel_ref)) {
+                channel_ref_close(channel_ref);
+            }
+        }
+        return;
+    }
+    if (channel_ref->ref_info->frame) {
+        /* 分帧器自行维护读低水位并回调完整的消息 */
+        if (force || (ringbuffer_available(rb) >= channel_ref->ref_info->recv_lowat)) {
+            if (error_ok != frame_update_recv(channel_ref->ref_info->frame, channel_ref)) {
+                channel_ref_close(channel_ref);
+            }
+        }
+        return;
+    }
+    while (channel_ref->ref_info->cb) {
+        available = ringbuffer_available(rb);
+        lowat     = channel_ref->ref_info->recv_lowat;
+        if (!force && (available < lowat)) {
+            /* 未达到低水位 */
+            break;
+        }
+        channel_ref->ref_info->cb(channel_ref, channel_cb_event_recv);
+        if (!lowat || channel_ref_check_state(channel_ref, channel_state_close)) {
+            break;
+        }
+        /* 回调内取走了数据或调整了低水位，剩余数据可能已满足新的低水位，继续回调 */
+        if ((ringbuffer_available(rb) == available) && (channel_ref->ref_info->recv_lowat == lowat)) {
+            break;
+        }
+        if (ringbuffer_empty(rb)) {
+            break;
+        }
+        force = 0;
+    }
+}
+
+void channel_ref_pause_recv(channel_ref_t* channel_ref) {
+    assert(channel_ref);
+    if (channel_ref->ref_info->recv_paused) {
+        return;
+    }
+    channel_ref->ref_info->recv_paused = 1;
+    channel_ref_clear_event(channel_ref, channel_event_recv);
+}
+
+void channel_ref_resume_recv(channel_ref_t* channel_ref) {
+    assert(channel_ref);
+    if (!channel_ref->ref_info->recv_paused || channel_ref->ref_info->closing) {
+        return;
+    }
+    if (!channel_ref_check_state(channel_ref, channel_state_active)) {
+        return;
+    }
+    if (ringbuffer_full(channel_ref_get_ringbuffer(channel_ref))) {
+        /* 仍然没有空间 */
+        return;
+    }
+    channel_ref->ref_info->recv_paused = 0;
+    /* 重新投递读事件，套接字内未读数据将再次触发读事件 */
+    channel_ref_set_event(channel_ref, channel_event_recv);
+    if (channel_get_shm(channel_ref->ref_info->channel) || channel_get_inproc(channel_ref->ref_info->channel)) {
+        /* 共享内存或读队列内未读数据不会再次通知，放入就绪链表继续读取 */
+        loop_add_ready_channel_ref(channel_ref->ref_info->loop, channel_ref);
     }
 }
 
 void channel_ref_update_send(channel_ref_t* channel_ref) {
     int error = 0;
     assert(channel_ref);
-    error = channel_update_send(channel_ref->ref_info->channel);
+    if (channel_ref->ref_info->udp) {
+        error = udp_update_send(channel_ref->ref_info->udp, channel_ref);
+    } else {
+        error = channel_update_send(channel_ref->ref_info->channel);
+    }
     switch (error) {
         case error_send_fail:
             channel_ref_close(channel_ref);
             break;
         case error_send_patial:
+            if (channel_get_shm(channel_ref->ref_info->channel)) {
+                /* 门铃始终可写，写环空间释放后由对端敲门铃，不重新投递写事件 */
+                break;
+            }
             channel_ref_set_event(channel_ref, channel_event_send);
             break;
         default:
@@ -390,6 +1157,9 @@ void channel_ref_update_send(channel_ref_t* channel_ref) {
         if (channel_ref->ref_info->cb) {
             channel_ref->ref_info->cb(channel_ref, channel_cb_event_send);
         }
+        if (channel_ref->ref_info->closing) {
+            channel_ref_close(channel_ref);
+        }
     }
 }
 
@@ -400,32 +1170,37 @@ void channel_ref_update(channel_ref_t* channel_ref, channel_event_e e, time_t ts
     }
     if ((e & channel_event_recv) && channel_ref_check_event(channel_ref, channel_event_recv)) {
         if (channel_ref_check_state(channel_ref, channel_state_accept)) {
-            /*  */
+            /* 新连接 */
             channel_ref_update_accept(channel_ref);
         } else {
-            /* һζȡݵʱ룩 */
+            /* 最后一次读取到数据的时间戳（秒） */
             channel_ref->ref_info->last_recv_ts = ts;
-            /*  */
+            /* 读 */
             channel_ref_update_recv(channel_ref);
         }
     } 
     if ((e & channel_event_send) && channel_ref_check_event(channel_ref, channel_event_send)) {
         if (channel_ref_check_state(channel_ref, channel_state_connect)) {
-            /*  */
+            /* 连接完成 */
             channel_ref_update_connect(channel_ref);
         } else {
-            /* д */
+            /* 写 */
             channel_ref_update_send(channel_ref);
         }
     }
 }
 
+int channel_ref_check_inproc(channel_ref_t* channel_ref) {
+    assert(channel_ref);
+    return (channel_get_inproc(channel_ref->ref_info->channel) != 0);
+}
+
 ringbuffer_t* channel_ref_get_ringbuffer(channel_ref_t* channel_ref) {
     assert(channel_ref);
     return channel_get_ringbuffer(channel_ref->ref_info->channel);
 }
 
-loop_t* channel_ref_choose_loop(channel_ref_t* channel_ref) {
+loop_t* channel_ref_choose_loop(channel_ref_t* channel_ref, const void* key, int size) {
     loop_t*          loop         = 0;
     loop_t*          current_loop = 0;
     loop_balancer_t* balancer     = 0;
@@ -438,13 +1213,30 @@ loop_t* channel_ref_choose_loop(channel_ref_t* channel_ref) {
     if (!balancer) {
         return 0;
     }
-    loop = loop_balancer_choose(balancer);
+    loop = loop_balancer_choose_key(balancer, key, size);
     if (loop == channel_ref->ref_info->loop) {
         return 0;
     }
     return loop;
 }
 
+loop_t* channel_ref_choose_loop_addr(channel_ref_t* channel_ref, const struct sockaddr* addr, int len) {
+    assert(channel_ref); /* addr可以为0 */
+    if (!addr || !len) {
+        return channel_ref_choose_loop(channel_ref, 0, 0);
+    }
+    /* 只以IP作为亲和键，同一主机的多个连接选取同一个loop_t */
+    if (addr->sa_family == AF_INET) {
+        return channel_ref_choose_loop(channel_ref, &((const struct sockaddr_in*)addr)->sin_addr,
+            (int)sizeof(struct in_addr));
+    }
+    if (addr->sa_family == AF_INET6) {
+        return channel_ref_choose_loop(channel_ref, &((const struct sockaddr_in6*)addr)->sin6_addr,
+            (int)sizeof(struct in6_addr));
+    }
+    return channel_ref_choose_loop(channel_ref, addr, len);
+}
+
 void channel_ref_set_flag(channel_ref_t* channel_ref, int flag) {
     assert(channel_ref);
     channel_ref->ref_info->flag = flag;
@@ -506,18 +1298,260 @@ channel_ref_cb_t channel_ref_get_cb(channel_ref_t* channel_ref) {
     return channel_ref->ref_info->cb;
 }
 
-int channel_ref_connect_in_loop(channel_ref_t* channel_ref, const char* ip, int port) {
+void channel_ref_set_max_recv_ring_len(channel_ref_t* channel_ref, uint32_t max_recv_ring_len) {
+    assert(channel_ref);
+    channel_set_max_recv_ring_len(channel_ref->ref_info->channel, max_recv_ring_len);
+}
+
+uint32_t channel_ref_get_max_recv_ring_len(channel_ref_t* channel_ref) {
+    assert(channel_ref);
+    return channel_get_max_recv_ring_len(channel_ref->ref_info->channel);
+}
+
+int channel_ref_set_http(channel_ref_t* channel_ref, channel_ref_http_cb_t cb) {
+    assert(channel_ref);
+    assert(cb);
+    if (channel_ref->ref_info->http) {
+        http_destroy(channel_ref->ref_info->http);
+    }
+    channel_ref->ref_info->http = http_create(cb);
+    channel_ref->ref_info->recv_lowat = 0;
+    return error_ok;
+}
+
+int channel_ref_set_resp(channel_ref_t* channel_ref, resp_reply_cb_t push_cb, void* data) {
+    assert(channel_ref);
+    if (channel_ref->ref_info->resp) {
+        return error_resp_invalid;
+    }
+    channel_ref->ref_info->resp = resp_create(push_cb, data);
+    channel_ref->ref_info->recv_lowat = 0;
+    return error_ok;
+}
+
+int channel_ref_set_ws(channel_ref_t* channel_ref, const char* host, const char* uri, uint32_t max_size) {
+    assert(channel_ref);
+    assert(host);
+    assert(uri);
+    if (strlen(host) + strlen(uri) > WS_MAX_HANDSHAKE / 2) {
+        return error_ws_handshake;
+    }
+    if (channel_ref->ref_info->ws) {
+        ws_destroy(channel_ref->ref_info->ws);
+    }
+    channel_ref->ref_info->ws = ws_create(host, uri, max_size);
+    channel_ref->ref_info->recv_lowat = 0;
+    return error_ok;
+}
+
+void channel_ref_set_udp(channel_ref_t* channel_ref, udp_t* udp) {
+    assert(channel_ref);
+    assert(udp);
+    assert(!channel_ref->ref_info->udp);
+    channel_ref->ref_info->udp = udp;
+}
+
+void channel_ref_set_pool_conn(channel_ref_t* channel_ref, pool_conn_t* pool_conn) {
+    assert(channel_ref);
+    channel_ref->ref_info->pool_conn = pool_conn;
+}
+
+pool_conn_t* channel_ref_get_pool_conn(channel_ref_t* channel_ref) {
+    assert(channel_ref);
+    return channel_ref->ref_info->pool_conn;
+}
+
+int channel_ref_set_udp_offload(channel_ref_t* channel_ref, int gso, int gro) {
+    assert(channel_ref);
+    if (!channel_ref->ref_info->udp) {
+        return error_udp_offload;
+    }
+    return udp_set_offload(channel_ref->ref_info->udp, channel_get_socket_fd(channel_ref->ref_info->channel), gso, gro);
+}
+
+void channel_ref_upgrade_ws(channel_ref_t* channel_ref, ws_t* ws) {
+    assert(channel_ref);
+    assert(ws);
+    assert(!channel_ref->ref_info->ws);
+    channel_ref->ref_info->ws = ws;
+}
+
+ws_t* channel_ref_get_ws(channel_ref_t* channel_ref) {
+    assert(channel_ref);
+    return channel_ref->ref_info->ws;
+}
+
+resp_t* channel_ref_get_resp(channel_ref_t* channel_ref) {
+    assert(channel_ref);
+    return channel_ref->ref_info->resp;
+}
+
+void channel_ref_set_recv_lowat(channel_ref_t* channel_ref, uint32_t recv_lowat) {
+    assert(channel_ref);
+    channel_ref->ref_info->recv_lowat = recv_lowat;
+}
+
+uint32_t channel_ref_get_recv_lowat(channel_ref_t* channel_ref) {
+    assert(channel_ref);
+    return channel_ref->ref_info->recv_lowat;
+}
+
+void channel_ref_set_recv_budget(channel_ref_t* channel_ref, uint32_t recv_budget) {
+    assert(channel_ref);
+    channel_set_recv_budget(channel_ref->ref_info->channel, recv_budget);
+}
+
+void channel_ref_set_fastopen(channel_ref_t* channel_ref, int qlen) {
+    assert(channel_ref);
+    channel_set_fastopen(channel_ref->ref_info->channel, qlen);
+}
+
+int channel_ref_connect_in_loop(channel_ref_t* channel_ref, loop_t* loop, const char* ip, int port, int timeout) {
     int error = 0;
     assert(channel_ref);
+    assert(loop);
+    if (channel_ref_check_state(channel_ref, channel_state_connect)) {
+        /* 已经处于连接状态 */
+        return error_ok;
+    }
+    if (timeout) {
+        /* 设置超时时间戳 */
+        channel_ref->ref_info->connect_timeout = time(0) + timeout;
+    }
+    /* 发起连接，非阻塞connect可以在任意线程调用 */
     error = channel_connect(channel_ref->ref_info->channel, ip, port);
     if (error == error_ok) {
-        loop_add_channel_ref(channel_ref->ref_info->loop, channel_ref);
-        channel_ref_set_state(channel_ref, channel_state_connect);
-        channel_ref_set_event(channel_ref, channel_event_send);
+        channel_ref_start_connect(channel_ref, loop);
     }
     return error;
 }
 
+void channel_ref_start_connect(channel_ref_t* channel_ref, loop_t* loop) {
+    assert(channel_ref);
+    assert(loop);
+    if (loop != channel_ref->ref_info->loop) {
+        /* 转到目标loop，在其线程内注册到选取器，连接完成的回调也在其线程内调用 */
+        channel_ref_set_loop(channel_ref, loop);
+        loop_notify_connect(loop, channel_ref);
+        return;
+    }
+    loop_add_channel_ref(loop, channel_ref);
+    channel_ref_set_state(channel_ref, channel_state_connect);
+    channel_ref_set_event(channel_ref, channel_event_send);
+}
+
+void channel_ref_update_connect_in_loop(loop_t* loop, channel_ref_t* channel_ref) {
+    assert(loop);
+    assert(channel_ref);
+    /* 添加到当前线程loop */
+    channel_ref_start_connect(channel_ref, loop);
+}
+
+int channel_ref_migrate(channel_ref_t* channel_ref, loop_t* loop) {
+    assert(channel_ref);
+    assert(loop);
+#if LOOP_IOCP
+    /* 套接字不能重新关联到其他完成端口 */
+    return error_migrate_fail;
+#else
+    if (!channel_ref_check_migrate(channel_ref)) {
+        return error_migrate_fail;
+    }
+    /* 在管道所属线程内按请求顺序迁出，事件持有共享引用直到迁出 */
+    loop_notify_migrate(channel_ref->ref_info->loop, channel_ref_share(channel_ref), loop);
+    return error_ok;
+#endif /* LOOP_IOCP */
+}
+
+int channel_ref_rebind(channel_ref_t* channel_ref, const void* key, int size) {
+    loop_t* loop = 0;
+    assert(channel_ref);
+    assert(key);
+    assert(size > 0);
+    loop = channel_ref_choose_loop(channel_ref, key, size);
+    if (loop) {
+        return channel_ref_migrate(channel_ref, loop);
+    }
+    /* 没有负载均衡器或已在键对应的loop_t内，与迁移相同，读缓冲区内未取走的数据再次回调 */
+    if (!channel_ref_check_notify(channel_ref) && channel_ref_check_event(channel_ref, channel_event_recv)) {
+        channel_ref_recv_again(channel_ref);
+    }
+    return error_ok;
+}
+
+int channel_ref_check_migrate(channel_ref_t* channel_ref) {
+    assert(channel_ref);
+    if (channel_get_inproc(channel_ref->ref_info->channel) || channel_get_shm(channel_ref->ref_info->channel)) {
+        /* 进程内管道及共享内存管道的对端持有所属loop_t */
+        return 0;
+    }
+    if (channel_ref->ref_info->pool_conn) {
+        /* 连接池由所属loop_t驱动 */
+        return 0;
+    }
+    return channel_ref_check_state(channel_ref, channel_state_active);
+}
+
+int channel_ref_equal(channel_ref_t* a, channel_ref_t* b) {
+    assert(a);
+    assert(b);
+    return (a->ref_info == b->ref_info);
+}
+
+time_t channel_ref_get_last_recv_ts(channel_ref_t* channel_ref) {
+    assert(channel_ref);
+    return channel_ref->ref_info->last_recv_ts;
+}
+
+void channel_ref_detach_in_loop(loop_t* loop, channel_ref_t* channel_ref) {
+    assert(loop);
+    assert(channel_ref);
+    loop_remove_ready_channel_ref(loop, channel_ref);
+    impl_remove_channel_ref(loop, channel_ref);
+    /* 清除事件，迁入后重新投递 */
+    channel_ref->ref_info->migrate_event = channel_ref->ref_info->event;
+    channel_ref->ref_info->event = 0;
+    loop_remove_channel_ref(loop, channel_ref);
+}
+
+void channel_ref_attach_in_loop(loop_t* loop, channel_ref_t* channel_ref) {
+    assert(loop);
+    assert(channel_ref);
+    loop_add_channel_ref(loop, channel_ref);
+    /* 边沿触发的选取器在重新注册时报告当前已就绪的事件，迁移期间到达的数据不会丢失 */
+    if (channel_ref->ref_info->migrate_event & channel_event_recv) {
+        channel_ref_set_event(channel_ref, channel_event_recv);
+        /* 读缓冲区内未取走的数据（如回调内调用channel_ref_rebind）在目标线程内回调 */
+        channel_ref_recv_again(channel_ref);
+    }
+    if (channel_ref->ref_info->migrate_event & channel_event_send) {
+        channel_ref_set_event(channel_ref, channel_event_send);
+    }
+    channel_ref->ref_info->migrate_event = 0;
+}
+
+void channel_ref_set_migrate_list(channel_ref_t* channel_ref, dlist_t* migrate_list) {
+    assert(channel_ref); /* migrate_list可以为0 */
+    channel_ref->ref_info->migrate_list = migrate_list;
+}
+
+dlist_t* channel_ref_get_migrate_list(channel_ref_t* channel_ref) {
+    assert(channel_ref);
+    return channel_ref->ref_info->migrate_list;
+}
+
+void channel_ref_set_peer_sockaddr(channel_ref_t* channel_ref, const struct sockaddr* addr, int len) {
+    assert(channel_ref);
+    if (len <= 0) {
+        /* 选取器自定义的accept没有地址，第一次取得时调用getpeername */
+        return;
+    }
+    if (!channel_ref->ref_info->peer_address) {
+        channel_ref->ref_info->peer_address = address_create();
+    }
+    address_set_sockaddr(channel_ref->ref_info->peer_address, addr, len);
+}
+
 address_t* channel_ref_get_peer_address(channel_ref_t* channel_ref) {
     if (channel_ref->ref_info->peer_address) {
         return channel_ref->ref_info->peer_address;
@@ -29,232 +29,503 @@
 #include "channel_ref_api.h"
 
 /*
- * ܵ
- * @param loop loop_tʵ
- * @param channel channel_tʵ
- * @return channel_ref_tʵ
+ * 创建管道引用
+ * @param loop loop_t实例
+ * @param channel channel_t实例
+ * @return channel_ref_t实例
  */
 channel_ref_t* channel_ref_create(loop_t* loop, channel_t* channel);
 
 /*
- * ٹܵ
- * ܵüΪʱܱʵ
- * @return channel_ref_tʵ
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 销毁管道引用
+ * 管道引用计数为零时才能被实际销毁
+ * @return channel_ref_t实例
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int channel_ref_destroy(channel_ref_t* channel_ref);
 
 /*
- * д
- * ܵüΪʱܱʵ
- * @return channel_ref_tʵ
- * @param data дָ
- * @param size ݳ
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 写入
+ * 管道引用计数为零时才能被实际销毁
+ * @return channel_ref_t实例
+ * @param data 写入数据指针
+ * @param size 数据长度
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int channel_ref_write(channel_ref_t* channel_ref, const char* data, int size);
 
 /*
- * Ϊͨaccept()ص׽ִܵ
- * @return channel_ref_tʵ
- * @param loop loop_tʵ
- * @param client_fd ͨaccept()õ׽
- * @param event ǷͶ¼ùܵ״̬
- * @return channel_ref_tʵ
+ * 聚合写入
+ * 非管道所在线程调用时合并为一个缓冲区后转到管道所在线程发送
+ * @param channel_ref channel_ref_t实例
+ * @param ptr 区域起始指针数组
+ * @param size 区域长度数组
+ * @param count 区域数量
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int channel_ref_write_segments(channel_ref_t* channel_ref, const char* ptr[], uint32_t size[], int count);
+
+/*
+ * 追加到发送链表，等待写事件时发送
+ * 发送链表原本为空时才投递写事件，同一次循环内的多次调用在写事件触发时合并为一次聚合写.
+ * 发送链表已达到最大长度限制时销毁send_buffer并关闭管道.
+ * 只能在管道所在线程调用
+ * @param channel_ref channel_ref_t实例
+ * @param send_buffer buffer_t实例
+ * @retval error_ok 成功
+ * @retval error_send_fail 发送链表已满，管道已关闭
+ */
+int channel_ref_queue_send(channel_ref_t* channel_ref, buffer_t* send_buffer);
+
+/*
+ * 发送缓冲区链表
+ * 发送链表为空时立即发送，其他线程调用时转到loop所在线程发送
+ * @param channel_ref channel_ref_t实例
+ * @param chain 缓冲区链表，发送后销毁
+ * @retval error_ok 成功
+ * @retval error_send_patial 部分发送，剩余数据等待写事件
+ * @retval 其他 失败
+ */
+int channel_ref_write_chain(channel_ref_t* channel_ref, buffer_t* chain);
+
+/*
+ * 将udp_pack打包的数据报放入发送队列
+ * 队列原本为空时才投递写事件，同一次循环内的多次调用在写事件触发时合并为sendmmsg批量发送.
+ * 只能在管道所在线程调用
+ * @param channel_ref channel_ref_t实例
+ * @param datagram udp_pack打包的数据报
+ * @retval error_ok 成功
+ * @retval 其他 失败，数据报已被销毁
+ */
+int channel_ref_queue_datagram(channel_ref_t* channel_ref, buffer_t* datagram);
+
+/*
+ * 设置UDP数据报收发器
+ * @param channel_ref channel_ref_t实例
+ * @param udp udp_t实例
+ */
+void channel_ref_set_udp(channel_ref_t* channel_ref, udp_t* udp);
+
+/*
+ * 设置所属连接池
+ * @param channel_ref channel_ref_t实例
+ * @param pool_conn pool_conn_t实例，0为与连接池分离
+ */
+void channel_ref_set_pool_conn(channel_ref_t* channel_ref, pool_conn_t* pool_conn);
+
+/*
+ * 取得所属连接池
+ * @param channel_ref channel_ref_t实例
+ * @return pool_conn_t实例，不属于连接池时返回0
+ */
+pool_conn_t* channel_ref_get_pool_conn(channel_ref_t* channel_ref);
+
+/*
+ * 切换为WebSocket
+ * 在HTTP请求回调内调用，回调返回后不再解析HTTP请求
+ * @param channel_ref channel_ref_t实例
+ * @param ws ws_t实例
+ */
+void channel_ref_upgrade_ws(channel_ref_t* channel_ref, ws_t* ws);
+
+/*
+ * 取得WebSocket
+ * @param channel_ref channel_ref_t实例
+ * @retval 0 未设置
+ * @retval 非零 ws_t实例
+ */
+ws_t* channel_ref_get_ws(channel_ref_t* channel_ref);
+
+/*
+ * 取得RESP客户端
+ * @param channel_ref channel_ref_t实例
+ * @retval 0 未设置
+ * @retval 非零 resp_t实例
+ */
+resp_t* channel_ref_get_resp(channel_ref_t* channel_ref);
+
+/*
+ * 分帧器解出一个完整消息
+ * 没有读方向过滤器时直接回调，否则交给读方向过滤器链
+ * @param channel_ref channel_ref_t实例
+ * @param data 消息体
+ * @param size 消息体长度
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int channel_ref_dispatch_frame(channel_ref_t* channel_ref, const char* data, uint32_t size);
+
+/*
+ * 过滤器链处理完毕
+ * 读方向调用分帧回调，写方向加上长度头后发送，缓冲区链表的所有权转移给管道
+ * @param channel_ref channel_ref_t实例
+ * @param dir 方向
+ * @param chain 缓冲区链表
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int channel_ref_filter_done(channel_ref_t* channel_ref, filter_dir_e dir, buffer_t* chain);
+
+/*
+ * 为通过accept()返回的套接字创建管道引用
+ * @return channel_ref_t实例
+ * @param loop loop_t实例
+ * @param client_fd 通过accept()得到的套接字
+ * @param event 是否投递事件和设置管道状态
+ * @return channel_ref_t实例
  */
 channel_ref_t* channel_ref_accept_from_socket_fd(channel_ref_t* channel_ref, loop_t* loop, socket_t client_fd, int event);
 
 /*
- * ȡùܵloop_tʵ
- * @param channel_ref channel_ref_tʵ
- * @return loop_tʵ
+ * 由负载均衡器选取管道所属的loop_t实例
+ * @param channel_ref channel_ref_t实例
+ * @param key 亲和键，可以为0
+ * @param size 亲和键长度
+ * @return loop_t实例，与当前loop_t相同或没有负载均衡器时返回0
  */
-loop_t* channel_ref_choose_loop(channel_ref_t* channel_ref);
+loop_t* channel_ref_choose_loop(channel_ref_t* channel_ref, const void* key, int size);
 
 /*
- * ùܵڵ
- * @param channel_ref channel_ref_tʵ
- * @param node ڵ
+ * 以地址的IP作为亲和键选取loop_t实例
+ * @param channel_ref channel_ref_t实例
+ * @param addr 对端地址，为0时不使用亲和键
+ * @param len 地址长度
+ * @return loop_t实例，与当前loop_t相同或没有负载均衡器时返回0
+ */
+loop_t* channel_ref_choose_loop_addr(channel_ref_t* channel_ref, const struct sockaddr* addr, int len);
+
+/*
+ * 设置管道链表节点
+ * @param channel_ref channel_ref_t实例
+ * @param node 链表节点
  */
 void channel_ref_set_loop_node(channel_ref_t* channel_ref, dlist_node_t* node);
 
 /*
- * ȡùܵڵ
- * @param channel_ref channel_ref_tʵ
- * @return dlist_node_tʵ
+ * 取得管道链表节点
+ * @param channel_ref channel_ref_t实例
+ * @return dlist_node_t实例
  */
 dlist_node_t* channel_ref_get_loop_node(channel_ref_t* channel_ref);
 
 /*
- * loop_tе߳
- * @param channel_ref channel_ref_tʵ
+ * 设置管道就绪链表节点
+ * @param channel_ref channel_ref_t实例
+ * @param node 链表节点，0表示不在就绪链表内
+ */
+void channel_ref_set_ready_node(channel_ref_t* channel_ref, dlist_node_t* node);
+
+/*
+ * 取得管道就绪链表节点
+ * @param channel_ref channel_ref_t实例
+ * @return dlist_node_t实例
+ */
+dlist_node_t* channel_ref_get_ready_node(channel_ref_t* channel_ref);
+
+/*
+ * 取得最后一次读取时loop_t的循环次数
+ * @param channel_ref channel_ref_t实例
+ * @return 循环次数，未读取过为0
+ */
+uint32_t channel_ref_get_recv_round(channel_ref_t* channel_ref);
+
+/*
+ * 发起连接，由指定的loop_t等待连接完成，不经过负载均衡
+ * @param channel_ref channel_ref_t实例
+ * @param loop 等待连接完成的loop_t实例
  * @param ip IP
- * @param port ˿
- * @retval error_ok ɹ
- * @retval  ʧ
+ * @param port 端口
+ * @param timeout 连接超时（秒）
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
-int channel_ref_connect_in_loop(channel_ref_t* channel_ref, const char* ip, int port);
+int channel_ref_connect_in_loop(channel_ref_t* channel_ref, loop_t* loop, const char* ip, int port, int timeout);
 
 /*
- * loop_tе߳ɽ
- * ͨؾⴥ
- * @param loop loop_tʵ
- * @param channel_ref channel_ref_tʵ
+ * 连接已发起，加入loop_t并等待写事件
+ * loop不是管道当前所属loop_t时，转交到loop所在线程
+ * @param channel_ref channel_ref_t实例
+ * @param loop loop_t实例
+ */
+void channel_ref_start_connect(channel_ref_t* channel_ref, loop_t* loop);
+
+/*
+ * 设置对端套接字地址，accept或连接时已知对端地址，不需要getpeername
+ * @param channel_ref channel_ref_t实例
+ * @param addr 套接字地址
+ * @param len 套接字地址长度，为0时忽略
+ */
+void channel_ref_set_peer_sockaddr(channel_ref_t* channel_ref, const struct sockaddr* addr, int len);
+
+/*
+ * 在loop_t所运行的线程内完成接收新连接流程
+ * 通过负载均衡触发
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
  */
 void channel_ref_update_accept_in_loop(loop_t* loop, channel_ref_t* channel_ref);
 
 /*
- * loop_tе߳ɹر
- * ̹ͨ߳رմ
- * @param loop loop_tʵ
- * @param channel_ref channel_ref_tʵ
+ * 在loop_t所运行的线程内注册正在连接的管道
+ * 通过负载均衡触发
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
+ */
+void channel_ref_update_connect_in_loop(loop_t* loop, channel_ref_t* channel_ref);
+
+/*
+ * 检查管道是否可以迁移
+ * @param channel_ref channel_ref_t实例
+ * @retval 1 可以
+ * @retval 0 不可以
+ */
+int channel_ref_check_migrate(channel_ref_t* channel_ref);
+
+/*
+ * 检查两个channel_ref_t是否引用同一管道
+ * @param a channel_ref_t实例
+ * @param b channel_ref_t实例
+ * @retval 1 是，包括channel_ref_share得到的共享引用
+ * @retval 0 不是
+ */
+int channel_ref_equal(channel_ref_t* a, channel_ref_t* b);
+
+/*
+ * 取得最后一次读操作时间戳
+ * @param channel_ref channel_ref_t实例
+ * @return 时间戳（秒）
+ */
+time_t channel_ref_get_last_recv_ts(channel_ref_t* channel_ref);
+
+/*
+ * 在原loop_t所运行的线程内注销迁出的管道
+ * 从就绪链表、选取器及活跃链表内删除，保存已投递的事件
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
+ */
+void channel_ref_detach_in_loop(loop_t* loop, channel_ref_t* channel_ref);
+
+/*
+ * 在目标loop_t所运行的线程内注册迁入的管道
+ * 加入活跃链表，重新投递迁出时保存的事件
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
+ */
+void channel_ref_attach_in_loop(loop_t* loop, channel_ref_t* channel_ref);
+
+/*
+ * 设置迁移中暂存的事件链表
+ * @param channel_ref channel_ref_t实例
+ * @param migrate_list 事件链表，0表示迁移已完成
+ */
+void channel_ref_set_migrate_list(channel_ref_t* channel_ref, dlist_t* migrate_list);
+
+/*
+ * 取得迁移中暂存的事件链表
+ * @param channel_ref channel_ref_t实例
+ * @return 事件链表，不在迁移中时返回0
+ */
+dlist_t* channel_ref_get_migrate_list(channel_ref_t* channel_ref);
+
+/*
+ * 在loop_t所运行的线程内完成关闭流程
+ * 通过跨线程关闭触发
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
  */
 void channel_ref_update_close_in_loop(loop_t* loop, channel_ref_t* channel_ref);
 
 /*
- * loop_tе߳ڷ
- * ̷ͨ߳ʹ
- * @param loop loop_tʵ
- * @param channel_ref channel_ref_tʵ
- * @param send_buffer buffer_tʵ
+ * 在loop_t所运行的线程内发送
+ * 通过跨线程发送触发
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
+ * @param send_buffer buffer_t实例
  */
 void channel_ref_update_send_in_loop(loop_t* loop, channel_ref_t* channel_ref, buffer_t* send_buffer);
 
 /*
- * ùܵԶ־
- * @param channel_ref channel_ref_tʵ
- * @param flag Զ־
+ * 在loop_t所运行的线程内将消息交给写方向过滤器链
+ * 通过跨线程发送消息触发
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
+ * @param chain 消息体缓冲区链表
+ */
+void channel_ref_update_send_frame_in_loop(loop_t* loop, channel_ref_t* channel_ref, buffer_t* chain);
+
+/*
+ * 设置管道自定义标志
+ * @param channel_ref channel_ref_t实例
+ * @param flag 自定义标志
  */
 void channel_ref_set_flag(channel_ref_t* channel_ref, int flag);
 
 /*
- * ȡùܵԶ־
- * @param channel_ref channel_ref_tʵ
- * @return Զ־
+ * 取得管道自定义标志
+ * @param channel_ref channel_ref_t实例
+ * @return 自定义标志
  */
 int channel_ref_get_flag(channel_ref_t* channel_ref);
 
 /*
- * ùܵԶ
- * @param channel_ref channel_ref_tʵ
- * @param data Զָ
+ * 设置管道自定义数据
+ * @param channel_ref channel_ref_t实例
+ * @param data 自定义数据指针
  */
 void channel_ref_set_data(channel_ref_t* channel_ref, void* data);
 
 /*
- * ȡùܵԶ
- * @param channel_ref channel_ref_tʵ
- * @return Զָ
+ * 取得管道自定义数据
+ * @param channel_ref channel_ref_t实例
+ * @return 自定义数据指针
  */
 void* channel_ref_get_data(channel_ref_t* channel_ref);
 
 /*
- * ùܵloop_tʵ
- * @param channel_ref channel_ref_tʵ
- * @param loop loop_tʵ
+ * 设置管道所属（相关联）loop_t实例
+ * @param channel_ref channel_ref_t实例
+ * @param loop loop_t实例
  */
 void channel_ref_set_loop(channel_ref_t* channel_ref, loop_t* loop);
 
 /*
- * Ͷݹܵ¼
- * @param channel_ref channel_ref_tʵ
- * @param e ܵ¼
+ * 投递管道事件
+ * @param channel_ref channel_ref_t实例
+ * @param e 管道事件
  */
 void channel_ref_set_event(channel_ref_t* channel_ref, channel_event_e e);
 
 /*
- * ȡܵѾͶݵ¼
- * @param channel_ref channel_ref_tʵ
- * @return ܵ¼
+ * 获取管道已经投递的事件集合
+ * @param channel_ref channel_ref_t实例
+ * @return 管道事件集合
  */
 channel_event_e channel_ref_get_event(channel_ref_t* channel_ref);
 
 /*
- * ȡܵ¼
- * @param channel_ref channel_ref_tʵ
- * @param e ܵ¼
+ * 取消管道事件
+ * @param channel_ref channel_ref_t实例
+ * @param e 管道事件
  */
 void channel_ref_clear_event(channel_ref_t* channel_ref, channel_event_e e);
 
 /*
- * ǷͶ¼
- * @param channel_ref channel_ref_tʵ
- * @param e ܵ¼
- * @retval 0 ûͶ
- * @retval  ѾͶ
+ * 检测是否投递了事件
+ * @param channel_ref channel_ref_t实例
+ * @param e 管道事件
+ * @retval 0 没有投递
+ * @retval 非零 已经投递
  */
 int channel_ref_check_event(channel_ref_t* channel_ref, channel_event_e event);
 
 /*
- * ùܵ״̬
- * @param channel_ref channel_ref_tʵ
- * @param state ܵ״̬
+ * 设置管道状态
+ * @param channel_ref channel_ref_t实例
+ * @param state 管道状态
  */
 void channel_ref_set_state(channel_ref_t* channel_ref, channel_state_e state);
 
 /*
- * ܵ¼֪ͨ
- * @param channel_ref channel_ref_tʵ
- * @param e ܵ¼
- * @param ts ǰʱ룩
+ * 管道事件通知
+ * @param channel_ref channel_ref_t实例
+ * @param e 管道事件
+ * @param ts 当前时间戳（秒）
  */
 void channel_ref_update(channel_ref_t* channel_ref, channel_event_e e, time_t ts);
 
 /*
- * ܵ¼-
- * @param channel_ref channel_ref_tʵ
+ * 管道事件处理-监听到新连接请求
+ * @param channel_ref channel_ref_t实例
  */
 void channel_ref_update_accept(channel_ref_t* channel_ref);
 
 /*
- * ܵ¼-
- * @param channel_ref channel_ref_tʵ
+ * 管道事件处理-发起连接完成
+ * @param channel_ref channel_ref_t实例
  */
 void channel_ref_update_connect(channel_ref_t* channel_ref);
 
 /*
- * ܵ¼-ݿɶ
- * @param channel_ref channel_ref_tʵ
+ * 管道事件处理-有数据可读
+ * @param channel_ref channel_ref_t实例
  */
 void channel_ref_update_recv(channel_ref_t* channel_ref);
 
 /*
- * ܵ¼-Է
- * @param channel_ref channel_ref_tʵ
+ * UDP管道事件处理-有数据报可读
+ * @param channel_ref channel_ref_t实例
+ */
+void channel_ref_update_recv_udp(channel_ref_t* channel_ref);
+
+/*
+ * 调用读事件回调
+ * 设置了读低水位时，回调内调整低水位或取走数据后若仍满足条件会继续回调
+ * @param channel_ref channel_ref_t实例
+ * @param force 非零时忽略读低水位
+ */
+void channel_ref_notify_recv(channel_ref_t* channel_ref, int force);
+
+/*
+ * 暂停读事件
+ * 读缓冲区已达到最大长度时调用，套接字内未读数据由TCP流量控制限制对端继续发送
+ * @param channel_ref channel_ref_t实例
+ */
+void channel_ref_pause_recv(channel_ref_t* channel_ref);
+
+/*
+ * 恢复被暂停的读事件
+ * 读缓冲区内数据被取出后调用，未暂停或读缓冲区仍然满时不做任何处理
+ * @param channel_ref channel_ref_t实例
+ */
+void channel_ref_resume_recv(channel_ref_t* channel_ref);
+
+/*
+ * 管道事件处理-可以发送数据
+ * @param channel_ref channel_ref_t实例
  */
 void channel_ref_update_send(channel_ref_t* channel_ref);
 
 /*
- * ܵӲǷʱ
- * @param channel_ref channel_ref_tʵ
- * @param ts ǰʱ룩
- * @retval 0 ûгʱ
- * @retval  ʱ
+ * 检测管道发起的连接操作是否超时
+ * @param channel_ref channel_ref_t实例
+ * @param ts 当前时间戳（秒）
+ * @retval 0 没有超时
+ * @retval 非零 超时
  */
 int channel_ref_check_connect_timeout(channel_ref_t* channel_ref, time_t ts);
 
 /*
- * ܵǷгʱ
- * @param channel_ref channel_ref_tʵ
- * @param ts ǰʱ룩
- * @retval 0 ûгʱ
- * @retval  ʱ
+ * 检测管道是否空闲超时
+ * @param channel_ref channel_ref_t实例
+ * @param ts 当前时间戳（秒）
+ * @retval 0 没有超时
+ * @retval 非零 超时
  */
 int channel_ref_check_timeout(channel_ref_t* channel_ref, time_t ts);
 
 /*
- * ȡùܵ
- * @param channel_ref channel_ref_tʵ
- * @return ringbuffer_tʵ
+ * 检查是否为进程内管道
+ * 进程内管道没有套接字，不注册到选取器
+ * @param channel_ref channel_ref_t实例
+ * @retval 0 不是
+ * @retval 非零 是
+ */
+int channel_ref_check_inproc(channel_ref_t* channel_ref);
+
+/*
+ * 取得管道读缓冲区
+ * @param channel_ref channel_ref_t实例
+ * @return ringbuffer_t实例
  */
 ringbuffer_t* channel_ref_get_ringbuffer(channel_ref_t* channel_ref);
 
 /*
- * ȡùܵ¼ص
- * @param channel_ref channel_ref_tʵ
- * @return صָ
+ * 取得管道事件回调
+ * @param channel_ref channel_ref_t实例
+ * @return 回调函数指针
  */
 channel_ref_cb_t channel_ref_get_cb(channel_ref_t* channel_ref);
 
@@ -28,115 +28,392 @@
 #include "config.h"
 
 /*
- * ӹܵüܵµchannel_ref_tʵ
- * channel_ref_shareɺ󣬿ڵǰ߳ڷ߳(loop_t)еĹܵ
- * @param channel_ref channel_ref_tʵ
- * @return channel_ref_tʵ
+ * 增加管道引用计数，并创建与管道关联的新的channel_ref_t实例
+ * channel_ref_share调用完成后，可以在当前线程内访问其他线程(loop_t)内运行的管道
+ * @param channel_ref channel_ref_t实例
+ * @return channel_ref_t实例
  */
 channel_ref_t* channel_ref_share(channel_ref_t* channel_ref);
 
 /*
- * ٹܵüchannel_ref_tʵ
- * @param channel_ref channel_ref_tʵ
+ * 减少管道引用计数，并销毁channel_ref_t实例
+ * @param channel_ref channel_ref_t实例
  */
 void channel_ref_leave(channel_ref_t* channel_ref);
 
 /*
- * 
- * channel_ref_connectĹܵᱻؾ⣬ڵǰloop_tе߳
- * @param channel_ref channel_ref_tʵ
- * @param ip IP
- * @param port ˿
- * @param timeout ӳʱ룩
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 主动连接
+ * 当前loop_t关联了负载均衡器且正在运行时，由负载均衡器选取loop_t，
+ * 管道转交到所选loop_t所运行的线程，channel_cb_event_connect也在其线程内回调，
+ * 因此回调等设置需要在调用之前完成
+ * @param channel_ref channel_ref_t实例
+ * @param ip IP，含有':'的为IPv6，以'/'开头为UNIX域套接字路径，以'@'开头为抽象命名空间（Linux）
+ * @param port 端口，UNIX域套接字忽略
+ * @param timeout 连接超时（秒）
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int channel_ref_connect(channel_ref_t* channel_ref, const char* ip, int port, int timeout);
 
 /*
- * ܵתΪܵ
- * ܵܵӽʹܵͬķͻƺͽܻ,
- * channel_ref_acceptܵӽؾ⣬ʵĸloop_tʵе
- * @param channel_ref channel_ref_tʵ
- * @param ip IP
- * @param port ˿
- * @param backlog ȴޣlisten())
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 使用已解析的套接字地址主动连接，不经过字符串转换
+ * 与channel_ref_connect相同，经过负载均衡选取loop_t
+ * @param channel_ref channel_ref_t实例
+ * @param addr 套接字地址（sockaddr_in，sockaddr_in6或sockaddr_un）
+ * @param len 套接字地址长度
+ * @param timeout 连接超时（秒）
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int channel_ref_connect_addr(channel_ref_t* channel_ref, const struct sockaddr* addr, int len, int timeout);
+
+/*
+ * 通过域名主动连接
+ * IP字符串及缓存命中时立即发起连接，否则由loop_t关联的解析器（resolver_attach）在工作线程内解析，
+ * 完成后在loop_t所运行的线程内发起连接，解析失败时以channel_cb_event_close回调.
+ * 解析期间管道不能关闭
+ * @param channel_ref channel_ref_t实例
+ * @param host 域名或IP，以'/'开头为UNIX域套接字路径，以'@'开头为抽象命名空间（Linux）
+ * @param port 端口，UNIX域套接字忽略
+ * @param timeout 连接超时（秒），从解析完成后开始计算
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int channel_ref_connect_host(channel_ref_t* channel_ref, const char* host, int port, int timeout);
+
+/*
+ * 将管道转换为监听管道
+ * 由这个监听管道接受的新连接将使用与监听管道相同的发送缓冲区最大数量限制和接受缓冲区长度限制,
+ * channel_ref_accept所接受的新连接将被负载均衡，实际运行在哪个loop_t内依赖于实际运行的情况
+ * @param channel_ref channel_ref_t实例
+ * @param ip IP，含有':'的为IPv6（"::"同时接受IPv4），以'/'开头为UNIX域套接字路径，以'@'开头为抽象命名空间（Linux）
+ * @param port 端口，UNIX域套接字忽略
+ * @param backlog 等待队列上限（listen())
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int channel_ref_accept(channel_ref_t* channel_ref, const char* ip, int port, int backlog);
 
 /*
- * ܵǷͨؾǰloop_t
- * @param channel_ref channel_ref_tʵ
- * @retval 0 
- * @retval 0 
+ * 检测管道是否是通过负载均衡关联到当前的loop_t
+ * @param channel_ref channel_ref_t实例
+ * @retval 0 不是
+ * @retval 非0 是
  */
 int channel_ref_check_balance(channel_ref_t* channel_ref);
 
 /*
- * ܵǰ״̬
- * @param channel_ref channel_ref_tʵ
- * @param state ҪԵ״̬
- * @retval 1 
- * @retval 0 
+ * 检测管道当前状态
+ * @param channel_ref channel_ref_t实例
+ * @param state 需要测试的状态
+ * @retval 1 是
+ * @retval 0 不是
  */
 int channel_ref_check_state(channel_ref_t* channel_ref, channel_state_e state);
 
 /*
- * رչܵ
- * @param channel_ref channel_ref_tʵ
+ * 关闭管道
+ * @param channel_ref channel_ref_t实例
  */
 void channel_ref_close(channel_ref_t* channel_ref);
 
 /*
- * ȡùܵ׽
- * @param channel_ref channel_ref_tʵ
- * @return ׽
+ * 发送链表内的数据发送完毕后关闭管道
+ * 调用后不再读取数据，只能在管道所在线程调用
+ * @param channel_ref channel_ref_t实例
+ */
+void channel_ref_close_after_send(channel_ref_t* channel_ref);
+
+/*
+ * 取得管道套接字
+ * @param channel_ref channel_ref_t实例
+ * @return 套接字
  */
 socket_t channel_ref_get_socket_fd(channel_ref_t* channel_ref);
 
 /*
- * ȡùܵ
- * @param channel_ref channel_ref_tʵ
- * @return stream_tʵ
+ * 取得管道数据流
+ * @param channel_ref channel_ref_t实例
+ * @return stream_t实例
  */
 stream_t* channel_ref_get_stream(channel_ref_t* channel_ref);
 
 /*
- * ȡùܵ¼ѭ
- * @param channel_ref channel_ref_tʵ
- * @return loop_tʵ
+ * 取得管道所关联的事件循环
+ * @param channel_ref channel_ref_t实例
+ * @return loop_t实例
  */
 loop_t* channel_ref_get_loop(channel_ref_t* channel_ref);
 
 /*
- * ùܵ¼ص
- * ¼صڹloop_tʵ߳ڱص
- * @param channel_ref channel_ref_tʵ
- * @paramn cb ص
+ * 将管道迁移到其他事件循环，可以在任意线程调用
+ * 管道在当前所属loop_t的线程内从选取器注销，读写缓冲区及状态随管道转交，
+ * 在目标loop_t的线程内重新注册，此后回调在目标线程内调用.
+ * 迁移前后跨线程投递的写入及关闭按投递顺序执行，不会丢失或乱序.
+ * 进程内管道、共享内存管道、连接池管道及非活跃状态的管道不能迁移，IOCP不支持迁移
+ * @param channel_ref channel_ref_t实例
+ * @param loop 目标loop_t实例
+ * @retval error_ok 成功
+ * @retval error_migrate_fail 管道不能迁移
+ */
+int channel_ref_migrate(channel_ref_t* channel_ref, loop_t* loop);
+
+/*
+ * 按应用键重新选取管道所属的事件循环
+ * 负载均衡策略为loop_balancer_strategy_affinity时，相同键的管道迁移到同一个loop_t，
+ * 用于在首个消息内解析出会话、用户等标识后延迟绑定，其他策略按策略重新选取.
+ * 可以在读回调内调用，读缓冲区内未取走的数据在管道最终所属的loop_t内再次回调
+ * （不需迁移时在下次循环内回调）；迁移完成前读回调仍可能在原线程内调用
+ * @param channel_ref channel_ref_t实例
+ * @param key 键
+ * @param size 键长度，大于0
+ * @retval error_ok 成功，已在目标loop_t内或没有负载均衡器时不迁移
+ * @retval error_migrate_fail 管道不能迁移
+ */
+int channel_ref_rebind(channel_ref_t* channel_ref, const void* key, int size);
+
+/*
+ * 设置管道事件回调
+ * 事件回调将在关联的loop_t实例所在线程内被回调
+ * @param channel_ref channel_ref_t实例
+ * @paramn cb 回调函数
  */
 void channel_ref_set_cb(channel_ref_t* channel_ref, channel_ref_cb_t cb);
 
 /*
- * ùܵгʱ
- * ܵгʱΪжϣtimeoutδпɶݼȴʱ
- * @param channel_ref channel_ref_tʵ
- * @param timeout ʱ룩
+ * 设置管道空闲超时
+ * 管道空闲超时依赖读操作作为判断，在timeout间隔内未有可读数据既触发超时
+ * @param channel_ref channel_ref_t实例
+ * @param timeout 超时（秒）
  */
 void channel_ref_set_timeout(channel_ref_t* channel_ref, int timeout);
 
 /*
- * ȡöԶ˵ַ
- * @param channel_ref channel_ref_tʵ
- * @return address_tʵ
+ * 设置读缓冲区可扩展的最大长度
+ * 读缓冲区满时按倍数扩展直至最大长度，达到最大长度后暂停读取，直到数据被stream_pop/stream_eat取出后恢复,
+ * 监听管道设置后，接受的新连接继承此设置
+ * @param channel_ref channel_ref_t实例
+ * @param max_recv_ring_len 读缓冲区最大长度
+ */
+void channel_ref_set_max_recv_ring_len(channel_ref_t* channel_ref, uint32_t max_recv_ring_len);
+
+/*
+ * 取得读缓冲区可扩展的最大长度
+ * @param channel_ref channel_ref_t实例
+ * @return 读缓冲区最大长度
+ */
+uint32_t channel_ref_get_max_recv_ring_len(channel_ref_t* channel_ref);
+
+/*
+ * 设置读低水位
+ * 可读字节数达到低水位后才触发channel_cb_event_recv回调，未达到时数据保留在读缓冲区内,
+ * 可以在回调内根据当前解析进度（例如已读到的包头长度）随时调整,
+ * 读缓冲区达到最大长度时无论是否达到低水位都会回调，低水位不应超过读缓冲区最大长度
+ * @param channel_ref channel_ref_t实例
+ * @param recv_lowat 低水位（字节），0为每次读到数据都回调
+ */
+void channel_ref_set_recv_lowat(channel_ref_t* channel_ref, uint32_t recv_lowat);
+
+/*
+ * 取得读低水位
+ * @param channel_ref channel_ref_t实例
+ * @return 低水位（字节）
+ */
+uint32_t channel_ref_get_recv_lowat(channel_ref_t* channel_ref);
+
+/*
+ * 设置每次读事件最多读取的字节数
+ * 达到上限后管道被放入loop_t的就绪链表，在下次循环内继续读取，避免单个管道占用整个事件循环.
+ * 每次循环最多读取一次，在就绪链表内时即使选取器报告新的读事件也不会得到第二次预算.
+ * 监听管道设置后，接受的新连接继承此设置
+ * @param channel_ref channel_ref_t实例
+ * @param recv_budget 最多读取的字节数，0为不限制
+ */
+void channel_ref_set_recv_budget(channel_ref_t* channel_ref, uint32_t recv_budget);
+
+/*
+ * 开启TCP Fast Open，在channel_ref_accept或channel_ref_connect之前调用.
+ * 监听管道接受SYN携带的数据（Linux需要net.ipv4.tcp_fastopen开启服务端位）,
+ * 连接管道推迟到第一次发送时才发出SYN，连接完成前写入的数据随SYN发送，
+ * 因此channel_cb_event_connect在握手完成前回调，连接失败以channel_cb_event_close通知,
+ * 只适用于客户端先发送数据的协议。系统不支持时为普通连接
+ * @param channel_ref channel_ref_t实例
+ * @param qlen 监听管道为TFO请求队列长度，连接管道非0开启，0关闭
+ */
+void channel_ref_set_fastopen(channel_ref_t* channel_ref, int qlen);
+
+/*
+ * 设置按长度头分帧
+ * 设置后读事件不再触发channel_cb_event_recv，每个完整的消息通过cb回调，回调参数为消息体（不含长度头），
+ * 消息未跨越读缓冲区绕回点时不拷贝，回调返回后数据失效，回调内不应再通过stream_t读取数据,
+ * 读缓冲区最大长度小于max_size + 14（最长的长度头及校验和）时会被提高到该值，之后通过
+ * channel_ref_set_max_recv_ring_len调小将导致最大长度的消息无法收齐. 监听管道设置后，接受的新连接继承此设置
+ * @param channel_ref channel_ref_t实例
+ * @param type 长度头类型
+ * @param big_endian 固定长度头是否为大端（网络）字节序
+ * @param max_size 消息体最大长度，超过时关闭管道，2字节长度头最大65535，其他最大0xFFFFFFF1
+ * @param cb 消息回调
+ * @retval error_ok 成功
+ * @retval error_frame_too_large max_size超过长度头能表示的范围
+ * @retval 其他 失败
+ */
+int channel_ref_set_frame(channel_ref_t* channel_ref, frame_type_e type, int big_endian, uint32_t max_size, channel_ref_frame_cb_t cb);
+
+/*
+ * 设置是否为消息附加CRC32C校验和
+ * 开启后每个消息的长度头之后跟随4字节的消息体CRC32C，收到校验失败的消息时关闭管道，
+ * 支持SSE4.2的CPU上使用硬件指令计算，发送时在缓冲区链表上、接收时在读缓冲区内直接计算，不拷贝消息体.
+ * 需要先调用channel_ref_set_frame，两端设置必须一致，监听管道设置后，接受的新连接继承此设置
+ * @param channel_ref channel_ref_t实例
+ * @param checksum 非零开启，零关闭
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int channel_ref_set_frame_checksum(channel_ref_t* channel_ref, int checksum);
+
+/*
+ * 发送一个消息
+ * 长度头与消息体通过一次聚合写发送，需要先调用channel_ref_set_frame
+ * @param channel_ref channel_ref_t实例
+ * @param data 消息体
+ * @param size 消息体长度
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int channel_ref_write_frame(channel_ref_t* channel_ref, const char* data, uint32_t size);
+
+/*
+ * 发送一个由缓冲区链表组成的消息
+ * 缓冲区链表的所有权转移给管道，经过写方向过滤器链后加上长度头发送，不再拷贝，
+ * 需要先调用channel_ref_set_frame.
+ * 有写方向过滤器时，其他线程写入的消息投递到管道所在线程后再经过过滤器链，此时总是返回error_ok
+ * @param channel_ref channel_ref_t实例
+ * @param chain 缓冲区链表
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int channel_ref_write_frame_buffer(channel_ref_t* channel_ref, buffer_t* chain);
+
+/*
+ * 在过滤器链末尾添加过滤器
+ * 过滤器以消息为单位工作：读方向处理分帧器解出的消息，按添加顺序调用，最后交给分帧回调；
+ * 写方向处理channel_ref_write_frame(_buffer)写入的消息，按添加顺序调用，最后加上长度头发送.
+ * 过滤函数获得缓冲区链表的所有权，处理后调用filter_emit交给下一个过滤器，或者销毁链表丢弃消息，
+ * 返回非error_ok时管道将被关闭. 过滤器不会被accept()的新管道继承，需要在新管道上重新添加.
+ * 过滤器只在管道所在loop_t的线程内运行，其他线程写入的消息先投递到该线程，
+ * 添加、删除过滤器只能在管道所在线程内调用
+ * @param channel_ref channel_ref_t实例
+ * @param dir 方向
+ * @param name 名称，用于删除和统计
+ * @param func 过滤函数
+ * @param data 用户数据
+ * @return filter_t实例
+ */
+filter_t* channel_ref_add_filter(channel_ref_t* channel_ref, filter_dir_e dir, const char* name, filter_func_t func, void* data);
+
+/*
+ * 删除过滤器
+ * 可以在过滤函数或分帧回调内调用（包括删除正在运行的过滤器），被删除的过滤器不再被调用，
+ * 正在运行的过滤器链结束后才销毁，在此之前过滤函数仍可以访问自身并调用filter_emit
+ * @param channel_ref channel_ref_t实例
+ * @param dir 方向
+ * @param name 名称
+ * @retval error_ok 成功
+ * @retval 其他 未找到
+ */
+int channel_ref_remove_filter(channel_ref_t* channel_ref, filter_dir_e dir, const char* name);
+
+/*
+ * 作为HTTP/1.1服务端处理请求
+ * 读缓冲区内收齐一个完整请求（请求头和Content-Length指定的消息体）后回调，请求不拷贝，
+ * 请求内的数据指向读缓冲区，应答完成前保持有效. 支持keep-alive和管线化(pipelining)，
+ * 应答完成前不会回调下一个请求，保证应答顺序. 单个请求的长度受读缓冲区最大长度限制.
+ * 设置后读事件不再触发channel_cb_event_recv回调，监听管道设置后，接受的新连接继承此设置
+ * @param channel_ref channel_ref_t实例
+ * @param cb 请求回调
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int channel_ref_set_http(channel_ref_t* channel_ref, channel_ref_http_cb_t cb);
+
+/*
+ * 作为RESP(Redis协议)客户端
+ * 通过resp_command发送命令，应答按命令顺序匹配回调，支持管线化和RESP3的全部类型.
+ * 收到推送（或没有等待应答的命令时收到的应答）调用push_cb.
+ * 设置后读事件不再触发channel_cb_event_recv回调
+ * @param channel_ref channel_ref_t实例
+ * @param push_cb 推送回调，可以为0
+ * @param data 推送回调用户数据
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int channel_ref_set_resp(channel_ref_t* channel_ref, resp_reply_cb_t push_cb, void* data);
+
+/*
+ * 作为WebSocket客户端
+ * 在channel_ref_connect之前调用，连接完成后发送握手请求，握手完成后以channel_cb_event_ws_open回调，
+ * 之后每收到一个完整消息以channel_cb_event_recv回调，通过ws_get_message取得消息.
+ * 服务端通过HTTP请求回调内调用ws_accept接受握手
+ * @param channel_ref channel_ref_t实例
+ * @param host 握手请求的Host
+ * @param uri 握手请求的URI，例如"/chat"
+ * @param max_size 消息最大长度（包括分片消息拼接后的长度）
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int channel_ref_set_ws(channel_ref_t* channel_ref, const char* host, const char* uri, uint32_t max_size);
+
+/*
+ * 绑定UDP管道的本地地址并开始接收数据报
+ * 只能用于loop_create_udp_channel创建的管道，发送数据报前必须先绑定.
+ * 绑定IPv6地址后可以收发IPv6数据报，绑定"::"时为双栈，IPv4对端的IP仍为点分十进制
+ * @param channel_ref channel_ref_t实例
+ * @param ip IP，为0时绑定所有IPv4地址
+ * @param port 端口，为0时由系统分配
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int channel_ref_bind(channel_ref_t* channel_ref, const char* ip, int port);
+
+/*
+ * 通过UDP管道发送数据报
+ * 数据报放入发送队列，在写事件触发时以sendmmsg批量发送（每次系统调用最多UDP_MAX_BATCH个）,
+ * 可以在任意线程调用
+ * @param channel_ref channel_ref_t实例
+ * @param data 数据报指针
+ * @param size 数据报长度，可以为0
+ * @param ip 目的IP，IPv4管道只能发往IPv4地址，双栈管道两者都可以
+ * @param port 目的端口
+ * @retval error_ok 成功
+ * @retval error_udp_address 目的IP无效或与绑定的地址族不符
+ * @retval error_udp_queue_full 发送队列已满，数据报被丢弃
+ * @retval 其他 失败
+ */
+int channel_ref_sendto(channel_ref_t* channel_ref, const char* data, uint32_t size, const char* ip, int port);
+
+/*
+ * 开启或关闭UDP GSO/GRO（Linux）
+ * 开启GSO后发送队列内发往同一地址的等长数据报合并为一次发送，由内核（或网卡）分段;
+ * 开启GRO后由内核合并接收，回调前按原数据报拆分，不能在数据报回调内调用
+ * @param channel_ref channel_ref_t实例
+ * @param gso 非零开启GSO
+ * @param gro 非零开启GRO
+ * @retval error_ok 成功
+ * @retval error_udp_offload 系统不支持
+ */
+int channel_ref_set_udp_offload(channel_ref_t* channel_ref, int gso, int gro);
+
+/*
+ * 取得对端地址
+ * @param channel_ref channel_ref_t实例
+ * @return address_t实例
  */
 address_t* channel_ref_get_peer_address(channel_ref_t* channel_ref);
 
 /*
- * ȡñصַ
- * @param channel_ref channel_ref_tʵ
- * @return address_tʵ
+ * 取得本地地址
+ * @param channel_ref channel_ref_t实例
+ * @return address_t实例
  */
 address_t* channel_ref_get_local_address(channel_ref_t* channel_ref);
 
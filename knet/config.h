@@ -39,12 +39,14 @@
         #define FD_SETSIZE 1024
     #endif /* defined(FD_SETSIZE) */
     #include <winsock2.h>
+    #include <ws2tcpip.h>
     #include <mswsock.h>
     #define WIN32_LEAN_AND_MEAN
     #include <windows.h>
     #include <process.h>
     #if defined(_MSC_VER )
         #pragma comment(lib,"wsock32.lib")
+        #pragma comment(lib,"ws2_32.lib")
     #endif /* defined(_MSC_VER) */
     #define socket_t SOCKET
     #define socket_len_t int
@@ -52,6 +54,7 @@
     #define atomic_counter_t volatile LONG
     #define uint32_t unsigned int
     #define uint64_t unsigned long long
+    #define int64_t long long
 #else
     #include <stdint.h>
     #include <errno.h>
@@ -60,6 +63,7 @@
     #include <netinet/in.h>
     #include <sys/socket.h>
     #include <sys/time.h>
+    #include <sys/uio.h>
     #include <arpa/inet.h>
     #include <fcntl.h>
     #include <unistd.h>
@@ -100,18 +104,37 @@
 #define min(a, b) ((a) < (b) ? (a) : (b))
 #endif
 
+#ifndef max
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
 typedef struct _loop_t loop_t;
 typedef struct _channel_t channel_t;
 typedef struct _channel_ref_t channel_ref_t;
 typedef struct _address_t address_t;
 typedef struct _lock_t lock_t;
 typedef struct _loop_balancer_t loop_balancer_t;
+typedef struct _loop_group_t loop_group_t;
 typedef struct _thread_runner_t thread_runner_t;
 typedef struct _stream_t stream_t;
 typedef struct _dlist_t dlist_t;
 typedef struct _dlist_node_t dlist_node_t;
 typedef struct _ringbuffer_t ringbuffer_t;
 typedef struct _buffer_t buffer_t;
+typedef struct _frame_t frame_t;
+typedef struct _filter_t filter_t;
+typedef struct _http_t http_t;
+typedef struct _http_request_t http_request_t;
+typedef struct _resp_t resp_t;
+typedef struct _resp_reply_t resp_reply_t;
+typedef struct _ws_t ws_t;
+typedef struct _udp_t udp_t;
+typedef struct _shm_t shm_t;
+typedef struct _inproc_t inproc_t;
+typedef struct _pool_t pool_t;
+typedef struct _pool_conn_t pool_conn_t;
+typedef struct _resolver_t resolver_t;
+typedef struct _resolver_job_t resolver_job_t;
 
 typedef enum _channel_event_e {
     channel_event_recv = 1,
@@ -119,10 +142,10 @@ typedef enum _channel_event_e {
 } channel_event_e;
 
 typedef enum _channel_state_e {
-    channel_state_connect = 1, /* ӣδ */
-    channel_state_accept = 2,  /*  */
-    channel_state_close = 4,   /* ܵѹر */
-    channel_state_active = 8,  /* ܵѼշ */
+    channel_state_connect = 1, /* 主动发起连接，连接未完成 */
+    channel_state_accept = 2,  /* 监听 */
+    channel_state_close = 4,   /* 管道已关闭 */
+    channel_state_active = 8,  /* 管道已激活，可以收发数据 */
 } channel_state_e;
 
 typedef enum _error_e {
@@ -146,20 +169,93 @@ typedef enum _error_e {
     error_impl_add_channel_ref_fail,
     error_getpeername,
     error_getsockname,
+    error_recv_budget,
+    error_frame_too_large,
+    error_frame_invalid,
+    error_filter_fail,
+    error_frame_checksum,
+    error_http_state,
+    error_http_thread,
+    error_resp_invalid,
+    error_ws_handshake,
+    error_ws_state,
+    error_udp_queue_full,
+    error_udp_address,
+    error_udp_offload,
+    error_shm_create,
+    error_shm_transfer,
+    error_resolve_fail,
+    error_loop_full,
+    error_migrate_fail,
 } error_e;
 
 typedef enum _channel_cb_event_e {
-    channel_cb_event_connect = 1,          /*  */
-    channel_cb_event_accept = 2,           /* ܵ */ 
-    channel_cb_event_recv = 4,             /* ܵݿԶ */
-    channel_cb_event_send = 8,             /* ֽܵڣ */
-    channel_cb_event_close = 16,           /* ܵر */
-    channel_cb_event_timeout = 32,         /* ܵ */
-    channel_cb_event_connect_timeout = 64, /* ӣӳʱ */
+    channel_cb_event_connect = 1,          /* 连接完成 */
+    channel_cb_event_accept = 2,           /* 管道监听到了新连接请求 */ 
+    channel_cb_event_recv = 4,             /* 管道有数据可以读 */
+    channel_cb_event_send = 8,             /* 管道发送了字节，保留 */
+    channel_cb_event_close = 16,           /* 管道关闭 */
+    channel_cb_event_timeout = 32,         /* 管道读空闲 */
+    channel_cb_event_connect_timeout = 64, /* 主动发起连接，但连接超时 */
+    channel_cb_event_ws_open = 128,        /* WebSocket握手完成 */
 } channel_cb_event_e;
 
+typedef enum _frame_type_e {
+    frame_type_2 = 2,       /* 2字节长度头 */
+    frame_type_4 = 4,       /* 4字节长度头 */
+    frame_type_8 = 8,       /* 8字节长度头 */
+    frame_type_varint = 16, /* 变长(varint)长度头，每字节7位，最多10字节 */
+} frame_type_e;
+
+typedef enum _resp_type_e {
+    resp_type_string = 1, /* 简单字符串 + */
+    resp_type_error,      /* 错误 - */
+    resp_type_integer,    /* 整数 : */
+    resp_type_bulk,       /* 二进制安全字符串 $ */
+    resp_type_array,      /* 数组 * */
+    resp_type_null,       /* 空值 _ $-1 *-1 */
+    resp_type_boolean,    /* 布尔 # (RESP3) */
+    resp_type_double,     /* 浮点数 , (RESP3) */
+    resp_type_big_number, /* 大整数 ( (RESP3) */
+    resp_type_bulk_error, /* 二进制安全错误 ! (RESP3) */
+    resp_type_verbatim,   /* 带格式的字符串 = (RESP3) */
+    resp_type_map,        /* 映射 % (RESP3) */
+    resp_type_set,        /* 集合 ~ (RESP3) */
+    resp_type_push,       /* 推送 > (RESP3) */
+} resp_type_e;
+
+typedef enum _ws_opcode_e {
+    ws_opcode_continuation = 0, /* 分片消息的后续帧 */
+    ws_opcode_text = 1,         /* 文本消息 */
+    ws_opcode_binary = 2,       /* 二进制消息 */
+    ws_opcode_close = 8,        /* 关闭 */
+    ws_opcode_ping = 9,         /* ping */
+    ws_opcode_pong = 10,        /* pong */
+} ws_opcode_e;
+
+typedef enum _loop_balancer_strategy_e {
+    loop_balancer_strategy_least_load = 1, /* 负载（活跃管道数量）最小，默认 */
+    loop_balancer_strategy_p2c,            /* 随机选取两个，取负载较小的一个 */
+    loop_balancer_strategy_ewma,           /* 按空闲程度（1 - 繁忙程度EWMA）加权随机 */
+    loop_balancer_strategy_weight,         /* 按静态权重，负载/权重最小 */
+    loop_balancer_strategy_round_robin,    /* 轮询 */
+    loop_balancer_strategy_affinity,       /* 按对端地址或应用键一致性散列（rendezvous），无键时负载最小 */
+} loop_balancer_strategy_e;
+
+typedef enum _filter_dir_e {
+    filter_dir_in = 1,  /* 读方向，处理分帧器解出的消息 */
+    filter_dir_out = 2, /* 写方向，处理channel_ref_write_frame写入的消息 */
+} filter_dir_e;
+
 typedef void (*thread_func_t)(thread_runner_t*);
 typedef void (*channel_ref_cb_t)(channel_ref_t* channel, channel_cb_event_e e);
+typedef void (*channel_ref_frame_cb_t)(channel_ref_t* channel, const char* data, uint32_t size);
+typedef int (*filter_func_t)(filter_t* filter, channel_ref_t* channel, buffer_t* chain);
+typedef void (*channel_ref_http_cb_t)(channel_ref_t* channel, http_request_t* request);
+typedef void (*resp_reply_cb_t)(channel_ref_t* channel, resp_reply_t* reply, void* data);
+typedef void (*channel_ref_udp_cb_t)(channel_ref_t* channel, const char* data, uint32_t size, address_t* address);
+typedef void (*pool_lease_cb_t)(channel_ref_t* channel, void* data);
+typedef void (*resolver_cb_t)(const struct sockaddr* addr, int len, void* data);
 
 #if defined(WIN32) || defined(WIN64)
 #define LOOP_IOCP 1    /* IOCP */
@@ -169,8 +265,29 @@ typedef void (*channel_ref_cb_t)(channel_ref_t* channel, channel_cb_event_e e);
 #define LOOP_SELECT 0  /* select */
 #endif /* defined(WIN32) || defined(WIN64) */
 
-#define TEST 1               /* Ƿ */
-#define TEST_ONE_LOOP 0      /* ̣߳loop_t */
-#define TEST_MULTI_THREAD 1  /* ̣߳loop_t */
+#define TEST 1               /* 是否开启测试 */
+#define TEST_ONE_LOOP 0      /* 单线程，单loop_t测试 */
+#define TEST_MULTI_THREAD 1  /* 多线程，多loop_t测试 */
+#define TEST_HTTP 0          /* HTTP服务端压力测试 */
+#define TEST_RESP 0          /* RESP客户端管线化测试 */
+#define TEST_UDP 0           /* UDP数据报收发测试 */
+#define TEST_POOL 0          /* 客户端连接池复用测试 */
+#define TEST_BALANCER 0      /* 负载均衡策略分布测试 */
+#define TEST_MIGRATE 0       /* 管道迁移及自动迁移测试 */
+#define TEST_AFFINITY 0      /* 亲和负载均衡及延迟绑定测试 */
+#define TEST_GROUP 0         /* 弹性事件循环组扩容及回收测试 */
+#define TEST_RESOLVER 0      /* 域名解析、缓存及过期测试 */
+#define TEST_WS 0            /* WebSocket握手、回显及协议校验测试 */
+#define TEST_UNIX 0          /* UNIX域套接字与TCP往返延迟对比测试 */
+#define TEST_SHM 0           /* 共享内存管道延迟及传输测试 */
+#define TEST_INPROC 0        /* 进程内管道延迟及传输测试 */
+#define TEST_FILTER 0        /* 过滤器各阶段开销及运行中删除测试 */
+#define TEST_FRAME 0         /* 分帧各长度头类型往返及最大长度测试 */
+#define TEST_CRC32C 0        /* CRC32C已知向量及各实现一致性测试 */
+#define TEST_IPV6 0          /* IPv6及双栈TCP/UDP地址测试 */
+#define TEST_FASTOPEN 0      /* TCP Fast Open回显及SYN携带数据测试 */
+#define TEST_BUDGET 0        /* 读预算公平性及每次循环读取上限测试 */
+#define TEST_LOWAT 0         /* 读低水位回调次数及动态调整测试 */
+#define TEST_FIND 0          /* 环形缓冲区分隔符查找正确性及吞吐测试 */
 
 #endif /* CONFIG_H */
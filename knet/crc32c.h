@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include "config.h"
+#include "crc32c_api.h"
+
+/*
+ * 计算环形缓冲区内一段数据的CRC32C，不拷贝也不取走数据
+ * @param crc 之前的计算结果，首次计算为0
+ * @param rb ringbuffer_t实例
+ * @param offset 相对于读位置的偏移
+ * @param size 数据长度
+ * @return CRC32C
+ */
+uint32_t crc32c_update_ringbuffer(uint32_t crc, ringbuffer_t* rb, uint32_t offset, uint32_t size);
+
+/*
+ * 强制使用查表实现，用于与硬件指令实现对比测试
+ * @param soft 非零使用查表实现，零恢复自动选择
+ */
+void crc32c_force_soft(int soft);
+
+/*
+ * 检查当前CPU是否支持硬件指令实现
+ * @retval 0 不支持
+ * @retval 非零 支持
+ */
+int crc32c_check_hardware();
+
+#endif /* CRC32C_H */
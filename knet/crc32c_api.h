@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRC32C_API_H
+#define CRC32C_API_H
+
+/*
+ * 计算CRC32C(Castagnoli)
+ * 支持SSE4.2的x86 CPU上使用crc32指令（运行时检测），否则查表计算，
+ * 可以分段增量计算: crc = crc32c_update(crc32c_update(0, a, n), b, m)
+ * @param crc 之前的计算结果，首次计算为0
+ * @param data 数据指针
+ * @param size 数据长度
+ * @return CRC32C
+ */
+uint32_t crc32c_update(uint32_t crc, const char* data, uint32_t size);
+
+/*
+ * 计算缓冲区链表内所有数据的CRC32C
+ * @param crc 之前的计算结果，首次计算为0
+ * @param chain 缓冲区链表
+ * @return CRC32C
+ */
+uint32_t crc32c_update_buffer_chain(uint32_t crc, buffer_t* chain);
+
+#endif /* CRC32C_API_H */
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "filter.h"
+#include "buffer.h"
+#include "channel_ref.h"
+
+struct _filter_t {
+    filter_dir_e  dir;       /* 方向 */
+    char*         name;      /* 名称 */
+    filter_func_t func;      /* 过滤函数 */
+    void*         data;      /* 用户数据 */
+    filter_t*     next;      /* 下一个过滤器 */
+    int           removed;   /* 过滤器链运行期间被删除，运行结束后销毁 */
+    uint64_t      calls;     /* 调用次数 */
+    uint64_t      bytes_in;  /* 输入字节数 */
+    uint64_t      bytes_out; /* 输出字节数 */
+};
+
+filter_t* filter_create(filter_dir_e dir, const char* name, filter_func_t func, void* data) {
+    filter_t* filter = create(filter_t);
+    assert(filter);
+    assert(name);
+    assert(func);
+    memset(filter, 0, sizeof(filter_t));
+    filter->name = create_raw(strlen(name) + 1);
+    assert(filter->name);
+    strcpy(filter->name, name);
+    filter->dir  = dir;
+    filter->func = func;
+    filter->data = data;
+    return filter;
+}
+
+void filter_destroy(filter_t* filter) {
+    assert(filter);
+    destroy(filter->name);
+    destroy(filter);
+}
+
+void filter_chain_destroy(filter_t* filter) {
+    filter_t* next = 0;
+    for (; filter; filter = next) {
+        next = filter->next;
+        filter_destroy(filter);
+    }
+}
+
+void filter_set_next(filter_t* filter, filter_t* next) {
+    assert(filter);
+    filter->next = next;
+}
+
+filter_t* filter_get_next(filter_t* filter) {
+    assert(filter);
+    return filter->next;
+}
+
+void filter_set_removed(filter_t* filter) {
+    assert(filter);
+    filter->removed = 1;
+}
+
+int filter_check_removed(filter_t* filter) {
+    assert(filter);
+    return filter->removed;
+}
+
+int filter_run(filter_t* filter, channel_ref_t* channel_ref, buffer_t* chain) {
+    filter_dir_e dir = filter_dir_in;
+    assert(filter);
+    assert(channel_ref);
+    assert(chain);
+    dir = filter->dir;
+    /* 跳过运行期间被删除的过滤器 */
+    for (; filter && filter->removed; filter = filter->next);
+    if (!filter) {
+        return channel_ref_filter_done(channel_ref, dir, chain);
+    }
+    filter->calls++;
+    filter->bytes_in += buffer_chain_get_length(chain);
+    return filter->func(filter, channel_ref, chain);
+}
+
+int filter_emit(filter_t* filter, channel_ref_t* channel_ref, buffer_t* chain) {
+    assert(filter);
+    assert(channel_ref);
+    assert(chain);
+    filter->bytes_out += buffer_chain_get_length(chain);
+    if (filter->next) {
+        return filter_run(filter->next, channel_ref, chain);
+    }
+    /* 最后一个过滤器 */
+    return channel_ref_filter_done(channel_ref, filter->dir, chain);
+}
+
+const char* filter_get_name(filter_t* filter) {
+    assert(filter);
+    return filter->name;
+}
+
+void* filter_get_data(filter_t* filter) {
+    assert(filter);
+    return filter->data;
+}
+
+uint64_t filter_get_calls(filter_t* filter) {
+    assert(filter);
+    return filter->calls;
+}
+
+uint64_t filter_get_bytes_in(filter_t* filter) {
+    assert(filter);
+    return filter->bytes_in;
+}
+
+uint64_t filter_get_bytes_out(filter_t* filter) {
+    assert(filter);
+    return filter->bytes_out;
+}
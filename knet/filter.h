@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "config.h"
+#include "filter_api.h"
+
+/*
+ * 创建过滤器
+ * @param dir 方向
+ * @param name 名称
+ * @param func 过滤函数
+ * @param data 用户数据
+ * @return filter_t实例
+ */
+filter_t* filter_create(filter_dir_e dir, const char* name, filter_func_t func, void* data);
+
+/*
+ * 销毁过滤器
+ * @param filter filter_t实例
+ */
+void filter_destroy(filter_t* filter);
+
+/*
+ * 销毁过滤器及其后的所有过滤器
+ * @param filter 第一个过滤器
+ */
+void filter_chain_destroy(filter_t* filter);
+
+/*
+ * 设置下一个过滤器
+ * @param filter filter_t实例
+ * @param next 下一个过滤器，0表示最后一个
+ */
+void filter_set_next(filter_t* filter, filter_t* next);
+
+/*
+ * 取得下一个过滤器
+ * @param filter filter_t实例
+ * @return 下一个过滤器
+ */
+filter_t* filter_get_next(filter_t* filter);
+
+/*
+ * 标记为已删除
+ * 过滤器链运行期间删除的过滤器保留在链表内，不再被调用，运行结束后由channel_ref_t销毁
+ * @param filter filter_t实例
+ */
+void filter_set_removed(filter_t* filter);
+
+/*
+ * 检查是否已被删除
+ * @param filter filter_t实例
+ * @retval 0 未删除
+ * @retval 非零 已删除
+ */
+int filter_check_removed(filter_t* filter);
+
+/*
+ * 调用过滤函数
+ * 缓冲区链表的所有权转移给过滤函数，跳过已删除的过滤器，之后没有过滤器时直接完成
+ * @param filter filter_t实例
+ * @param channel_ref channel_ref_t实例
+ * @param chain 缓冲区链表
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int filter_run(filter_t* filter, channel_ref_t* channel_ref, buffer_t* chain);
+
+#endif /* FILTER_H */
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FILTER_API_H
+#define FILTER_API_H
+
+/*
+ * 将处理后的缓冲区链表交给下一个过滤器
+ * 缓冲区链表的所有权随之转移，调用后不能再访问链表内的缓冲区，
+ * 最后一个过滤器调用时，读方向交给分帧回调，写方向加上长度头后发送
+ * @param filter 当前过滤器
+ * @param channel_ref channel_ref_t实例
+ * @param chain 缓冲区链表
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int filter_emit(filter_t* filter, channel_ref_t* channel_ref, buffer_t* chain);
+
+/*
+ * 取得过滤器名称
+ * @param filter filter_t实例
+ * @return 名称
+ */
+const char* filter_get_name(filter_t* filter);
+
+/*
+ * 取得过滤器用户数据
+ * @param filter filter_t实例
+ * @return 用户数据
+ */
+void* filter_get_data(filter_t* filter);
+
+/*
+ * 取得过滤器被调用的次数
+ * @param filter filter_t实例
+ * @return 调用次数
+ */
+uint64_t filter_get_calls(filter_t* filter);
+
+/*
+ * 取得进入过滤器的字节数
+ * @param filter filter_t实例
+ * @return 字节数
+ */
+uint64_t filter_get_bytes_in(filter_t* filter);
+
+/*
+ * 取得过滤器输出的字节数
+ * @param filter filter_t实例
+ * @return 字节数
+ */
+uint64_t filter_get_bytes_out(filter_t* filter);
+
+#endif /* FILTER_API_H */
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "frame.h"
+#include "channel_ref.h"
+#include "ringbuffer.h"
+#include "crc32c.h"
+
+struct _frame_t {
+    frame_type_e           type;        /* 长度头类型 */
+    int                    big_endian;  /* 固定长度头是否为大端字节序 */
+    uint32_t               max_size;    /* 消息体最大长度 */
+    int                    checksum;    /* 长度头后是否跟随消息体的CRC32C */
+    channel_ref_frame_cb_t cb;          /* 消息回调 */
+    char*                  buffer;      /* 跨越绕回点的消息拼接缓冲区 */
+    uint32_t               buffer_size; /* 拼接缓冲区长度 */
+};
+
+frame_t* frame_create(frame_type_e type, int big_endian, uint32_t max_size, channel_ref_frame_cb_t cb) {
+    frame_t* frame = create(frame_t);
+    assert(frame);
+    memset(frame, 0, sizeof(frame_t));
+    frame->type       = type;
+    frame->big_endian = big_endian;
+    frame->max_size   = max_size;
+    frame->cb         = cb;
+    return frame;
+}
+
+frame_t* frame_clone(frame_t* frame) {
+    frame_t* clone = 0;
+    assert(frame);
+    clone = frame_create(frame->type, frame->big_endian, frame->max_size, frame->cb);
+    clone->checksum = frame->checksum;
+    return clone;
+}
+
+void frame_destroy(frame_t* frame) {
+    assert(frame);
+    if (frame->buffer) {
+        destroy(frame->buffer);
+    }
+    destroy(frame);
+}
+
+uint32_t frame_get_max_size(frame_t* frame) {
+    assert(frame);
+    return frame->max_size;
+}
+
+void frame_set_checksum(frame_t* frame, int checksum) {
+    assert(frame);
+    frame->checksum = checksum;
+}
+
+int frame_get_checksum(frame_t* frame) {
+    assert(frame);
+    return frame->checksum;
+}
+
+channel_ref_frame_cb_t frame_get_cb(frame_t* frame) {
+    assert(frame);
+    return frame->cb;
+}
+
+uint32_t frame_get_min_header_size(frame_t* frame) {
+    assert(frame);
+    if (frame->type == frame_type_varint) {
+        return 1;
+    }
+    return (uint32_t)frame->type;
+}
+
+uint32_t frame_encode_header(frame_t* frame, char* header, uint64_t size) {
+    uint32_t i      = 0;
+    uint32_t length = 0;
+    assert(frame);
+    assert(header);
+    if (frame->type == frame_type_varint) {
+        do {
+            header[length] = (char)(size & 0x7f);
+            size >>= 7;
+            if (size) {
+                header[length] |= 0x80;
+            }
+            length++;
+        } while (size);
+        return length;
+    }
+    length = (uint32_t)frame->type;
+    for (; i < length; i++) {
+        if (frame->big_endian) {
+            header[length - i - 1] = (char)(size >> (i * 8));
+        } else {
+            header[i] = (char)(size >> (i * 8));
+        }
+    }
+    return length;
+}
+
+uint32_t frame_encode_checksum(frame_t* frame, char* header, uint32_t crc) {
+    uint32_t i = 0;
+    assert(frame);
+    assert(header);
+    /* 与固定长度头字节序相同，varint长度头使用小端 */
+    for (; i < FRAME_CHECKSUM_SIZE; i++) {
+        if (frame->big_endian && (frame->type != frame_type_varint)) {
+            header[FRAME_CHECKSUM_SIZE - i - 1] = (char)(crc >> (i * 8));
+        } else {
+            header[i] = (char)(crc >> (i * 8));
+        }
+    }
+    return FRAME_CHECKSUM_SIZE;
+}
+
+uint32_t frame_decode_checksum(frame_t* frame, const char* header) {
+    uint32_t i   = 0;
+    uint32_t crc = 0;
+    assert(frame);
+    assert(header);
+    for (; i < FRAME_CHECKSUM_SIZE; i++) {
+        if (frame->big_endian && (frame->type != frame_type_varint)) {
+            crc = (crc << 8) | (unsigned char)header[i];
+        } else {
+            crc |= (uint32_t)(unsigned char)header[i] << (i * 8);
+        }
+    }
+    return crc;
+}
+
+int frame_decode_header(frame_t* frame, const char* header, uint32_t length, uint64_t* size) {
+    uint32_t i      = 0;
+    uint32_t bytes  = 0;
+    uint64_t value  = 0;
+    assert(frame);
+    assert(header);
+    assert(size);
+    if (frame->type == frame_type_varint) {
+        for (; (i < length) && (i < FRAME_MAX_HEADER_SIZE); i++) {
+            value |= (uint64_t)(header[i] & 0x7f) << (i * 7);
+            if (!(header[i] & 0x80)) {
+                *size = value;
+                return (int)(i + 1);
+            }
+        }
+        if (i == FRAME_MAX_HEADER_SIZE) {
+            /* 超过10字节 */
+            return -1;
+        }
+        return 0;
+    }
+    bytes = (uint32_t)frame->type;
+    if (length < bytes) {
+        return 0;
+    }
+    for (; i < bytes; i++) {
+        if (frame->big_endian) {
+            value = (value << 8) | (unsigned char)header[i];
+        } else {
+            value |= (uint64_t)(unsigned char)header[i] << (i * 8);
+        }
+    }
+    *size = value;
+    return (int)bytes;
+}
+
+int frame_update_recv(frame_t* frame, channel_ref_t* channel_ref) {
+    ringbuffer_t* rb          = 0;
+    char*         ptr         = 0;
+    uint32_t      available   = 0;
+    uint32_t      total       = 0;
+    uint64_t      size        = 0;
+    int           header_size = 0;
+    int           error       = error_ok;
+    uint32_t      extra       = 0;
+    char          header[FRAME_MAX_HEADER_SIZE + FRAME_CHECKSUM_SIZE];
+    assert(frame);
+    assert(channel_ref);
+    rb = channel_ref_get_ringbuffer(channel_ref);
+    extra = frame->checksum ? FRAME_CHECKSUM_SIZE : 0;
+    while (!channel_ref_check_state(channel_ref, channel_state_close)) {
+        available = ringbuffer_available(rb);
+        if (!available) {
+            channel_ref_set_recv_lowat(channel_ref, frame_get_min_header_size(frame));
+            break;
+        }
+        /* 长度头（和校验和）只拷贝最多14字节 */
+        header_size = frame_decode_header(frame, header,
+            ringbuffer_copy(rb, header, min(available, sizeof(header))), &size);
+        if (header_size < 0) {
+            return error_frame_invalid;
+        }
+        if (!header_size) {
+            /* 长度头不完整 */
+            channel_ref_set_recv_lowat(channel_ref, max(available + 1, frame_get_min_header_size(frame)));
+            break;
+        }
+        if (size > frame->max_size) {
+            return error_frame_too_large;
+        }
+        header_size += extra;
+        total = (uint32_t)header_size + (uint32_t)size;
+        if (available < total) {
+            /* 消息体不完整，收齐前不再回调 */
+            channel_ref_set_recv_lowat(channel_ref, total);
+            break;
+        }
+        if (extra) {
+            /* 在读缓冲区内直接校验，不拷贝消息体 */
+            if (frame_decode_checksum(frame, header + header_size - extra) !=
+                crc32c_update_ringbuffer(0, rb, header_size, (uint32_t)size)) {
+                return error_frame_checksum;
+            }
+        }
+        if (ringbuffer_read_lock_size(rb) >= total) {
+            /* 未跨越绕回点，直接使用读缓冲区内的数据，提交后数据在回调返回前保持有效 */
+            ptr = ringbuffer_read_lock_ptr(rb);
+            ringbuffer_read_commit(rb, total);
+        } else {
+            if (frame->buffer_size < total) {
+                if (frame->buffer) {
+                    destroy(frame->buffer);
+                }
+                frame->buffer = create_raw(total);
+                assert(frame->buffer);
+                frame->buffer_size = total;
+            }
+            ringbuffer_read(rb, frame->buffer, total);
+            ptr = frame->buffer;
+        }
+        error = channel_ref_dispatch_frame(channel_ref, ptr + header_size, (uint32_t)size);
+        if (error != error_ok) {
+            return error;
+        }
+    }
+    /* 读缓冲区有空间后恢复读事件 */
+    channel_ref_resume_recv(channel_ref);
+    return error_ok;
+}
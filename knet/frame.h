@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "config.h"
+
+#define FRAME_MAX_HEADER_SIZE 10 /* 长度头最大字节数 */
+#define FRAME_CHECKSUM_SIZE 4    /* 校验和字节数 */
+#define FRAME_MAX_SIZE ((uint32_t)-1 - FRAME_MAX_HEADER_SIZE - FRAME_CHECKSUM_SIZE) /* 消息体最大长度，加上长度头和校验和不超过uint32_t */
+
+/*
+ * 创建分帧器
+ * @param type 长度头类型
+ * @param big_endian 固定长度头是否为大端（网络）字节序，varint长度头忽略此参数
+ * @param max_size 消息体最大长度
+ * @param cb 消息回调
+ * @return frame_t实例
+ */
+frame_t* frame_create(frame_type_e type, int big_endian, uint32_t max_size, channel_ref_frame_cb_t cb);
+
+/*
+ * 以相同的设置创建分帧器
+ * @param frame frame_t实例
+ * @return frame_t实例
+ */
+frame_t* frame_clone(frame_t* frame);
+
+/*
+ * 销毁分帧器
+ * @param frame frame_t实例
+ */
+void frame_destroy(frame_t* frame);
+
+/*
+ * 取得消息体最大长度
+ * @param frame frame_t实例
+ * @return 消息体最大长度
+ */
+uint32_t frame_get_max_size(frame_t* frame);
+
+/*
+ * 设置是否校验消息体
+ * 开启后长度头之后跟随4字节的消息体CRC32C，字节序与长度头相同（varint长度头为小端）
+ * @param frame frame_t实例
+ * @param checksum 非零开启，零关闭
+ */
+void frame_set_checksum(frame_t* frame, int checksum);
+
+/*
+ * 检查是否校验消息体
+ * @param frame frame_t实例
+ * @return 非零开启，零关闭
+ */
+int frame_get_checksum(frame_t* frame);
+
+/*
+ * 取得消息回调
+ * @param frame frame_t实例
+ * @return 消息回调
+ */
+channel_ref_frame_cb_t frame_get_cb(frame_t* frame);
+
+/*
+ * 取得解析长度头至少需要的字节数
+ * @param frame frame_t实例
+ * @return 字节数
+ */
+uint32_t frame_get_min_header_size(frame_t* frame);
+
+/*
+ * 写入长度头
+ * @param frame frame_t实例
+ * @param header 长度头缓冲区，至少FRAME_MAX_HEADER_SIZE字节
+ * @param size 消息体长度
+ * @return 长度头字节数
+ */
+uint32_t frame_encode_header(frame_t* frame, char* header, uint64_t size);
+
+/*
+ * 写入校验和
+ * @param frame frame_t实例
+ * @param header 写入位置，至少FRAME_CHECKSUM_SIZE字节
+ * @param crc 消息体CRC32C
+ * @return 校验和字节数
+ */
+uint32_t frame_encode_checksum(frame_t* frame, char* header, uint32_t crc);
+
+/*
+ * 读取校验和
+ * @param frame frame_t实例
+ * @param header 校验和起始位置
+ * @return 消息体CRC32C
+ */
+uint32_t frame_decode_checksum(frame_t* frame, const char* header);
+
+/*
+ * 解析长度头
+ * @param frame frame_t实例
+ * @param header 长度头数据
+ * @param length 长度头数据长度
+ * @param size 消息体长度
+ * @retval >0 长度头字节数
+ * @retval 0 数据不足
+ * @retval <0 长度头错误
+ */
+int frame_decode_header(frame_t* frame, const char* header, uint32_t length, uint64_t* size);
+
+/*
+ * 从管道读缓冲区内取出所有完整的消息并回调
+ * 消息未跨越读缓冲区绕回点时直接回调读缓冲区内的地址，否则拷贝到分帧器内部缓冲区，
+ * 不完整的消息根据已解析的长度设置管道读低水位
+ * @param frame frame_t实例
+ * @param channel_ref channel_ref_t实例
+ * @retval error_ok 成功
+ * @retval 其他 失败，需要关闭管道
+ */
+int frame_update_recv(frame_t* frame, channel_ref_t* channel_ref);
+
+#endif /* FRAME_H */
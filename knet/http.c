@@ -0,0 +1,711 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ctype.h>
+#include "http.h"
+#include "channel_ref.h"
+#include "ringbuffer.h"
+#include "loop.h"
+#include "misc.h"
+
+typedef enum _http_state_e {
+    http_state_head = 1, /* 等待请求头 */
+    http_state_body,     /* 请求头已解析，等待消息体 */
+    http_state_response, /* 已回调，等待应答完成 */
+    http_state_close,    /* 应答后关闭，不再处理请求 */
+    http_state_upgrade,  /* 已切换到其他协议，不再处理请求 */
+} http_state_e;
+
+typedef struct _http_header_t {
+    uint32_t name;       /* 名称偏移 */
+    uint32_t name_size;  /* 名称长度 */
+    uint32_t value;      /* 值偏移 */
+    uint32_t value_size; /* 值长度 */
+} http_header_t;
+
+struct _http_request_t {
+    http_t*        http;                      /* 所属的http_t */
+    channel_ref_t* channel_ref;               /* 所属的管道 */
+    const char*    base;                      /* 请求在读缓冲区内的起始地址 */
+    uint32_t       method_size;               /* 方法长度，方法偏移总是0 */
+    uint32_t       uri;                       /* URI偏移 */
+    uint32_t       uri_size;                  /* URI长度 */
+    int            version;                   /* 次版本号 */
+    http_header_t  headers[HTTP_MAX_HEADERS]; /* 请求头偏移 */
+    int            header_count;              /* 请求头数量 */
+    uint32_t       head_size;                 /* 请求头长度（包括结束空行） */
+    uint32_t       body_size;                 /* 消息体长度 */
+    int            keep_alive;                /* 应答后是否保持连接 */
+};
+
+struct _http_t {
+    channel_ref_http_cb_t cb;                            /* 请求回调 */
+    http_state_e          state;                         /* 状态 */
+    uint32_t              scanned;                       /* 已查找过请求头结束标记的字节数 */
+    int                   dispatching;                   /* 正在回调 */
+    int                   chunked;                       /* 1: 分块应答 2: HTTP/1.0原样发送 */
+    http_request_t        request;                       /* 当前请求 */
+    char                  extra[HTTP_MAX_RESPONSE_HEADER]; /* 附加应答头 */
+    uint32_t              extra_size;                    /* 附加应答头长度 */
+};
+
+http_t* http_create(channel_ref_http_cb_t cb) {
+    http_t* http = create(http_t);
+    assert(http);
+    memset(http, 0, sizeof(http_t));
+    http->cb           = cb;
+    http->state        = http_state_head;
+    http->request.http = http;
+    return http;
+}
+
+http_t* http_clone(http_t* http) {
+    assert(http);
+    return http_create(http->cb);
+}
+
+void http_destroy(http_t* http) {
+    assert(http);
+    destroy(http);
+}
+
+static int http_equal_nocase(const char* data, uint32_t size, const char* s) {
+    uint32_t i = 0;
+    for (; i < size; i++) {
+        if (!s[i] || (tolower((unsigned char)data[i]) != tolower((unsigned char)s[i]))) {
+            return 0;
+        }
+    }
+    return !s[i];
+}
+
+/*
+ * 检查逗号分隔的列表内是否有token（不区分大小写），例如"keep-alive, Upgrade"包含"upgrade"
+ */
+static int http_check_token(const char* value, uint32_t size, const char* token) {
+    uint32_t start = 0;
+    uint32_t end   = 0;
+    uint32_t next  = 0;
+    while (start < size) {
+        for (next = start; (next < size) && (value[next] != ','); next++);
+        /* 去掉token前后的空白 */
+        for (end = next; (end > start) && ((value[end - 1] == ' ') || (value[end - 1] == '\t')); end--);
+        for (; (start < end) && ((value[start] == ' ') || (value[start] == '\t')); start++);
+        if (http_equal_nocase(value + start, end - start, token)) {
+            return 1;
+        }
+        start = next + 1;
+    }
+    return 0;
+}
+
+/*
+ * 检查是否在管道所属线程内，请求及应答状态只能在该线程访问
+ */
+static int http_check_thread(http_request_t* request) {
+    return (loop_get_thread_id(channel_ref_get_loop(request->channel_ref)) == thread_get_self_id());
+}
+
+static const char* http_get_reason(int status) {
+    switch (status) {
+        case 100: return "Continue";
+        case 101: return "Switching Protocols";
+        case 200: return "OK";
+        case 201: return "Created";
+        case 202: return "Accepted";
+        case 204: return "No Content";
+        case 206: return "Partial Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default: break;
+    }
+    return "Unknown";
+}
+
+static int http_append(char* buffer, uint32_t* pos, uint32_t size, const char* s, uint32_t length) {
+    if (length > size - *pos) {
+        return error_fail;
+    }
+    memcpy(buffer + *pos, s, length);
+    *pos += length;
+    return error_ok;
+}
+
+static const char* http_get_ptr(ringbuffer_t* rb, uint32_t size) {
+    if (ringbuffer_read_lock_size(rb) < size) {
+        /* 请求跨越绕回点，原地移动使其连续 */
+        ringbuffer_linearize(rb);
+        ringbuffer_read_lock_size(rb);
+    }
+    return ringbuffer_read_lock_ptr(rb);
+}
+
+/*
+ * 解析请求头，记录各部分在请求内的偏移
+ * @retval 0 成功
+ * @retval >0 失败，需要返回的状态码
+ */
+static int http_parse_head(http_request_t* request, const char* p, uint32_t size) {
+    uint32_t       i      = 0;
+    uint32_t       start  = 0;
+    uint32_t       end    = 0;
+    uint32_t       colon  = 0;
+    uint64_t       length = 0;
+    const char*    line   = 0;
+    http_header_t* header = 0;
+    int            close  = 0;
+    int            sized  = 0;
+    request->header_count = 0;
+    request->body_size    = 0;
+    /* 请求行: 方法 URI 版本 */
+    line = (const char*)memchr(p, '\n', size);
+    end  = (uint32_t)(line - p);
+    if (end && (p[end - 1] == '\r')) {
+        end--;
+    }
+    for (; (i < end) && (p[i] != ' '); i++);
+    if (!i || (i == end)) {
+        return 400;
+    }
+    request->method_size = i;
+    start = ++i;
+    for (; (i < end) && (p[i] != ' '); i++);
+    if ((i == start) || (i == end)) {
+        return 400;
+    }
+    request->uri      = start;
+    request->uri_size = i - start;
+    i++;
+    if ((end - i != 8) || memcmp(p + i, "HTTP/1.", 7) || ((p[i + 7] != '0') && (p[i + 7] != '1'))) {
+        return 400;
+    }
+    request->version    = p[i + 7] - '0';
+    request->keep_alive = request->version;
+    start = (uint32_t)(line - p) + 1;
+    /* 请求头: 名称: 值 */
+    for (;;) {
+        line = (const char*)memchr(p + start, '\n', size - start);
+        if (!line) {
+            return 400;
+        }
+        end = (uint32_t)(line - p);
+        i   = end;
+        if ((end > start) && (p[end - 1] == '\r')) {
+            end--;
+        }
+        if (end == start) {
+            /* 空行，请求头结束 */
+            break;
+        }
+        if ((p[start] == ' ') || (p[start] == '\t')) {
+            /* 不支持折行 */
+            return 400;
+        }
+        for (colon = start; (colon < end) && (p[colon] != ':'); colon++) {
+            if ((p[colon] == ' ') || (p[colon] == '\t')) {
+                return 400;
+            }
+        }
+        if ((colon == start) || (colon == end)) {
+            return 400;
+        }
+        if (request->header_count >= HTTP_MAX_HEADERS) {
+            return 431;
+        }
+        header = &request->headers[request->header_count++];
+        header->name      = start;
+        header->name_size = colon - start;
+        /* 去掉值前后的空白 */
+        for (colon++; (colon < end) && ((p[colon] == ' ') || (p[colon] == '\t')); colon++);
+        for (; (end > colon) && ((p[end - 1] == ' ') || (p[end - 1] == '\t')); end--);
+        header->value      = colon;
+        header->value_size = end - colon;
+        if (http_equal_nocase(p + header->name, header->name_size, "Content-Length")) {
+            if (!header->value_size || sized) {
+                /* 重复的Content-Length，前端代理可能取另一个值，拒绝以防请求走私(RFC 7230 3.3.3) */
+                return 400;
+            }
+            sized = 1;
+            for (length = 0, colon = header->value; colon < end; colon++) {
+                if ((p[colon] < '0') || (p[colon] > '9')) {
+                    return 400;
+                }
+                length = length * 10 + (p[colon] - '0');
+                if (length > (uint32_t)-1) {
+                    return 413;
+                }
+            }
+            request->body_size = (uint32_t)length;
+        } else if (http_equal_nocase(p + header->name, header->name_size, "Transfer-Encoding")) {
+            /* 不支持分块请求 */
+            return 501;
+        } else if (http_equal_nocase(p + header->name, header->name_size, "Connection")) {
+            /* 值为token列表，例如"keep-alive, Upgrade"，同时出现时close优先 */
+            if (http_check_token(p + header->value, header->value_size, "close")) {
+                request->keep_alive = 0;
+                close = 1;
+            } else if (!close && http_check_token(p + header->value, header->value_size, "keep-alive")) {
+                request->keep_alive = 1;
+            }
+        }
+        start = i + 1;
+    }
+    return 0;
+}
+
+static void http_reject(http_t* http, channel_ref_t* channel_ref, int status) {
+    char     head[128] = {0};
+    uint32_t size      = 0;
+    http->state = http_state_close;
+    sprintf(head, "HTTP/1.1 %d %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", status, http_get_reason(status));
+    size = (uint32_t)strlen(head);
+    channel_ref_write(channel_ref, head, (int)size);
+    if (!channel_ref_check_state(channel_ref, channel_state_close)) {
+        channel_ref_close_after_send(channel_ref);
+    }
+}
+
+int http_update_recv(http_t* http, channel_ref_t* channel_ref) {
+    ringbuffer_t*   rb        = 0;
+    http_request_t* request   = 0;
+    uint32_t        available = 0;
+    uint32_t        max_size  = 0;
+    int             pos       = 0;
+    int             status    = 0;
+    char            c         = 0;
+    assert(http);
+    assert(channel_ref);
+    rb       = channel_ref_get_ringbuffer(channel_ref);
+    max_size = channel_ref_get_max_recv_ring_len(channel_ref);
+    request  = &http->request;
+    while (!channel_ref_check_state(channel_ref, channel_state_close)) {
+        if ((http->state == http_state_response) || (http->state == http_state_close) ||
+            (http->state == http_state_upgrade)) {
+            break;
+        }
+        available = ringbuffer_available(rb);
+        if (http->state == http_state_head) {
+            /* 跳过请求之间多余的空行 */
+            while (available && !http->scanned && ringbuffer_copy(rb, &c, 1) && ((c == '\r') || (c == '\n'))) {
+                ringbuffer_read(rb, &c, 1);
+                available--;
+            }
+            /* 只查找新到达的数据 */
+            pos = ringbuffer_find_offset(rb, http->scanned, "\r\n\r\n", 4);
+            if (pos < 0) {
+                if (available >= max_size) {
+                    http_reject(http, channel_ref, 431);
+                    break;
+                }
+                http->scanned = (available > 3) ? (available - 3) : 0;
+                channel_ref_set_recv_lowat(channel_ref, available + 1);
+                break;
+            }
+            request->head_size = (uint32_t)pos + 4;
+            status = http_parse_head(request, http_get_ptr(rb, request->head_size), request->head_size);
+            if (status) {
+                http_reject(http, channel_ref, status);
+                break;
+            }
+            if ((uint64_t)request->head_size + request->body_size > max_size) {
+                http_reject(http, channel_ref, 413);
+                break;
+            }
+            http->state = http_state_body;
+        }
+        if (available < request->head_size + request->body_size) {
+            /* 消息体收齐前不再回调 */
+            channel_ref_set_recv_lowat(channel_ref, request->head_size + request->body_size);
+            break;
+        }
+        request->channel_ref = channel_ref;
+        request->base        = http_get_ptr(rb, request->head_size + request->body_size);
+        http->state          = http_state_response;
+        http->dispatching    = 1;
+        http->cb(channel_ref, request);
+        http->dispatching    = 0;
+    }
+    if (http->state == http_state_response) {
+        /* 应答完成前暂停读取，读缓冲区不会扩展，请求数据保持有效 */
+        channel_ref_pause_recv(channel_ref);
+    } else {
+        channel_ref_resume_recv(channel_ref);
+    }
+    return error_ok;
+}
+
+static void http_response_done(http_t* http) {
+    http_request_t* request     = 0;
+    channel_ref_t*  channel_ref = 0;
+    ringbuffer_t*   rb          = 0;
+    request     = &http->request;
+    channel_ref = request->channel_ref;
+    rb          = channel_ref_get_ringbuffer(channel_ref);
+    /* 从读缓冲区内取走请求 */
+    ringbuffer_read_lock_size(rb);
+    ringbuffer_read_commit(rb, request->head_size + request->body_size);
+    request->base     = 0;
+    http->state       = http_state_head;
+    http->scanned     = 0;
+    http->chunked     = 0;
+    http->extra_size  = 0;
+    if (channel_ref_check_state(channel_ref, channel_state_close)) {
+        return;
+    }
+    if (!request->keep_alive) {
+        http->state = http_state_close;
+        channel_ref_close_after_send(channel_ref);
+        return;
+    }
+    if (!http->dispatching) {
+        /* 在回调外完成应答，继续处理已收到的请求 */
+        http_update_recv(http, channel_ref);
+    }
+}
+
+static int http_write_head(http_request_t* request, int status, const char* content_type, int chunked,
+    uint32_t size, const char* body) {
+    char        head[HTTP_MAX_RESPONSE_HEAD];
+    char        number[64]  = {0};
+    uint32_t    pos         = 0;
+    const char* ptr[2]      = {0};
+    uint32_t    len[2]      = {0};
+    http_t*     http        = request->http;
+    int         error       = error_ok;
+    sprintf(number, "HTTP/1.1 %d ", status);
+    error |= http_append(head, &pos, sizeof(head), number, (uint32_t)strlen(number));
+    error |= http_append(head, &pos, sizeof(head), http_get_reason(status), (uint32_t)strlen(http_get_reason(status)));
+    error |= http_append(head, &pos, sizeof(head), "\r\n", 2);
+    if (content_type) {
+        error |= http_append(head, &pos, sizeof(head), "Content-Type: ", 14);
+        error |= http_append(head, &pos, sizeof(head), content_type, (uint32_t)strlen(content_type));
+        error |= http_append(head, &pos, sizeof(head), "\r\n", 2);
+    }
+    if (chunked == 1) {
+        error |= http_append(head, &pos, sizeof(head), "Transfer-Encoding: chunked\r\n", 28);
+    } else if (!chunked) {
+        sprintf(number, "Content-Length: %u\r\n", size);
+        error |= http_append(head, &pos, sizeof(head), number, (uint32_t)strlen(number));
+    }
+    if (request->keep_alive) {
+        error |= http_append(head, &pos, sizeof(head), "Connection: keep-alive\r\n", 24);
+    } else {
+        error |= http_append(head, &pos, sizeof(head), "Connection: close\r\n", 19);
+    }
+    error |= http_append(head, &pos, sizeof(head), http->extra, http->extra_size);
+    error |= http_append(head, &pos, sizeof(head), "\r\n", 2);
+    if (error) {
+        return error_fail;
+    }
+    /* HEAD请求不发送消息体 */
+    if (http_request_check_method(request, "HEAD")) {
+        size = 0;
+    }
+    /* 应答头与消息体一次发送 */
+    ptr[0] = head;
+    len[0] = pos;
+    ptr[1] = body;
+    len[1] = size;
+    error = channel_ref_write_segments(request->channel_ref, ptr, len, (body && size) ? 2 : 1);
+    if (error == error_send_patial) {
+        return error_ok;
+    }
+    return error;
+}
+
+channel_ref_t* http_request_get_channel_ref(http_request_t* request) {
+    assert(request);
+    return request->channel_ref;
+}
+
+const char* http_request_get_method(http_request_t* request, uint32_t* size) {
+    assert(request);
+    assert(size);
+    *size = request->method_size;
+    return request->base;
+}
+
+int http_request_check_method(http_request_t* request, const char* method) {
+    assert(request);
+    assert(method);
+    return (strlen(method) == request->method_size) && !memcmp(request->base, method, request->method_size);
+}
+
+const char* http_request_get_uri(http_request_t* request, uint32_t* size) {
+    assert(request);
+    assert(size);
+    *size = request->uri_size;
+    return request->base + request->uri;
+}
+
+int http_request_get_version(http_request_t* request) {
+    assert(request);
+    return request->version;
+}
+
+int http_request_get_header_count(http_request_t* request) {
+    assert(request);
+    return request->header_count;
+}
+
+int http_request_get_header(http_request_t* request, int index, const char** name, uint32_t* name_size,
+    const char** value, uint32_t* value_size) {
+    http_header_t* header = 0;
+    assert(request);
+    if ((index < 0) || (index >= request->header_count)) {
+        return error_fail;
+    }
+    header = &request->headers[index];
+    if (name) {
+        *name = request->base + header->name;
+    }
+    if (name_size) {
+        *name_size = header->name_size;
+    }
+    if (value) {
+        *value = request->base + header->value;
+    }
+    if (value_size) {
+        *value_size = header->value_size;
+    }
+    return error_ok;
+}
+
+const char* http_request_find_header(http_request_t* request, const char* name, uint32_t* size) {
+    int            i      = 0;
+    http_header_t* header = 0;
+    assert(request);
+    assert(name);
+    assert(size);
+    for (; i < request->header_count; i++) {
+        header = &request->headers[i];
+        if (http_equal_nocase(request->base + header->name, header->name_size, name)) {
+            *size = header->value_size;
+            return request->base + header->value;
+        }
+    }
+    *size = 0;
+    return 0;
+}
+
+const char* http_request_get_body(http_request_t* request, uint32_t* size) {
+    assert(request);
+    assert(size);
+    *size = request->body_size;
+    return request->base + request->head_size;
+}
+
+int http_request_check_keep_alive(http_request_t* request) {
+    assert(request);
+    return request->keep_alive;
+}
+
+int http_request_check_header_token(http_request_t* request, const char* name, const char* token) {
+    int            i      = 0;
+    http_header_t* header = 0;
+    assert(request);
+    assert(name);
+    assert(token);
+    for (; i < request->header_count; i++) {
+        header = &request->headers[i];
+        if (http_equal_nocase(request->base + header->name, header->name_size, name) &&
+            http_check_token(request->base + header->value, header->value_size, token)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int http_response_add_header(http_request_t* request, const char* name, const char* value) {
+    http_t*  http  = 0;
+    uint32_t pos   = 0;
+    int      error = error_ok;
+    assert(request);
+    assert(name);
+    assert(value);
+    http = request->http;
+    if (!http_check_thread(request)) {
+        return error_http_thread;
+    }
+    if ((http->state != http_state_response) || http->chunked) {
+        return error_http_state;
+    }
+    pos = http->extra_size;
+    error |= http_append(http->extra, &pos, sizeof(http->extra), name, (uint32_t)strlen(name));
+    error |= http_append(http->extra, &pos, sizeof(http->extra), ": ", 2);
+    error |= http_append(http->extra, &pos, sizeof(http->extra), value, (uint32_t)strlen(value));
+    error |= http_append(http->extra, &pos, sizeof(http->extra), "\r\n", 2);
+    if (error) {
+        return error_fail;
+    }
+    http->extra_size = pos;
+    return error_ok;
+}
+
+int http_response_write(http_request_t* request, int status, const char* content_type, const char* body, uint32_t size) {
+    http_t* http  = 0;
+    int     error = error_ok;
+    assert(request);
+    http = request->http;
+    if (!http_check_thread(request)) {
+        return error_http_thread;
+    }
+    if ((http->state != http_state_response) || http->chunked) {
+        return error_http_state;
+    }
+    error = http_write_head(request, status, content_type, 0, size, body);
+    http_response_done(http);
+    return error;
+}
+
+int http_response_switch(http_request_t* request, const char* protocol) {
+    char          head[HTTP_MAX_RESPONSE_HEAD];
+    uint32_t      pos   = 0;
+    http_t*       http  = 0;
+    ringbuffer_t* rb    = 0;
+    int           error = error_ok;
+    assert(request);
+    assert(protocol);
+    http = request->http;
+    if (!http_check_thread(request)) {
+        return error_http_thread;
+    }
+    if ((http->state != http_state_response) || http->chunked || !http->dispatching || !request->version) {
+        return error_http_state;
+    }
+    error |= http_append(head, &pos, sizeof(head), "HTTP/1.1 101 Switching Protocols\r\nUpgrade: ", 43);
+    error |= http_append(head, &pos, sizeof(head), protocol, (uint32_t)strlen(protocol));
+    error |= http_append(head, &pos, sizeof(head), "\r\nConnection: Upgrade\r\n", 23);
+    error |= http_append(head, &pos, sizeof(head), http->extra, http->extra_size);
+    error |= http_append(head, &pos, sizeof(head), "\r\n", 2);
+    if (error) {
+        return error_fail;
+    }
+    error = channel_ref_write(request->channel_ref, head, (int)pos);
+    if ((error != error_ok) && (error != error_send_patial)) {
+        return error;
+    }
+    /* 从读缓冲区内取走请求，之后的数据属于新协议 */
+    rb = channel_ref_get_ringbuffer(request->channel_ref);
+    ringbuffer_read_lock_size(rb);
+    ringbuffer_read_commit(rb, request->head_size + request->body_size);
+    request->base    = 0;
+    http->state      = http_state_upgrade;
+    http->extra_size = 0;
+    return error_ok;
+}
+
+int http_response_begin_chunked(http_request_t* request, int status, const char* content_type) {
+    http_t* http  = 0;
+    int     error = error_ok;
+    assert(request);
+    http = request->http;
+    if (!http_check_thread(request)) {
+        return error_http_thread;
+    }
+    if ((http->state != http_state_response) || http->chunked) {
+        return error_http_state;
+    }
+    if (!request->version) {
+        /* HTTP/1.0不支持分块，以关闭连接表示应答结束 */
+        request->keep_alive = 0;
+        http->chunked = 2;
+    } else {
+        http->chunked = 1;
+    }
+    error = http_write_head(request, status, content_type, http->chunked, 0, 0);
+    if (error != error_ok) {
+        http_response_done(http);
+    }
+    return error;
+}
+
+int http_response_write_chunk(http_request_t* request, const char* data, uint32_t size) {
+    char        length[16] = {0};
+    const char* ptr[3]     = {0};
+    uint32_t    len[3]     = {0};
+    http_t*     http       = 0;
+    int         error      = error_ok;
+    assert(request);
+    http = request->http;
+    if (!http_check_thread(request)) {
+        return error_http_thread;
+    }
+    if ((http->state != http_state_response) || !http->chunked) {
+        return error_http_state;
+    }
+    if (!size || http_request_check_method(request, "HEAD")) {
+        return error_ok;
+    }
+    assert(data);
+    if (http->chunked == 2) {
+        error = channel_ref_write_segments(request->channel_ref, &data, &size, 1);
+    } else {
+        /* 分块长度、数据、结束符一次发送 */
+        sprintf(length, "%x\r\n", size);
+        ptr[0] = length;
+        len[0] = (uint32_t)strlen(length);
+        ptr[1] = data;
+        len[1] = size;
+        ptr[2] = "\r\n";
+        len[2] = 2;
+        error = channel_ref_write_segments(request->channel_ref, ptr, len, 3);
+    }
+    if (error == error_send_patial) {
+        return error_ok;
+    }
+    return error;
+}
+
+int http_response_end_chunked(http_request_t* request) {
+    http_t* http  = 0;
+    int     error = error_ok;
+    assert(request);
+    http = request->http;
+    if (!http_check_thread(request)) {
+        return error_http_thread;
+    }
+    if ((http->state != http_state_response) || !http->chunked) {
+        return error_http_state;
+    }
+    if ((http->chunked == 1) && !http_request_check_method(request, "HEAD")) {
+        error = channel_ref_write(request->channel_ref, "0\r\n\r\n", 5);
+        if (error == error_send_patial) {
+            error = error_ok;
+        }
+    }
+    http_response_done(http);
+    return error;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HTTP_H
+#define HTTP_H
+
+#include "config.h"
+#include "http_api.h"
+
+#define HTTP_MAX_HEADERS 32           /* 请求头最大数量 */
+#define HTTP_MAX_RESPONSE_HEADER 1024 /* 附加应答头最大长度 */
+#define HTTP_MAX_RESPONSE_HEAD 2048   /* 应答头最大长度 */
+
+/*
+ * 创建HTTP服务端
+ * @param cb 请求回调
+ * @return http_t实例
+ */
+http_t* http_create(channel_ref_http_cb_t cb);
+
+/*
+ * 以相同的设置创建HTTP服务端
+ * @param http http_t实例
+ * @return http_t实例
+ */
+http_t* http_clone(http_t* http);
+
+/*
+ * 销毁HTTP服务端
+ * @param http http_t实例
+ */
+void http_destroy(http_t* http);
+
+/*
+ * 解析读缓冲区内的请求
+ * 请求头未收齐时只查找新到达的数据，收齐整个请求后回调
+ * @param http http_t实例
+ * @param channel_ref channel_ref_t实例
+ * @retval error_ok 成功
+ * @retval 其他 失败，需要关闭管道
+ */
+int http_update_recv(http_t* http, channel_ref_t* channel_ref);
+
+/*
+ * 以101应答切换到其他协议
+ * 只能在请求回调内调用，之后不再解析HTTP请求，读缓冲区内请求之后的数据属于新协议.
+ * 通过http_response_add_header添加的应答头一起发送
+ * @param request http_request_t实例
+ * @param protocol Upgrade应答头的值
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int http_response_switch(http_request_t* request, const char* protocol);
+
+#endif /* HTTP_H */
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HTTP_API_H
+#define HTTP_API_H
+
+/*
+ * 请求及应答状态属于管道，不加锁. 所有函数只能在管道所在线程调用（请求回调内，或由同一loop_t的
+ * 定时器等回调调用），应答函数在其他线程调用时返回error_http_thread
+ */
+
+/*
+ * 取得请求所属的管道
+ * @param request http_request_t实例
+ * @return channel_ref_t实例
+ */
+channel_ref_t* http_request_get_channel_ref(http_request_t* request);
+
+/*
+ * 取得请求方法
+ * 返回的字符串不以0结尾，下同
+ * @param request http_request_t实例
+ * @param size 长度
+ * @return 方法
+ */
+const char* http_request_get_method(http_request_t* request, uint32_t* size);
+
+/*
+ * 检查请求方法
+ * @param request http_request_t实例
+ * @param method 方法，例如"GET"
+ * @retval 1 是
+ * @retval 0 不是
+ */
+int http_request_check_method(http_request_t* request, const char* method);
+
+/*
+ * 取得请求URI
+ * @param request http_request_t实例
+ * @param size 长度
+ * @return URI
+ */
+const char* http_request_get_uri(http_request_t* request, uint32_t* size);
+
+/*
+ * 取得HTTP次版本号
+ * @param request http_request_t实例
+ * @retval 0 HTTP/1.0
+ * @retval 1 HTTP/1.1
+ */
+int http_request_get_version(http_request_t* request);
+
+/*
+ * 取得请求头数量
+ * @param request http_request_t实例
+ * @return 请求头数量
+ */
+int http_request_get_header_count(http_request_t* request);
+
+/*
+ * 取得请求头
+ * @param request http_request_t实例
+ * @param index 下标
+ * @param name 名称
+ * @param name_size 名称长度
+ * @param value 值
+ * @param value_size 值长度
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int http_request_get_header(http_request_t* request, int index, const char** name, uint32_t* name_size,
+    const char** value, uint32_t* value_size);
+
+/*
+ * 查找请求头
+ * 名称不区分大小写，有多个同名请求头时返回第一个
+ * @param request http_request_t实例
+ * @param name 名称
+ * @param size 值长度
+ * @retval 0 未找到
+ * @retval 非零 值
+ */
+const char* http_request_find_header(http_request_t* request, const char* name, uint32_t* size);
+
+/*
+ * 取得消息体
+ * @param request http_request_t实例
+ * @param size 长度
+ * @return 消息体，没有消息体时长度为0
+ */
+const char* http_request_get_body(http_request_t* request, uint32_t* size);
+
+/*
+ * 检查应答后是否保持连接
+ * @param request http_request_t实例
+ * @retval 1 是
+ * @retval 0 应答完成后关闭连接
+ */
+int http_request_check_keep_alive(http_request_t* request);
+
+/*
+ * 检查请求头的值内是否有指定的token
+ * 值按逗号分隔的列表解析，名称和token不区分大小写，检查所有同名请求头.
+ * 例如"Connection: keep-alive, Upgrade"包含"upgrade"
+ * @param request http_request_t实例
+ * @param name 名称
+ * @param token token
+ * @retval 1 是
+ * @retval 0 不是
+ */
+int http_request_check_header_token(http_request_t* request, const char* name, const char* token);
+
+/*
+ * 添加应答头
+ * 在http_response_write或http_response_begin_chunked之前调用
+ * @param request http_request_t实例
+ * @param name 名称
+ * @param value 值
+ * @retval error_ok 成功
+ * @retval error_http_thread 不在管道所在线程
+ * @retval 其他 失败
+ */
+int http_response_add_header(http_request_t* request, const char* name, const char* value);
+
+/*
+ * 发送完整应答
+ * 应答头与消息体通过一次聚合写发送，消息体不拷贝. 应答完成后请求失效，
+ * 只能在管道所在线程调用，可以在请求回调返回后调用
+ * @param request http_request_t实例
+ * @param status 状态码
+ * @param content_type Content-Type，可以为0
+ * @param body 消息体，可以为0
+ * @param size 消息体长度
+ * @retval error_ok 成功
+ * @retval error_http_thread 不在管道所在线程
+ * @retval 其他 失败
+ */
+int http_response_write(http_request_t* request, int status, const char* content_type, const char* body, uint32_t size);
+
+/*
+ * 开始分块(chunked)应答
+ * HTTP/1.0请求不支持分块，数据原样发送，应答完成后关闭连接
+ * @param request http_request_t实例
+ * @param status 状态码
+ * @param content_type Content-Type，可以为0
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int http_response_begin_chunked(http_request_t* request, int status, const char* content_type);
+
+/*
+ * 发送一个分块
+ * 分块长度、数据、结束符通过一次聚合写发送，数据不拷贝
+ * @param request http_request_t实例
+ * @param data 数据
+ * @param size 长度，为0时忽略
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int http_response_write_chunk(http_request_t* request, const char* data, uint32_t size);
+
+/*
+ * 结束分块应答
+ * 应答完成后请求失效
+ * @param request http_request_t实例
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int http_response_end_chunked(http_request_t* request);
+
+#endif /* HTTP_API_H */
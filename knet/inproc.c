@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "inproc.h"
+#include "buffer.h"
+#include "channel_ref.h"
+#include "loop.h"
+#include "misc.h"
+
+typedef struct _inproc_end_t {
+    buffer_t*      head;        /* 读队列首 */
+    buffer_t*      tail;        /* 读队列尾 */
+    channel_ref_t* channel_ref; /* 本端管道，未设置或已关闭时为0 */
+    int            posted;      /* 已放入本端loop就绪链表，读空前对端不必重复通知 */
+    int            closed;      /* 本端已关闭 */
+} inproc_end_t;
+
+typedef struct _inproc_pair_t {
+    lock_t*          lock;      /* 锁 - 读队列，通知标志 */
+    inproc_end_t     end[2];    /* 两端 */
+    atomic_counter_t ref_count; /* 未销毁的端数 */
+} inproc_pair_t;
+
+struct _inproc_t {
+    inproc_pair_t* pair;    /* 共享部分 */
+    int            side;    /* 0为第一端，1为第二端 */
+    buffer_t*      pending; /* 已从读队列取出但未读完的缓冲区，只由本端loop访问 */
+};
+
+void inproc_create_pair(inproc_t* pair[2]) {
+    inproc_pair_t* shared = 0;
+    int            i      = 0;
+    assert(pair);
+    shared = create(inproc_pair_t);
+    assert(shared);
+    memset(shared, 0, sizeof(inproc_pair_t));
+    shared->lock = lock_create();
+    assert(shared->lock);
+    shared->ref_count = 2;
+    for (; i < 2; i++) {
+        pair[i] = create(inproc_t);
+        assert(pair[i]);
+        pair[i]->pair    = shared;
+        pair[i]->side    = i;
+        pair[i]->pending = 0;
+    }
+}
+
+void inproc_destroy(inproc_t* inproc) {
+    inproc_pair_t* pair = 0;
+    assert(inproc);
+    pair = inproc->pair;
+    if (inproc->pending) {
+        buffer_chain_destroy(inproc->pending);
+    }
+    if (!atomic_counter_dec(&pair->ref_count)) {
+        /* 两端都已销毁 */
+        if (pair->end[0].head) {
+            buffer_chain_destroy(pair->end[0].head);
+        }
+        if (pair->end[1].head) {
+            buffer_chain_destroy(pair->end[1].head);
+        }
+        lock_destroy(pair->lock);
+        destroy(pair);
+    }
+    destroy(inproc);
+}
+
+/*
+ * 通知端所在loop读取，调用前需持有锁，关闭时会在同一把锁内清除channel_ref
+ */
+static void inproc_post(inproc_end_t* end) {
+    if (end->posted || !end->channel_ref) {
+        return;
+    }
+    end->posted = 1;
+    loop_post_ready_channel_ref(channel_ref_get_loop(end->channel_ref), end->channel_ref);
+}
+
+void inproc_set_channel_ref(inproc_t* inproc, channel_ref_t* channel_ref) {
+    inproc_end_t* end = 0;
+    assert(inproc);
+    assert(channel_ref);
+    end = &inproc->pair->end[inproc->side];
+    lock_lock(inproc->pair->lock);
+    end->channel_ref = channel_ref;
+    if (end->head || inproc->pair->end[1 - inproc->side].closed) {
+        /* 设置前对端已写入或已关闭 */
+        inproc_post(end);
+    }
+    lock_unlock(inproc->pair->lock);
+}
+
+int inproc_read_segments(inproc_t* inproc, char* ptr[], uint32_t size[], int count) {
+    inproc_end_t* end    = 0;
+    buffer_t*     buffer = 0;
+    uint32_t      offset = 0;
+    uint32_t      n      = 0;
+    uint32_t      bytes  = 0;
+    int           i      = 0;
+    int           closed = 0;
+    assert(inproc);
+    assert(ptr);
+    assert(size);
+    end = &inproc->pair->end[inproc->side];
+    for (;;) {
+        /* 先读完已取出的缓冲区，读取时不持有锁 */
+        while (inproc->pending && (i < count)) {
+            buffer = inproc->pending;
+            n = min(buffer_get_length(buffer), size[i] - offset);
+            memcpy(ptr[i] + offset, buffer_get_ptr(buffer), n);
+            buffer_adjust(buffer, n);
+            bytes  += n;
+            offset += n;
+            if (offset == size[i]) {
+                i++;
+                offset = 0;
+            }
+            if (!buffer_get_length(buffer)) {
+                inproc->pending = buffer_get_next(buffer);
+                buffer_destroy(buffer);
+            }
+        }
+        if (i >= count) {
+            /* 区域已填满，通知标志保持设置，由调用者继续读取 */
+            break;
+        }
+        /* 一次取出整个读队列 */
+        lock_lock(inproc->pair->lock);
+        inproc->pending = end->head;
+        end->head = 0;
+        end->tail = 0;
+        if (!inproc->pending) {
+            /* 已读空，对端下次写入时重新通知 */
+            end->posted = 0;
+            closed = inproc->pair->end[1 - inproc->side].closed;
+            if (closed && bytes) {
+                /* 关闭通知已被本次读取合并，重新通知，下次读取时返回关闭 */
+                inproc_post(end);
+            }
+        }
+        lock_unlock(inproc->pair->lock);
+        if (!inproc->pending) {
+            break;
+        }
+    }
+    if (!bytes && closed) {
+        /* 对端关闭前写入的数据已读完 */
+        return -1;
+    }
+    return (int)bytes;
+}
+
+int inproc_write_chain(inproc_t* inproc, buffer_t* chain) {
+    inproc_end_t* peer = 0;
+    buffer_t*     tail = 0;
+    assert(inproc);
+    assert(chain);
+    peer = &inproc->pair->end[1 - inproc->side];
+    for (tail = chain; buffer_get_next(tail); tail = buffer_get_next(tail));
+    lock_lock(inproc->pair->lock);
+    if (peer->closed) {
+        lock_unlock(inproc->pair->lock);
+        buffer_chain_destroy(chain);
+        return error_send_fail;
+    }
+    if (peer->tail) {
+        buffer_set_next(peer->tail, chain);
+    } else {
+        peer->head = chain;
+    }
+    peer->tail = tail;
+    inproc_post(peer);
+    lock_unlock(inproc->pair->lock);
+    return error_ok;
+}
+
+void inproc_close(inproc_t* inproc) {
+    inproc_end_t* end   = 0;
+    buffer_t*     chain = 0;
+    assert(inproc);
+    end = &inproc->pair->end[inproc->side];
+    lock_lock(inproc->pair->lock);
+    if (end->closed) {
+        lock_unlock(inproc->pair->lock);
+        return;
+    }
+    end->closed      = 1;
+    end->channel_ref = 0;
+    chain            = end->head;
+    end->head        = 0;
+    end->tail        = 0;
+    /* 对端读完剩余数据后关闭 */
+    inproc_post(&inproc->pair->end[1 - inproc->side]);
+    lock_unlock(inproc->pair->lock);
+    if (chain) {
+        buffer_chain_destroy(chain);
+    }
+    if (inproc->pending) {
+        buffer_chain_destroy(inproc->pending);
+        inproc->pending = 0;
+    }
+}
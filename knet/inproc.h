@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef INPROC_H
+#define INPROC_H
+
+#include "config.h"
+
+/*
+ * 创建进程内管道的两端
+ * 每端有一个读队列，写入时缓冲区链表直接移入对端读队列，不拷贝也不经过系统调用
+ * @param pair 两端的inproc_t实例
+ */
+void inproc_create_pair(inproc_t* pair[2]);
+
+/*
+ * 销毁一端，两端都销毁后释放共享部分
+ * @param inproc inproc_t实例
+ */
+void inproc_destroy(inproc_t* inproc);
+
+/*
+ * 设置本端管道，对端写入时将本端管道放入本端loop的就绪链表
+ * @param inproc inproc_t实例
+ * @param channel_ref channel_ref_t实例
+ */
+void inproc_set_channel_ref(inproc_t* inproc, channel_ref_t* channel_ref);
+
+/*
+ * 从读队列读取到多个区域
+ * 读空后清除通知标志，对端下次写入时重新通知
+ * @param inproc inproc_t实例
+ * @param ptr 区域起始指针数组
+ * @param size 区域长度数组
+ * @param count 区域数量
+ * @retval >0 读取的字节数
+ * @retval 0 读队列为空
+ * @retval <0 对端已关闭且读队列为空
+ */
+int inproc_read_segments(inproc_t* inproc, char* ptr[], uint32_t size[], int count);
+
+/*
+ * 将缓冲区链表移入对端读队列
+ * 缓冲区链表的所有权转移给对端，对端读空后首次写入时通知对端loop
+ * @param inproc inproc_t实例
+ * @param chain 缓冲区链表
+ * @retval error_ok 成功
+ * @retval error_send_fail 对端已关闭，缓冲区链表已被销毁
+ */
+int inproc_write_chain(inproc_t* inproc, buffer_t* chain);
+
+/*
+ * 关闭本端，丢弃未读数据，通知对端读完剩余数据后关闭
+ * @param inproc inproc_t实例
+ */
+void inproc_close(inproc_t* inproc);
+
+#endif /* INPROC_H */
@@ -29,6 +29,16 @@
 #include "stream_api.h"
 #include "channel_ref_api.h"
 #include "address_api.h"
+#include "buffer_api.h"
+#include "filter_api.h"
+#include "crc32c_api.h"
+#include "http_api.h"
+#include "resp_api.h"
+#include "ws_api.h"
+#include "shm_api.h"
+#include "pool_api.h"
+#include "resolver_api.h"
 #include "loop_balancer_api.h"
+#include "loop_group_api.h"
 
 #endif /* KNET_H */
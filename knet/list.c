@@ -26,7 +26,7 @@
 #include "list.h"
 #include "misc.h"
 
-/* ڵ */
+/* 链表节点 */
 struct _dlist_node_t {
     struct _dlist_node_t* prev;
     struct _dlist_node_t* next;
@@ -34,7 +34,7 @@ struct _dlist_node_t {
     int                   init;
 };
 
-/* ˫ѭ */
+/* 双向循环链表 */
 struct _dlist_t {
     dlist_node_t*    head;
     atomic_counter_t count;
@@ -62,7 +62,7 @@ dlist_node_t* dlist_node_init(dlist_node_t* node) {
 
 void dlist_node_destroy(dlist_node_t* node) {
     assert(node);
-    /* dataⲿ */
+    /* data在外部销毁 */
     if (!node->init) {
         destroy(node);
     }
@@ -48,11 +48,11 @@ dlist_node_t* dlist_next(dlist_t* dlist, dlist_node_t* node);
 dlist_node_t* dlist_get_front(dlist_t* dlist);
 dlist_node_t* dlist_get_back(dlist_t* dlist);
 
-/* ڱͬʱɾڵ */
+/* 遍历链表，在遍历的同时不能删除或销毁链表节点 */
 #define dlist_for_each(list, node) \
     for (node = dlist_get_front(list); (node); node = dlist_next(list, node))
 
-/* ڱͬʱɾڵ */
+/* 遍历链表，可以在遍历同时进行删除或销毁链表节点 */
 #define dlist_for_each_safe(list, node, temp) \
     for (node = dlist_get_front(list), temp = dlist_next(list, node); (node); node = temp, temp = dlist_next(list, node))
 
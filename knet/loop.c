@@ -30,37 +30,75 @@
 #include "misc.h"
 #include "loop_balancer.h"
 #include "stream.h"
+#include "udp.h"
+#include "inproc.h"
+#include "pool.h"
+#include "resolver.h"
 
-struct _loop_t {
-    dlist_t*         active_channel_list; /* Ծܵ */
-    dlist_t*         close_channel_list;  /* ѹرչܵ */
-    dlist_t*         event_list;          /* ¼ */
-    lock_t*          lock;                /* -¼*/
-    channel_ref_t*   notify_channel;      /* ¼֪ͨдܵ */
-    channel_ref_t*   read_channel;        /* ¼֪ͨܵ */
-    loop_balancer_t* balancer;            /* ؾ */
-    void*            impl;                /* ¼ѡȡʵ */
-    volatile int     running;             /* ¼ѭб־ */
-    thread_id_t      thread_id;           /* ¼ѡȡǰ߳ID */
-};
+#define LOOP_BUSY_INTERVAL      100  /* 繁忙程度采样间隔（毫秒） */
+#define LOOP_BUSY_EWMA_WEIGHT   4    /* 新样本所占权重的倒数 */
+#define LOOP_BUSY_SCALE         16   /* EWMA累加值的定点放大倍数，避免整数除法截断使空闲时无法衰减到0 */
+#define LOOP_REBALANCE_INTERVAL 1000 /* 自动迁移管道的最小间隔（毫秒） */
+#define LOOP_INTERNAL_LOAD      2    /* 事件通知读写管道计入的负载 */
 
 typedef enum _loop_event_e {
-    loop_event_accept = 1,  /* ¼ */
-    loop_event_send,        /* ¼ */
-    loop_event_close,       /* ر¼ */
+    loop_event_accept = 1,  /* 接受新连接事件 */
+    loop_event_send,        /* 发送事件 */
+    loop_event_send_frame,  /* 发送消息事件，在loop_t线程内经过写方向过滤器链 */
+    loop_event_close,       /* 关闭事件 */
+    loop_event_resolve,     /* 域名解析完成事件 */
+    loop_event_connect,     /* 发起连接事件 */
+    loop_event_migrate,     /* 迁出管道事件 */
+    loop_event_migrate_in,  /* 迁入管道事件 */
 } loop_event_e;
 
 typedef struct _loop_event_t {
-    channel_ref_t* channel_ref; /* ¼عܵ */
-    buffer_t*      send_buffer; /* ͻָ */
-    loop_event_e   event;       /* ¼ */
+    channel_ref_t*  channel_ref; /* 事件相关管道 */
+    buffer_t*       send_buffer; /* 发送缓冲区指针 */
+    resolver_job_t* job;         /* 域名解析请求 */
+    loop_t*         target;      /* 迁移目标loop_t */
+    loop_event_e    event;       /* 事件类型 */
 } loop_event_t;
 
+struct _loop_t {
+    dlist_t*         active_channel_list; /* 活跃管道链表 */
+    dlist_t*         close_channel_list;  /* 已关闭管道链表 */
+    dlist_t*         ready_channel_list;  /* 读预算用尽，等待继续读取的管道链表 */
+    dlist_t*         post_channel_list;   /* 其他线程投递的就绪管道链表 */
+    uint32_t         round;               /* 循环次数，管道每次循环最多读取一次 */
+    dlist_t*         event_list;          /* 事件链表 */
+    dlist_t*         event_process_list;  /* 处理中的事件链表，只在loop_t所在线程访问 */
+    loop_event_t*    migrate_event;       /* 待执行的迁出事件，本次循环结束后处理 */
+    dlist_t*         pool_list;           /* 连接池链表 */
+    lock_t*          lock;                /* 锁-事件链表*/
+    lock_t*          post_lock;           /* 锁-投递链表 */
+    channel_ref_t*   notify_channel;      /* 事件通知写管道 */
+    channel_ref_t*   read_channel;        /* 事件通知读管道 */
+    loop_balancer_t* volatile balancer;   /* 负载均衡器，可能被其他线程解除关联 */
+    loop_balancer_t* volatile drain;      /* 排空时迁入管道的负载均衡器，0为未排空 */
+    resolver_t*      resolver;            /* 域名解析器 */
+    void*            impl;                /* 事件选取器实现 */
+    atomic_counter_t load;                /* 负载：活跃管道数量及投递中的管道数量，负载均衡器无锁读取 */
+    volatile int     busy;                /* 繁忙程度（千分比），线程CPU时间占比的EWMA，负载均衡器无锁读取 */
+    int              busy_acc;            /* 繁忙程度EWMA累加值，放大LOOP_BUSY_SCALE倍 */
+    uint32_t         busy_ts;             /* 上次采样时间戳（毫秒） */
+    uint64_t         busy_cpu;            /* 上次采样时线程CPU时间（微秒） */
+    uint32_t         rebalance_ts;        /* 上次自动迁移管道时间戳（毫秒） */
+    volatile int     running;             /* 事件循环运行标志 */
+    int              waiting;             /* 选取器将阻塞等待，投递时需要唤醒，由post_lock保护 */
+    int              woken;               /* 本次等待已唤醒过，由post_lock保护 */
+    thread_id_t      thread_id;           /* 事件选取器当前运行线程ID */
+};
+
+static void loop_check_post(loop_t* loop);
+
 loop_event_t* loop_event_create(channel_ref_t* channel_ref, buffer_t* send_buffer, loop_event_e e) {
     loop_event_t* event = create(loop_event_t);
     assert(event);
     event->channel_ref = channel_ref;
     event->send_buffer = send_buffer;
+    event->job = 0;
+    event->target = 0;
     event->event = e;
     return event;
 }
@@ -86,24 +124,30 @@ loop_event_e loop_event_get_event(loop_event_t* loop_event) {
 }
 
 loop_t* loop_create() {
-    socket_t pair[2] = {0}; /* ¼д */
+    socket_t pair[2] = {0}; /* 事件读写描述符 */
     loop_t*  loop    = create(loop_t);
     assert(loop);
     memset(loop, 0, sizeof(loop_t));
-    /* ѡȡʵ */
+    /* 建立选取器实现 */
     if (impl_create(loop)) {
         destroy(loop);
         return 0;
     }
-    /* д */
+    /* 建立读写描述符 */
     if (socket_pair(pair)) {
         destroy(loop);
         return 0;
     }
     loop->active_channel_list = dlist_create();
     loop->close_channel_list = dlist_create();
+    loop->ready_channel_list = dlist_create();
+    loop->post_channel_list = dlist_create();
+    loop->round = 1;
     loop->event_list = dlist_create();
+    loop->event_process_list = dlist_create();
+    loop->pool_list = dlist_create();
     loop->lock = lock_create();
+    loop->post_lock = lock_create();
     loop->notify_channel = loop_create_channel_exist_socket_fd(loop, pair[0], 0, 0);
     assert(loop->notify_channel);
     loop->read_channel = loop_create_channel_exist_socket_fd(loop, pair[1], 0, 1024 * 64);
@@ -112,9 +156,9 @@ loop_t* loop_create() {
     loop_add_channel_ref(loop, loop->read_channel);
     channel_ref_set_state(loop->notify_channel, channel_state_active);
     channel_ref_set_state(loop->read_channel, channel_state_active);
-    /* ע¼ */
+    /* 注册读事件 */
     channel_ref_set_event(loop->read_channel, channel_event_recv);
-    /* ö¼ص */
+    /* 设置读事件回调 */
     channel_ref_set_cb(loop->read_channel, loop_queue_cb);
     return loop;
 }
@@ -124,35 +168,78 @@ void loop_destroy(loop_t* loop) {
     dlist_node_t*  temp        = 0;
     channel_ref_t* channel_ref = 0;
     loop_event_t*  event       = 0;
-    /* رչܵ */
+    /* 销毁连接池，关闭空闲连接 */
+    dlist_for_each_safe(loop->pool_list, node, temp) {
+        pool_destroy((pool_t*)dlist_node_get_data(node));
+    }
+    dlist_destroy(loop->pool_list);
+    /* 取消未执行的迁移，释放共享引用 */
+    if (loop->migrate_event) {
+        channel_ref_leave(loop->migrate_event->channel_ref);
+        destroy(loop->migrate_event);
+    }
+    /* 投递的管道可能尚未加入活跃链表 */
+    loop_check_post(loop);
+    /* 关闭管道 */
     dlist_for_each_safe(loop->active_channel_list, node, temp) {
         channel_ref = (channel_ref_t*)dlist_node_get_data(node);
         channel_ref_update_close_in_loop(channel_ref_get_loop(channel_ref), channel_ref);
     }
-    /* ѡȡ */
+    /* 销毁选取器 */
     impl_destroy(loop);
-    /* ѹرչܵ */
+    /* 销毁已关闭管道 */
     dlist_for_each_safe(loop->close_channel_list, node, temp) {
         channel_ref = (channel_ref_t*)dlist_node_get_data(node);
         channel_ref_destroy(channel_ref);
     }
     dlist_destroy(loop->close_channel_list);
     dlist_destroy(loop->active_channel_list);
-    /* δ¼ */
+    dlist_destroy(loop->ready_channel_list);
+    dlist_destroy(loop->post_channel_list);
+    lock_destroy(loop->post_lock);
+    /* 销毁未处理事件 */
     dlist_for_each_safe(loop->event_list, node, temp) {
         event = (loop_event_t*)dlist_node_get_data(node);
+        if (event->job) {
+            resolver_job_destroy(event->job);
+        }
+        if (event->event == loop_event_migrate) {
+            channel_ref_leave(event->channel_ref);
+        }
         destroy(event);
     }
     dlist_destroy(loop->event_list);
+    dlist_destroy(loop->event_process_list);
     lock_destroy(loop->lock);
     destroy(loop);
 }
 
+/*
+ * 检查事件是否需要改投到管道当前所属的loop_t
+ */
+static int loop_event_check_route(loop_t* loop, loop_event_t* loop_event) {
+    switch (loop_event->event) {
+        case loop_event_send:
+        case loop_event_send_frame:
+        case loop_event_close:
+        case loop_event_migrate:
+            return (channel_ref_get_loop(loop_event->channel_ref) != loop);
+        default:
+            return 0;
+    }
+}
+
 void loop_add_event(loop_t* loop, loop_event_t* loop_event) {
     assert(loop);
     assert(loop_event);
     lock_lock(loop->lock);
-    /* ¼ӵβ */
+    /* 管道迁出时在原loop_t的锁内修改所属loop_t，加锁后检查，不会投递到已迁出的loop_t */
+    while (loop_event_check_route(loop, loop_event)) {
+        lock_unlock(loop->lock);
+        loop = channel_ref_get_loop(loop_event->channel_ref);
+        lock_lock(loop->lock);
+    }
+    /* 事件添加到链表尾部 */
     dlist_add_tail_node(loop->event_list, loop_event);
     lock_unlock(loop->lock);
     loop_notify(loop);
@@ -161,9 +248,28 @@ void loop_add_event(loop_t* loop, loop_event_t* loop_event) {
 void loop_notify_accept(loop_t* loop, channel_ref_t* channel_ref) {
     assert(loop);
     assert(channel_ref);
+    /* 投递中的管道计入负载，避免连续选取时都选中同一个loop_t */
+    atomic_counter_inc(&loop->load);
     loop_add_event(loop, loop_event_create(channel_ref, 0, loop_event_accept));
 }
 
+void loop_notify_connect(loop_t* loop, channel_ref_t* channel_ref) {
+    assert(loop);
+    assert(channel_ref);
+    atomic_counter_inc(&loop->load);
+    loop_add_event(loop, loop_event_create(channel_ref, 0, loop_event_connect));
+}
+
+void loop_notify_migrate(loop_t* loop, channel_ref_t* channel_ref, loop_t* target) {
+    loop_event_t* loop_event = 0;
+    assert(loop);
+    assert(channel_ref);
+    assert(target);
+    loop_event = loop_event_create(channel_ref, 0, loop_event_migrate);
+    loop_event->target = target;
+    loop_add_event(loop, loop_event);
+}
+
 void loop_notify_send(loop_t* loop, channel_ref_t* channel_ref, buffer_t* send_buffer) {
     assert(loop);
     assert(channel_ref);
@@ -171,20 +277,36 @@ void loop_notify_send(loop_t* loop, channel_ref_t* channel_ref, buffer_t* send_b
     loop_add_event(loop, loop_event_create(channel_ref, send_buffer, loop_event_send));
 }
 
+void loop_notify_send_frame(loop_t* loop, channel_ref_t* channel_ref, buffer_t* chain) {
+    assert(loop);
+    assert(channel_ref);
+    assert(chain);
+    loop_add_event(loop, loop_event_create(channel_ref, chain, loop_event_send_frame));
+}
+
 void loop_notify_close(loop_t* loop, channel_ref_t* channel_ref) {
     assert(loop);
     assert(channel_ref);
     loop_add_event(loop, loop_event_create(channel_ref, 0, loop_event_close));
 }
 
+void loop_notify_resolve(loop_t* loop, resolver_job_t* job) {
+    loop_event_t* loop_event = 0;
+    assert(loop);
+    assert(job);
+    loop_event = loop_event_create(0, 0, loop_event_resolve);
+    loop_event->job = job;
+    loop_add_event(loop, loop_event);
+}
+
 void loop_queue_cb(channel_ref_t* channel, channel_cb_event_e e) {
     if (e & channel_cb_event_recv) {
-        /* ж */
+        /* 清空所有读到的数据 */
         stream_eat(channel_ref_get_stream(channel));
         loop_event_process(channel_ref_get_loop(channel));
     } else if (e & channel_cb_event_close) {
         if (loop_check_running(channel_ref_get_loop(channel))) {
-            /* ӶϿ,  */
+            /* 连接断开, 致命错误 */
             assert(0);
         }
     }
@@ -193,38 +315,173 @@ void loop_queue_cb(channel_ref_t* channel, channel_cb_event_e e) {
 void loop_notify(loop_t* loop) {
     char c = 1;
     assert(loop);
-    /* һֽڴص  */
+    /* 发送一个字节触发读回调  */
     socket_send(channel_ref_get_socket_fd(loop->notify_channel), &c, sizeof(c));
 }
 
-void loop_event_process(loop_t* loop) {
+/*
+ * 将管道的未处理事件按顺序移入暂存链表
+ */
+static void loop_move_channel_event(dlist_t* from, dlist_t* to, channel_ref_t* channel_ref) {
     dlist_node_t* node       = 0;
     dlist_node_t* temp       = 0;
     loop_event_t* loop_event = 0;
+    dlist_for_each_safe(from, node, temp) {
+        loop_event = (loop_event_t*)dlist_node_get_data(node);
+        if (loop_event->channel_ref && channel_ref_equal(loop_event->channel_ref, channel_ref)) {
+            dlist_add_tail_node(to, loop_event);
+            dlist_delete(from, node);
+        }
+    }
+}
+
+/*
+ * 在原loop_t的线程内迁出管道
+ * 在本次循环结束后调用，选取器本次返回的事件已处理完，不会再访问迁出的管道
+ */
+static void loop_migrate_out(loop_t* loop, channel_ref_t* channel_ref, loop_t* target) {
+    dlist_t*       migrate_list = 0;
+    channel_ref_t* origin       = 0;
+    /* 迁出事件处理后暂停处理事件链表，管道仍属于本loop_t */
+    assert(channel_ref_get_loop(channel_ref) == loop);
+    if ((target == loop) || !channel_ref_check_migrate(channel_ref)) {
+        /* 已在目标loop_t或已关闭 */
+        channel_ref_leave(channel_ref);
+        return;
+    }
+    /* 选取器内注册的是活跃链表内的原始引用 */
+    origin = (channel_ref_t*)dlist_node_get_data(channel_ref_get_loop_node(channel_ref));
+    channel_ref_leave(channel_ref);
+    channel_ref = origin;
+    channel_ref_detach_in_loop(loop, channel_ref);
+    migrate_list = dlist_create();
+    lock_lock(loop->lock);
+    /* 尚未处理的事件随管道转交，此后投递的事件改投到目标loop_t */
+    loop_move_channel_event(loop->event_list, migrate_list, channel_ref);
+    channel_ref_set_migrate_list(channel_ref, migrate_list);
+    channel_ref_set_loop(channel_ref, target);
+    lock_unlock(loop->lock);
+    /* 迁入中的管道计入目标负载 */
+    atomic_counter_inc(&target->load);
+    loop_add_event(target, loop_event_create(channel_ref, 0, loop_event_migrate_in));
+}
+
+/*
+ * 在目标loop_t的线程内迁入管道
+ * 暂存的事件放到处理链表头部，在本线程其他事件之前按投递顺序处理
+ */
+static void loop_migrate_in(loop_t* loop, channel_ref_t* channel_ref) {
+    dlist_t*      migrate_list = channel_ref_get_migrate_list(channel_ref);
+    dlist_node_t* node         = 0;
+    assert(migrate_list);
+    channel_ref_attach_in_loop(loop, channel_ref);
+    atomic_counter_dec(&loop->load);
+    channel_ref_set_migrate_list(channel_ref, 0);
+    while ((node = dlist_get_front(loop->event_process_list))) {
+        dlist_add_tail_node(migrate_list, dlist_node_get_data(node));
+        dlist_delete(loop->event_process_list, node);
+    }
+    dlist_destroy(loop->event_process_list);
+    loop->event_process_list = migrate_list;
+}
+
+/*
+ * 处理一个事件
+ */
+static void loop_event_dispatch(loop_t* loop, loop_event_t* loop_event) {
+    dlist_t* migrate_list = 0;
+    if (loop_event->channel_ref && (loop_event->event != loop_event_migrate_in)) {
+        migrate_list = channel_ref_get_migrate_list(loop_event->channel_ref);
+        if (migrate_list) {
+            /* 管道迁入前投递到本线程的事件，迁入后按顺序处理 */
+            dlist_add_tail_node(migrate_list, loop_event);
+            return;
+        }
+    }
+    switch(loop_event->event) {
+        case loop_event_accept:
+            channel_ref_update_accept_in_loop(loop, loop_event->channel_ref);
+            /* 已加入活跃链表 */
+            atomic_counter_dec(&loop->load);
+            break;
+        case loop_event_send:
+            channel_ref_update_send_in_loop(loop, loop_event->channel_ref, loop_event->send_buffer);
+            break;
+        case loop_event_send_frame:
+            channel_ref_update_send_frame_in_loop(loop, loop_event->channel_ref, loop_event->send_buffer);
+            break;
+        case loop_event_close:
+            channel_ref_update_close_in_loop(loop, loop_event->channel_ref);
+            break;
+        case loop_event_resolve:
+            resolver_job_complete(loop_event->job);
+            break;
+        case loop_event_connect:
+            channel_ref_update_connect_in_loop(loop, loop_event->channel_ref);
+            atomic_counter_dec(&loop->load);
+            break;
+        case loop_event_migrate:
+            /* 选取器本次返回的事件可能还未处理，循环结束后迁出 */
+            loop->migrate_event = loop_event;
+            return;
+        case loop_event_migrate_in:
+            loop_migrate_in(loop, loop_event->channel_ref);
+            break;
+        default:
+            break;
+    }
+    loop_event_destroy(loop_event);
+}
+
+void loop_event_process(loop_t* loop) {
+    dlist_t*      list       = 0;
+    dlist_node_t* node       = 0;
+    loop_event_t* loop_event = 0;
     assert(loop);
     lock_lock(loop->lock);
-    /* ÿζ¼صڴ¼ */
-    dlist_for_each_safe(loop->event_list, node, temp) {
+    /* 每次读事件回调内处理整个事件链表，处理时不加锁 */
+    list = loop->event_list;
+    loop->event_list = loop->event_process_list;
+    loop->event_process_list = list;
+    lock_unlock(loop->lock);
+    /* 迁入管道时会在链表头部插入暂存事件，每次重新取链表头 */
+    while ((node = dlist_get_front(loop->event_process_list))) {
         loop_event = (loop_event_t*)dlist_node_get_data(node);
-        switch(loop_event->event) {
-            case loop_event_accept:
-                channel_ref_update_accept_in_loop(loop, loop_event->channel_ref);
-                break;
-            case loop_event_send:
-                channel_ref_update_send_in_loop(loop, loop_event->channel_ref, loop_event->send_buffer);
-                break;
-            case loop_event_close:
-                channel_ref_update_close_in_loop(loop, loop_event->channel_ref);
-                break;
-            default:
-                break;
+        dlist_delete(loop->event_process_list, node);
+        loop_event_dispatch(loop, loop_event);
+        if (loop->migrate_event) {
+            break;
         }
-        loop_event_destroy(loop_event);
+    }
+    if (dlist_empty(loop->event_process_list)) {
+        return;
+    }
+    /* 迁出前暂停，剩余事件放回事件链表头部，迁出时与管道的后续事件一起转交 */
+    lock_lock(loop->lock);
+    while ((node = dlist_get_front(loop->event_list))) {
+        dlist_add_tail_node(loop->event_process_list, dlist_node_get_data(node));
         dlist_delete(loop->event_list, node);
     }
+    list = loop->event_list;
+    loop->event_list = loop->event_process_list;
+    loop->event_process_list = list;
     lock_unlock(loop->lock);
 }
 
+/*
+ * 迁出本次循环内请求迁移的管道，继续处理之后的事件
+ */
+static void loop_check_migrate(loop_t* loop) {
+    loop_event_t* loop_event = 0;
+    while (loop->migrate_event) {
+        loop_event = loop->migrate_event;
+        loop->migrate_event = 0;
+        loop_migrate_out(loop, loop_event->channel_ref, loop_event->target);
+        loop_event_destroy(loop_event);
+        loop_event_process(loop);
+    }
+}
+
 channel_ref_t* loop_create_channel_exist_socket_fd(loop_t* loop, socket_t socket_fd, uint32_t max_send_list_len, uint32_t recv_ring_len) {
     assert(loop);
     return channel_ref_create(loop, channel_create_exist_socket_fd(socket_fd, max_send_list_len, recv_ring_len));
@@ -235,15 +492,152 @@ channel_ref_t* loop_create_channel(loop_t* loop, uint32_t max_send_list_len, uin
     return channel_ref_create(loop, channel_create(max_send_list_len, recv_ring_len));
 }
 
+channel_ref_t* loop_create_udp_channel(loop_t* loop, uint32_t max_size, uint32_t max_send_count, channel_ref_udp_cb_t cb) {
+    channel_ref_t* channel_ref = 0;
+    assert(loop);
+    assert(cb);
+    channel_ref = channel_ref_create(loop, channel_create_udp());
+    channel_ref_set_udp(channel_ref, udp_create(max_size, max_send_count, cb));
+    return channel_ref;
+}
+
+void loop_create_channel_pair(loop_t* loop_a, loop_t* loop_b, uint32_t max_send_list_len, uint32_t recv_ring_len, channel_ref_t* pair[2]) {
+    inproc_t* inproc[2] = {0};
+    int       i         = 0;
+    assert(loop_a);
+    assert(loop_b);
+    assert(pair);
+    inproc_create_pair(inproc);
+    pair[0] = channel_ref_create(loop_a, channel_create_inproc(inproc[0], max_send_list_len, recv_ring_len));
+    pair[1] = channel_ref_create(loop_b, channel_create_inproc(inproc[1], max_send_list_len, recv_ring_len));
+    for (; i < 2; i++) {
+        channel_ref_set_state(pair[i], channel_state_active);
+        channel_ref_set_event(pair[i], channel_event_recv);
+        /* 投递到所属loop，在所属线程加入活跃链表 */
+        inproc_set_channel_ref(inproc[i], pair[i]);
+    }
+}
+
+channel_ref_t* loop_create_shm_channel(loop_t* loop, shm_t* shm, uint32_t max_send_list_len, uint32_t recv_ring_len) {
+    channel_ref_t* channel_ref = 0;
+    assert(loop);
+    assert(shm);
+    channel_ref = channel_ref_create(loop, channel_create_shm(shm, max_send_list_len, recv_ring_len));
+    loop_add_channel_ref(loop, channel_ref);
+    channel_ref_set_state(channel_ref, channel_state_active);
+    channel_ref_set_event(channel_ref, channel_event_recv);
+    return channel_ref;
+}
+
 thread_id_t loop_get_thread_id(loop_t* loop) {
     assert(loop);
     return loop->thread_id;
 }
 
+/*
+ * 每个采样间隔计算一次线程CPU时间占比，更新繁忙程度
+ * @retval 1 本次已采样
+ * @retval 0 未到采样间隔
+ */
+static int loop_update_busy(loop_t* loop) {
+    uint32_t ms     = time_get_milliseconds();
+    uint64_t cpu    = 0;
+    int      sample = 0;
+    if (loop->busy_ts && (ms - loop->busy_ts < LOOP_BUSY_INTERVAL)) {
+        return 0;
+    }
+    cpu = thread_get_cpu_microseconds();
+    if (loop->busy_ts) {
+        /* 每毫秒内的CPU微秒数即千分比 */
+        sample = (int)((cpu - loop->busy_cpu) / (ms - loop->busy_ts));
+        if (sample > 1000) {
+            sample = 1000;
+        }
+        loop->busy_acc += (sample * LOOP_BUSY_SCALE - loop->busy_acc) / LOOP_BUSY_EWMA_WEIGHT;
+        /* 四舍五入，累加值小于LOOP_BUSY_SCALE / 2时为0 */
+        loop->busy = (loop->busy_acc + LOOP_BUSY_SCALE / 2) / LOOP_BUSY_SCALE;
+    }
+    loop->busy_ts  = ms;
+    loop->busy_cpu = cpu;
+    return 1;
+}
+
+/*
+ * 繁忙程度超过负载均衡器的迁移阈值时，将最近读取过数据的一个管道迁移到最空闲的loop_t.
+ * 繁忙程度是平滑值，迁移后若干采样间隔才能反映，限制迁移频率避免过度迁移
+ */
+static void loop_check_rebalance(loop_t* loop, loop_balancer_t* balancer) {
+    dlist_node_t*  node        = 0;
+    channel_ref_t* channel_ref = 0;
+    channel_ref_t* found       = 0;
+    loop_t*        target      = 0;
+    uint32_t       ms          = time_get_milliseconds();
+    if (ms - loop->rebalance_ts < LOOP_REBALANCE_INTERVAL) {
+        return;
+    }
+    target = loop_balancer_choose_rebalance(balancer, loop);
+    if (!target) {
+        return;
+    }
+    dlist_for_each(loop->active_channel_list, node) {
+        channel_ref = (channel_ref_t*)dlist_node_get_data(node);
+        if ((channel_ref == loop->notify_channel) || (channel_ref == loop->read_channel) ||
+            !channel_ref_check_migrate(channel_ref)) {
+            continue;
+        }
+        if (!found || (channel_ref_get_last_recv_ts(channel_ref) > channel_ref_get_last_recv_ts(found))) {
+            found = channel_ref;
+        }
+    }
+    if (found) {
+        loop->rebalance_ts = ms;
+        channel_ref_migrate(found, target);
+    }
+}
+
+/*
+ * 排空 - 将可迁移的管道全部迁出，逐个同步迁出使目标负载立即计入，分散到各个loop_t
+ */
+static void loop_check_drain(loop_t* loop, loop_balancer_t* balancer) {
+    dlist_node_t*  node        = 0;
+    dlist_node_t*  temp        = 0;
+    channel_ref_t* channel_ref = 0;
+    loop_t*        target      = 0;
+    dlist_for_each_safe(loop->active_channel_list, node, temp) {
+        channel_ref = (channel_ref_t*)dlist_node_get_data(node);
+        if ((channel_ref == loop->notify_channel) || (channel_ref == loop->read_channel) ||
+            !channel_ref_check_migrate(channel_ref)) {
+            /* 不可迁移的管道等待关闭 */
+            continue;
+        }
+        target = loop_balancer_choose(balancer);
+        if (!target || (target == loop)) {
+            break;
+        }
+        loop_migrate_out(loop, channel_ref_share(channel_ref), target);
+    }
+}
+
 int loop_run_once(loop_t* loop) {
+    int              error    = 0;
+    loop_balancer_t* balancer = 0;
     assert(loop);
     loop->thread_id = thread_get_self_id();
-    return impl_run_once(loop);
+    error = impl_run_once(loop);
+    loop_check_migrate(loop);
+    if (loop_update_busy(loop)) {
+        balancer = loop->drain;
+        if (balancer) {
+            loop_check_drain(loop, balancer);
+        } else {
+            /* 只读取一次，其他线程解除关联后不会读到0 */
+            balancer = loop->balancer;
+            if (balancer) {
+                loop_check_rebalance(loop, balancer);
+            }
+        }
+    }
+    return error;
 }
 
 int loop_run(loop_t* loop) {
@@ -279,23 +673,51 @@ void loop_add_channel_ref(loop_t* loop, channel_ref_t* channel_ref) {
     assert(loop);
     assert(channel_ref);
     if (node) {
-        /* ѾҪڵ */
+        /* 已经加入过链表，不需要创建链表节点 */
         dlist_add_front(loop->active_channel_list, node);
     } else {
-        /* ڵ */
+        /* 创建链表节点 */
         dlist_add_front_node(loop->active_channel_list, channel_ref);
     }
-    /* ýڵ */
+    /* 设置节点 */
     channel_ref_set_loop_node(channel_ref, dlist_get_front(loop->active_channel_list));
-    /* ֪ͨѡȡӹܵ */
+    atomic_counter_inc(&loop->load);
+    if (channel_ref_check_inproc(channel_ref)) {
+        /* 进程内管道不注册到选取器 */
+        return;
+    }
+    /* 通知选取器添加管道 */
     impl_add_channel_ref(loop, channel_ref);
 }
 
 void loop_remove_channel_ref(loop_t* loop, channel_ref_t* channel_ref) {
     assert(loop);
     assert(channel_ref);
-    /* 뵱ǰٽڵ */
+    /* 解除与当前链表关联，但不销毁节点 */
     dlist_remove(loop->active_channel_list, channel_ref_get_loop_node(channel_ref));
+    atomic_counter_dec(&loop->load);
+}
+
+int loop_get_load(loop_t* loop) {
+    assert(loop);
+    /* 对齐的整数读取是原子的，其他线程读到的可能是稍旧的值 */
+    return (int)loop->load;
+}
+
+void loop_drain(loop_t* loop, loop_balancer_t* balancer) {
+    assert(loop); /* balancer可以为0 */
+    loop->drain = balancer;
+}
+
+int loop_check_drained(loop_t* loop) {
+    assert(loop);
+    /* 连接池由loop_t销毁，仍有连接池时不能销毁loop_t */
+    return (loop->drain && ((int)loop->load <= LOOP_INTERNAL_LOAD) && !dlist_get_count(loop->pool_list));
+}
+
+int loop_get_busy(loop_t* loop) {
+    assert(loop);
+    return loop->busy;
 }
 
 void loop_set_impl(loop_t* loop, void* impl) {
@@ -312,16 +734,15 @@ void* loop_get_impl(loop_t* loop) {
 void loop_close_channel_ref(loop_t* loop, channel_ref_t* channel_ref) {
     assert(loop);
     assert(channel_ref);
-    /* 㺯׽Ѿر */
-    /* ӻԾȡ */
+    /* 在外层函数内套接字已经被关闭 */
+    /* 从活跃链表内取出 */
     loop_remove_channel_ref(loop, channel_ref);
-    /* 뵽ѹر */
+    /* 加入到已关闭链表 */
     dlist_add_front(loop->close_channel_list, channel_ref_get_loop_node(channel_ref));
 }
 
 void loop_set_balancer(loop_t* loop, loop_balancer_t* balancer) {
     assert(loop);
-    assert(balancer);
     loop->balancer = balancer;
 }
 
@@ -330,20 +751,46 @@ loop_balancer_t* loop_get_balancer(loop_t* loop) {
     return loop->balancer;
 }
 
+void loop_set_resolver(loop_t* loop, resolver_t* resolver) {
+    assert(loop);
+    loop->resolver = resolver;
+}
+
+resolver_t* loop_get_resolver(loop_t* loop) {
+    assert(loop);
+    return loop->resolver;
+}
+
+dlist_node_t* loop_add_pool(loop_t* loop, pool_t* pool) {
+    assert(loop);
+    assert(pool);
+    return dlist_add_tail_node(loop->pool_list, pool);
+}
+
+void loop_remove_pool(loop_t* loop, dlist_node_t* node) {
+    assert(loop);
+    assert(node);
+    dlist_delete(loop->pool_list, node);
+}
+
 void loop_check_timeout(loop_t* loop, time_t ts) {
     dlist_node_t*  node        = 0;
     dlist_node_t*  temp        = 0;
     channel_ref_t* channel_ref = 0;
+    dlist_for_each_safe(loop->pool_list, node, temp) {
+        /* 连接池健康检查 */
+        pool_check((pool_t*)dlist_node_get_data(node), ts);
+    }
     dlist_for_each_safe(loop_get_active_list(loop), node, temp) {
         channel_ref = (channel_ref_t*)dlist_node_get_data(node);
         if (channel_ref_check_connect_timeout(channel_ref, ts)) {
-            /* ӳʱ */            
+            /* 连接超时 */            
             if (channel_ref_get_cb(channel_ref)) {
                 channel_ref_get_cb(channel_ref)(channel_ref, channel_cb_event_connect_timeout);
             }
         }
         if (channel_ref_check_timeout(channel_ref, ts)) {
-            /* ʱ */
+            /* 读超时，心跳 */
             if (channel_ref_get_cb(channel_ref)) {
                 channel_ref_get_cb(channel_ref)(channel_ref, channel_cb_event_timeout);
             }
@@ -363,6 +810,131 @@ void loop_check_close(loop_t* loop) {
     }
 }
 
+void loop_add_ready_channel_ref(loop_t* loop, channel_ref_t* channel_ref) {
+    assert(loop);
+    assert(channel_ref);
+    if (channel_ref_get_ready_node(channel_ref)) {
+        /* 已经在就绪链表内 */
+        return;
+    }
+    channel_ref_set_ready_node(channel_ref, dlist_add_tail_node(loop->ready_channel_list, channel_ref));
+}
+
+void loop_remove_ready_channel_ref(loop_t* loop, channel_ref_t* channel_ref) {
+    dlist_node_t* node = 0;
+    assert(loop);
+    assert(channel_ref);
+    node = channel_ref_get_ready_node(channel_ref);
+    if (!node) {
+        return;
+    }
+    dlist_delete(loop->ready_channel_list, node);
+    channel_ref_set_ready_node(channel_ref, 0);
+}
+
+void loop_post_ready_channel_ref(loop_t* loop, channel_ref_t* channel_ref) {
+    int wake = 0;
+    assert(loop);
+    assert(channel_ref);
+    lock_lock(loop->post_lock);
+    dlist_add_tail_node(loop->post_channel_list, channel_ref);
+    if (loop->waiting && !loop->woken) {
+        /* 选取器阻塞等待中，每次等待只唤醒一次 */
+        loop->woken = 1;
+        wake = 1;
+    }
+    lock_unlock(loop->post_lock);
+    if (wake) {
+        loop_notify(loop);
+    }
+}
+
+void loop_cancel_ready_channel_ref(loop_t* loop, channel_ref_t* channel_ref) {
+    dlist_node_t* node = 0;
+    dlist_node_t* temp = 0;
+    assert(loop);
+    assert(channel_ref);
+    lock_lock(loop->post_lock);
+    dlist_for_each_safe(loop->post_channel_list, node, temp) {
+        if (dlist_node_get_data(node) == channel_ref) {
+            dlist_delete(loop->post_channel_list, node);
+        }
+    }
+    lock_unlock(loop->post_lock);
+}
+
+/*
+ * 将其他线程投递的管道移入就绪链表
+ */
+static void loop_check_post(loop_t* loop) {
+    dlist_node_t*  node        = 0;
+    dlist_node_t*  temp        = 0;
+    channel_ref_t* channel_ref = 0;
+    if (!loop->waiting && dlist_empty(loop->post_channel_list)) {
+        /* 未加锁读取，遗漏的管道下次循环处理 */
+        return;
+    }
+    lock_lock(loop->post_lock);
+    /* 选取器已返回 */
+    loop->waiting = 0;
+    loop->woken   = 0;
+    dlist_for_each_safe(loop->post_channel_list, node, temp) {
+        channel_ref = (channel_ref_t*)dlist_node_get_data(node);
+        if (!channel_ref_get_loop_node(channel_ref)) {
+            /* 其他线程创建的管道，在所属线程加入活跃链表 */
+            loop_add_channel_ref(loop, channel_ref);
+        }
+        loop_add_ready_channel_ref(loop, channel_ref);
+        dlist_delete(loop->post_channel_list, node);
+    }
+    lock_unlock(loop->post_lock);
+}
+
+int loop_get_ready_count(loop_t* loop) {
+    int count = 0;
+    assert(loop);
+    count = dlist_get_count(loop->ready_channel_list);
+    if (count) {
+        return count;
+    }
+    /* 与投递在同一把锁内检查，投递或者发生在检查前，或者看到等待标志后唤醒选取器 */
+    lock_lock(loop->post_lock);
+    count = dlist_get_count(loop->post_channel_list);
+    loop->waiting = !count;
+    lock_unlock(loop->post_lock);
+    return count;
+}
+
+void loop_check_ready(loop_t* loop, time_t ts) {
+    dlist_node_t*  node        = 0;
+    channel_ref_t* channel_ref = 0;
+    int            count       = 0;
+    assert(loop);
+    loop_check_post(loop);
+    /* 轮流读取，本次重新加入链表尾部的管道下次处理 */
+    count = dlist_get_count(loop->ready_channel_list);
+    for (; count > 0; count--) {
+        node = dlist_get_front(loop->ready_channel_list);
+        if (!node) {
+            break;
+        }
+        channel_ref = (channel_ref_t*)dlist_node_get_data(node);
+        loop_remove_ready_channel_ref(loop, channel_ref);
+        if (channel_ref_get_recv_round(channel_ref) == loop->round) {
+            /* 本次循环内选取器已经读取过，排到链表尾部下次处理，不给第二次读预算 */
+            loop_add_ready_channel_ref(loop, channel_ref);
+            continue;
+        }
+        channel_ref_update(channel_ref, channel_event_recv, ts);
+    }
+    loop->round++;
+}
+
+uint32_t loop_get_round(loop_t* loop) {
+    assert(loop);
+    return loop->round;
+}
+
 int loop_check_running(loop_t* loop) {
     return loop->running;
 }
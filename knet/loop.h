@@ -29,197 +29,338 @@
 #include "loop_api.h"
 
 /*
- * channel_ref_tʵԾ
- * @param loop loop_tʵ
- * @param channel_ref channel_ref_tʵ
+ * 添加channel_ref_t实例到活跃链表
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
  */
 void loop_add_channel_ref(loop_t* loop, channel_ref_t* channel_ref);
 
 /*
- * ӵԾɾchannel_ref_tʵ
- * @param loop loop_tʵ
- * @param channel_ref channel_ref_tʵ
+ * 从到活跃链表删除channel_ref_t实例
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
  */
 void loop_remove_channel_ref(loop_t* loop, channel_ref_t* channel_ref);
 
 /*
- * ӵԾɾchannel_ref_tʵر
- * @param loop loop_tʵ
- * @param channel_ref channel_ref_tʵ
+ * 从到活跃链表删除channel_ref_t实例，并放入关闭链表
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
  */
 void loop_close_channel_ref(loop_t* loop, channel_ref_t* channel_ref);
 
 /*
- * ȡûԾ
- * @param loop loop_tʵ
- * @return dlist_tʵ
+ * 添加管道到就绪链表
+ * 读预算用尽的管道在下次循环内继续读取
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
+ */
+void loop_add_ready_channel_ref(loop_t* loop, channel_ref_t* channel_ref);
+
+/*
+ * 从就绪链表删除管道
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
+ */
+void loop_remove_ready_channel_ref(loop_t* loop, channel_ref_t* channel_ref);
+
+/*
+ * 跨线程添加管道到就绪链表
+ * 可以在任意线程调用，管道先放入投递链表，loop_t下次处理就绪链表时移入，
+ * 尚未加入活跃链表的管道同时加入活跃链表. loop_t忙碌时不经过系统调用，
+ * 只在选取器阻塞等待时唤醒一次
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
+ */
+void loop_post_ready_channel_ref(loop_t* loop, channel_ref_t* channel_ref);
+
+/*
+ * 从投递链表删除管道
+ * 管道关闭时在loop_t所在线程调用
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
+ */
+void loop_cancel_ready_channel_ref(loop_t* loop, channel_ref_t* channel_ref);
+
+/*
+ * 取得就绪链表和投递链表内管道数量
+ * 选取器在有就绪管道时不应阻塞等待. 返回0时设置等待标志，其他线程投递管道时唤醒选取器，
+ * 下次处理就绪链表时清除
+ * @param loop loop_t实例
+ * @return 就绪管道数量
+ */
+int loop_get_ready_count(loop_t* loop);
+
+/*
+ * 处理就绪链表内的管道
+ * 只处理调用前已在链表内的管道，本次重新加入的管道以及本次循环内已由选取器读取过的管道下次处理
+ * @param loop loop_t实例
+ * @param ts 当前时间戳（秒）
+ */
+void loop_check_ready(loop_t* loop, time_t ts);
+
+/*
+ * 取得循环次数，每次处理就绪链表后增加
+ * @param loop loop_t实例
+ * @return 循环次数
+ */
+uint32_t loop_get_round(loop_t* loop);
+
+/*
+ * 取得活跃链表
+ * @param loop loop_t实例
+ * @return dlist_t实例
  */
 dlist_t* loop_get_active_list(loop_t* loop);
 
 /*
- * ȡùر
- * @param loop loop_tʵ
- * @return dlist_tʵ
+ * 取得关闭链表
+ * @param loop loop_t实例
+ * @return dlist_t实例
  */
 dlist_t* loop_get_close_list(loop_t* loop);
 
 /*
- * ѡȡʵ
- * @param loop loop_tʵ
- * @param impl ѡȡʵ
+ * 设置选取器实现
+ * @param loop loop_t实例
+ * @param impl 选取器实现
  */
 void loop_set_impl(loop_t* loop, void* impl);
 
 /*
- * ȡѡȡʵ
- * @param loop loop_tʵ
- * @return ѡȡʵ
+ * 取得选取器实现
+ * @param loop loop_t实例
+ * @return 选取器实现
  */
 void* loop_get_impl(loop_t* loop);
 
 /*
- * ȡѡȡǰ߳ID
- * @param loop loop_tʵ
- * @return ߳ID
+ * 取得选取器当前线程ID
+ * @param loop loop_t实例
+ * @return 线程ID
  */
 thread_id_t loop_get_thread_id(loop_t* loop);
 
 /*
- * øؾ(loop_balancer_tʵ
- * @param loop loop_tʵ
- * @param balancer loop_balancer_tʵ
+ * 设置负载均衡器(loop_balancer_t实例）
+ * @param loop loop_t实例
+ * @param balancer loop_balancer_t实例
  */
 void loop_set_balancer(loop_t* loop, loop_balancer_t* balancer);
 
 /*
- * ȡøؾ(loop_balancer_tʵ
- * @param loop loop_tʵ
- * @return loop_balancer_tʵ
+ * 取得负载均衡器(loop_balancer_t实例）
+ * @param loop loop_t实例
+ * @return loop_balancer_t实例
  */
 loop_balancer_t* loop_get_balancer(loop_t* loop);
 
 /*
- * ¼֪ͨ - 
- * @param loop loop_tʵ
- * @param channel_ref channel_ref_tʵ
+ * 取得负载（活跃管道数量及投递中的管道数量），可以在任意线程调用
+ * @param loop loop_t实例
+ * @return 负载
+ */
+int loop_get_load(loop_t* loop);
+
+/*
+ * 排空loop_t，可以在任意线程调用
+ * loop_t所在线程每次采样繁忙程度时将可迁移的管道迁移到balancer选取的loop_t，
+ * 不可迁移的管道（进程内、共享内存、连接池、连接中）等待关闭或下次采样时再迁移.
+ * 调用前应先从balancer解除关联，避免迁回
+ * @param loop loop_t实例
+ * @param balancer 迁入管道的loop_balancer_t实例，0为取消排空
+ */
+void loop_drain(loop_t* loop, loop_balancer_t* balancer);
+
+/*
+ * 检查loop_t是否已排空，可以在任意线程调用
+ * @param loop loop_t实例
+ * @retval 非零 已调用loop_drain，除事件通知管道外没有活跃管道及投递中的管道，且没有连接池
+ * @retval 0 未排空
+ */
+int loop_check_drained(loop_t* loop);
+
+/*
+ * 设置域名解析器
+ * @param loop loop_t实例
+ * @param resolver resolver_t实例
+ */
+void loop_set_resolver(loop_t* loop, resolver_t* resolver);
+
+/*
+ * 取得域名解析器
+ * @param loop loop_t实例
+ * @return resolver_t实例，未关联时返回0
+ */
+resolver_t* loop_get_resolver(loop_t* loop);
+
+/*
+ * 添加连接池，由loop_t驱动健康检查
+ * @param loop loop_t实例
+ * @param pool pool_t实例
+ * @return 连接池链表节点
+ */
+dlist_node_t* loop_add_pool(loop_t* loop, pool_t* pool);
+
+/*
+ * 删除连接池
+ * @param loop loop_t实例
+ * @param node loop_add_pool返回的节点
+ */
+void loop_remove_pool(loop_t* loop, dlist_node_t* node);
+
+/*
+ * 发送事件通知 - 监听到新连接
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
  */
 void loop_notify_accept(loop_t* loop, channel_ref_t* channel_ref);
 
 /*
- * ¼֪ͨ - ̷߳
- * @param loop loop_tʵ
- * @param channel_ref channel_ref_tʵ
- * @param send_buffer buffer_tʵ
+ * 发送事件通知 - 已发起连接，由目标loop_t等待连接完成
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
+ */
+void loop_notify_connect(loop_t* loop, channel_ref_t* channel_ref);
+
+/*
+ * 发送事件通知 - 迁移管道，在管道所属线程内迁出
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例（共享引用），迁出后释放
+ * @param target 目标loop_t实例
+ */
+void loop_notify_migrate(loop_t* loop, channel_ref_t* channel_ref, loop_t* target);
+
+/*
+ * 发送事件通知 - 跨线程发送
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
+ * @param send_buffer buffer_t实例
  */
 void loop_notify_send(loop_t* loop, channel_ref_t* channel_ref, buffer_t* send_buffer);
 
 /*
- * ¼֪ͨ - رչܵ
- * @param loop loop_tʵ
- * @param channel_ref channel_ref_tʵ
+ * 发送消息事件通知 - 跨线程发送需要经过写方向过滤器链的消息
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
+ * @param chain 消息体缓冲区链表
+ */
+void loop_notify_send_frame(loop_t* loop, channel_ref_t* channel_ref, buffer_t* chain);
+
+/*
+ * 发送事件通知 - 关闭管道
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
  */
 void loop_notify_close(loop_t* loop, channel_ref_t* channel_ref);
 
 /*
- * ֪ͨܵص
- * @param loop loop_tʵ
- * @param e ܵ¼
+ * 发送事件通知 - 域名解析完成，由解析器工作线程调用
+ * @param loop loop_t实例
+ * @param job resolver_job_t实例
+ */
+void loop_notify_resolve(loop_t* loop, resolver_job_t* job);
+
+/*
+ * 通知管道回调函数
+ * @param loop loop_t实例
+ * @param e 管道事件
  */
 void loop_queue_cb(channel_ref_t* channel, channel_cb_event_e e);
 
 /*
- * ¼صloop_queue_cb
- * @param loop loop_tʵ
+ * 触发读事件回调loop_queue_cb
+ * @param loop loop_t实例
  */
 void loop_notify(loop_t* loop);
 
 /*
- * ¼
- * @param loop loop_tʵ
+ * 处理事件
+ * @param loop loop_t实例
  */
 void loop_event_process(loop_t* loop);
 
 /*
- * Ծܵгʱ
- * @param loop loop_tʵ
+ * 检查活跃管道空闲超时
+ * @param loop loop_t实例
  */
 void loop_check_timeout(loop_t* loop, time_t ts);
 
 /*
- * رչܵǷ
- * @param loop loop_tʵ
+ * 检查关闭管道是否可以销毁
+ * @param loop loop_t实例
  */
 void loop_check_close(loop_t* loop);
 
 /*
- * Ƿ
- * @param loop loop_tʵ
+ * 检查是否正在运行
+ * @param loop loop_t实例
  */
 int loop_check_running(loop_t* loop);
 
 /* 
- * ѡȡҪʵֵĺ - ʼ
- * @param loop loop_tʵ
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 选取器需要实现的函数 - 建立并初始化
+ * @param loop loop_t实例
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 
 int impl_create(loop_t* loop);
 
 /* 
- * ѡȡҪʵֵĺ - ֹͣ
- * @param loop loop_tʵ
+ * 选取器需要实现的函数 - 停止并销毁
+ * @param loop loop_t实例
  */
 void impl_destroy(loop_t* loop);
 
 /* 
- * ѡȡҪʵֵĺ - һ¼ѭ
- * @param loop loop_tʵ
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 选取器需要实现的函数 - 运行一次事件循环
+ * @param loop loop_t实例
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int impl_run_once(loop_t* loop);
 
 /* 
- * ѡȡҪʵֵĺ - Ͷһ¼
- * @param loop loop_tʵ
- * @param e ¼
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 选取器需要实现的函数 - 投递一个（多个）事件
+ * @param loop loop_t实例
+ * @param e 事件
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int impl_event_add(channel_ref_t* channel_ref, channel_event_e e);
 
 /* 
- * ѡȡҪʵֵĺ - ȡһ¼
- * @param loop loop_tʵ
- * @param e ¼
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 选取器需要实现的函数 - 取消一个（多个）事件
+ * @param loop loop_t实例
+ * @param e 事件
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int impl_event_remove(channel_ref_t* channel_ref, channel_event_e e);
 
 /* 
- * ѡȡҪʵֵĺ - ֪ͨµĹܵ˻Ծ
- * @param loop loop_tʵ
- * @param channel_ref channel_ref_tʵ
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 选取器需要实现的函数 - 通知有新的管道加入了活跃链表
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int impl_add_channel_ref(loop_t* loop, channel_ref_t* channel_ref);
 
 /* 
- * ѡȡҪʵֵĺ - ֪ͨܵرղ
- * @param loop loop_tʵ
- * @param channel_ref channel_ref_tʵ
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 选取器需要实现的函数 - 通知管道关闭并销毁
+ * @param loop loop_t实例
+ * @param channel_ref channel_ref_t实例
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int impl_remove_channel_ref(loop_t* loop, channel_ref_t* channel_ref);
 
 /* 
- * ѡȡҪʵֵĺ - ӵʱѡȡԶʵ
- * @param channel_ref channel_ref_tʵ
- * @return ׽
+ * 选取器需要实现的函数 - 新连接到来时检测选取器自定义实现
+ * @param channel_ref channel_ref_t实例
+ * @return 套接字
  */
 socket_t impl_channel_accept(channel_ref_t* channel_ref);
 
@@ -28,59 +28,105 @@
 #include "config.h"
 
 /*
- * һ¼ѭ
- * @return loop_tʵ
+ * 创建一个事件循环
+ * @return loop_t实例
  */
 loop_t* loop_create();
 
 /*
- * ¼ѭ
- * ¼ѭڵйܵҲᱻ
- * @param loop loop_tʵ
+ * 销毁事件循环
+ * 事件循环内的所有管道也会被销毁
+ * @param loop loop_t实例
  */
 void loop_destroy(loop_t* loop);
 
 /*
- * ܵ
- * @param loop loop_tʵ
- * @param max_send_list_len ͻ󳤶
- * @param recv_ring_len ܻλ󳤶
- * @return channel_ref_tʵ
+ * 创建管道
+ * @param loop loop_t实例
+ * @param max_send_list_len 发送缓冲区链最大长度
+ * @param recv_ring_len 接受环形缓冲区初始长度，可通过channel_ref_set_max_recv_ring_len设置扩展上限
+ * @return channel_ref_t实例
  */
 channel_ref_t* loop_create_channel(loop_t* loop, uint32_t max_send_list_len, uint32_t recv_ring_len);
 
 /*
- * ʹѴڵ׽ִܵ
- * @param loop loop_tʵ
- * @param socket_fd ׽
- * @param max_send_list_len ͻ󳤶
- * @param recv_ring_len ܻλ󳤶
- * @return channel_ref_tʵ
+ * 创建UDP管道
+ * 通过channel_ref_bind绑定后开始接收，每次读事件以recvmmsg批量读取并逐个回调cb，
+ * 通过channel_ref_sendto发送. 只支持epoll和select选取器
+ * @param loop loop_t实例
+ * @param max_size 接收数据报最大长度，超过的数据报被丢弃
+ * @param max_send_count 发送队列最多容纳的数据报数量
+ * @param cb 数据报回调
+ * @return channel_ref_t实例
+ */
+channel_ref_t* loop_create_udp_channel(loop_t* loop, uint32_t max_size, uint32_t max_send_count, channel_ref_udp_cb_t cb);
+
+/*
+ * 创建共享内存管道
+ * 创建后即可读写，读写语义与TCP管道相同，数据经共享内存环传递，只在对端读空后等待时敲门铃.
+ * 一端关闭后另一端读完剩余数据后关闭. 对端进程异常退出时不会通知，需要通过读空闲超时检测.
+ * 需要在loop所在线程调用，只支持Linux和epoll选取器
+ * @param loop loop_t实例
+ * @param shm shm_create_pair或shm_recv取得的shm_t实例，所有权转移给管道
+ * @param max_send_list_len 发送缓冲区链最大长度
+ * @param recv_ring_len 接受环形缓冲区初始长度
+ * @return channel_ref_t实例
+ */
+channel_ref_t* loop_create_shm_channel(loop_t* loop, shm_t* shm, uint32_t max_send_list_len, uint32_t recv_ring_len);
+
+/*
+ * 创建一对相互连接的进程内管道
+ * 不使用套接字，写入的缓冲区直接移入对端读队列，不拷贝也不经过系统调用，
+ * 对端在自己的loop内得到读事件回调. 两个loop可以相同，也可以在不同线程内运行，
+ * 管道在所属loop下次循环时加入活跃链表. 一端关闭后另一端读完剩余数据后关闭
+ * @param loop_a 第一端所属loop_t实例
+ * @param loop_b 第二端所属loop_t实例
+ * @param max_send_list_len 发送缓冲区链最大长度
+ * @param recv_ring_len 接受环形缓冲区初始长度
+ * @param pair 两端的channel_ref_t实例，pair[0]属于loop_a，pair[1]属于loop_b
+ */
+void loop_create_channel_pair(loop_t* loop_a, loop_t* loop_b, uint32_t max_send_list_len, uint32_t recv_ring_len, channel_ref_t* pair[2]);
+
+/*
+ * 使用已存在的套接字创建管道
+ * @param loop loop_t实例
+ * @param socket_fd 套接字
+ * @param max_send_list_len 发送缓冲区链最大长度
+ * @param recv_ring_len 接受环形缓冲区最大长度
+ * @return channel_ref_t实例
  */
 channel_ref_t* loop_create_channel_exist_socket_fd(loop_t* loop, socket_t socket_fd, uint32_t max_send_list_len, uint32_t recv_ring_len);
 
 /*
- * һ¼ѭ
- * loop_t̰߳ȫģڶ߳ͬʱͬһloop_tʵloop_run_once
- * @param loop loop_tʵ
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 运行一次事件循环
+ * loop_t不是线程安全的，不能在多个线程内同时对同一个loop_t实例调用loop_run_once
+ * @param loop loop_t实例
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int loop_run_once(loop_t* loop);
 
 /*
- * ¼ѭֱloop_exit()
- * loop_t̰߳ȫģڶ߳ͬʱͬһloop_tʵloop_run
- * @param loop loop_tʵ
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 运行事件循环直到调用loop_exit()
+ * loop_t不是线程安全的，不能在多个线程内同时对同一个loop_t实例调用loop_run
+ * @param loop loop_t实例
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int loop_run(loop_t* loop);
 
 /*
- * ˳loop_run()
- * @param loop loop_tʵ
+ * 退出函数loop_run()
+ * @param loop loop_t实例
  */
 void loop_exit(loop_t* loop);
 
+/*
+ * 取得繁忙程度，可以在任意线程调用
+ * 每100毫秒采样一次loop_t所在线程的CPU时间占比，取指数加权移动平均
+ * @param loop loop_t实例
+ * @return 繁忙程度（千分比）
+ */
+int loop_get_busy(loop_t* loop);
+
 #endif /* LOOP_API_H */
@@ -23,117 +23,363 @@
  */
 
 #include "loop_balancer.h"
-#include "list.h"
 #include "misc.h"
 #include "loop.h"
 
-typedef struct _loop_info_t {
-    loop_t*  loop;    /* loop_tʵ */
-    uint64_t choose;  /* ѡȡ */
-} loop_info_t;
+#define LOOP_BALANCER_MAX_LOOP 64   /* 负载均衡器最多关联的loop_t数量 */
+#define LOOP_BALANCER_IDLE_MIN 10   /* EWMA策略下繁忙loop_t保留的最小空闲权重（千分比） */
+#define LOOP_BALANCER_BUSY_GAP 200  /* 自动迁移时目标loop_t至少空闲的程度（千分比） */
+
+typedef struct _loop_slot_t {
+    loop_t* volatile loop;   /* loop_t实例，0为空槽位 */
+    volatile int     weight; /* 静态权重 */
+} loop_slot_t;
+
+typedef loop_t* (*loop_balancer_choose_t)(loop_balancer_t*, int);
 
 struct _loop_balancer_t {
-    dlist_t* loop_info_list; /* loop_tʵ */
-    lock_t*  lock;           /*  - , loop_tʵɾ */
+    loop_slot_t            slots[LOOP_BALANCER_MAX_LOOP]; /* loop_t槽位 */
+    volatile int           slot_count;                    /* 使用过的槽位数量，只增不减 */
+    loop_balancer_choose_t choose;                        /* 当前策略的选取函数 */
+    atomic_counter_t       seq;                           /* 轮询序号及随机数种子 */
+    volatile int           affinity;                      /* 是否按键一致性散列选取 */
+    volatile int           rebalance;                     /* 自动迁移管道的繁忙阈值（千分比），0为关闭 */
+    lock_t*                lock;                          /* 锁 - loop_t实例的添加删除，选取不加锁 */
 };
 
+static loop_t* loop_balancer_choose_least_load(loop_balancer_t* balancer, int slots);
+
 loop_balancer_t* loop_balancer_create() {
     loop_balancer_t* balancer = create(loop_balancer_t);
     assert(balancer);
-    balancer->loop_info_list = dlist_create();
-    assert(balancer->loop_info_list);
+    memset(balancer, 0, sizeof(loop_balancer_t));
+    balancer->choose = loop_balancer_choose_least_load;
     balancer->lock = lock_create();
     assert(balancer->lock);
     return balancer;
 }
 
 void loop_balancer_destroy(loop_balancer_t* balancer) {
-    dlist_node_t* node = 0;
-    dlist_node_t* temp = 0;
     assert(balancer);
     lock_destroy(balancer->lock);
-    dlist_for_each_safe(balancer->loop_info_list, node, temp) {
-        destroy(dlist_node_get_data(node));
-    }
-    dlist_destroy(balancer->loop_info_list);
     destroy(balancer);
 }
 
 int loop_balancer_attach(loop_balancer_t* balancer, loop_t* loop) {
-    dlist_node_t* node      = 0;
-    dlist_node_t* temp      = 0;
-    loop_info_t*  loop_info = 0;
-    int           error     = error_ok;
+    int i     = 0;
+    int found = -1;
+    int error = error_ok;
     assert(balancer);
     assert(loop);
     lock_lock(balancer->lock);
-    dlist_for_each_safe(balancer->loop_info_list, node, temp) {
-        loop_info = (loop_info_t*)dlist_node_get_data(node);
-        if (loop_info->loop == loop) {
+    for (; i < balancer->slot_count; i++) {
+        if (balancer->slots[i].loop == loop) {
             error = error_loop_attached;
             goto unlock_return;
         }
+        if ((found < 0) && !balancer->slots[i].loop) {
+            /* 复用已删除的槽位 */
+            found = i;
+        }
+    }
+    if (found < 0) {
+        if (balancer->slot_count >= LOOP_BALANCER_MAX_LOOP) {
+            error = error_loop_full;
+            goto unlock_return;
+        }
+        found = balancer->slot_count;
     }
-    loop_info = create(loop_info_t);
-    assert(loop_info);
-    memset(loop_info, 0, sizeof(loop_info_t));
-    loop_info->loop = loop;
-    dlist_add_tail_node(balancer->loop_info_list, loop_info);
     loop_set_balancer(loop, balancer);
+    balancer->slots[found].weight = 1;
+    balancer->slots[found].loop = loop;
+    if (found == balancer->slot_count) {
+        /* 槽位写入后再增加数量，选取线程不会读到未初始化的槽位 */
+        balancer->slot_count++;
+    }
 unlock_return:
     lock_unlock(balancer->lock);
     return error;
 }
 
 int loop_balancer_detach(loop_balancer_t* balancer, loop_t* loop) {
-    dlist_node_t* node      = 0;
-    dlist_node_t* found     = 0;
-    dlist_node_t* temp      = 0;
-    loop_info_t*  loop_info = 0;
-    int           error     = error_ok;
+    int i     = 0;
+    int error = error_loop_not_found;
     assert(balancer);
     assert(loop);
     lock_lock(balancer->lock);
-    dlist_for_each_safe(balancer->loop_info_list, node, temp) {
-        loop_info = (loop_info_t*)dlist_node_get_data(node);
-        if (loop_info->loop == loop) {
-            found = node;
+    for (; i < balancer->slot_count; i++) {
+        if (balancer->slots[i].loop == loop) {
+            balancer->slots[i].loop = 0;
+            loop_set_balancer(loop, 0);
+            error = error_ok;
             break;
         }
     }
-    if (found) {
-        loop_set_balancer(loop_info->loop, 0);
-        destroy(loop_info);
-        dlist_delete(balancer->loop_info_list, found);
-    } else {
-        error = error_loop_not_found;
-    }
     lock_unlock(balancer->lock);
     return error;
 }
 
-loop_t* loop_balancer_choose(loop_balancer_t* balancer) {
-    dlist_node_t* node          = 0;
-    dlist_node_t* temp          = 0;
-    dlist_t*      channel_list  = 0;
-    loop_info_t*  found         = 0;
-    loop_info_t*  loop_info     = 0;
-    int           channel_count = INT_MAX;
-    int           count         = 0;
+int loop_balancer_set_weight(loop_balancer_t* balancer, loop_t* loop, int weight) {
+    int i     = 0;
+    int error = error_loop_not_found;
     assert(balancer);
+    assert(loop);
+    assert(weight > 0);
     lock_lock(balancer->lock);
-    /* ѡȡǰԾܵٵloop_t */
-    dlist_for_each_safe(balancer->loop_info_list, node, temp) {
-        loop_info = (loop_info_t*)dlist_node_get_data(node);
-        channel_list = loop_get_active_list(loop_info->loop);
-        count = dlist_get_count(channel_list);
-        if (count < channel_count) {
-            found = loop_info;
-            channel_count = count;
-        }
-    }
-    /* ¼ѡȡ */
-    found->choose++;
+    for (; i < balancer->slot_count; i++) {
+        if (balancer->slots[i].loop == loop) {
+            balancer->slots[i].weight = weight;
+            error = error_ok;
+            break;
+        }
+    }
     lock_unlock(balancer->lock);
-    return found->loop;
+    return error;
+}
+
+/*
+ * 无锁的伪随机数，由递增序号散列得到
+ */
+static uint32_t loop_balancer_random(loop_balancer_t* balancer) {
+    uint32_t x = (uint32_t)atomic_counter_inc(&balancer->seq) * 2654435761u;
+    x ^= x >> 16;
+    x *= 0x45d9f3b;
+    x ^= x >> 16;
+    return x;
+}
+
+static loop_t* loop_balancer_choose_least_load(loop_balancer_t* balancer, int slots) {
+    int     i     = 0;
+    int     count = 0;
+    int     load  = INT_MAX;
+    loop_t* loop  = 0;
+    loop_t* found = 0;
+    for (; i < slots; i++) {
+        loop = balancer->slots[i].loop;
+        if (!loop) {
+            continue;
+        }
+        count = loop_get_load(loop);
+        if (count < load) {
+            found = loop;
+            load  = count;
+        }
+    }
+    return found;
+}
+
+static loop_t* loop_balancer_choose_p2c(loop_balancer_t* balancer, int slots) {
+    uint32_t r = loop_balancer_random(balancer);
+    loop_t*  a = balancer->slots[r % slots].loop;
+    /* 第二个与第一个不同 */
+    loop_t*  b = (slots > 1) ? balancer->slots[(r % slots + 1 + (r >> 16) % (slots - 1)) % slots].loop : 0;
+    if (!a || !b) {
+        /* 选中空槽位，退化为最小负载 */
+        return (a || b) ? (a ? a : b) : loop_balancer_choose_least_load(balancer, slots);
+    }
+    return (loop_get_load(b) < loop_get_load(a)) ? b : a;
+}
+
+static loop_t* loop_balancer_choose_ewma(loop_balancer_t* balancer, int slots) {
+    int     i     = 0;
+    int     total = 0;
+    int     pick  = 0;
+    int     idle[LOOP_BALANCER_MAX_LOOP];
+    loop_t* loop  = 0;
+    /* 空闲程度作为权重，随机选取避免采样间隔内全部选中同一个loop_t */
+    for (; i < slots; i++) {
+        loop = balancer->slots[i].loop;
+        idle[i] = 0;
+        if (loop) {
+            idle[i] = 1000 - loop_get_busy(loop);
+            if (idle[i] < LOOP_BALANCER_IDLE_MIN) {
+                idle[i] = LOOP_BALANCER_IDLE_MIN;
+            }
+            total += idle[i];
+        }
+    }
+    if (!total) {
+        return 0;
+    }
+    pick = (int)(loop_balancer_random(balancer) % (uint32_t)total);
+    for (i = 0; i < slots; i++) {
+        if (pick < idle[i]) {
+            loop = balancer->slots[i].loop;
+            if (loop) {
+                return loop;
+            }
+            /* 读取后被删除 */
+            break;
+        }
+        pick -= idle[i];
+    }
+    return loop_balancer_choose_least_load(balancer, slots);
+}
+
+static loop_t* loop_balancer_choose_weight(loop_balancer_t* balancer, int slots) {
+    int     i            = 0;
+    int     weight       = 0;
+    int     load         = 0;
+    int     found_load   = 0;
+    int     found_weight = 0;
+    loop_t* loop         = 0;
+    loop_t* found        = 0;
+    for (; i < slots; i++) {
+        loop = balancer->slots[i].loop;
+        if (!loop) {
+            continue;
+        }
+        weight = balancer->slots[i].weight;
+        load   = loop_get_load(loop);
+        /* 比较load/weight，交叉相乘避免除法 */
+        if (!found || ((int64_t)load * found_weight < (int64_t)found_load * weight)) {
+            found        = loop;
+            found_load   = load;
+            found_weight = weight;
+        }
+    }
+    return found;
+}
+
+static loop_t* loop_balancer_choose_round_robin(loop_balancer_t* balancer, int slots) {
+    int      i     = 0;
+    uint32_t start = (uint32_t)atomic_counter_inc(&balancer->seq);
+    loop_t*  loop  = 0;
+    for (; i < slots; i++) {
+        /* 跳过空槽位 */
+        loop = balancer->slots[(start + i) % (uint32_t)slots].loop;
+        if (loop) {
+            return loop;
+        }
+    }
+    return 0;
+}
+
+/*
+ * 64位整数混合（splitmix64终结函数）
+ */
+static uint64_t loop_balancer_mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+/*
+ * 键的散列值（FNV-1a）
+ */
+static uint64_t loop_balancer_hash(const void* key, int size) {
+    const unsigned char* p = (const unsigned char*)key;
+    uint64_t             h = 0xcbf29ce484222325ull;
+    int                  i = 0;
+    for (; i < size; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+static loop_t* loop_balancer_choose_rendezvous(loop_balancer_t* balancer, int slots, uint64_t hash) {
+    int      i     = 0;
+    uint64_t score = 0;
+    uint64_t max   = 0;
+    loop_t*  loop  = 0;
+    loop_t*  found = 0;
+    /* 每个loop_t以自身地址与键共同散列，取分数最大者，结果与槽位顺序无关 */
+    for (; i < slots; i++) {
+        loop = balancer->slots[i].loop;
+        if (!loop) {
+            continue;
+        }
+        score = loop_balancer_mix(hash ^ loop_balancer_mix((uint64_t)(size_t)loop));
+        if (!found || (score > max)) {
+            found = loop;
+            max   = score;
+        }
+    }
+    return found;
+}
+
+void loop_balancer_set_strategy(loop_balancer_t* balancer, loop_balancer_strategy_e strategy) {
+    assert(balancer);
+    balancer->affinity = (strategy == loop_balancer_strategy_affinity);
+    switch (strategy) {
+    case loop_balancer_strategy_p2c:
+        balancer->choose = loop_balancer_choose_p2c;
+        break;
+    case loop_balancer_strategy_ewma:
+        balancer->choose = loop_balancer_choose_ewma;
+        break;
+    case loop_balancer_strategy_weight:
+        balancer->choose = loop_balancer_choose_weight;
+        break;
+    case loop_balancer_strategy_round_robin:
+        balancer->choose = loop_balancer_choose_round_robin;
+        break;
+    default:
+        balancer->choose = loop_balancer_choose_least_load;
+        break;
+    }
+}
+
+loop_t* loop_balancer_choose(loop_balancer_t* balancer) {
+    int slots = 0;
+    assert(balancer);
+    slots = balancer->slot_count;
+    if (!slots) {
+        return 0;
+    }
+    /* 不加锁，由策略选取 */
+    return balancer->choose(balancer, slots);
+}
+
+loop_t* loop_balancer_choose_key(loop_balancer_t* balancer, const void* key, int size) {
+    int slots = 0;
+    assert(balancer);
+    if (!balancer->affinity || !key || (size <= 0)) {
+        return loop_balancer_choose(balancer);
+    }
+    slots = balancer->slot_count;
+    if (!slots) {
+        return 0;
+    }
+    return loop_balancer_choose_rendezvous(balancer, slots, loop_balancer_hash(key, size));
+}
+
+void loop_balancer_set_rebalance(loop_balancer_t* balancer, int busy) {
+    assert(balancer);
+    assert((busy >= 0) && (busy <= 1000));
+    balancer->rebalance = busy;
+}
+
+loop_t* loop_balancer_choose_rebalance(loop_balancer_t* balancer, loop_t* loop) {
+    int     i     = 0;
+    int     slots = 0;
+    int     busy  = 0;
+    int     least = 0;
+    loop_t* other = 0;
+    loop_t* found = 0;
+    assert(balancer);
+    assert(loop);
+    busy = loop_get_busy(loop);
+    if (!balancer->rebalance || (busy < balancer->rebalance)) {
+        return 0;
+    }
+    /* 只迁移到明显更空闲的loop_t，避免来回迁移 */
+    least = busy - LOOP_BALANCER_BUSY_GAP;
+    slots = balancer->slot_count;
+    for (; i < slots; i++) {
+        other = balancer->slots[i].loop;
+        if (!other || (other == loop)) {
+            continue;
+        }
+        busy = loop_get_busy(other);
+        if (busy < least) {
+            found = other;
+            least = busy;
+        }
+    }
+    return found;
 }
@@ -29,10 +29,29 @@
 #include "loop_balancer_api.h"
 
 /*
- * ؾ - ѡȡһloop_tʵ
- * @param balancer loop_balancer_tʵ
- * @return loop_tʵ
+ * 负载均衡 - 选取一个loop_t实例，不加锁，可以在任意线程调用
+ * @param balancer loop_balancer_t实例
+ * @return loop_t实例，没有关联的loop_t时返回0
  */
 loop_t* loop_balancer_choose(loop_balancer_t* balancer);
 
+/*
+ * 负载均衡 - 按键选取一个loop_t实例，不加锁，可以在任意线程调用
+ * loop_balancer_strategy_affinity策略下相同的键总是选取同一个loop_t，增删loop_t时
+ * 只有映射到该loop_t的键改变选取结果；其他策略忽略键
+ * @param balancer loop_balancer_t实例
+ * @param key 键
+ * @param size 键长度，为0时与loop_balancer_choose相同
+ * @return loop_t实例，没有关联的loop_t时返回0
+ */
+loop_t* loop_balancer_choose_key(loop_balancer_t* balancer, const void* key, int size);
+
+/*
+ * 自动迁移 - 选取比loop明显空闲的loop_t实例，在loop所在线程调用
+ * @param balancer loop_balancer_t实例
+ * @param loop 当前loop_t实例
+ * @return 最空闲的loop_t实例，未开启自动迁移、loop繁忙程度未达到阈值或没有合适的loop_t时返回0
+ */
+loop_t* loop_balancer_choose_rebalance(loop_balancer_t* balancer, loop_t* loop);
+
 #endif /* LOOP_BALANCER_H */
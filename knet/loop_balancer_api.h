@@ -28,33 +28,62 @@
 #include "config.h"
 
 /*
- * ؾ
- * @return loop_balancer_tʵ
+ * 创建负载均衡器
+ * @return loop_balancer_t实例
  */
 loop_balancer_t* loop_balancer_create();
 
 /*
- * ٸؾ
- * @param loop_balancer_tʵ
+ * 销毁负载均衡器
+ * @param loop_balancer_t实例
  */
 void loop_balancer_destroy(loop_balancer_t* balancer);
 
 /*
- * ¼ѭؾ
- * @param loop_balancer_tʵ
- * @param loop loop_tʵ
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 添加事件循环到负载均衡器，最多64个
+ * @param loop_balancer_t实例
+ * @param loop loop_t实例
+ * @retval error_ok 成功
+ * @retval error_loop_full 没有空闲槽位
+ * @retval 其他 失败
  */
 int loop_balancer_attach(loop_balancer_t* balancer, loop_t* loop);
 
 /*
- * Ӹؾɾ¼ѭ
- * @param loop_balancer_tʵ
- * @param loop loop_tʵ
- * @retval error_ok ɹ
- * @retval  ʧ
+ * 从负载均衡器内删除事件循环
+ * 选取不加锁，删除时正在进行的选取仍可能返回此loop_t，销毁loop_t前需要停止其他loop_t的监听和连接
+ * @param loop_balancer_t实例
+ * @param loop loop_t实例
+ * @retval error_ok 成功
+ * @retval 其他 失败
  */
 int loop_balancer_detach(loop_balancer_t* balancer, loop_t* loop);
 
+/*
+ * 设置负载均衡策略，默认为loop_balancer_strategy_least_load
+ * @param loop_balancer_t实例
+ * @param strategy 策略
+ */
+void loop_balancer_set_strategy(loop_balancer_t* balancer, loop_balancer_strategy_e strategy);
+
+/*
+ * 设置loop_t的静态权重，loop_balancer_strategy_weight策略使用
+ * @param loop_balancer_t实例
+ * @param loop loop_t实例
+ * @param weight 权重，大于0，默认为1
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int loop_balancer_set_weight(loop_balancer_t* balancer, loop_t* loop, int weight);
+
+/*
+ * 开启自动迁移管道
+ * loop_t繁忙程度（loop_get_busy）达到阈值且有明显更空闲的loop_t时，将最近读取过数据的管道
+ * 逐个迁移（channel_ref_migrate）到最空闲的loop_t，每秒最多迁移一个.
+ * 迁移不考虑loop_balancer_strategy_affinity的亲和关系
+ * @param loop_balancer_t实例
+ * @param busy 繁忙阈值（千分比），0关闭，默认关闭
+ */
+void loop_balancer_set_rebalance(loop_balancer_t* balancer, int busy);
+
 #endif /* LOOP_BALANCER_API_H */
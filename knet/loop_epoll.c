@@ -30,8 +30,8 @@
 #include "channel.h"
 
 typedef struct _loop_epoll_t {
-    int                 epoll_fd; /* epoll */
-    struct epoll_event* events;   /* epoll¼ */
+    int                 epoll_fd; /* epoll描述符 */
+    struct epoll_event* events;   /* epoll事件数组 */
 } loop_epoll_t;
 
 #define MAXEVENTS 256
@@ -58,7 +58,8 @@ void impl_destroy(loop_t* loop) {
 
 int _select(loop_t* loop, int* count) {
     loop_epoll_t* impl = (loop_epoll_t*)loop_get_impl(loop);
-    *count = epoll_wait(impl->epoll_fd, impl->events, MAXEVENTS, 1);
+    /* 有就绪管道时不等待 */
+    *count = epoll_wait(impl->epoll_fd, impl->events, MAXEVENTS, loop_get_ready_count(loop) ? 0 : 1);
     if (*count < 0) {
         return error_loop_fail;
     }
@@ -79,15 +80,20 @@ int impl_run_once(loop_t* loop) {
     events = impl->events;
     for (; i < count; i++) {
         channel_ref = (channel_ref_t*)events[i].data.ptr;
-        if (events[i].events & EPOLLIN) {
-            channel_ref_update(channel_ref, channel_event_recv, ts);
-        } else if (events[i].events & EPOLLOUT) {
-            channel_ref_update(channel_ref, channel_event_send, ts);
+        if (events[i].events & (EPOLLIN | EPOLLOUT)) {
+            /* 边沿触发，同时可读可写时两个事件都要处理，否则写事件丢失 */
+            if (events[i].events & EPOLLIN) {
+                channel_ref_update(channel_ref, channel_event_recv, ts);
+            }
+            if (events[i].events & EPOLLOUT) {
+                channel_ref_update(channel_ref, channel_event_send, ts);
+            }
         } else {
-            /*  */
+            /* 错误 */
             channel_ref_close(channel_ref);
         }
     }
+    loop_check_ready(loop, ts);
     loop_check_timeout(loop, ts);
     loop_check_close(loop);
     return error_ok;
@@ -101,12 +107,12 @@ int impl_event_add(channel_ref_t* channel_ref, channel_event_e e) {
     event.data.ptr = channel_ref;
     event.events |= EPOLLET;
     if (e & channel_event_recv) {
-        if (old_event & channel_event_send) { /* Ѿעд¼ */
+        if (old_event & channel_event_send) { /* 已经注册写事件 */
             event.events |= EPOLLOUT;
         }
         event.events |= EPOLLIN;
     } else if (e & channel_event_send) {
-        if (old_event & channel_event_recv) { /* Ѿע¼ */
+        if (old_event & channel_event_recv) { /* 已经注册读事件 */
             event.events |= EPOLLIN;
         }
         event.events |= EPOLLOUT;
@@ -128,11 +134,11 @@ int impl_event_remove(channel_ref_t* channel_ref, channel_event_e e) {
     event.data.ptr = channel_ref;
     event.events |= EPOLLET;
     if (e & channel_event_recv) {
-        if (old_event & channel_event_send) { /* Ѿעд¼ */
+        if (old_event & channel_event_send) { /* 已经注册写事件 */
             event.events |= EPOLLOUT;
         }
     } else if (e & channel_event_send) {
-        if (old_event & channel_event_recv) { /* Ѿע¼ */
+        if (old_event & channel_event_recv) { /* 已经注册读事件 */
             event.events |= EPOLLIN;
         }
     }
@@ -152,13 +158,17 @@ int impl_add_channel_ref(loop_t* loop, channel_ref_t* channel_ref) {
 int impl_remove_channel_ref(loop_t* loop, channel_ref_t* channel_ref) {
     struct epoll_event event;
     loop_epoll_t* impl = (loop_epoll_t*)loop_get_impl(loop);
-    /* ӱ */
+    /* 清除添加标记 */
     channel_ref_set_flag(channel_ref, 0);
    /* ManPage: In kernel versions before 2.6.9, the EPOLL_CTL_DEL operation required a non-NULL pointer
       in event, even though this argument is ignored. Since Linux 2.6.9, event can be specified
       as NULL when using EPOLL_CTL_DEL. Applications that need to be portable to kernels before
       2.6.9 should specify a non-NULL pointer in event.
     */
+    if (channel_ref_check_state(channel_ref, channel_state_close)) {
+        /* 关闭套接字时已从epoll内删除，套接字可能已被新连接复用，不能再删除 */
+        return error_ok;
+    }
     epoll_ctl(impl->epoll_fd, EPOLL_CTL_DEL, channel_ref_get_socket_fd(channel_ref), &event);
     return error_ok;
 }
@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "loop_group.h"
+#include "loop_balancer.h"
+#include "loop.h"
+#include "misc.h"
+
+#define LOOP_GROUP_MAX_LOOP      64    /* 最多loop_t数量，与负载均衡器槽位数量相同 */
+#define LOOP_GROUP_TICK          100   /* 管理线程检查停止标志的间隔（毫秒） */
+#define LOOP_GROUP_INTERVAL      1000  /* 采样周期（毫秒） */
+#define LOOP_GROUP_GRACE         1000  /* 排空后等待其他线程投递中的事件的时间（毫秒） */
+#define LOOP_GROUP_GROW_BUSY     700   /* 默认扩容阈值（千分比） */
+#define LOOP_GROUP_SHRINK_BUSY   200   /* 默认回收阈值（千分比） */
+#define LOOP_GROUP_SHRINK_IDLE   10000 /* 默认回收前持续空闲时间（毫秒） */
+#define LOOP_GROUP_DRAIN_TIMEOUT 30000 /* 默认排空超时（毫秒） */
+
+typedef struct _loop_group_member_t {
+    loop_t*          loop;       /* loop_t实例，0为空位置 */
+    thread_runner_t* runner;     /* loop_t运行线程 */
+    int              retiring;   /* 是否回收中 */
+    int              drained;    /* 是否已排空 */
+    uint32_t         retire_ts;  /* 开始回收时间戳（毫秒） */
+    uint32_t         drained_ts; /* 排空时间戳（毫秒） */
+} loop_group_member_t;
+
+struct _loop_group_t {
+    loop_group_member_t members[LOOP_GROUP_MAX_LOOP]; /* loop_t及其运行线程 */
+    loop_balancer_t*    balancer;                     /* 负载均衡器 */
+    thread_runner_t*    runner;                       /* 管理线程 */
+    int                 min_loop;                     /* 最少loop_t数量 */
+    int                 max_loop;                     /* 最多loop_t数量 */
+    volatile int        count;                        /* loop_t数量，不包括回收中的loop_t */
+    volatile int        grow_busy;                    /* 扩容阈值（千分比） */
+    volatile int        shrink_busy;                  /* 回收阈值（千分比），0不回收 */
+    volatile int        shrink_idle;                  /* 回收前持续空闲时间（毫秒） */
+    volatile int        drain_timeout;                /* 排空超时（毫秒） */
+    int                 idle;                         /* 平均繁忙程度是否已低于回收阈值 */
+    uint32_t            idle_ts;                      /* 开始低于回收阈值的时间戳（毫秒） */
+    uint32_t            update_ts;                    /* 上次采样时间戳（毫秒） */
+};
+
+loop_group_t* loop_group_create(int min_loop, int max_loop) {
+    loop_group_t* group = 0;
+    assert(min_loop > 0);
+    assert((max_loop >= min_loop) && (max_loop <= LOOP_GROUP_MAX_LOOP));
+    group = create(loop_group_t);
+    assert(group);
+    memset(group, 0, sizeof(loop_group_t));
+    group->balancer      = loop_balancer_create();
+    group->min_loop      = min_loop;
+    group->max_loop      = max_loop;
+    group->grow_busy     = LOOP_GROUP_GROW_BUSY;
+    group->shrink_busy   = LOOP_GROUP_SHRINK_BUSY;
+    group->shrink_idle   = LOOP_GROUP_SHRINK_IDLE;
+    group->drain_timeout = LOOP_GROUP_DRAIN_TIMEOUT;
+    return group;
+}
+
+/*
+ * 停止loop_t运行线程并销毁loop_t
+ */
+static void loop_group_remove(loop_group_t* group, loop_group_member_t* member) {
+    thread_runner_stop(member->runner);
+    thread_runner_join(member->runner);
+    thread_runner_destroy(member->runner);
+    if (!member->retiring) {
+        loop_balancer_detach(group->balancer, member->loop);
+        group->count--;
+    }
+    loop_destroy(member->loop);
+    memset(member, 0, sizeof(loop_group_member_t));
+}
+
+void loop_group_destroy(loop_group_t* group) {
+    int i = 0;
+    assert(group);
+    if (group->runner) {
+        thread_runner_stop(group->runner);
+        thread_runner_join(group->runner);
+        thread_runner_destroy(group->runner);
+    }
+    /* 先全部解除关联，销毁时不再有管道投递到组内loop_t */
+    for (; i < group->max_loop; i++) {
+        if (group->members[i].loop && !group->members[i].retiring) {
+            loop_balancer_detach(group->balancer, group->members[i].loop);
+            group->members[i].retiring = 1;
+        }
+    }
+    for (i = 0; i < group->max_loop; i++) {
+        if (group->members[i].loop) {
+            loop_group_remove(group, &group->members[i]);
+        }
+    }
+    loop_balancer_destroy(group->balancer);
+    destroy(group);
+}
+
+/*
+ * 增加一个loop_t，先关联负载均衡器再启动线程
+ */
+static int loop_group_spawn(loop_group_t* group) {
+    int                  i      = 0;
+    loop_group_member_t* member = 0;
+    for (; i < group->max_loop; i++) {
+        if (!group->members[i].loop) {
+            member = &group->members[i];
+            break;
+        }
+    }
+    if (!member) {
+        /* 回收中的loop_t仍占用位置 */
+        return error_loop_full;
+    }
+    member->loop = loop_create();
+    if (!member->loop) {
+        return error_loop_fail;
+    }
+    member->runner = thread_runner_create(0, 0);
+    assert(member->runner);
+    loop_balancer_attach(group->balancer, member->loop);
+    if (error_ok != thread_runner_start_loop(member->runner, member->loop, 0)) {
+        loop_balancer_detach(group->balancer, member->loop);
+        thread_runner_destroy(member->runner);
+        loop_destroy(member->loop);
+        memset(member, 0, sizeof(loop_group_member_t));
+        return error_thread_start_fail;
+    }
+    group->count++;
+    return error_ok;
+}
+
+/*
+ * 回收负载最小的loop_t，解除关联后排空
+ */
+static void loop_group_retire(loop_group_t* group, uint32_t ms) {
+    int                  i      = 0;
+    loop_group_member_t* member = 0;
+    for (; i < group->max_loop; i++) {
+        if (!group->members[i].loop || group->members[i].retiring) {
+            continue;
+        }
+        if (!member || (loop_get_load(group->members[i].loop) < loop_get_load(member->loop))) {
+            member = &group->members[i];
+        }
+    }
+    if (!member) {
+        return;
+    }
+    loop_balancer_detach(group->balancer, member->loop);
+    loop_drain(member->loop, group->balancer);
+    member->retiring  = 1;
+    member->retire_ts = ms;
+    group->count--;
+}
+
+/*
+ * 取消回收，重新关联到负载均衡器
+ */
+static void loop_group_cancel_retire(loop_group_t* group, loop_group_member_t* member) {
+    loop_drain(member->loop, 0);
+    if (error_ok != loop_balancer_attach(group->balancer, member->loop)) {
+        /* 没有空闲槽位，继续排空 */
+        loop_drain(member->loop, group->balancer);
+        return;
+    }
+    member->retiring = 0;
+    member->drained  = 0;
+    group->count++;
+}
+
+/*
+ * 销毁已排空的loop_t，排空超时的取消回收
+ */
+static void loop_group_check_retire(loop_group_t* group, uint32_t ms) {
+    int                  i      = 0;
+    loop_group_member_t* member = 0;
+    for (; i < group->max_loop; i++) {
+        member = &group->members[i];
+        if (!member->loop || !member->retiring) {
+            continue;
+        }
+        if (!member->drained && loop_check_drained(member->loop)) {
+            member->drained    = 1;
+            member->drained_ts = ms;
+        }
+        /* 排空后再等待一段时间，选取时读到此loop_t的其他线程完成投递 */
+        if (member->drained && (ms - member->drained_ts >= LOOP_GROUP_GRACE)) {
+            if (loop_check_drained(member->loop)) {
+                loop_group_remove(group, member);
+                continue;
+            }
+            /* 等待期间又投递了管道 */
+            member->drained = 0;
+        }
+        if (ms - member->retire_ts >= (uint32_t)group->drain_timeout) {
+            /* 仍有不可迁移的管道，销毁会使对端访问已释放的loop_t，取消回收 */
+            loop_group_cancel_retire(group, member);
+        }
+    }
+}
+
+void loop_group_update(loop_group_t* group, uint32_t ms) {
+    int i     = 0;
+    int total = 0;
+    int count = 0;
+    int busy  = 0;
+    assert(group);
+    loop_group_check_retire(group, ms);
+    for (; i < group->max_loop; i++) {
+        if (group->members[i].loop && !group->members[i].retiring) {
+            total += loop_get_busy(group->members[i].loop);
+            count++;
+        }
+    }
+    if (!count) {
+        return;
+    }
+    busy = total / count;
+    if ((busy > group->grow_busy) && (count < group->max_loop)) {
+        loop_group_spawn(group);
+        group->idle = 0;
+        return;
+    }
+    /* 回收后其余loop_t不会立即达到扩容阈值，避免反复增减 */
+    if (group->shrink_busy && (count > group->min_loop) && (busy < group->shrink_busy) &&
+        (total / (count - 1) < group->grow_busy)) {
+        if (!group->idle) {
+            group->idle    = 1;
+            group->idle_ts = ms;
+        } else if (ms - group->idle_ts >= (uint32_t)group->shrink_idle) {
+            loop_group_retire(group, ms);
+            group->idle = 0;
+        }
+    } else {
+        group->idle = 0;
+    }
+}
+
+static void loop_group_monitor(thread_runner_t* runner) {
+    uint32_t      ms    = 0;
+    loop_group_t* group = (loop_group_t*)thread_runner_get_params(runner);
+    while (thread_runner_check_start(runner)) {
+        thread_sleep_ms(LOOP_GROUP_TICK);
+        ms = time_get_milliseconds();
+        if (ms - group->update_ts >= LOOP_GROUP_INTERVAL) {
+            group->update_ts = ms;
+            loop_group_update(group, ms);
+        }
+    }
+}
+
+int loop_group_start(loop_group_t* group) {
+    int error = error_ok;
+    assert(group);
+    assert(!group->runner);
+    while (group->count < group->min_loop) {
+        error = loop_group_spawn(group);
+        if (error != error_ok) {
+            return error;
+        }
+    }
+    group->update_ts = time_get_milliseconds();
+    group->runner = thread_runner_create(loop_group_monitor, group);
+    assert(group->runner);
+    return thread_runner_start(group->runner, 0);
+}
+
+void loop_group_bind(loop_group_t* group, loop_t* loop) {
+    assert(group);
+    assert(loop);
+    /* 不占用槽位，只使用负载均衡器选取 */
+    loop_set_balancer(loop, group->balancer);
+}
+
+loop_balancer_t* loop_group_get_balancer(loop_group_t* group) {
+    assert(group);
+    return group->balancer;
+}
+
+void loop_group_set_grow(loop_group_t* group, int busy) {
+    assert(group);
+    assert((busy > 0) && (busy <= 1000));
+    group->grow_busy = busy;
+}
+
+void loop_group_set_shrink(loop_group_t* group, int busy, int idle) {
+    assert(group);
+    assert((busy >= 0) && (busy <= 1000));
+    assert(idle >= 0);
+    group->shrink_busy = busy;
+    group->shrink_idle = idle;
+}
+
+void loop_group_set_drain_timeout(loop_group_t* group, int timeout) {
+    assert(group);
+    assert(timeout >= 0);
+    group->drain_timeout = timeout;
+}
+
+int loop_group_get_count(loop_group_t* group) {
+    assert(group);
+    return group->count;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOOP_GROUP_API_H
+#define LOOP_GROUP_API_H
+
+#include "config.h"
+
+/*
+ * 创建弹性事件循环组
+ * 事件循环组拥有若干个loop_t及其运行线程，由内置的负载均衡器分配管道，
+ * 管理线程按平均繁忙程度（loop_get_busy）增加或回收loop_t
+ * @param min_loop 最少loop_t数量，大于0
+ * @param max_loop 最多loop_t数量，不小于min_loop且不超过64
+ * @return loop_group_t实例
+ */
+loop_group_t* loop_group_create(int min_loop, int max_loop);
+
+/*
+ * 销毁事件循环组，停止管理线程及所有loop_t线程，销毁所有loop_t
+ * 组内loop_t上的进程内管道、共享内存管道需要先关闭两端
+ * @param group loop_group_t实例
+ */
+void loop_group_destroy(loop_group_t* group);
+
+/*
+ * 启动min_loop个loop_t及管理线程
+ * @param group loop_group_t实例
+ * @retval error_ok 成功
+ * @retval error_thread_start_fail 线程启动失败
+ */
+int loop_group_start(loop_group_t* group);
+
+/*
+ * 绑定组外的loop_t（如监听所在的loop_t），在loop_t所在线程调用
+ * 绑定的loop_t接受及发起的连接分配到组内的loop_t，自身不参与分配，也不计入平均繁忙程度.
+ * 事件循环组销毁前需要先销毁绑定的loop_t
+ * @param group loop_group_t实例
+ * @param loop loop_t实例
+ */
+void loop_group_bind(loop_group_t* group, loop_t* loop);
+
+/*
+ * 取得事件循环组的负载均衡器
+ * 负载均衡策略和自动迁移在此负载均衡器上设置，由事件循环组销毁
+ * @param group loop_group_t实例
+ * @return loop_balancer_t实例
+ */
+loop_balancer_t* loop_group_get_balancer(loop_group_t* group);
+
+/*
+ * 设置扩容阈值
+ * 组内loop_t平均繁忙程度超过阈值时增加一个loop_t，每个采样周期最多增加一个
+ * @param group loop_group_t实例
+ * @param busy 繁忙阈值（千分比），默认700
+ */
+void loop_group_set_grow(loop_group_t* group, int busy);
+
+/*
+ * 设置回收阈值
+ * 平均繁忙程度持续idle毫秒低于阈值，且回收后其余loop_t的平均繁忙程度不会超过扩容阈值时，
+ * 回收负载最小的loop_t：先从负载均衡器解除关联，再将管道迁移（channel_ref_migrate）到其他loop_t，
+ * 排空或超时后停止线程并销毁
+ * @param group loop_group_t实例
+ * @param busy 繁忙阈值（千分比），默认200，0不回收
+ * @param idle 持续时间（毫秒），默认10000
+ */
+void loop_group_set_shrink(loop_group_t* group, int busy, int idle);
+
+/*
+ * 设置回收的排空超时
+ * 进程内管道、共享内存管道的对端持有所属loop_t，连接池由所属loop_t驱动，都不能迁移.
+ * 超时后仍有这些管道或连接池时取消回收，loop_t重新关联到负载均衡器继续工作，
+ * 不会强制销毁；需要回收时由应用先关闭管道两端
+ * @param group loop_group_t实例
+ * @param timeout 超时（毫秒），默认30000
+ */
+void loop_group_set_drain_timeout(loop_group_t* group, int timeout);
+
+/*
+ * 取得事件循环组内loop_t数量，不包括回收中的loop_t，可以在任意线程调用
+ * @param group loop_group_t实例
+ * @return loop_t数量
+ */
+int loop_group_get_count(loop_group_t* group);
+
+#endif /* LOOP_GROUP_API_H */
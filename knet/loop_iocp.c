@@ -33,7 +33,7 @@
     #pragma comment(lib,"Ws2_32.lib")
 #endif /* defined(_MSC_VER) */
 
-#define ACCEPTEX_ADDR_SIZE   sizeof(struct sockaddr_in) + 16
+#define ACCEPTEX_ADDR_SIZE   sizeof(struct sockaddr_in6) + 16
 #define ACCEPTEX_BUFFER_SIZE 1024
 #define ACCEPTEX             LPFN_ACCEPTEX
 
@@ -50,16 +50,17 @@ typedef struct _per_io_t {
 } per_io_t;
 
 typedef struct _AcceptEx_t {
-    ACCEPTEX       fn_AcceptEx;                  /* AcceptExָ */
-    socket_t       socket_fd;                    /* ǰδĿͻ׽ - AcceptEx */
-    char           buffer[ACCEPTEX_BUFFER_SIZE]; /*  - AcceptEx */
+    ACCEPTEX       fn_AcceptEx;                  /* AcceptEx函数指针 */
+    int            family;                       /* 监听套接字的协议族 */
+    socket_t       socket_fd;                    /* 当前未决的客户端套接字 - AcceptEx */
+    char           buffer[ACCEPTEX_BUFFER_SIZE]; /* 参数 - AcceptEx */
 } AcceptEx_t;
 
 typedef struct _per_sock_t {  
-    channel_ref_t* channel_ref;                  /* ǰܵ */
-    AcceptEx_t*    AcceptEx_info;                /* AcceptEx_tָ */
-    per_io_t       io_recv;                      /* ǰʵֻ֧ͬһʱֻͶһrecv */
-    per_io_t       io_send;                      /* ǰʵֻ֧ͬһʱֻͶһsend */
+    channel_ref_t* channel_ref;                  /* 当前管道 */
+    AcceptEx_t*    AcceptEx_info;                /* AcceptEx_t指针 */
+    per_io_t       io_recv;                      /* 当前实现只支持同一个时刻只投递一个recv请求 */
+    per_io_t       io_send;                      /* 当前实现只支持同一个时刻只投递一个send请求 */
 } per_sock_t;
 
 typedef struct _loop_iocp_t {
@@ -85,7 +86,7 @@ per_sock_t* socket_data_create() {
 void socket_data_destroy(per_sock_t* data) {
     assert(data);
     if (data->AcceptEx_info) {
-        /* ر׽ */
+        /* 关闭套接字 */
         if (data->AcceptEx_info->socket_fd) {
             socket_close(data->AcceptEx_info->socket_fd);
         }
@@ -95,7 +96,9 @@ void socket_data_destroy(per_sock_t* data) {
 }
 
 AcceptEx_t* socket_data_prepare_accept(per_sock_t* data) {
-    socket_t fd = 0;
+    socket_t         fd  = 0;
+    socket_len_t     len = sizeof(socket_address_t);
+    socket_address_t addr;
     assert(data);
     fd = channel_ref_get_socket_fd(data->channel_ref);
     if (!data->AcceptEx_info) {
@@ -105,9 +108,13 @@ AcceptEx_t* socket_data_prepare_accept(per_sock_t* data) {
     }
     if (!data->AcceptEx_info->fn_AcceptEx) {
         data->AcceptEx_info->fn_AcceptEx = get_fn_AcceptEx(fd);
+        /* 客户端套接字的协议族必须与监听套接字相同 */
+        memset(&addr, 0, sizeof(addr));
+        getsockname(fd, &addr.sa, &len);
+        data->AcceptEx_info->family = (addr.sa.sa_family == AF_INET6) ? AF_INET6 : AF_INET;
     }
-    /* һ֧صI/O׽ */
-    data->AcceptEx_info->socket_fd = WSASocket(AF_INET, SOCK_STREAM, IPPROTO_TCP, 0, 0, WSA_FLAG_OVERLAPPED);
+    /* 建立一个支持重叠I/O的套接字 */
+    data->AcceptEx_info->socket_fd = WSASocket(data->AcceptEx_info->family, SOCK_STREAM, IPPROTO_TCP, 0, 0, WSA_FLAG_OVERLAPPED);
     if (data->AcceptEx_info->socket_fd == INVALID_SOCKET) {
         assert(0);
         return 0;
@@ -154,7 +161,9 @@ int _select(loop_t* loop, time_t ts) {
     per_sock_t*    per_sock    = 0;
     channel_ref_t* channel_ref = 0;
     loop_iocp_t*   impl        = get_impl(loop);
-    error = GetQueuedCompletionStatus(impl->iocp, &bytes, (PULONG_PTR)&per_sock, (LPOVERLAPPED*)&per_io, 1);
+    /* 有就绪管道时不等待 */
+    error = GetQueuedCompletionStatus(impl->iocp, &bytes, (PULONG_PTR)&per_sock, (LPOVERLAPPED*)&per_io,
+        loop_get_ready_count(loop) ? 0 : 1);
     if (error == FALSE) {
         last_error = GetLastError();
         if ((last_error == WAIT_TIMEOUT) || (last_error == ERROR_NETNAME_DELETED) || (last_error == ERROR_OPERATION_ABORTED)) {
@@ -182,6 +191,7 @@ int impl_run_once(loop_t* loop) {
     if (error != error_ok) {
         return error;
     }
+    loop_check_ready(loop, ts);
     loop_check_timeout(loop, ts);
     loop_check_close(loop);
     return error_ok;
@@ -212,7 +222,7 @@ ACCEPTEX get_fn_AcceptEx(socket_t fd) {
     DWORD    bytes         = 0;
     ACCEPTEX fn_AcceptEx   = 0;
     GUID     guid_AcceptEx = WSAID_ACCEPTEX;
-    /* ȡAcceptExָ */
+    /* 获取AcceptEx指针 */
     error = WSAIoctl(fd, SIO_GET_EXTENSION_FUNCTION_POINTER, &guid_AcceptEx, sizeof(guid_AcceptEx),
                 &fn_AcceptEx, sizeof(ACCEPTEX), &bytes, NULL, NULL);
     if (error) {
@@ -236,7 +246,7 @@ void on_iocp_recv(channel_ref_t* channel_ref) {
     if (channel_ref_check_state(channel_ref, channel_state_accept)) {
         per_io->type = io_type_accept;
         AcceptEx_ptr = socket_data_prepare_accept(per_sock);
-        /* Ͷһaccept */
+        /* 投递一个accept请求 */
         result = AcceptEx_ptr->fn_AcceptEx(fd, AcceptEx_ptr->socket_fd, AcceptEx_ptr->buffer,
                     0, ACCEPTEX_ADDR_SIZE, ACCEPTEX_ADDR_SIZE, 0, &per_io->ov);
         if (result == FALSE) {
@@ -248,7 +258,7 @@ void on_iocp_recv(channel_ref_t* channel_ref) {
         }
     } else {
         per_io->type = io_type_recv;
-        /* Ͷһ0recv */
+        /* 投递一个0长度recv请求 */
         result = WSARecv(fd, &sbuf, 1, &bytes, &flags, &per_io->ov, 0);
         if (result != 0) {
             error = GetLastError();
@@ -272,13 +282,13 @@ void on_iocp_send(channel_ref_t* channel_ref) {
     int            flag     = channel_ref_get_flag(channel_ref);
     per_sock_t*    per_sock = (per_sock_t*)channel_ref_get_data(channel_ref);
     per_io_t*      per_io   = &per_sock->io_send;
-    /* Ͷ¼ */
+    /* 设置投递事件类型 */
     if (channel_ref_check_state(channel_ref, channel_state_connect)) {
         per_io->type = io_type_connect;
     } else {
         per_io->type = io_type_send;
     }
-    /* Ͷһ0send */
+    /* 投递一个0长度send请求 */
     result = WSASend(fd, &sbuf, 1, &bytes, flags, &per_io->ov, 0);
     if (result != 0) {
         error = GetLastError();
@@ -287,7 +297,7 @@ void on_iocp_send(channel_ref_t* channel_ref) {
         }
         return;
     }
-    /* Ͷݱ־ */
+    /* 设置投递标志 */
     flag |= io_type_send;
     channel_ref_set_flag(channel_ref, flag);
 }
@@ -297,7 +307,7 @@ int impl_event_add(channel_ref_t* channel_ref, channel_event_e e) {
     if (channel_ref_check_state(channel_ref, channel_state_close)) {
         return error_already_close;
     }
-    /* Ͷ¼ */
+    /* 投递事件 */
     if (channel_event_recv & e) {
         on_iocp_recv(channel_ref);
     } else if (e & channel_event_send) {
@@ -333,7 +343,7 @@ int impl_add_channel_ref(loop_t* loop, channel_ref_t* channel_ref) {
     per_sock  = socket_data_create();
     assert(per_sock);
     per_sock->channel_ref  = channel_ref;
-    /* IOCP */
+    /* 与IOCP关联 */
     iocp = CreateIoCompletionPort((HANDLE)socket_fd, impl->iocp, (ULONG_PTR)per_sock, 0);
     if (!iocp) {
         socket_data_destroy(per_sock);
@@ -344,7 +354,7 @@ int impl_add_channel_ref(loop_t* loop, channel_ref_t* channel_ref) {
 }
 
 int impl_remove_channel_ref(loop_t* loop, channel_ref_t* channel_ref) {
-    /* ⲿر׽ֺIOCPchannel_ret_tٺloop_t˳ʱô˺ */
+    /* 外部关闭套接字后，IOCP解除关联，channel_ret_t销毁和loop_t退出的时候调用此函数 */
     per_sock_t* per_sock = 0;
     loop;
     assert(channel_ref);
@@ -29,8 +29,8 @@
 #include "channel_ref.h"
 
 typedef struct _loop_select_t {
-    fd_set read_fds[FD_SETSIZE]; /* select */
-    fd_set send_fds[FD_SETSIZE]; /* selectд */
+    fd_set read_fds[FD_SETSIZE]; /* select读描述符数组 */
+    fd_set send_fds[FD_SETSIZE]; /* select写描述符数组 */
 } loop_select_t;
 
 int impl_create(loop_t* loop) {
@@ -59,8 +59,12 @@ int _select(loop_t* loop) {
     dlist_node_t* node = 0;
     dlist_node_t* temp = 0;
     channel_ref_t* channel_ref = 0;
-    struct timeval tv = {0, 100}; /* תʱȴ1ms */
+    struct timeval tv = {0, 100}; /* 空转时最多等待1ms */
     loop_select_t* impl = (loop_select_t*)loop_get_impl(loop);
+    if (loop_get_ready_count(loop)) {
+        /* 有就绪管道时不等待 */
+        tv.tv_usec = 0;
+    }
     FD_ZERO(impl->read_fds);
     FD_ZERO(impl->send_fds);
     dlist_for_each_safe(loop_get_active_list(loop), node, temp) {
@@ -68,6 +72,10 @@ int _select(loop_t* loop) {
         fd = channel_ref_get_socket_fd(channel_ref);
         if (channel_ref_check_balance(channel_ref)) {
         }
+        if (channel_ref_check_inproc(channel_ref)) {
+            /* 进程内管道没有套接字 */
+            continue;
+        }
         if (channel_ref_check_event(channel_ref, channel_event_recv)) {
             FD_SET(fd, impl->read_fds);
             max_fd = max(max_fd, fd);
@@ -105,6 +113,7 @@ int impl_run_once(loop_t* loop) {
             channel_ref_update(channel_ref, channel_event_send, ts);
         }
     }
+    loop_check_ready(loop, ts);
     loop_check_timeout(loop, ts);
     loop_check_close(loop);
     return error_ok;
@@ -27,6 +27,11 @@
 #include "channel_ref.h"
 #include "address.h"
 
+#if !defined(WIN32) && !defined(WIN64)
+#include <stddef.h>
+#include <sys/stat.h>
+#endif /* !defined(WIN32) && !defined(WIN64) */
+
 socket_t socket_create() {
     socket_t socket_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
 #if WIN32
@@ -41,27 +46,227 @@ socket_t socket_create() {
     return socket_fd;
 }
 
-int socket_connect(socket_t socket_fd, const char* ip, int port) {
+socket_t socket_create_udp() {
+    socket_t socket_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#if WIN32
+    if (socket_fd == INVALID_SOCKET) {
+        return 0;
+    }
+#else
+    if (socket_fd < 0) {
+        return 0;
+    }
+#endif /* (WIN32 || WIN64) */
+    return socket_fd;
+}
+
+int socket_check_unix_path(const char* ip) {
+    /* 以'/'开头为文件路径，以'@'开头为抽象命名空间 */
+    return (ip && ((ip[0] == '/') || (ip[0] == '@')));
+}
+
+socket_t socket_create_udp_ipv6() {
+    socket_t socket_fd = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+#if WIN32
+    if (socket_fd == INVALID_SOCKET) {
+        return 0;
+    }
+#else
+    if (socket_fd < 0) {
+        return 0;
+    }
+#endif /* (WIN32 || WIN64) */
+    return socket_fd;
+}
+
+socket_t socket_create_unix() {
 #if defined(WIN32) || defined(WIN64)
-    DWORD last_error = 0;
+    return 0;
+#else
+    socket_t socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_fd < 0) {
+        return 0;
+    }
+    return socket_fd;
 #endif /* defined(WIN32) || defined(WIN64) */
-    int error = 0;
-    struct sockaddr_in sa;
-    memset(&sa, 0, sizeof(sa));
-    sa.sin_family = AF_INET;
-    sa.sin_port   = htons((unsigned short)port);
+}
+
+socket_t socket_create_ipv6() {
+    socket_t socket_fd = socket(AF_INET6, SOCK_STREAM, IPPROTO_TCP);
+#if WIN32
+    if (socket_fd == INVALID_SOCKET) {
+        return 0;
+    }
+#else
+    if (socket_fd < 0) {
+        return 0;
+    }
+#endif /* (WIN32 || WIN64) */
+    return socket_fd;
+}
+
+#if !defined(WIN32) && !defined(WIN64)
+/*
+ * 填写UNIX域套接字地址
+ * @return 地址长度，路径过长返回0
+ */
+static socket_len_t socket_make_unix_address(const char* path, struct sockaddr_un* sa) {
+    size_t size = strlen(path);
+    memset(sa, 0, sizeof(struct sockaddr_un));
+    sa->sun_family = AF_UNIX;
+    if (size >= sizeof(sa->sun_path)) {
+        return 0;
+    }
+    memcpy(sa->sun_path, path, size);
+    if (path[0] == '@') {
+        /* 抽象命名空间，首字节为0，长度不包括结尾的0 */
+        sa->sun_path[0] = 0;
+        return (socket_len_t)(offsetof(struct sockaddr_un, sun_path) + size);
+    }
+    return (socket_len_t)(offsetof(struct sockaddr_un, sun_path) + size + 1);
+}
+#endif /* !defined(WIN32) && !defined(WIN64) */
+
+int socket_connect_unix(socket_t socket_fd, const char* path) {
 #if defined(WIN32) || defined(WIN64)
-    sa.sin_addr.S_un.S_addr = INADDR_ANY;
-    if (ip) {
-        sa.sin_addr.S_un.S_addr = inet_addr(ip);
+    return error_connect_fail;
+#else
+    struct sockaddr_un sa;
+    socket_len_t       len = socket_make_unix_address(path, &sa);
+    if (!len) {
+        return error_connect_fail;
+    }
+    /* 监听队列已满时返回EAGAIN，不会稍后完成 */
+    if (connect(socket_fd, (struct sockaddr*)&sa, len) < 0) {
+        if ((errno != EINPROGRESS) && (errno != EINTR) && (errno != EISCONN)) {
+            return error_connect_fail;
+        }
+    }
+    return error_ok;
+#endif /* defined(WIN32) || defined(WIN64) */
+}
+
+int socket_bind_and_listen_unix(socket_t socket_fd, const char* path, int backlog) {
+#if defined(WIN32) || defined(WIN64)
+    return error_bind_fail;
+#else
+    struct sockaddr_un sa;
+    struct stat        st;
+    socket_len_t       len = socket_make_unix_address(path, &sa);
+    if (!len) {
+        return error_bind_fail;
+    }
+    if ((path[0] == '/') && !stat(path, &st) && S_ISSOCK(st.st_mode)) {
+        /* 删除上次运行遗留的套接字文件 */
+        unlink(path);
+    }
+    if (bind(socket_fd, (struct sockaddr*)&sa, len) < 0) {
+        return error_bind_fail;
+    }
+    if (listen(socket_fd, backlog) < 0) {
+        return error_listen_fail;
+    }
+    return error_ok;
+#endif /* defined(WIN32) || defined(WIN64) */
+}
+
+socket_len_t socket_make_address(const char* ip, int port, socket_address_t* addr) {
+#if defined(WIN32) || defined(WIN64)
+    int len = sizeof(socket_address_t);
+#endif /* defined(WIN32) || defined(WIN64) */
+    memset(addr, 0, sizeof(socket_address_t));
+    if (ip && strchr(ip, ':')) {
+        /* 含有':'的为IPv6地址 */
+    #if defined(WIN32) || defined(WIN64)
+        if (WSAStringToAddressA((char*)ip, AF_INET6, 0, &addr->sa, &len)) {
+            return 0;
+        }
+    #else
+        if (inet_pton(AF_INET6, ip, &addr->sin6.sin6_addr) != 1) {
+            return 0;
+        }
+    #endif /* defined(WIN32) || defined(WIN64) */
+        addr->sin6.sin6_family = AF_INET6;
+        addr->sin6.sin6_port   = htons((unsigned short)port);
+        return sizeof(struct sockaddr_in6);
+    }
+    addr->sin.sin_family = AF_INET;
+    addr->sin.sin_port   = htons((unsigned short)port);
+    if (!ip) {
+        addr->sin.sin_addr.s_addr = INADDR_ANY;
+        return sizeof(struct sockaddr_in);
+    }
+#if defined(WIN32) || defined(WIN64)
+    addr->sin.sin_addr.s_addr = inet_addr(ip);
+    if ((addr->sin.sin_addr.s_addr == INADDR_NONE) && strcmp(ip, "255.255.255.255")) {
+        return 0;
     }
 #else
-    sa.sin_addr.s_addr = INADDR_ANY;
-    if (ip) {
-        sa.sin_addr.s_addr = inet_addr(ip);
+    if (inet_pton(AF_INET, ip, &addr->sin.sin_addr) != 1) {
+        return 0;
     }
 #endif /* defined(WIN32) || defined(WIN64) */
-    error = connect(socket_fd, (struct sockaddr*)&sa, sizeof(struct sockaddr));
+    return sizeof(struct sockaddr_in);
+}
+
+int socket_address_to_string(const socket_address_t* addr, socket_len_t len, char* ip, int size) {
+    const void* src = 0;
+    ip[0] = 0;
+    switch (addr->sa.sa_family) {
+    case AF_INET:
+        src = &addr->sin.sin_addr;
+        break;
+    case AF_INET6:
+        if (IN6_IS_ADDR_V4MAPPED(&addr->sin6.sin6_addr)) {
+            /* 双栈监听器接受的IPv4连接，还原为点分十进制 */
+            src = addr->sin6.sin6_addr.s6_addr + 12;
+            break;
+        }
+    #if defined(WIN32) || defined(WIN64)
+        return getnameinfo(&addr->sa, len, ip, size, 0, 0, NI_NUMERICHOST);
+    #else
+        return (inet_ntop(AF_INET6, &addr->sin6.sin6_addr, ip, size) ? 0 : 1);
+    #endif /* defined(WIN32) || defined(WIN64) */
+#if !defined(WIN32) && !defined(WIN64)
+    case AF_UNIX:
+        /* UNIX域套接字的IP为路径（抽象命名空间以'@'开头） */
+        if (len > (socket_len_t)offsetof(struct sockaddr_un, sun_path)) {
+            len -= (socket_len_t)offsetof(struct sockaddr_un, sun_path);
+            len = min(len, (socket_len_t)(size - 1));
+            memcpy(ip, addr->sun.sun_path, len);
+            ip[len] = 0;
+            if (!ip[0] && (len > 1)) {
+                ip[0] = '@';
+            }
+        }
+        return 0;
+#endif /* !defined(WIN32) && !defined(WIN64) */
+    default:
+        return 1;
+    }
+#if defined(WIN32) || defined(WIN64)
+    strncpy(ip, inet_ntoa(*(struct in_addr*)src), size - 1);
+    ip[size - 1] = 0;
+    return 0;
+#else
+    return (inet_ntop(AF_INET, src, ip, size) ? 0 : 1);
+#endif /* defined(WIN32) || defined(WIN64) */
+}
+
+int socket_connect(socket_t socket_fd, const char* ip, int port) {
+    socket_address_t addr;
+    socket_len_t     len = socket_make_address(ip, port, &addr);
+    if (!len) {
+        return error_connect_fail;
+    }
+    return socket_connect_addr(socket_fd, &addr.sa, len);
+}
+
+int socket_connect_addr(socket_t socket_fd, const struct sockaddr* addr, socket_len_t len) {
+#if defined(WIN32) || defined(WIN64)
+    DWORD last_error = 0;
+#endif /* defined(WIN32) || defined(WIN64) */
+    int error = connect(socket_fd, addr, len);
 #if defined(WIN32) || defined(WIN64)
     if (error < 0) {
         last_error = GetLastError();
@@ -80,29 +285,23 @@ int socket_connect(socket_t socket_fd, const char* ip, int port) {
 }
 
 int socket_bind_and_listen(socket_t socket_fd, const char* ip, int port, int backlog) {
-    int error = 0;
-    struct sockaddr_in sa;
-    memset(&sa, 0, sizeof(sa));
-    sa.sin_family = AF_INET;
-    sa.sin_port   = htons((unsigned short)port);
-#if defined(WIN32) || defined(WIN64)
-    sa.sin_addr.S_un.S_addr = INADDR_ANY;
-    if (ip) {
-        sa.sin_addr.S_un.S_addr = inet_addr(ip);
+    int              error = 0;
+    socket_address_t addr;
+    socket_len_t     len   = socket_make_address(ip, port, &addr);
+    if (!len) {
+        return error_bind_fail;
     }
-#else
-    sa.sin_addr.s_addr = INADDR_ANY;
-    if (ip) {
-        sa.sin_addr.s_addr = inet_addr(ip);
+    if (addr.sa.sa_family == AF_INET6) {
+        /* 监听"::"时同时接受IPv4连接 */
+        socket_set_ipv6_only_off(socket_fd);
     }
-#endif /* defined(WIN32) || defined(WIN64) */
     socket_set_reuse_addr_on(socket_fd);
     socket_set_linger_off(socket_fd);
-    error = bind(socket_fd, (struct sockaddr*)&sa, sizeof(struct sockaddr));
+    error = bind(socket_fd, &addr.sa, len);
     if (error < 0) {
         return error_bind_fail;
     }
-    /*  */
+    /* 监听 */
     error = listen(socket_fd, backlog);
     if (error < 0) {
         return error_listen_fail;
@@ -110,16 +309,39 @@ int socket_bind_and_listen(socket_t socket_fd, const char* ip, int port, int bac
     return error_ok;
 }
 
-socket_t socket_accept(socket_t socket_fd) {
-    socket_t     client_fd = 0; /* ͻ׽ */
-    socket_len_t addr_len  = sizeof(struct sockaddr_in);
-    struct sockaddr_in sa;
-    memset(&sa, 0, sizeof(sa));
-    /* ܿͻ */
-    client_fd = accept(socket_fd, (struct sockaddr*)&sa, &addr_len);
+int socket_bind(socket_t socket_fd, const char* ip, int port) {
+    socket_address_t addr;
+    socket_len_t     len = socket_make_address(ip, port, &addr);
+    if (!len) {
+        return error_bind_fail;
+    }
+    if (addr.sa.sa_family == AF_INET6) {
+        /* 绑定"::"时同时接收IPv4数据报 */
+        socket_set_ipv6_only_off(socket_fd);
+    }
+    socket_set_reuse_addr_on(socket_fd);
+    if (bind(socket_fd, &addr.sa, len) < 0) {
+        return error_bind_fail;
+    }
+    return error_ok;
+}
+
+socket_t socket_accept(socket_t socket_fd, socket_address_t* addr, socket_len_t* len) {
+    socket_t client_fd = 0; /* 客户端套接字 */
+    *len = sizeof(socket_address_t);
+    /* 接受客户端，同时取得对端地址，之后不再需要getpeername */
+    client_fd = accept(socket_fd, &addr->sa, len);
+#if defined(WIN32) || defined(WIN64)
+    if (client_fd == INVALID_SOCKET) {
+        *len = 0;
+        return 0;
+    }
+#else
     if (client_fd < 0) {
+        *len = 0;
         return 0;
     }
+#endif /* defined(WIN32) || defined(WIN64) */
     return client_fd;
 }
 
@@ -175,6 +397,28 @@ int socket_set_keepalive_off(socket_t socket_fd) {
     return setsockopt(socket_fd, SOL_SOCKET, SO_KEEPALIVE, (char*)&keepalive, sizeof(keepalive));
 }
 
+int socket_set_ipv6_only_off(socket_t socket_fd) {
+    int v6only = 0;
+    return setsockopt(socket_fd, IPPROTO_IPV6, IPV6_V6ONLY, (char*)&v6only, sizeof(v6only));
+}
+
+int socket_set_fastopen_on(socket_t socket_fd, int qlen) {
+#if defined(TCP_FASTOPEN)
+    return setsockopt(socket_fd, IPPROTO_TCP, TCP_FASTOPEN, (char*)&qlen, sizeof(qlen));
+#else
+    return -1;
+#endif /* defined(TCP_FASTOPEN) */
+}
+
+int socket_set_fastopen_connect_on(socket_t socket_fd) {
+#if defined(TCP_FASTOPEN_CONNECT)
+    int fastopen = 1;
+    return setsockopt(socket_fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, (char*)&fastopen, sizeof(fastopen));
+#else
+    return -1;
+#endif /* defined(TCP_FASTOPEN_CONNECT) */
+}
+
 int socket_set_donot_route_on(socket_t socket_fd) {
     int donot_route = 1;
     return setsockopt(socket_fd, SOL_SOCKET, SO_DONTROUTE, (char*)&donot_route, sizeof(donot_route));
@@ -201,6 +445,15 @@ int socket_check_send_ready(socket_t socket_fd) {
     return FD_ISSET(socket_fd, send_fds);
 }
 
+int socket_get_error(socket_t socket_fd) {
+    int          error = 0;
+    socket_len_t len   = sizeof(error);
+    if (getsockopt(socket_fd, SOL_SOCKET, SO_ERROR, (char*)&error, &len) < 0) {
+        return 1;
+    }
+    return error;
+}
+
 int socket_send(socket_t socket_fd, const char* data, uint32_t size) {
     int send_bytes = 0;
 #if defined(WIN32) || defined(WIN64)
@@ -218,7 +471,59 @@ int socket_send(socket_t socket_fd, const char* data, uint32_t size) {
             send_bytes = -1;
         }
     #else
-        if ((errno == 0) || (errno == EAGAIN ) || (errno == EWOULDBLOCK) || (errno == EINTR)) {
+        if ((errno == 0) || (errno == EAGAIN ) || (errno == EWOULDBLOCK) || (errno == EINTR) || (errno == EINPROGRESS)) {
+            return 0;
+        } else {
+            send_bytes = -1;
+        }
+    #endif /* defined(WIN32) || defined(WIN64) */
+    } else if (send_bytes == 0) {
+        return -1;
+    }
+    return send_bytes;
+}
+
+int socket_send_segments(socket_t socket_fd, const char* ptr[], uint32_t size[], int count) {
+    int i          = 0;
+    int send_bytes = 0;
+#if defined(WIN32) || defined(WIN64)
+    DWORD  error = 0;
+    DWORD  bytes = 0;
+    WSABUF buffers[SOCKET_MAX_SEGMENTS];
+    count = min(count, SOCKET_MAX_SEGMENTS);
+    for (; i < count; i++) {
+        buffers[i].buf = (char*)ptr[i];
+        buffers[i].len = size[i];
+    }
+    if (SOCKET_ERROR == WSASend(socket_fd, buffers, count, &bytes, 0, 0, 0)) {
+        send_bytes = -1;
+    } else {
+        send_bytes = (int)bytes;
+    }
+#else
+    struct msghdr msg;
+    struct iovec  iov[SOCKET_MAX_SEGMENTS];
+    count = min(count, SOCKET_MAX_SEGMENTS);
+    for (; i < count; i++) {
+        iov[i].iov_base = (void*)ptr[i];
+        iov[i].iov_len  = size[i];
+    }
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = count;
+    /* 使用sendmsg代替writev以避免SIGPIPE */
+    send_bytes = sendmsg(socket_fd, &msg, MSG_NOSIGNAL);
+#endif /* defined(WIN32) || defined(WIN64) */
+    if (send_bytes < 0) {
+    #if defined(WIN32) || defined(WIN64)
+        error = GetLastError();
+        if ((error == 0) || (error == WSAEINTR) || (error == WSAEINPROGRESS) || (error == WSAEWOULDBLOCK)) {
+            return 0;
+        } else {
+            send_bytes = -1;
+        }
+    #else
+        if ((errno == 0) || (errno == EAGAIN ) || (errno == EWOULDBLOCK) || (errno == EINTR) || (errno == EINPROGRESS)) {
             return 0;
         } else {
             send_bytes = -1;
@@ -259,6 +564,54 @@ int socket_recv(socket_t socket_fd, char* data, uint32_t size) {
     return recv_bytes;
 }
 
+int socket_recv_segments(socket_t socket_fd, char* ptr[], uint32_t size[], int count) {
+    int i          = 0;
+    int recv_bytes = 0;
+#if defined(WIN32) || defined(WIN64)
+    DWORD  error = 0;
+    DWORD  bytes = 0;
+    DWORD  flags = 0;
+    WSABUF buffers[2];
+    assert(count <= 2);
+    for (; i < count; i++) {
+        buffers[i].buf = ptr[i];
+        buffers[i].len = size[i];
+    }
+    if (SOCKET_ERROR == WSARecv(socket_fd, buffers, count, &bytes, &flags, 0, 0)) {
+        recv_bytes = -1;
+    } else {
+        recv_bytes = (int)bytes;
+    }
+#else
+    struct iovec iov[2];
+    assert(count <= 2);
+    for (; i < count; i++) {
+        iov[i].iov_base = ptr[i];
+        iov[i].iov_len  = size[i];
+    }
+    recv_bytes = readv(socket_fd, iov, count);
+#endif /* defined(WIN32) || defined(WIN64) */
+    if (recv_bytes < 0) {
+    #if defined(WIN32) || defined(WIN64)
+        error = GetLastError();
+        if ((error == 0) || (error == WSAEINTR) || (error == WSAEINPROGRESS) || (error == WSAEWOULDBLOCK)) {
+            return 0;
+        } else {
+            recv_bytes = -1;
+        }
+    #else
+        if ((errno == 0) || (errno == EAGAIN ) || (errno == EWOULDBLOCK) || (errno == EINTR)) {
+            return 0;
+        } else {
+            recv_bytes = -1;
+        }
+    #endif /* defined(WIN32) || defined(WIN64) */
+    } else if (recv_bytes == 0) {
+        recv_bytes = -1;
+    }
+    return recv_bytes;
+}
+
 #if defined(WIN32) || defined(WIN64)
 u_short _get_random_port(int begin, int gap) {
     srand((int)time(0));
@@ -288,40 +641,40 @@ int socket_pair(socket_t pair[2]) {
     accept_addr.sin_port = htons(port);
     accept_addr.sin_family = AF_INET;
     accept_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    /* ˿ */
+    /* 绑定随机端口 */
     error = bind(accept_sock, (struct sockaddr*)&accept_addr,sizeof(accept_addr));
     while (error) {
         if (WSAEADDRINUSE != GetLastError()) {
             goto error_return;
         }
-        /* һ˿ */
+        /* 随机分配一个端口 */
         port = _get_random_port(port_begin, port_gap);
         memset(&accept_addr, 0, sizeof(accept_addr));
         accept_addr.sin_port = htons(port);
         accept_addr.sin_family = AF_INET;
         accept_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-        /* ° */
+        /* 重新绑定 */
         error = bind(accept_sock, (struct sockaddr*)&accept_addr,sizeof(accept_addr));
     }
-    /*  */
+    /* 监听 */
     error = listen(accept_sock, 1);
     if (error) {
         goto error_return;
     }
-    /* ȡַ */
+    /* 获取地址 */
     error = getsockname(accept_sock, (struct sockaddr*)&connect_addr, &addr_len);
     if (error) {
         goto error_return;
     }
-    /* ͻ׽ */
+    /* 建立客户端套接字 */
     pair[0] = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (pair[0] == INVALID_SOCKET) {
         goto error_return;
     }
-    /* ÷ */
+    /* 设置非阻塞 */
     ioctlsocket(pair[0], FIONBIO, (u_long*)&flag);
     connect_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-    /*  */
+    /* 建立连接 */
     error = connect(pair[0], (struct sockaddr*)&connect_addr, sizeof(connect_addr));
     if(error < 0) {
         error = WSAGetLastError();
@@ -329,7 +682,7 @@ int socket_pair(socket_t pair[2]) {
             goto error_return;
         }
     }
-    /*  */
+    /* 接受连接 */
     pair[1] = accept(accept_sock, (struct sockaddr*)&accept_addr, &addr_len);
     if(pair[1] == INVALID_SOCKET) {
         goto error_return;
@@ -358,48 +711,24 @@ error_return:
 }
 
 int socket_getpeername(channel_ref_t* channel_ref, address_t* address) {
-#if defined(WIN32) || defined(WIN64)
-    char* ip;
-#else
-    char ip[32] = {0};
-#endif /* defined(WIN32) || define(WIN64) */
-    int port;
-    struct sockaddr_in addr;
-    socket_len_t len = sizeof(struct sockaddr);
-    int retval = getpeername(channel_ref_get_socket_fd(channel_ref), (struct sockaddr*)&addr, &len);
-    if (retval < 0) {
+    socket_address_t addr;
+    socket_len_t     len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    if (getpeername(channel_ref_get_socket_fd(channel_ref), &addr.sa, &len) < 0) {
         return error_getpeername;
     }
-#if defined(WIN32) || defined(WIN64)
-    ip = inet_ntoa(addr.sin_addr);
-#else
-    inet_ntop(AF_INET, &addr.sin_addr.s_addr, ip, sizeof(ip));
-#endif /* defined(WIN32) || define(WIN64) */
-    port = ntohs(addr.sin_port);
-    address_set(address, ip, port);
+    address_set_sockaddr(address, &addr.sa, len);
     return error_ok;
 }
 
-int socket_getsockname(channel_ref_t* channel_ref,address_t* address) {
-#if defined(WIN32) || defined(WIN64)
-    char* ip;
-#else
-    char ip[32] = {0};
-#endif /* defined(WIN32) || define(WIN64) */
-    int port;
-    struct sockaddr_in addr;
-    socket_len_t len = sizeof(struct sockaddr);
-    int retval = getsockname(channel_ref_get_socket_fd(channel_ref), (struct sockaddr*)&addr, &len);
-    if (retval < 0) {
-        return error_getpeername;
+int socket_getsockname(channel_ref_t* channel_ref, address_t* address) {
+    socket_address_t addr;
+    socket_len_t     len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    if (getsockname(channel_ref_get_socket_fd(channel_ref), &addr.sa, &len) < 0) {
+        return error_getsockname;
     }
-#if defined(WIN32) || defined(WIN64)
-    ip = inet_ntoa(addr.sin_addr);
-#else
-    inet_ntop(AF_INET, &addr.sin_addr.s_addr, ip, sizeof(ip));
-#endif /* defined(WIN32) || define(WIN64) */
-    port = ntohs(addr.sin_port);
-    address_set(address, ip, port);
+    address_set_sockaddr(address, &addr.sa, len);
     return error_ok;
 }
 
@@ -499,7 +828,7 @@ void _thread_func(void* params) {
     thread_runner_t* runner = 0;
     assert(params);
     runner = (thread_runner_t*)params;
-    runner->func(runner->params);
+    runner->func(runner);
 }
 
 void _thread_loop_func(void* params) {
@@ -650,6 +979,29 @@ void thread_sleep_ms(int ms) {
 #endif /* (WIN32 || WIN64) */
 }
 
+uint64_t thread_get_cpu_microseconds() {
+#if defined(WIN32) || defined(WIN64)
+    FILETIME create_time;
+    FILETIME exit_time;
+    FILETIME kernel_time;
+    FILETIME user_time;
+    uint64_t cpu = 0;
+    if (!GetThreadTimes(GetCurrentThread(), &create_time, &exit_time, &kernel_time, &user_time)) {
+        return 0;
+    }
+    cpu  = ((uint64_t)kernel_time.dwHighDateTime << 32) | kernel_time.dwLowDateTime;
+    cpu += ((uint64_t)user_time.dwHighDateTime << 32) | user_time.dwLowDateTime;
+    /* 单位为100纳秒 */
+    return cpu / 10;
+#else
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)) {
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000 * 1000 + ts.tv_nsec / 1000;
+#endif /* defined(WIN32) || defined(WIN64) */
+}
+
 uint32_t time_get_milliseconds() {
 #if defined(WIN32) || defined(WIN64)
     return GetTickCount();
@@ -27,25 +27,58 @@
 
 #include "config.h"
 
+#if !defined(WIN32) && !defined(WIN64)
+#include <sys/un.h>
+#endif /* !defined(WIN32) && !defined(WIN64) */
+
+#define SOCKET_MAX_SEGMENTS 64 /* socket_send_segments一次最多发送的区域数量 */
+
+typedef union _socket_address_t {
+    struct sockaddr         sa;   /* 通用 */
+    struct sockaddr_in      sin;  /* IPv4 */
+    struct sockaddr_in6     sin6; /* IPv6 */
+    struct sockaddr_storage ss;   /* 保证容纳所有协议族 */
+#if !defined(WIN32) && !defined(WIN64)
+    struct sockaddr_un      sun;  /* UNIX域 */
+#endif /* !defined(WIN32) && !defined(WIN64) */
+} socket_address_t;
+
 socket_t socket_create();
+socket_t socket_create_udp();
+socket_t socket_create_udp_ipv6();
+socket_t socket_create_unix();
+socket_t socket_create_ipv6();
+int socket_check_unix_path(const char* ip);
+int socket_connect_unix(socket_t socket_fd, const char* path);
+int socket_bind_and_listen_unix(socket_t socket_fd, const char* path, int backlog);
+socket_len_t socket_make_address(const char* ip, int port, socket_address_t* addr);
+int socket_address_to_string(const socket_address_t* addr, socket_len_t len, char* ip, int size);
 int socket_connect(socket_t socket_fd, const char* ip, int port);
+int socket_connect_addr(socket_t socket_fd, const struct sockaddr* addr, socket_len_t len);
 int socket_bind_and_listen(socket_t socket_fd, const char* ip, int port, int backlog);
-socket_t socket_accept(socket_t socket_fd);
+int socket_bind(socket_t socket_fd, const char* ip, int port);
+socket_t socket_accept(socket_t socket_fd, socket_address_t* addr, socket_len_t* len);
 int socket_close(socket_t socket_fd);
 int socket_set_reuse_addr_on(socket_t socket_fd);
 int socket_set_non_blocking_on(socket_t socket_fd);
 int socket_set_nagle_off(socket_t socket_fd);
 int socket_set_linger_off(socket_t socket_fd);
 int socket_set_keepalive_off(socket_t socket_fd);
+int socket_set_ipv6_only_off(socket_t socket_fd);
+int socket_set_fastopen_on(socket_t socket_fd, int qlen);
+int socket_set_fastopen_connect_on(socket_t socket_fd);
 int socket_set_donot_route_on(socket_t socket_fd);
 int socket_set_recv_buffer_size(socket_t socket_fd, int size);
 int socket_set_send_buffer_size(socket_t socket_fd, int size);
 int socket_send(socket_t socket_fd, const char* data, uint32_t size);
+int socket_send_segments(socket_t socket_fd, const char* ptr[], uint32_t size[], int count);
 int socket_recv(socket_t socket_fd, char* data, uint32_t size);
+int socket_recv_segments(socket_t socket_fd, char* ptr[], uint32_t size[], int count);
 int socket_pair(socket_t pair[2]);
 int socket_getpeername(channel_ref_t* channel_ref, address_t* address);
 int socket_getsockname(channel_ref_t* channel_ref, address_t* address);
 int socket_check_send_ready(socket_t socket_fd);
+int socket_get_error(socket_t socket_fd);
 
 atomic_counter_t atomic_counter_inc(atomic_counter_t* counter);
 atomic_counter_t atomic_counter_dec(atomic_counter_t* counter);
@@ -74,6 +107,7 @@ int thread_runner_check_start(thread_runner_t* runner);
 void* thread_runner_get_params(thread_runner_t* runner);
 thread_id_t thread_get_self_id();
 void thread_sleep_ms(int ms);
+uint64_t thread_get_cpu_microseconds();
 
 uint32_t time_get_milliseconds();
 uint64_t time_get_microseconds();
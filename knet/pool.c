@@ -0,0 +1,464 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pool.h"
+#include "channel_ref.h"
+#include "loop.h"
+#include "list.h"
+#include "stream.h"
+#include "misc.h"
+
+typedef enum _pool_conn_state_e {
+    pool_conn_state_connect = 1, /* 正在连接 */
+    pool_conn_state_idle,        /* 空闲 */
+    pool_conn_state_lease,       /* 已借出 */
+} pool_conn_state_e;
+
+typedef struct _pool_wait_t {
+    pool_lease_cb_t cb;   /* 借用回调 */
+    void*           data; /* 回调用户数据 */
+} pool_wait_t;
+
+typedef struct _pool_dest_t {
+    pool_t*  pool;       /* 所属连接池 */
+    char     ip[128];    /* IP */
+    int      port;       /* 端口 */
+    dlist_t* idle_list;  /* 空闲连接链表，最近归还的在首部 */
+    dlist_t* busy_list;  /* 正在连接及已借出的连接链表 */
+    dlist_t* wait_list;  /* 等待中的借用请求链表 */
+    int      connecting; /* 正在连接的数量 */
+} pool_dest_t;
+
+struct _pool_conn_t {
+    pool_dest_t*      dest;        /* 目的地址 */
+    channel_ref_t*    channel_ref; /* 连接 */
+    dlist_node_t*     node;        /* 空闲链表或忙碌链表节点 */
+    pool_conn_state_e state;       /* 状态 */
+    time_t            idle_ts;     /* 放入空闲链表的时间戳（秒） */
+};
+
+struct _pool_t {
+    loop_t*       loop;              /* 所属loop_t */
+    dlist_node_t* loop_node;         /* loop_t连接池链表节点 */
+    dlist_t*      dest_list;         /* 目的地址链表 */
+    uint32_t      max_send_list_len; /* 连接的发送链表最大长度 */
+    uint32_t      recv_ring_len;     /* 连接的读缓冲区最大长度 */
+    int           warm;              /* 每个目的地址的预热连接数量 */
+    int           max_idle;          /* 每个目的地址的最大空闲连接数量 */
+    int           max_connecting;    /* 同时发起连接的最大数量 */
+    int           connecting;        /* 正在连接的数量 */
+    int           connect_timeout;   /* 连接超时（秒） */
+    int           interval;          /* 健康检查间隔（秒） */
+    int           idle_timeout;      /* 空闲超时（秒） */
+    time_t        last_check_ts;     /* 上次健康检查时间戳（秒） */
+};
+
+static void pool_cb(channel_ref_t* channel_ref, channel_cb_event_e e);
+
+pool_t* pool_create(loop_t* loop, uint32_t max_send_list_len, uint32_t recv_ring_len, int warm, int max_connecting) {
+    pool_t* pool = 0;
+    assert(loop);
+    pool = create(pool_t);
+    assert(pool);
+    memset(pool, 0, sizeof(pool_t));
+    pool->dest_list = dlist_create();
+    assert(pool->dest_list);
+    pool->loop              = loop;
+    pool->max_send_list_len = max_send_list_len;
+    pool->recv_ring_len     = recv_ring_len;
+    pool->warm              = warm;
+    pool->max_idle          = max(warm, 1);
+    pool->max_connecting    = max_connecting;
+    pool->last_check_ts     = time(0);
+    /* 健康检查由loop_t驱动 */
+    pool->loop_node = loop_add_pool(loop, pool);
+    return pool;
+}
+
+/*
+ * 销毁pool_conn_t并与管道分离
+ */
+static void pool_conn_destroy(pool_conn_t* pool_conn) {
+    channel_ref_set_pool_conn(pool_conn->channel_ref, 0);
+    destroy(pool_conn);
+}
+
+static void pool_dest_destroy(pool_dest_t* dest) {
+    dlist_node_t*  node        = 0;
+    dlist_node_t*  temp        = 0;
+    pool_conn_t*   pool_conn   = 0;
+    channel_ref_t* channel_ref = 0;
+    dlist_for_each_safe(dest->wait_list, node, temp) {
+        destroy((pool_wait_t*)dlist_node_get_data(node));
+    }
+    dlist_for_each_safe(dest->busy_list, node, temp) {
+        pool_conn   = (pool_conn_t*)dlist_node_get_data(node);
+        channel_ref = pool_conn->channel_ref;
+        if (pool_conn->state == pool_conn_state_connect) {
+            pool_conn_destroy(pool_conn);
+            channel_ref_set_cb(channel_ref, 0);
+            channel_ref_close(channel_ref);
+        } else {
+            /* 已借出的连接与连接池分离，归还时关闭 */
+            pool_conn_destroy(pool_conn);
+        }
+    }
+    dlist_for_each_safe(dest->idle_list, node, temp) {
+        pool_conn   = (pool_conn_t*)dlist_node_get_data(node);
+        channel_ref = pool_conn->channel_ref;
+        pool_conn_destroy(pool_conn);
+        channel_ref_set_cb(channel_ref, 0);
+        channel_ref_close(channel_ref);
+    }
+    dlist_destroy(dest->wait_list);
+    dlist_destroy(dest->busy_list);
+    dlist_destroy(dest->idle_list);
+    destroy(dest);
+}
+
+void pool_destroy(pool_t* pool) {
+    dlist_node_t* node = 0;
+    dlist_node_t* temp = 0;
+    assert(pool);
+    loop_remove_pool(pool->loop, pool->loop_node);
+    dlist_for_each_safe(pool->dest_list, node, temp) {
+        pool_dest_destroy((pool_dest_t*)dlist_node_get_data(node));
+    }
+    dlist_destroy(pool->dest_list);
+    destroy(pool);
+}
+
+void pool_set_health_check(pool_t* pool, int interval, int idle_timeout) {
+    assert(pool);
+    pool->interval     = interval;
+    pool->idle_timeout = idle_timeout;
+}
+
+void pool_set_connect_timeout(pool_t* pool, int timeout) {
+    assert(pool);
+    pool->connect_timeout = timeout;
+}
+
+void pool_set_max_idle(pool_t* pool, int max_idle) {
+    assert(pool);
+    pool->max_idle = max_idle;
+}
+
+/*
+ * 查找目的地址，不存在时建立
+ */
+static pool_dest_t* pool_get_dest(pool_t* pool, const char* ip, int port) {
+    dlist_node_t* node = 0;
+    dlist_node_t* temp = 0;
+    pool_dest_t*  dest = 0;
+    dlist_for_each_safe(pool->dest_list, node, temp) {
+        dest = (pool_dest_t*)dlist_node_get_data(node);
+        if ((dest->port == port) && !strcmp(dest->ip, ip)) {
+            return dest;
+        }
+    }
+    if (strlen(ip) >= sizeof(dest->ip)) {
+        return 0;
+    }
+    dest = create(pool_dest_t);
+    assert(dest);
+    memset(dest, 0, sizeof(pool_dest_t));
+    dest->idle_list = dlist_create();
+    assert(dest->idle_list);
+    dest->busy_list = dlist_create();
+    assert(dest->busy_list);
+    dest->wait_list = dlist_create();
+    assert(dest->wait_list);
+    dest->pool = pool;
+    dest->port = port;
+    strcpy(dest->ip, ip);
+    dlist_add_tail_node(pool->dest_list, dest);
+    return dest;
+}
+
+/*
+ * 检查是否可以继续发起连接
+ */
+static int pool_check_connect(pool_t* pool) {
+    return (!pool->max_connecting || (pool->connecting < pool->max_connecting));
+}
+
+/*
+ * 向目的地址发起一个新连接
+ */
+static int pool_dest_connect(pool_dest_t* dest) {
+    pool_t*        pool        = dest->pool;
+    pool_conn_t*   pool_conn   = 0;
+    channel_ref_t* channel_ref = 0;
+    int            error       = 0;
+    channel_ref = loop_create_channel(pool->loop, pool->max_send_list_len, pool->recv_ring_len);
+    /* 连接池按loop_t划分，不经过负载均衡 */
+    error = channel_ref_connect_in_loop(channel_ref, pool->loop, dest->ip, dest->port, pool->connect_timeout);
+    if (error != error_ok) {
+        /* 尚未加入loop_t，直接销毁 */
+        channel_ref_destroy(channel_ref);
+        return error;
+    }
+    pool_conn = create(pool_conn_t);
+    assert(pool_conn);
+    memset(pool_conn, 0, sizeof(pool_conn_t));
+    pool_conn->dest        = dest;
+    pool_conn->channel_ref = channel_ref;
+    pool_conn->state       = pool_conn_state_connect;
+    pool_conn->node        = dlist_add_tail_node(dest->busy_list, pool_conn);
+    channel_ref_set_pool_conn(channel_ref, pool_conn);
+    channel_ref_set_cb(channel_ref, pool_cb);
+    dest->connecting++;
+    pool->connecting++;
+    return error_ok;
+}
+
+/*
+ * 为等待中的借用请求发起连接，直至每个请求都有一个正在进行的连接或达到同时连接数量限制
+ */
+static void pool_dest_pump(pool_dest_t* dest) {
+    while ((dlist_get_count(dest->wait_list) > dest->connecting) && pool_check_connect(dest->pool)) {
+        if (error_ok != pool_dest_connect(dest)) {
+            break;
+        }
+    }
+}
+
+/*
+ * 连接数量限制空出时，为所有目的地址的等待请求发起连接
+ */
+static void pool_pump(pool_t* pool) {
+    dlist_node_t* node = 0;
+    dlist_node_t* temp = 0;
+    dlist_for_each_safe(pool->dest_list, node, temp) {
+        if (!pool_check_connect(pool)) {
+            break;
+        }
+        pool_dest_pump((pool_dest_t*)dlist_node_get_data(node));
+    }
+}
+
+/*
+ * 取出等待中的第一个借用请求
+ */
+static int pool_dest_pop_wait(pool_dest_t* dest, pool_wait_t* wait) {
+    dlist_node_t* node = dlist_get_front(dest->wait_list);
+    if (!node) {
+        return 0;
+    }
+    *wait = *(pool_wait_t*)dlist_node_get_data(node);
+    destroy((pool_wait_t*)dlist_node_get_data(node));
+    dlist_delete(dest->wait_list, node);
+    return 1;
+}
+
+/*
+ * 连接可用（连接完成或被归还），已从所在链表取出
+ * 有等待中的借用请求时直接借出，否则放入空闲链表
+ */
+static void pool_conn_ready(pool_conn_t* pool_conn) {
+    pool_dest_t*   dest        = pool_conn->dest;
+    channel_ref_t* channel_ref = pool_conn->channel_ref;
+    pool_wait_t    wait;
+    if (pool_dest_pop_wait(dest, &wait)) {
+        pool_conn->state = pool_conn_state_lease;
+        dlist_add_tail(dest->busy_list, pool_conn->node);
+        /* 回调由借用者设置 */
+        channel_ref_set_cb(channel_ref, 0);
+        wait.cb(channel_ref, wait.data);
+        return;
+    }
+    pool_conn->state   = pool_conn_state_idle;
+    pool_conn->idle_ts = time(0);
+    channel_ref_set_cb(channel_ref, pool_cb);
+    dlist_add_front(dest->idle_list, pool_conn->node);
+    if (dlist_get_count(dest->idle_list) > dest->pool->max_idle) {
+        /* 超出最大空闲数量，关闭最久未使用的连接 */
+        pool_conn = (pool_conn_t*)dlist_node_get_data(dlist_get_back(dest->idle_list));
+        channel_ref_close(pool_conn->channel_ref);
+    }
+}
+
+static void pool_cb(channel_ref_t* channel_ref, channel_cb_event_e e) {
+    pool_conn_t* pool_conn = channel_ref_get_pool_conn(channel_ref);
+    pool_t*      pool      = 0;
+    if (!pool_conn) {
+        return;
+    }
+    pool = pool_conn->dest->pool;
+    if (e & channel_cb_event_connect) {
+        pool_conn->dest->connecting--;
+        pool->connecting--;
+        dlist_remove(pool_conn->dest->busy_list, pool_conn->node);
+        pool_conn_ready(pool_conn);
+        /* 空出的连接数量留给其他等待请求 */
+        pool_pump(pool);
+    } else if (e & (channel_cb_event_connect_timeout | channel_cb_event_recv)) {
+        /* 连接超时，或空闲连接收到数据（对端不应主动发送） */
+        channel_ref_close(channel_ref);
+    }
+}
+
+void pool_conn_close(pool_conn_t* pool_conn) {
+    pool_dest_t* dest = 0;
+    pool_t*      pool = 0;
+    pool_wait_t  wait;
+    assert(pool_conn);
+    dest = pool_conn->dest;
+    pool = dest->pool;
+    switch (pool_conn->state) {
+    case pool_conn_state_idle:
+        dlist_delete(dest->idle_list, pool_conn->node);
+        pool_conn_destroy(pool_conn);
+        break;
+    case pool_conn_state_lease:
+        dlist_delete(dest->busy_list, pool_conn->node);
+        pool_conn_destroy(pool_conn);
+        break;
+    case pool_conn_state_connect:
+        dlist_delete(dest->busy_list, pool_conn->node);
+        pool_conn_destroy(pool_conn);
+        dest->connecting--;
+        pool->connecting--;
+        /* 每次连接失败以失败回调一个等待请求，目的地址不可用时等待请求不会无限重试 */
+        if (pool_dest_pop_wait(dest, &wait)) {
+            wait.cb(0, wait.data);
+        }
+        pool_pump(pool);
+        break;
+    }
+}
+
+/*
+ * 补足预热连接，正在连接的也计算在内
+ */
+static int pool_dest_warm(pool_dest_t* dest) {
+    int error = error_ok;
+    while ((dlist_get_count(dest->idle_list) + dest->connecting < dest->pool->warm) && pool_check_connect(dest->pool)) {
+        error = pool_dest_connect(dest);
+        if (error != error_ok) {
+            break;
+        }
+    }
+    return error;
+}
+
+int pool_prepare(pool_t* pool, const char* ip, int port) {
+    pool_dest_t* dest = 0;
+    assert(pool);
+    assert(ip);
+    dest = pool_get_dest(pool, ip, port);
+    if (!dest) {
+        return error_connect_fail;
+    }
+    return pool_dest_warm(dest);
+}
+
+int pool_lease(pool_t* pool, const char* ip, int port, pool_lease_cb_t cb, void* data) {
+    pool_dest_t*  dest      = 0;
+    pool_conn_t*  pool_conn = 0;
+    pool_wait_t*  wait      = 0;
+    dlist_node_t* node      = 0;
+    int           error     = 0;
+    assert(pool);
+    assert(ip);
+    assert(cb);
+    dest = pool_get_dest(pool, ip, port);
+    if (!dest) {
+        return error_connect_fail;
+    }
+    node = dlist_get_front(dest->idle_list);
+    if (node) {
+        /* 借出最近归还的空闲连接 */
+        pool_conn = (pool_conn_t*)dlist_node_get_data(node);
+        dlist_remove(dest->idle_list, node);
+        pool_conn->state = pool_conn_state_lease;
+        dlist_add_tail(dest->busy_list, node);
+        channel_ref_set_cb(pool_conn->channel_ref, 0);
+        cb(pool_conn->channel_ref, data);
+        return error_ok;
+    }
+    if ((dlist_get_count(dest->wait_list) >= dest->connecting) && pool_check_connect(pool)) {
+        /* 发起连接失败时不等待 */
+        error = pool_dest_connect(dest);
+        if (error != error_ok) {
+            return error;
+        }
+    }
+    wait = create(pool_wait_t);
+    assert(wait);
+    wait->cb   = cb;
+    wait->data = data;
+    dlist_add_tail_node(dest->wait_list, wait);
+    return error_ok;
+}
+
+void pool_release(channel_ref_t* channel_ref, int reuse) {
+    pool_conn_t* pool_conn = 0;
+    assert(channel_ref);
+    pool_conn = channel_ref_get_pool_conn(channel_ref);
+    if (!pool_conn) {
+        /* 已关闭或连接池已销毁 */
+        channel_ref_close(channel_ref);
+        return;
+    }
+    assert(pool_conn->state == pool_conn_state_lease);
+    /* 不再回调借用者 */
+    channel_ref_set_cb(channel_ref, pool_cb);
+    if (!reuse || !channel_ref_check_state(channel_ref, channel_state_active) ||
+        stream_available(channel_ref_get_stream(channel_ref))) {
+        /* 有未读数据时协议状态不确定，不能复用 */
+        channel_ref_close(channel_ref);
+        return;
+    }
+    dlist_remove(pool_conn->dest->busy_list, pool_conn->node);
+    pool_conn_ready(pool_conn);
+}
+
+void pool_check(pool_t* pool, time_t ts) {
+    dlist_node_t* node      = 0;
+    dlist_node_t* temp      = 0;
+    pool_dest_t*  dest      = 0;
+    pool_conn_t*  pool_conn = 0;
+    assert(pool);
+    if (!pool->interval || (ts - pool->last_check_ts < pool->interval)) {
+        return;
+    }
+    pool->last_check_ts = ts;
+    dlist_for_each_safe(pool->dest_list, node, temp) {
+        dest = (pool_dest_t*)dlist_node_get_data(node);
+        /* 最久未使用的在尾部，保留预热数量 */
+        while (pool->idle_timeout && (dlist_get_count(dest->idle_list) > pool->warm)) {
+            pool_conn = (pool_conn_t*)dlist_node_get_data(dlist_get_back(dest->idle_list));
+            if (ts - pool_conn->idle_ts < pool->idle_timeout) {
+                break;
+            }
+            channel_ref_close(pool_conn->channel_ref);
+        }
+        /* 补足预热连接 */
+        pool_dest_warm(dest);
+        /* 重试因连接数量限制而未发起的等待请求 */
+        pool_dest_pump(dest);
+    }
+}
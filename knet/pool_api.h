@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef POOL_API_H
+#define POOL_API_H
+
+#include "config.h"
+
+/*
+ * 创建客户端连接池
+ * 连接池属于一个loop_t，只能在loop_t所运行的线程内使用，每个目的地址（IP，端口）维护各自的空闲连接.
+ * 多线程时每个loop_t各自创建连接池，连接不会跨线程借出
+ * @param loop loop_t实例
+ * @param max_send_list_len 连接的发送链表最大长度
+ * @param recv_ring_len 连接的读缓冲区最大长度
+ * @param warm 每个目的地址保持的预热（空闲）连接数量，0为不预热
+ * @param max_connecting 同时发起连接的最大数量，0为不限制
+ * @return pool_t实例
+ */
+pool_t* pool_create(loop_t* loop, uint32_t max_send_list_len, uint32_t recv_ring_len, int warm, int max_connecting);
+
+/*
+ * 销毁连接池
+ * 关闭空闲及正在连接的连接，丢弃等待中的借用请求，未归还的连接不再属于连接池.
+ * 未销毁的连接池由loop_destroy销毁
+ * @param pool pool_t实例
+ */
+void pool_destroy(pool_t* pool);
+
+/*
+ * 设置健康检查
+ * 每interval秒检查一次：关闭空闲超过idle_timeout秒且超出预热数量的连接，补足预热连接，
+ * 重试等待中的借用请求. 空闲连接被对端关闭或收到数据时立即关闭
+ * @param pool pool_t实例
+ * @param interval 检查间隔（秒），0为不检查
+ * @param idle_timeout 空闲超时（秒），0为不超时
+ */
+void pool_set_health_check(pool_t* pool, int interval, int idle_timeout);
+
+/*
+ * 设置连接超时
+ * @param pool pool_t实例
+ * @param timeout 连接超时（秒），0为不超时
+ */
+void pool_set_connect_timeout(pool_t* pool, int timeout);
+
+/*
+ * 设置每个目的地址最多保留的空闲连接数量，归还时超出的连接被关闭
+ * @param pool pool_t实例
+ * @param max_idle 最大空闲连接数量，默认与预热数量相同（至少为1）
+ */
+void pool_set_max_idle(pool_t* pool, int max_idle);
+
+/*
+ * 预热目的地址，立即发起预热连接
+ * @param pool pool_t实例
+ * @param ip IP
+ * @param port 端口
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int pool_prepare(pool_t* pool, const char* ip, int port);
+
+/*
+ * 借用连接
+ * 有空闲连接时在本函数内回调，否则发起新连接（受同时连接数量限制）并在连接完成或有连接归还时回调.
+ * 连接失败时以channel为0回调. 借出的连接由调用者设置回调，使用完毕后必须通过pool_release归还
+ * @param pool pool_t实例
+ * @param ip IP
+ * @param port 端口
+ * @param cb 借用回调
+ * @param data 回调用户数据
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int pool_lease(pool_t* pool, const char* ip, int port, pool_lease_cb_t cb, void* data);
+
+/*
+ * 归还借用的连接
+ * 连接已关闭、reuse为0或发送链表/读缓冲区内有残留数据时关闭连接，否则交给等待中的借用请求或放入空闲连接.
+ * 连接池已销毁时关闭连接
+ * @param channel_ref 借用的连接
+ * @param reuse 是否可以复用
+ */
+void pool_release(channel_ref_t* channel_ref, int reuse);
+
+#endif /* POOL_API_H */
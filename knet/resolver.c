@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "resolver.h"
+#include "channel_ref.h"
+#include "loop.h"
+#include "list.h"
+
+#define RESOLVER_MAX_HOST 256 /* 域名最大长度 */
+#define RESOLVER_WAIT_MS  100 /* 工作线程等待门铃的超时，检查退出标志 */
+
+typedef struct _resolver_cache_t {
+    char             host[RESOLVER_MAX_HOST]; /* 域名 */
+    socket_address_t addr;                    /* 地址，端口为0 */
+    socket_len_t     len;                     /* 地址长度 */
+    time_t           expire;                  /* 过期时间戳（秒） */
+} resolver_cache_t;
+
+struct _resolver_job_t {
+    resolver_t*      resolver;                /* 所属解析器 */
+    loop_t*          loop;                    /* 回调所在的loop_t */
+    channel_ref_t*   channel_ref;             /* 解析完成后发起连接的管道 */
+    int              timeout;                 /* 连接超时（秒） */
+    resolver_cb_t    cb;                      /* 回调 */
+    void*            data;                    /* 回调用户数据 */
+    char             host[RESOLVER_MAX_HOST]; /* 域名 */
+    int              port;                    /* 端口 */
+    socket_address_t addr;                    /* 解析结果 */
+    socket_len_t     len;                     /* 解析结果长度，0为失败 */
+};
+
+struct _resolver_t {
+    lock_t*           lock;         /* 锁 - 请求链表，缓存 */
+    dlist_t*          job_list;     /* 等待工作线程处理的请求链表 */
+    dlist_t*          cache_list;   /* 缓存链表 */
+    socket_t          doorbell[2];  /* 门铃，0端写入唤醒工作线程，1端由工作线程等待 */
+    thread_runner_t** workers;      /* 工作线程 */
+    int               worker_count; /* 工作线程数量 */
+    int               ttl;          /* 缓存有效期（秒） */
+};
+
+static void resolver_worker(thread_runner_t* runner);
+
+resolver_t* resolver_create(int worker_count, int ttl) {
+    int         i        = 0;
+    resolver_t* resolver = create(resolver_t);
+    assert(resolver);
+    assert(worker_count > 0);
+    memset(resolver, 0, sizeof(resolver_t));
+    if (socket_pair(resolver->doorbell)) {
+        destroy(resolver);
+        return 0;
+    }
+    resolver->lock = lock_create();
+    assert(resolver->lock);
+    resolver->job_list = dlist_create();
+    assert(resolver->job_list);
+    resolver->cache_list = dlist_create();
+    assert(resolver->cache_list);
+    resolver->ttl          = ttl;
+    resolver->worker_count = worker_count;
+    resolver->workers      = create_type(thread_runner_t*, sizeof(thread_runner_t*) * worker_count);
+    assert(resolver->workers);
+    for (; i < worker_count; i++) {
+        resolver->workers[i] = thread_runner_create(resolver_worker, resolver);
+        if (error_ok != thread_runner_start(resolver->workers[i], 0)) {
+            thread_runner_destroy(resolver->workers[i]);
+            resolver->worker_count = i;
+            resolver_destroy(resolver);
+            return 0;
+        }
+    }
+    return resolver;
+}
+
+void resolver_destroy(resolver_t* resolver) {
+    int           i    = 0;
+    dlist_node_t* node = 0;
+    dlist_node_t* temp = 0;
+    assert(resolver);
+    for (i = 0; i < resolver->worker_count; i++) {
+        thread_runner_stop(resolver->workers[i]);
+    }
+    for (i = 0; i < resolver->worker_count; i++) {
+        thread_runner_join(resolver->workers[i]);
+        thread_runner_destroy(resolver->workers[i]);
+    }
+    destroy(resolver->workers);
+    dlist_for_each_safe(resolver->job_list, node, temp) {
+        destroy((resolver_job_t*)dlist_node_get_data(node));
+    }
+    dlist_for_each_safe(resolver->cache_list, node, temp) {
+        destroy((resolver_cache_t*)dlist_node_get_data(node));
+    }
+    dlist_destroy(resolver->job_list);
+    dlist_destroy(resolver->cache_list);
+    lock_destroy(resolver->lock);
+    socket_close(resolver->doorbell[0]);
+    socket_close(resolver->doorbell[1]);
+    destroy(resolver);
+}
+
+void resolver_attach(resolver_t* resolver, loop_t* loop) {
+    assert(resolver);
+    assert(loop);
+    loop_set_resolver(loop, resolver);
+}
+
+/*
+ * 填写端口，缓存内的地址端口为0
+ */
+static void resolver_set_port(socket_address_t* addr, int port) {
+    if (addr->sa.sa_family == AF_INET6) {
+        addr->sin6.sin6_port = htons((unsigned short)port);
+    } else {
+        addr->sin.sin_port = htons((unsigned short)port);
+    }
+}
+
+/*
+ * 查找缓存，同时删除已过期的缓存
+ */
+static socket_len_t resolver_cache_get(resolver_t* resolver, const char* host, socket_address_t* addr) {
+    dlist_node_t*     node  = 0;
+    dlist_node_t*     temp  = 0;
+    resolver_cache_t* cache = 0;
+    socket_len_t      len   = 0;
+    time_t            ts    = time(0);
+    lock_lock(resolver->lock);
+    dlist_for_each_safe(resolver->cache_list, node, temp) {
+        cache = (resolver_cache_t*)dlist_node_get_data(node);
+        if (cache->expire <= ts) {
+            destroy(cache);
+            dlist_delete(resolver->cache_list, node);
+            continue;
+        }
+        if (!strcmp(cache->host, host)) {
+            memcpy(addr, &cache->addr, cache->len);
+            len = cache->len;
+            break;
+        }
+    }
+    lock_unlock(resolver->lock);
+    return len;
+}
+
+static void resolver_cache_set(resolver_t* resolver, const char* host, socket_address_t* addr, socket_len_t len) {
+    dlist_node_t*     node  = 0;
+    dlist_node_t*     temp  = 0;
+    resolver_cache_t* cache = 0;
+    if (!resolver->ttl) {
+        return;
+    }
+    lock_lock(resolver->lock);
+    dlist_for_each_safe(resolver->cache_list, node, temp) {
+        if (!strcmp(((resolver_cache_t*)dlist_node_get_data(node))->host, host)) {
+            cache = (resolver_cache_t*)dlist_node_get_data(node);
+            break;
+        }
+    }
+    if (!cache) {
+        cache = create(resolver_cache_t);
+        assert(cache);
+        strcpy(cache->host, host);
+        dlist_add_tail_node(resolver->cache_list, cache);
+    }
+    memcpy(&cache->addr, addr, len);
+    resolver_set_port(&cache->addr, 0);
+    cache->len    = len;
+    cache->expire = time(0) + resolver->ttl;
+    lock_unlock(resolver->lock);
+}
+
+socket_len_t resolver_get_address(resolver_t* resolver, const char* host, int port, socket_address_t* addr) {
+    socket_len_t len = socket_make_address(host, port, addr);
+    if (len || !resolver) {
+        return len;
+    }
+    len = resolver_cache_get(resolver, host, addr);
+    if (len) {
+        resolver_set_port(addr, port);
+    }
+    return len;
+}
+
+/*
+ * 提交请求并敲门铃
+ */
+static int resolver_submit(resolver_t* resolver, loop_t* loop, channel_ref_t* channel_ref, const char* host,
+    int port, int timeout, resolver_cb_t cb, void* data) {
+    char            c   = 1;
+    resolver_job_t* job = 0;
+    if (strlen(host) >= RESOLVER_MAX_HOST) {
+        return error_resolve_fail;
+    }
+    job = create(resolver_job_t);
+    assert(job);
+    memset(job, 0, sizeof(resolver_job_t));
+    job->resolver    = resolver;
+    job->loop        = loop;
+    job->channel_ref = channel_ref;
+    job->timeout     = timeout;
+    job->cb          = cb;
+    job->data        = data;
+    job->port        = port;
+    strcpy(job->host, host);
+    lock_lock(resolver->lock);
+    dlist_add_tail_node(resolver->job_list, job);
+    lock_unlock(resolver->lock);
+    socket_send(resolver->doorbell[0], &c, sizeof(c));
+    return error_ok;
+}
+
+int resolver_resolve(resolver_t* resolver, loop_t* loop, const char* host, int port, resolver_cb_t cb, void* data) {
+    socket_address_t addr;
+    socket_len_t     len = 0;
+    assert(resolver);
+    assert(loop);
+    assert(host);
+    assert(cb);
+    len = resolver_get_address(resolver, host, port, &addr);
+    if (len) {
+        cb(&addr.sa, (int)len, data);
+        return error_ok;
+    }
+    return resolver_submit(resolver, loop, 0, host, port, 0, cb, data);
+}
+
+int resolver_connect(resolver_t* resolver, channel_ref_t* channel_ref, const char* host, int port, int timeout) {
+    assert(resolver);
+    assert(channel_ref);
+    assert(host);
+    return resolver_submit(resolver, channel_ref_get_loop(channel_ref), channel_ref, host, port, timeout, 0, 0);
+}
+
+void resolver_job_complete(resolver_job_t* job) {
+    int error = error_ok;
+    assert(job);
+    if (job->channel_ref) {
+        if (job->len) {
+            error = channel_ref_connect_addr(job->channel_ref, &job->addr.sa, (int)job->len, job->timeout);
+        } else {
+            error = error_resolve_fail;
+        }
+        if (error != error_ok) {
+            /* 加入loop_t后关闭，以channel_cb_event_close回调 */
+            loop_add_channel_ref(job->loop, job->channel_ref);
+            channel_ref_close(job->channel_ref);
+        }
+    } else {
+        job->cb(job->len ? &job->addr.sa : 0, (int)job->len, job->data);
+    }
+    destroy(job);
+}
+
+void resolver_job_destroy(resolver_job_t* job) {
+    assert(job);
+    destroy(job);
+}
+
+/*
+ * 工作线程内解析，只取第一个地址
+ */
+static void resolver_lookup(resolver_t* resolver, resolver_job_t* job) {
+    struct addrinfo  hints;
+    struct addrinfo* result = 0;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = AI_ADDRCONFIG;
+    if (!getaddrinfo(job->host, 0, &hints, &result)) {
+        if (result && (result->ai_addrlen <= sizeof(job->addr))) {
+            memcpy(&job->addr, result->ai_addr, result->ai_addrlen);
+            job->len = (socket_len_t)result->ai_addrlen;
+        }
+        freeaddrinfo(result);
+    }
+    if (job->len) {
+        resolver_cache_set(resolver, job->host, &job->addr, job->len);
+        resolver_set_port(&job->addr, job->port);
+    }
+}
+
+/*
+ * 等待门铃，超时返回以检查退出标志
+ */
+static void resolver_wait(resolver_t* resolver) {
+    char           buffer[64];
+    fd_set         recv_fds[1];
+    struct timeval tv = {0, RESOLVER_WAIT_MS * 1000};
+    FD_ZERO(recv_fds);
+    FD_SET(resolver->doorbell[1], recv_fds);
+    if (select((int)(resolver->doorbell[1] + 1), recv_fds, 0, 0, &tv) > 0) {
+        /* 多个工作线程同时被唤醒时只有一个读到，其他的直接检查请求链表 */
+        socket_recv(resolver->doorbell[1], buffer, sizeof(buffer));
+    }
+}
+
+static void resolver_worker(thread_runner_t* runner) {
+    resolver_t*     resolver = (resolver_t*)thread_runner_get_params(runner);
+    resolver_job_t* job      = 0;
+    dlist_node_t*   node     = 0;
+    while (thread_runner_check_start(runner)) {
+        job = 0;
+        lock_lock(resolver->lock);
+        node = dlist_get_front(resolver->job_list);
+        if (node) {
+            job = (resolver_job_t*)dlist_node_get_data(node);
+            dlist_delete(resolver->job_list, node);
+        }
+        lock_unlock(resolver->lock);
+        if (!job) {
+            resolver_wait(resolver);
+            continue;
+        }
+        resolver_lookup(resolver, job);
+        /* 投递回发起解析的loop_t */
+        loop_notify_resolve(job->loop, job);
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "config.h"
+#include "misc.h"
+#include "resolver_api.h"
+
+/*
+ * 不经过工作线程取得地址，host为IP字符串或缓存命中
+ * @param resolver resolver_t实例，为0时只转换IP字符串
+ * @param host 域名或IP
+ * @param port 端口
+ * @param addr 地址
+ * @return 地址长度，需要异步解析时返回0
+ */
+socket_len_t resolver_get_address(resolver_t* resolver, const char* host, int port, socket_address_t* addr);
+
+/*
+ * 提交异步解析，完成后在loop_t所运行的线程内发起连接
+ * 解析或连接失败时管道被关闭，以channel_cb_event_close回调
+ * @param resolver resolver_t实例
+ * @param channel_ref channel_ref_t实例
+ * @param host 域名
+ * @param port 端口
+ * @param timeout 连接超时（秒）
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int resolver_connect(resolver_t* resolver, channel_ref_t* channel_ref, const char* host, int port, int timeout);
+
+/*
+ * 解析完成，由loop_t在所运行的线程内调用
+ * @param job resolver_job_t实例
+ */
+void resolver_job_complete(resolver_job_t* job);
+
+/*
+ * 销毁未完成的解析请求，由loop_t销毁时调用
+ * @param job resolver_job_t实例
+ */
+void resolver_job_destroy(resolver_job_t* job);
+
+#endif /* RESOLVER_H */
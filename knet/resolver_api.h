@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RESOLVER_API_H
+#define RESOLVER_API_H
+
+#include "config.h"
+
+/*
+ * 创建域名解析器
+ * getaddrinfo在工作线程内执行，结果投递回发起解析的loop_t所运行的线程回调.
+ * 解析结果放入所有loop_t共享的缓存，有效期内不再解析
+ * @param worker_count 工作线程数量
+ * @param ttl 缓存有效期（秒），0为不缓存
+ * @return resolver_t实例，启动工作线程失败返回0
+ */
+resolver_t* resolver_create(int worker_count, int ttl);
+
+/*
+ * 销毁域名解析器
+ * 等待工作线程退出，丢弃未完成的解析请求，需要在关联的loop_t销毁之前调用
+ * @param resolver resolver_t实例
+ */
+void resolver_destroy(resolver_t* resolver);
+
+/*
+ * 关联loop_t，关联后loop_t内的管道可以调用channel_ref_connect_host
+ * @param resolver resolver_t实例
+ * @param loop loop_t实例
+ */
+void resolver_attach(resolver_t* resolver, loop_t* loop);
+
+/*
+ * 解析域名
+ * IP字符串及缓存命中时在本函数内回调，否则在loop_t所运行的线程内回调，解析失败时addr为0
+ * @param resolver resolver_t实例
+ * @param loop 回调所在的loop_t实例
+ * @param host 域名或IP
+ * @param port 端口，填写在回调的地址内
+ * @param cb 回调
+ * @param data 回调用户数据
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int resolver_resolve(resolver_t* resolver, loop_t* loop, const char* host, int port, resolver_cb_t cb, void* data);
+
+#endif /* RESOLVER_API_H */
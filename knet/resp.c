@@ -0,0 +1,568 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "resp.h"
+#include "channel_ref.h"
+#include "ringbuffer.h"
+#include "buffer.h"
+
+#define RESP_MAX_LINE 32 /* 长度行最大字节数 */
+
+typedef struct _resp_pending_t {
+    resp_reply_cb_t cb;   /* 应答回调 */
+    void*           data; /* 回调用户数据 */
+} resp_pending_t;
+
+typedef struct _resp_level_t {
+    uint32_t remain;    /* 尚未收齐的元素数量 */
+    int      attribute; /* 是否为属性 */
+} resp_level_t;
+
+struct _resp_reply_t {
+    resp_type_e   type;     /* 类型 */
+    const char*   str;      /* 字符串 */
+    uint32_t      size;     /* 字符串长度 */
+    int64_t       integer;  /* 整数 */
+    uint32_t      count;    /* 元素数量 */
+    resp_reply_t* elements; /* 元素数组 */
+};
+
+struct _resp_t {
+    resp_reply_cb_t push_cb;                 /* 推送回调 */
+    void*           push_data;               /* 推送回调用户数据 */
+    resp_pending_t* pending;                 /* 等待应答的命令（循环队列） */
+    uint32_t        pending_head;            /* 队列头 */
+    uint32_t        pending_count;           /* 队列长度 */
+    uint32_t        pending_size;            /* 队列容量 */
+    uint32_t        scanned;                 /* 当前应答已扫描的字节数 */
+    uint32_t        nodes;                   /* 当前应答已扫描的值数量 */
+    int             depth;                   /* 当前嵌套深度 */
+    resp_level_t    stack[RESP_MAX_DEPTH];   /* 未完成的聚合类型 */
+    resp_reply_t*   pool;                    /* 应答节点池 */
+    uint32_t        pool_size;               /* 节点池容量 */
+};
+
+resp_t* resp_create(resp_reply_cb_t push_cb, void* data) {
+    resp_t* resp = create(resp_t);
+    assert(resp);
+    memset(resp, 0, sizeof(resp_t));
+    resp->push_cb   = push_cb;
+    resp->push_data = data;
+    return resp;
+}
+
+void resp_destroy(resp_t* resp) {
+    assert(resp);
+    if (resp->pending) {
+        destroy(resp->pending);
+    }
+    if (resp->pool) {
+        destroy(resp->pool);
+    }
+    destroy(resp);
+}
+
+static void resp_push_pending(resp_t* resp, resp_reply_cb_t cb, void* data) {
+    uint32_t        i       = 0;
+    uint32_t        size    = 0;
+    resp_pending_t* pending = 0;
+    if (resp->pending_count == resp->pending_size) {
+        /* 队列已满，容量加倍并展开为从0开始 */
+        size    = resp->pending_size ? resp->pending_size * 2 : 16;
+        pending = (resp_pending_t*)create_raw(sizeof(resp_pending_t) * size);
+        assert(pending);
+        for (; i < resp->pending_count; i++) {
+            pending[i] = resp->pending[(resp->pending_head + i) % resp->pending_size];
+        }
+        if (resp->pending) {
+            destroy(resp->pending);
+        }
+        resp->pending      = pending;
+        resp->pending_size = size;
+        resp->pending_head = 0;
+    }
+    pending = &resp->pending[(resp->pending_head + resp->pending_count) % resp->pending_size];
+    pending->cb   = cb;
+    pending->data = data;
+    resp->pending_count++;
+}
+
+static resp_pending_t resp_pop_pending(resp_t* resp) {
+    resp_pending_t pending = resp->pending[resp->pending_head];
+    resp->pending_head = (resp->pending_head + 1) % resp->pending_size;
+    resp->pending_count--;
+    return pending;
+}
+
+void resp_abort(resp_t* resp, channel_ref_t* channel_ref) {
+    resp_pending_t pending;
+    assert(resp);
+    assert(channel_ref);
+    /* 回调内可能继续发送命令，每次只取队列头 */
+    while (resp->pending_count) {
+        pending = resp_pop_pending(resp);
+        if (pending.cb) {
+            pending.cb(channel_ref, 0, pending.data);
+        }
+    }
+}
+
+/*
+ * 解析十进制整数
+ * @retval 0 成功
+ * @retval -1 格式错误
+ */
+static int resp_parse_number(const char* p, uint32_t size, int64_t* value) {
+    uint32_t i        = 0;
+    int      negative = 0;
+    int64_t  result   = 0;
+    if (size && (p[0] == '-')) {
+        negative = 1;
+        i++;
+    }
+    if ((i == size) || (size - i > 18)) {
+        return -1;
+    }
+    for (; i < size; i++) {
+        if ((p[i] < '0') || (p[i] > '9')) {
+            return -1;
+        }
+        result = result * 10 + (p[i] - '0');
+    }
+    *value = negative ? -result : result;
+    return 0;
+}
+
+/*
+ * 读取从offset开始的一行，最多拷贝RESP_MAX_LINE字节
+ * @retval >=0 行长度（不含\r\n）
+ * @retval -1 数据不足
+ */
+static int resp_read_line(ringbuffer_t* rb, uint32_t offset, char* line, uint32_t* next) {
+    int         pos     = 0;
+    uint32_t    length  = 0;
+    uint32_t    copy    = 0;
+    char*       ptr[2]  = {0};
+    uint32_t    len[2]  = {0};
+    int         i       = 0;
+    int         count   = 0;
+    pos = ringbuffer_find_offset(rb, offset, "\r\n", 2);
+    if (pos < 0) {
+        return -1;
+    }
+    length = (uint32_t)pos - offset;
+    count  = ringbuffer_read_segments(rb, offset, min(length, RESP_MAX_LINE), ptr, len);
+    for (; i < count; i++) {
+        memcpy(line + copy, ptr[i], len[i]);
+        copy += len[i];
+    }
+    *next = (uint32_t)pos + 2;
+    return (int)length;
+}
+
+/*
+ * 检查offset处是否为\r\n，调用前须确认数据足够
+ * @retval 1 是
+ * @retval 0 不是
+ */
+static int resp_check_crlf(ringbuffer_t* rb, uint32_t offset) {
+    char     crlf[2] = {0};
+    char*    ptr[2]  = {0};
+    uint32_t len[2]  = {0};
+    uint32_t copy    = 0;
+    int      i       = 0;
+    int      count   = ringbuffer_read_segments(rb, offset, 2, ptr, len);
+    for (; i < count; i++) {
+        memcpy(crlf + copy, ptr[i], len[i]);
+        copy += len[i];
+    }
+    return ((copy == 2) && (crlf[0] == '\r') && (crlf[1] == '\n'));
+}
+
+/*
+ * 一个值完成后逐层检查所属的聚合类型是否完成
+ * @retval 1 应答完成
+ * @retval 0 应答未完成
+ */
+static int resp_value_done(resp_t* resp) {
+    resp_level_t* level = 0;
+    while (resp->depth) {
+        level = &resp->stack[resp->depth - 1];
+        if (--level->remain) {
+            return 0;
+        }
+        resp->depth--;
+        if (level->attribute) {
+            /* 属性不计入所属的聚合类型，继续等待其后的值 */
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * 从上次停止的位置继续扫描应答，只校验格式和记录位置，不拷贝数据
+ * @retval 1 应答完整
+ * @retval 0 数据不足
+ * @retval -1 格式错误
+ */
+static int resp_scan(resp_t* resp, ringbuffer_t* rb, uint32_t max_size) {
+    char     line[RESP_MAX_LINE];
+    int      length    = 0;
+    uint32_t next      = 0;
+    int64_t  value     = 0;
+    uint64_t count     = 0;
+    uint32_t available = ringbuffer_available(rb);
+    for (;;) {
+        length = resp_read_line(rb, resp->scanned, line, &next);
+        if (length < 0) {
+            if (available >= max_size) {
+                /* 读缓冲区已满仍不能取得完整的行 */
+                return -1;
+            }
+            return 0;
+        }
+        if (!length) {
+            return -1;
+        }
+        switch (line[0]) {
+        case '+': case '-': case ':': case '_': case '#': case ',': case '(':
+            break;
+        case '$': case '!': case '=':
+            if ((length > RESP_MAX_LINE) || resp_parse_number(line + 1, length - 1, &value) || (value < -1)) {
+                return -1;
+            }
+            if ((value == -1) && (line[0] != '$')) {
+                return -1;
+            }
+            if (value >= 0) {
+                if ((uint64_t)next + value + 2 > max_size) {
+                    /* 读缓冲区无法容纳 */
+                    return -1;
+                }
+                if ((uint64_t)next + value + 2 > available) {
+                    return 0;
+                }
+                if (!resp_check_crlf(rb, next + (uint32_t)value)) {
+                    /* 数据长度与声明的长度不符 */
+                    return -1;
+                }
+                next += (uint32_t)value + 2;
+            }
+            break;
+        case '*': case '%': case '~': case '>': case '|':
+            if ((length > RESP_MAX_LINE) || resp_parse_number(line + 1, length - 1, &value) || (value < -1)) {
+                return -1;
+            }
+            if (value == -1) {
+                if (line[0] != '*') {
+                    return -1;
+                }
+                break;
+            }
+            count = (uint64_t)value * (((line[0] == '%') || (line[0] == '|')) ? 2 : 1);
+            if (count * 3 > max_size) {
+                /* 每个元素至少3字节 */
+                return -1;
+            }
+            resp->nodes++;
+            resp->scanned = next;
+            if (count) {
+                if (resp->depth == RESP_MAX_DEPTH) {
+                    return -1;
+                }
+                resp->stack[resp->depth].remain    = (uint32_t)count;
+                resp->stack[resp->depth].attribute = (line[0] == '|');
+                resp->depth++;
+                continue;
+            }
+            if (line[0] == '|') {
+                /* 空属性 */
+                continue;
+            }
+            if (resp_value_done(resp)) {
+                return 1;
+            }
+            continue;
+        default:
+            return -1;
+        }
+        resp->nodes++;
+        resp->scanned = next;
+        if (resp_value_done(resp)) {
+            return 1;
+        }
+    }
+}
+
+/*
+ * 在连续的应答数据上建立节点树，子节点在节点池内连续存放
+ * @return 值之后的位置
+ */
+static const char* resp_build(resp_t* resp, resp_reply_t* reply, const char* p, uint32_t* used) {
+    const char* end   = 0;
+    int64_t     value = 0;
+    uint32_t    i     = 0;
+    /* 已经过扫描校验，一定存在\r\n */
+    for (end = p; (end[0] != '\r') || (end[1] != '\n'); end++);
+    memset(reply, 0, sizeof(resp_reply_t));
+    switch (p[0]) {
+    case '+':
+    case '-':
+    case ',':
+    case '(':
+        reply->type = (p[0] == '+') ? resp_type_string :
+            ((p[0] == '-') ? resp_type_error : ((p[0] == ',') ? resp_type_double : resp_type_big_number));
+        reply->str  = p + 1;
+        reply->size = (uint32_t)(end - p - 1);
+        return end + 2;
+    case ':':
+        reply->type = resp_type_integer;
+        if (resp_parse_number(p + 1, (uint32_t)(end - p - 1), &reply->integer)) {
+            /* 超出范围的整数按大整数保留字符串 */
+            reply->type = resp_type_big_number;
+            reply->str  = p + 1;
+            reply->size = (uint32_t)(end - p - 1);
+        }
+        return end + 2;
+    case '_':
+        reply->type = resp_type_null;
+        return end + 2;
+    case '#':
+        reply->type    = resp_type_boolean;
+        reply->integer = (p[1] == 't');
+        return end + 2;
+    case '$':
+    case '!':
+    case '=':
+        resp_parse_number(p + 1, (uint32_t)(end - p - 1), &value);
+        if (value < 0) {
+            reply->type = resp_type_null;
+            return end + 2;
+        }
+        reply->type = (p[0] == '$') ? resp_type_bulk : ((p[0] == '!') ? resp_type_bulk_error : resp_type_verbatim);
+        reply->str  = end + 2;
+        reply->size = (uint32_t)value;
+        if ((p[0] == '=') && (reply->size >= 4)) {
+            /* 跳过格式前缀，例如"txt:" */
+            reply->str  += 4;
+            reply->size -= 4;
+        }
+        return end + 2 + value + 2;
+    case '|':
+        /* 属性建立在节点池内后丢弃，返回其后的值 */
+        resp_parse_number(p + 1, (uint32_t)(end - p - 1), &value);
+        reply->elements = resp->pool + *used;
+        *used += (uint32_t)value * 2;
+        p = end + 2;
+        for (i = 0; i < (uint32_t)value * 2; i++) {
+            p = resp_build(resp, &reply->elements[i], p, used);
+        }
+        return resp_build(resp, reply, p, used);
+    default:
+        break;
+    }
+    resp_parse_number(p + 1, (uint32_t)(end - p - 1), &value);
+    if (value < 0) {
+        reply->type = resp_type_null;
+        return end + 2;
+    }
+    reply->type     = (p[0] == '%') ? resp_type_map :
+        ((p[0] == '~') ? resp_type_set : ((p[0] == '>') ? resp_type_push : resp_type_array));
+    reply->count    = (uint32_t)value * ((p[0] == '%') ? 2 : 1);
+    reply->elements = resp->pool + *used;
+    *used += reply->count;
+    p = end + 2;
+    for (i = 0; i < reply->count; i++) {
+        p = resp_build(resp, &reply->elements[i], p, used);
+    }
+    return p;
+}
+
+static const char* resp_get_ptr(ringbuffer_t* rb, uint32_t size) {
+    if (ringbuffer_read_lock_size(rb) < size) {
+        /* 应答跨越绕回点，原地移动使其连续 */
+        ringbuffer_linearize(rb);
+        ringbuffer_read_lock_size(rb);
+    }
+    return ringbuffer_read_lock_ptr(rb);
+}
+
+int resp_update_recv(resp_t* resp, channel_ref_t* channel_ref) {
+    ringbuffer_t*   rb       = 0;
+    uint32_t        max_size = 0;
+    uint32_t        total    = 0;
+    uint32_t        used     = 0;
+    int             result   = 0;
+    resp_pending_t  pending;
+    assert(resp);
+    assert(channel_ref);
+    rb       = channel_ref_get_ringbuffer(channel_ref);
+    max_size = channel_ref_get_max_recv_ring_len(channel_ref);
+    while (!channel_ref_check_state(channel_ref, channel_state_close)) {
+        if (ringbuffer_empty(rb)) {
+            channel_ref_set_recv_lowat(channel_ref, 1);
+            break;
+        }
+        result = resp_scan(resp, rb, max_size);
+        if (result < 0) {
+            return error_resp_invalid;
+        }
+        if (!result) {
+            /* 应答不完整，下次从停止的位置继续扫描 */
+            channel_ref_set_recv_lowat(channel_ref, ringbuffer_available(rb) + 1);
+            break;
+        }
+        total = resp->scanned;
+        if (resp->pool_size < resp->nodes) {
+            if (resp->pool) {
+                destroy(resp->pool);
+            }
+            resp->pool_size = max(resp->nodes, 16);
+            resp->pool      = (resp_reply_t*)create_raw(sizeof(resp_reply_t) * resp->pool_size);
+            assert(resp->pool);
+        }
+        used = 1;
+        resp_build(resp, resp->pool, resp_get_ptr(rb, total), &used);
+        resp->scanned = 0;
+        resp->nodes   = 0;
+        resp->depth   = 0;
+        if ((resp->pool->type == resp_type_push) || !resp->pending_count) {
+            /* 推送或没有等待应答的命令 */
+            pending.cb   = resp->push_cb;
+            pending.data = resp->push_data;
+        } else {
+            pending = resp_pop_pending(resp);
+        }
+        if (pending.cb) {
+            pending.cb(channel_ref, resp->pool, pending.data);
+        }
+        /* 回调返回后应答失效 */
+        ringbuffer_read_lock_size(rb);
+        ringbuffer_read_commit(rb, total);
+    }
+    /* 读缓冲区有空间后恢复读事件 */
+    channel_ref_resume_recv(channel_ref);
+    return error_ok;
+}
+
+int resp_command_argv(channel_ref_t* channel_ref, resp_reply_cb_t cb, void* data, int argc, const char* argv[],
+    const uint32_t argv_size[]) {
+    int       i           = 0;
+    int       length      = 0;
+    uint32_t  size        = 16;
+    buffer_t* send_buffer = 0;
+    resp_t*   resp        = 0;
+    char      header[RESP_MAX_LINE];
+    assert(channel_ref);
+    assert(argv);
+    assert(argv_size);
+    resp = channel_ref_get_resp(channel_ref);
+    if (!resp || (argc <= 0)) {
+        return error_resp_invalid;
+    }
+    if (channel_ref_check_state(channel_ref, channel_state_close)) {
+        return error_already_close;
+    }
+    for (; i < argc; i++) {
+        size += argv_size[i] + 16;
+    }
+    /* *argc\r\n $len\r\narg\r\n ... 编码到一个缓冲区 */
+    send_buffer = buffer_create(size);
+    length = sprintf(header, "*%d\r\n", argc);
+    buffer_put(send_buffer, header, length);
+    for (i = 0; i < argc; i++) {
+        length = sprintf(header, "$%u\r\n", argv_size[i]);
+        buffer_put(send_buffer, header, length);
+        if (argv_size[i]) {
+            buffer_put(send_buffer, argv[i], argv_size[i]);
+        }
+        buffer_put(send_buffer, "\r\n", 2);
+    }
+    if (error_ok != channel_ref_queue_send(channel_ref, send_buffer)) {
+        return error_send_fail;
+    }
+    resp_push_pending(resp, cb, data);
+    return error_ok;
+}
+
+int resp_command(channel_ref_t* channel_ref, resp_reply_cb_t cb, void* data, const char* command) {
+    int         argc = 0;
+    const char* p    = 0;
+    const char* argv[RESP_MAX_ARGS];
+    uint32_t    argv_size[RESP_MAX_ARGS];
+    assert(channel_ref);
+    assert(command);
+    for (p = command; *p; ) {
+        if (*p == ' ') {
+            p++;
+            continue;
+        }
+        if (argc == RESP_MAX_ARGS) {
+            return error_resp_invalid;
+        }
+        argv[argc] = p;
+        for (; *p && (*p != ' '); p++);
+        argv_size[argc] = (uint32_t)(p - argv[argc]);
+        argc++;
+    }
+    return resp_command_argv(channel_ref, cb, data, argc, argv, argv_size);
+}
+
+uint32_t resp_get_pending_count(channel_ref_t* channel_ref) {
+    resp_t* resp = 0;
+    assert(channel_ref);
+    resp = channel_ref_get_resp(channel_ref);
+    return resp ? resp->pending_count : 0;
+}
+
+resp_type_e resp_reply_get_type(resp_reply_t* reply) {
+    assert(reply);
+    return reply->type;
+}
+
+const char* resp_reply_get_string(resp_reply_t* reply, uint32_t* size) {
+    assert(reply);
+    if (size) {
+        *size = reply->size;
+    }
+    return reply->str;
+}
+
+int64_t resp_reply_get_integer(resp_reply_t* reply) {
+    assert(reply);
+    return reply->integer;
+}
+
+uint32_t resp_reply_get_count(resp_reply_t* reply) {
+    assert(reply);
+    return reply->count;
+}
+
+resp_reply_t* resp_reply_get_element(resp_reply_t* reply, uint32_t index) {
+    assert(reply);
+    if (index >= reply->count) {
+        return 0;
+    }
+    return &reply->elements[index];
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RESP_H
+#define RESP_H
+
+#include "config.h"
+#include "resp_api.h"
+
+#define RESP_MAX_DEPTH 16 /* 嵌套最大深度 */
+#define RESP_MAX_ARGS 64  /* resp_command最大参数数量 */
+
+/*
+ * 创建RESP客户端
+ * @param push_cb 推送回调
+ * @param data 推送回调用户数据
+ * @return resp_t实例
+ */
+resp_t* resp_create(resp_reply_cb_t push_cb, void* data);
+
+/*
+ * 销毁RESP客户端
+ * @param resp resp_t实例
+ */
+void resp_destroy(resp_t* resp);
+
+/*
+ * 解析读缓冲区内的应答
+ * 应答未收齐时只扫描新到达的数据，收齐后按命令顺序回调
+ * @param resp resp_t实例
+ * @param channel_ref channel_ref_t实例
+ * @retval error_ok 成功
+ * @retval 其他 协议错误，需要关闭管道
+ */
+int resp_update_recv(resp_t* resp, channel_ref_t* channel_ref);
+
+/*
+ * 管道关闭，所有等待应答的回调以reply为0调用
+ * @param resp resp_t实例
+ * @param channel_ref channel_ref_t实例
+ */
+void resp_abort(resp_t* resp, channel_ref_t* channel_ref);
+
+#endif /* RESP_H */
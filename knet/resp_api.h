@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RESP_API_H
+#define RESP_API_H
+
+/*
+ * 发送命令
+ * 命令编码后放入发送链表，本次循环内的所有命令在下次写事件时通过聚合写一起发送.
+ * 应答按命令顺序匹配，回调的reply在回调返回后失效，管道关闭时未收到应答的回调以reply为0调用.
+ * 需要先调用channel_ref_set_resp，只能在管道所在线程调用
+ * @param channel_ref channel_ref_t实例
+ * @param cb 应答回调，可以为0
+ * @param data 回调用户数据
+ * @param argc 参数数量
+ * @param argv 参数数组
+ * @param argv_size 参数长度数组
+ * @retval error_ok 成功
+ * @retval error_send_fail 发送链表已达到最大长度限制，管道已关闭，cb不会被调用
+ * @retval 其他 失败
+ */
+int resp_command_argv(channel_ref_t* channel_ref, resp_reply_cb_t cb, void* data, int argc, const char* argv[],
+    const uint32_t argv_size[]);
+
+/*
+ * 发送以空格分隔参数的命令
+ * 例如"SET key value"，参数内不能包含空格
+ * @param channel_ref channel_ref_t实例
+ * @param cb 应答回调，可以为0
+ * @param data 回调用户数据
+ * @param command 命令
+ * @retval error_ok 成功
+ * @retval 其他 失败，参见resp_command_argv
+ */
+int resp_command(channel_ref_t* channel_ref, resp_reply_cb_t cb, void* data, const char* command);
+
+/*
+ * 取得等待应答的命令数量
+ * @param channel_ref channel_ref_t实例
+ * @return 命令数量
+ */
+uint32_t resp_get_pending_count(channel_ref_t* channel_ref);
+
+/*
+ * 取得应答类型
+ * @param reply resp_reply_t实例
+ * @return 类型
+ */
+resp_type_e resp_reply_get_type(resp_reply_t* reply);
+
+/*
+ * 取得字符串
+ * 适用于字符串、错误、二进制安全字符串、浮点数、大整数类型，指向读缓冲区，不以0结尾
+ * @param reply resp_reply_t实例
+ * @param size 长度
+ * @return 字符串
+ */
+const char* resp_reply_get_string(resp_reply_t* reply, uint32_t* size);
+
+/*
+ * 取得整数
+ * 适用于整数和布尔类型
+ * @param reply resp_reply_t实例
+ * @return 整数
+ */
+int64_t resp_reply_get_integer(resp_reply_t* reply);
+
+/*
+ * 取得元素数量
+ * 适用于数组、映射、集合、推送类型，映射的键和值各算一个元素
+ * @param reply resp_reply_t实例
+ * @return 元素数量
+ */
+uint32_t resp_reply_get_count(resp_reply_t* reply);
+
+/*
+ * 取得元素
+ * @param reply resp_reply_t实例
+ * @param index 下标
+ * @retval 0 下标越界
+ * @retval 非零 元素
+ */
+resp_reply_t* resp_reply_get_element(resp_reply_t* reply, uint32_t index);
+
+#endif /* RESP_API_H */
@@ -25,14 +25,33 @@
 #include <stdlib.h>
 #include "ringbuffer.h"
 
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define RINGBUFFER_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #include <emmintrin.h>
+    #define RINGBUFFER_SIMD_SSE2 1
+#endif /* defined(__AVX2__) */
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+    static __inline int ringbuffer_ctz(uint32_t mask) {
+        unsigned long index = 0;
+        _BitScanForward(&index, mask);
+        return (int)index;
+    }
+#else
+    #define ringbuffer_ctz(mask) __builtin_ctz(mask)
+#endif /* defined(_MSC_VER) */
+
 struct _ringbuffer_t {
-    char*    ptr;       /* ָ */
-    uint32_t read_pos;  /*  */
-    uint32_t write_pos; /* д */
-    uint32_t max_size;  /* 󳤶 */
-    uint32_t lock_size; /*  */
-    uint32_t lock_type; /* ͣ 1   2 д */
-    uint32_t count;     /* ɶݳ */
+    char*    ptr;       /* 缓冲区指针 */
+    uint32_t read_pos;  /* 读索引 */
+    uint32_t write_pos; /* 写索引 */
+    uint32_t max_size;  /* 最大长度 */
+    uint32_t lock_size; /* 锁定长度 */
+    uint32_t lock_type; /* 锁定类型， 1： 读锁定  2： 写锁定 */
+    uint32_t count;     /* 可读数据长度 */
 };
 
 ringbuffer_t* ringbuffer_create(uint32_t size) {
@@ -58,33 +77,56 @@ void ringbuffer_eat(ringbuffer_t* rb) {
 }
 
 uint32_t ringbuffer_read(ringbuffer_t* rb, char* buffer, uint32_t size) {
-    uint32_t i = 0;
     assert(rb);
     assert(buffer);
     assert(size);
-    size = min(rb->count, size);
-    for (; i < size; i++) {
-        buffer[i] = rb->ptr[rb->read_pos];
-        rb->read_pos = (rb->read_pos + 1) % rb->max_size;
-    }
+    size = ringbuffer_copy(rb, buffer, size);
+    rb->read_pos = (rb->read_pos + size) % rb->max_size;
     rb->count -= size;
     return size;
 }
 
 uint32_t ringbuffer_copy(ringbuffer_t* rb, char* buffer, uint32_t size) {
-    uint32_t i        = 0;
-    uint32_t read_pos = rb->read_pos;
+    uint32_t first = 0;
     assert(rb);
     assert(buffer);
     assert(size);
     size = min(rb->count, size);
-    for (; i < size; i++) {
-        buffer[i] = rb->ptr[read_pos];
-        read_pos = (read_pos + 1) % rb->max_size;
+    /* 最多分两段拷贝 */
+    first = min(size, rb->max_size - rb->read_pos);
+    memcpy(buffer, rb->ptr + rb->read_pos, first);
+    if (size > first) {
+        memcpy(buffer + first, rb->ptr, size - first);
     }
     return size;
 }
 
+int ringbuffer_read_segments(ringbuffer_t* rb, uint32_t offset, uint32_t size, char* ptr[2], uint32_t len[2]) {
+    uint32_t start = 0;
+    uint32_t first = 0;
+    assert(rb);
+    assert(ptr);
+    assert(len);
+    if (offset >= rb->count) {
+        return 0;
+    }
+    size = min(rb->count - offset, size);
+    if (!size) {
+        return 0;
+    }
+    start = (rb->read_pos + offset) % rb->max_size;
+    first = min(size, rb->max_size - start);
+    ptr[0] = rb->ptr + start;
+    len[0] = first;
+    if (size == first) {
+        return 1;
+    }
+    /* 跨越绕回点 */
+    ptr[1] = rb->ptr;
+    len[1] = size - first;
+    return 2;
+}
+
 uint32_t ringbuffer_available(ringbuffer_t* rb) {
     assert(rb);
     return rb->count;
@@ -148,6 +190,31 @@ uint32_t ringbuffer_write_lock_size(ringbuffer_t* rb) {
     return rb->lock_size;
 }
 
+int ringbuffer_write_lock_segments(ringbuffer_t* rb, char* ptr[2], uint32_t size[2]) {
+    int count = 0;
+    assert(rb);
+    if (ringbuffer_full(rb)) {
+        return 0;
+    }
+    rb->lock_type = 2;
+    ptr[0] = rb->ptr + rb->write_pos;
+    if (rb->write_pos >= rb->read_pos) {
+        /* 写索引到缓冲区末尾，以及缓冲区起始到读索引 */
+        size[0] = rb->max_size - rb->write_pos;
+        count = 1;
+        if (rb->read_pos) {
+            ptr[1]  = rb->ptr;
+            size[1] = rb->read_pos;
+            count = 2;
+        }
+    } else {
+        size[0] = rb->read_pos - rb->write_pos;
+        count = 1;
+    }
+    rb->lock_size = rb->max_size - rb->count;
+    return count;
+}
+
 char* ringbuffer_write_lock_ptr(ringbuffer_t* rb) {
     assert(rb);
     if (rb->lock_type != 2) {
@@ -184,3 +251,151 @@ uint32_t ringbuffer_get_max_size(ringbuffer_t* rb) {
     assert(rb);
     return rb->max_size;
 }
+
+int ringbuffer_resize(ringbuffer_t* rb, uint32_t size) {
+    char* ptr = 0;
+    assert(rb);
+    assert(size);
+    if (size < rb->count) {
+        return error_fail;
+    }
+    ptr = create_raw(size);
+    assert(ptr);
+    if (rb->count) {
+        /* 拷贝到新缓冲区起始位置，消除绕回 */
+        ringbuffer_copy(rb, ptr, rb->count);
+    }
+    destroy(rb->ptr);
+    rb->ptr       = ptr;
+    rb->max_size  = size;
+    rb->read_pos  = 0;
+    rb->write_pos = rb->count % size;
+    rb->lock_size = 0;
+    rb->lock_type = 0;
+    return error_ok;
+}
+
+int ringbuffer_find_contiguous(const char* ptr, uint32_t length, const char* delim, uint32_t size) {
+    uint32_t i = 0;
+#if RINGBUFFER_SIMD_AVX2
+    __m256i first = _mm256_set1_epi8(delim[0]);
+    __m256i last  = _mm256_set1_epi8(delim[size - 1]);
+    /* 同时比较分隔符首尾字节，过滤后再逐个确认 */
+    for (; i + size - 1 + 32 <= length; i += 32) {
+        __m256i  head = _mm256_loadu_si256((const __m256i*)(ptr + i));
+        __m256i  tail = _mm256_loadu_si256((const __m256i*)(ptr + i + size - 1));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last)));
+        while (mask) {
+            int bit = ringbuffer_ctz(mask);
+            if (!memcmp(ptr + i + bit, delim, size)) {
+                return (int)i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+#elif RINGBUFFER_SIMD_SSE2
+    __m128i first = _mm_set1_epi8(delim[0]);
+    __m128i last  = _mm_set1_epi8(delim[size - 1]);
+    /* 同时比较分隔符首尾字节，过滤后再逐个确认 */
+    for (; i + size - 1 + 16 <= length; i += 16) {
+        __m128i  head = _mm_loadu_si128((const __m128i*)(ptr + i));
+        __m128i  tail = _mm_loadu_si128((const __m128i*)(ptr + i + size - 1));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(
+            _mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)));
+        while (mask) {
+            int bit = ringbuffer_ctz(mask);
+            if (!memcmp(ptr + i + bit, delim, size)) {
+                return (int)i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif /* RINGBUFFER_SIMD_AVX2 */
+    /* 剩余部分或不支持SIMD */
+    for (; i + size <= length; i++) {
+        if ((ptr[i] == delim[0]) && !memcmp(ptr + i, delim, size)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int ringbuffer_find(ringbuffer_t* rb, const char* delim, uint32_t size) {
+    return ringbuffer_find_offset(rb, 0, delim, size);
+}
+
+int ringbuffer_find_offset(ringbuffer_t* rb, uint32_t offset, const char* delim, uint32_t size) {
+    uint32_t start  = 0; /* 查找起始位置 */
+    uint32_t count  = 0; /* 查找范围长度 */
+    uint32_t first  = 0; /* 第一段长度 */
+    uint32_t second = 0; /* 绕回后第二段长度 */
+    uint32_t i      = 0;
+    uint32_t j      = 0;
+    int      pos    = 0;
+    assert(rb);
+    assert(delim);
+    if ((offset >= rb->count) || !size || (size > rb->count - offset)) {
+        return -1;
+    }
+    start  = (rb->read_pos + offset) % rb->max_size;
+    count  = rb->count - offset;
+    first  = min(count, rb->max_size - start);
+    second = count - first;
+    /* 完全位于第一段内 */
+    pos = ringbuffer_find_contiguous(rb->ptr + start, first, delim, size);
+    if (pos >= 0) {
+        return (int)offset + pos;
+    }
+    if (!second) {
+        return -1;
+    }
+    /* 跨越绕回点 */
+    i = (first >= size) ? (first - size + 1) : 0;
+    for (; (i < first) && (i + size <= count); i++) {
+        for (j = 0; j < size; j++) {
+            if (rb->ptr[(start + i + j) % rb->max_size] != delim[j]) {
+                break;
+            }
+        }
+        if (j == size) {
+            return (int)(offset + i);
+        }
+    }
+    /* 完全位于第二段内 */
+    pos = ringbuffer_find_contiguous(rb->ptr, second, delim, size);
+    if (pos >= 0) {
+        return (int)(offset + first) + pos;
+    }
+    return -1;
+}
+
+static void ringbuffer_reverse(char* ptr, uint32_t size) {
+    char     c = 0;
+    uint32_t i = 0;
+    for (; i < size / 2; i++) {
+        c = ptr[i];
+        ptr[i] = ptr[size - i - 1];
+        ptr[size - i - 1] = c;
+    }
+}
+
+void ringbuffer_linearize(ringbuffer_t* rb) {
+    assert(rb);
+    if (!rb->read_pos) {
+        return;
+    }
+    if (rb->read_pos + rb->count <= rb->max_size) {
+        /* 未绕回，移动到缓冲区起始位置 */
+        memmove(rb->ptr, rb->ptr + rb->read_pos, rb->count);
+    } else {
+        /* 已绕回，原地循环左移read_pos字节 */
+        ringbuffer_reverse(rb->ptr, rb->read_pos);
+        ringbuffer_reverse(rb->ptr + rb->read_pos, rb->max_size - rb->read_pos);
+        ringbuffer_reverse(rb->ptr, rb->max_size);
+    }
+    rb->read_pos  = 0;
+    rb->write_pos = rb->count % rb->max_size;
+    rb->lock_size = 0;
+    rb->lock_type = 0;
+}
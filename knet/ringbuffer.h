@@ -28,112 +28,170 @@
 #include "config.h"
 
 /*
- * һringbuffer
- * @param size 󳤶
- * @return ringbuffer_tʵ
+ * 建立一个ringbuffer
+ * @param size 最大长度
+ * @return ringbuffer_t实例
  */
 ringbuffer_t* ringbuffer_create(uint32_t size);
 
 /*
- * ringbuffer
- * @param rb ringbuffer_tʵ
+ * 销毁ringbuffer
+ * @param rb ringbuffer_t实例
  */
 void ringbuffer_destroy(ringbuffer_t* rb);
 
 /*
- * ȡ
- * @param rb ringbuffer_tʵ
- * @param buffer д뻺ָ
- * @param size д뻺
- * @return ʵʶֽ
+ * 读取并清除
+ * @param rb ringbuffer_t实例
+ * @param buffer 写入缓冲区指针
+ * @param size 写入缓冲区长度
+ * @return 实际读出字节数
  */
 uint32_t ringbuffer_read(ringbuffer_t* rb, char* buffer, uint32_t size);
 
 /*
- * ȡ
- * @param rb ringbuffer_tʵ
- * @param buffer д뻺ָ
- * @param size д뻺
- * @return ʵʶֽ
+ * 读取但不清除
+ * @param rb ringbuffer_t实例
+ * @param buffer 写入缓冲区指针
+ * @param size 写入缓冲区长度
+ * @return 实际读出字节数
  */
 uint32_t ringbuffer_copy(ringbuffer_t* rb, char* buffer, uint32_t size);
 
 /*
- * ȡÿɶֽ
- * @param rb ringbuffer_tʵ
- * @return ɶֽ
+ * 取得可读数据内一段区域的地址，不拷贝也不清除
+ * @param rb ringbuffer_t实例
+ * @param offset 相对于读位置的偏移
+ * @param size 区域长度，超过可读数据时截断
+ * @param ptr 区域起始指针数组
+ * @param len 区域长度数组
+ * @return 区域数量(0, 1, 2)，跨越绕回点时为2
+ */
+int ringbuffer_read_segments(ringbuffer_t* rb, uint32_t offset, uint32_t size, char* ptr[2], uint32_t len[2]);
+
+/*
+ * 在可读数据内查找分隔符，不拷贝数据, 分隔符可以跨越绕回点
+ * @param rb ringbuffer_t实例
+ * @param delim 分隔符
+ * @param size 分隔符长度
+ * @retval -1 未找到
+ * @retval >=0 分隔符起始位置相对于可读数据起始位置的偏移
+ */
+int ringbuffer_find(ringbuffer_t* rb, const char* delim, uint32_t size);
+
+/*
+ * 从指定偏移开始查找分隔符，用于增量查找时跳过已经查找过的数据
+ * @param rb ringbuffer_t实例
+ * @param offset 相对于可读数据起始位置的偏移
+ * @param delim 分隔符
+ * @param size 分隔符长度
+ * @retval -1 未找到
+ * @retval >=0 分隔符起始位置相对于可读数据起始位置的偏移
+ */
+int ringbuffer_find_offset(ringbuffer_t* rb, uint32_t offset, const char* delim, uint32_t size);
+
+/*
+ * 将可读数据移动到缓冲区起始位置，使其连续
+ * 原地移动，不分配内存
+ * @param rb ringbuffer_t实例
+ */
+void ringbuffer_linearize(ringbuffer_t* rb);
+
+/*
+ * 取得可读字节数
+ * @param rb ringbuffer_t实例
+ * @return 可读字节数
  */
 uint32_t ringbuffer_available(ringbuffer_t* rb);
 
 /*
- * пɶֽ
- * @param rb ringbuffer_tʵ
+ * 清除所有可读字节
+ * @param rb ringbuffer_t实例
  */
 void ringbuffer_eat(ringbuffer_t* rb);
 
 /*
- * ȡ÷ƻַɶֽ
- * @param rb ringbuffer_tʵ
- * @return ƻַɶֽ
+ * 取得非绕回连续地址的最大可读字节数
+ * @param rb ringbuffer_t实例
+ * @return 非绕回连续地址的最大可读字节数
  */
 uint32_t ringbuffer_read_lock_size(ringbuffer_t* rb);
 
 /*
- * ȡÿɶָֹ
- * @param rb ringbuffer_tʵ
- * @return ɶָֹ
+ * 取得可读数据起止指针
+ * @param rb ringbuffer_t实例
+ * @return 可读数据起止指针
  */
 char* ringbuffer_read_lock_ptr(ringbuffer_t* rb);
 
 /*
- * ύѾֽ
- * @param rb ringbuffer_tʵ
- * @param size Ѿֽ
+ * 提交并清除已经读到的字节
+ * @param rb ringbuffer_t实例
+ * @param size 已经读出的字节数
  */
 void ringbuffer_read_commit(ringbuffer_t* rb, uint32_t size);
 
 /*
- * ȡ÷ƻؿд󳤶
- * @param rb ringbuffer_tʵ
- * @return ƻؿд󳤶
+ * 取得非绕回可连续写入的最大长度
+ * @param rb ringbuffer_t实例
+ * @return 非绕回可连续写入的最大长度
  */
 uint32_t ringbuffer_write_lock_size(ringbuffer_t* rb);
 
 /*
- * ȡÿдָֹ
- * @param rb ringbuffer_tʵ
- * @return дָֹ
+ * 取得所有可写区域，绕回时为两段，用于一次性分散读入(readv)
+ * 调用后使用ringbuffer_write_commit提交实际写入的总字节数
+ * @param rb ringbuffer_t实例
+ * @param ptr 可写区域起始指针数组
+ * @param size 可写区域长度数组
+ * @return 可写区域数量, 0表示缓冲区已满
+ */
+int ringbuffer_write_lock_segments(ringbuffer_t* rb, char* ptr[2], uint32_t size[2]);
+
+/*
+ * 取得可写起止指针
+ * @param rb ringbuffer_t实例
+ * @return 可写起止指针
  */
 char* ringbuffer_write_lock_ptr(ringbuffer_t* rb);
 
 /*
- * ύɹдֽ
- * @param rb ringbuffer_tʵ
- * @param size ɹдֽ
+ * 提交成功写入的字节数
+ * @param rb ringbuffer_t实例
+ * @param size 成功写入的字节数
  */
 void ringbuffer_write_commit(ringbuffer_t* rb, uint32_t size);
 
 /*
- * 
- * @param rb ringbuffer_tʵ
- * @retval 0 δ
- * @retval  
+ * 满
+ * @param rb ringbuffer_t实例
+ * @retval 0 未满
+ * @retval 非零 满
  */
 int ringbuffer_full(ringbuffer_t* rb);
 
 /*
- * 
- * @param rb ringbuffer_tʵ
- * @retval 0 ǿ
- * @retval  
+ * 空
+ * @param rb ringbuffer_t实例
+ * @retval 0 非空
+ * @retval 非零 空
  */
 int ringbuffer_empty(ringbuffer_t* rb);
 
 /*
- * ȡ󳤶
- * @param rb ringbuffer_tʵ
- * @return 󳤶
+ * 取得最大长度
+ * @param rb ringbuffer_t实例
+ * @return 最大长度
  */
 uint32_t ringbuffer_get_max_size(ringbuffer_t* rb);
 
+/*
+ * 调整最大长度，已有数据保持顺序不变
+ * @param rb ringbuffer_t实例
+ * @param size 新的最大长度，不能小于当前可读字节数
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int ringbuffer_resize(ringbuffer_t* rb, uint32_t size);
+
 #endif /* RINGBUFFER_H */
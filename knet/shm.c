@@ -0,0 +1,530 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* syscall */
+#endif /* defined(__linux__) && !defined(_GNU_SOURCE) */
+
+#include "shm.h"
+
+#if defined(__linux__)
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 1U
+#endif /* MFD_CLOEXEC */
+
+#define SHM_MAGIC 0x4b4e4554            /* 段头部标识 */
+#define SHM_CACHE_LINE 64               /* 缓存行长度，生产者和消费者各自修改的字段不共享缓存行 */
+#define SHM_MIN_RING_SIZE 4096          /* 环最小长度 */
+#define SHM_MAX_RING_SIZE (1 << 30)     /* 环最大长度 */
+#define shm_barrier() __sync_synchronize()
+
+typedef struct _shm_ring_t {
+    volatile uint32_t head;     /* 读位置，只由消费者修改 */
+    char              pad0[SHM_CACHE_LINE - sizeof(uint32_t)];
+    volatile uint32_t tail;     /* 写位置，只由生产者修改 */
+    char              pad1[SHM_CACHE_LINE - sizeof(uint32_t)];
+    volatile uint32_t sleeping; /* 消费者已读空，下次写入时需要敲门铃 */
+    volatile uint32_t blocked;  /* 生产者等待空间，下次读取后需要敲门铃 */
+    volatile uint32_t closed;   /* 生产者已关闭 */
+    char              pad2[SHM_CACHE_LINE - 3 * sizeof(uint32_t)];
+} shm_ring_t;
+
+typedef struct _shm_header_t {
+    uint32_t   magic;     /* 段头部标识 */
+    uint32_t   ring_size; /* 每个环的长度 */
+    char       pad[SHM_CACHE_LINE - 2 * sizeof(uint32_t)];
+    shm_ring_t ring[2];   /* 第一端写ring[0]读ring[1]，第二端相反，数据区按相同顺序跟随在段头部之后 */
+} shm_header_t;
+
+struct _shm_t {
+    shm_header_t* header;   /* 映射的共享内存段 */
+    size_t        map_size; /* 映射长度 */
+    int           side;     /* 0为第一端，1为第二端 */
+    int           memfd;    /* 共享内存段描述符，传递给其他进程时使用 */
+    int           fd;       /* 本端门铃 */
+    int           peer_fd;  /* 对端门铃 */
+    uint32_t      mask;     /* 环长度 - 1 */
+    shm_ring_t*   in;       /* 读环 */
+    char*         in_data;  /* 读环数据区 */
+    shm_ring_t*   out;      /* 写环 */
+    char*         out_data; /* 写环数据区 */
+    uint32_t      spin;     /* 读空后继续轮询的次数，0为不轮询 */
+    uint32_t      idle;     /* 连续读空的次数 */
+    int           polling;  /* 读空后未等待门铃，需要继续轮询 */
+};
+
+static int shm_memfd_create() {
+#if defined(SYS_memfd_create)
+    return (int)syscall(SYS_memfd_create, "knet-shm", MFD_CLOEXEC);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif /* defined(SYS_memfd_create) */
+}
+
+/*
+ * 映射共享内存段并校验段头部，成功后描述符的所有权转移给shm_t
+ */
+static shm_t* shm_attach(int memfd, int side, int fd, int peer_fd) {
+    struct stat   st;
+    void*         base      = 0;
+    shm_header_t* header    = 0;
+    shm_t*        shm       = 0;
+    uint32_t      ring_size = 0;
+    memset(&st, 0, sizeof(st));
+    if (fstat(memfd, &st) || (st.st_size < (off_t)sizeof(shm_header_t))) {
+        return 0;
+    }
+    base = mmap(0, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (base == MAP_FAILED) {
+        return 0;
+    }
+    header    = (shm_header_t*)base;
+    ring_size = header->ring_size;
+    if ((header->magic != SHM_MAGIC) || (ring_size < SHM_MIN_RING_SIZE) || (ring_size > SHM_MAX_RING_SIZE) ||
+        (ring_size & (ring_size - 1)) || ((off_t)(sizeof(shm_header_t) + 2 * (size_t)ring_size) != st.st_size)) {
+        /* 不是shm_create_pair创建的段 */
+        munmap(base, (size_t)st.st_size);
+        return 0;
+    }
+    shm = create(shm_t);
+    assert(shm);
+    memset(shm, 0, sizeof(shm_t));
+    shm->header   = header;
+    shm->map_size = (size_t)st.st_size;
+    shm->side     = side;
+    shm->memfd    = memfd;
+    shm->fd       = fd;
+    shm->peer_fd  = peer_fd;
+    shm->mask     = ring_size - 1;
+    shm->out      = &header->ring[side];
+    shm->out_data = (char*)base + sizeof(shm_header_t) + (size_t)side * ring_size;
+    shm->in       = &header->ring[1 - side];
+    shm->in_data  = (char*)base + sizeof(shm_header_t) + (size_t)(1 - side) * ring_size;
+    return shm;
+}
+
+static void shm_close_fd(int fd) {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+int shm_create_pair(uint32_t ring_size, shm_t* pair[2]) {
+    shm_header_t header;
+    uint32_t     size  = SHM_MIN_RING_SIZE;
+    int          memfd = -1;
+    int          fd[2] = {-1, -1};
+    assert(pair);
+    pair[0] = 0;
+    pair[1] = 0;
+    while ((size < ring_size) && (size < SHM_MAX_RING_SIZE)) {
+        size <<= 1;
+    }
+    memfd = shm_memfd_create();
+    if (memfd < 0) {
+        return error_shm_create;
+    }
+    if (ftruncate(memfd, (off_t)(sizeof(shm_header_t) + 2 * (size_t)size))) {
+        goto error_return;
+    }
+    /* 写入段头部，两端的消费者初始都在等待门铃，对端管道创建前写入的数据在创建后触发读事件 */
+    memset(&header, 0, sizeof(header));
+    header.magic     = SHM_MAGIC;
+    header.ring_size = size;
+    header.ring[0].sleeping = 1;
+    header.ring[1].sleeping = 1;
+    if (pwrite(memfd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        goto error_return;
+    }
+    fd[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    fd[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((fd[0] < 0) || (fd[1] < 0)) {
+        goto error_return;
+    }
+    /* 每端持有各自的描述符，可以独立关闭 */
+    pair[1] = shm_attach(dup(memfd), 1, dup(fd[1]), dup(fd[0]));
+    if (!pair[1]) {
+        goto error_return;
+    }
+    pair[0] = shm_attach(memfd, 0, fd[0], fd[1]);
+    if (!pair[0]) {
+        shm_destroy(pair[1]);
+        pair[1] = 0;
+        goto error_return;
+    }
+    return error_ok;
+error_return:
+    shm_close_fd(memfd);
+    shm_close_fd(fd[0]);
+    shm_close_fd(fd[1]);
+    return error_shm_create;
+}
+
+int shm_send(shm_t* shm, socket_t socket_fd) {
+    struct msghdr   msg;
+    struct iovec    iov;
+    struct cmsghdr* cmsg = 0;
+    uint32_t        side = 0;
+    int             fds[3];
+    char            control[CMSG_SPACE(sizeof(fds))];
+    ssize_t         bytes = 0;
+    assert(shm);
+    assert(shm->fd >= 0);
+    memset(&msg, 0, sizeof(msg));
+    memset(control, 0, sizeof(control));
+    side         = (uint32_t)shm->side;
+    fds[0]       = shm->memfd;
+    fds[1]       = shm->fd;
+    fds[2]       = shm->peer_fd;
+    iov.iov_base = &side;
+    iov.iov_len  = sizeof(side);
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control;
+    msg.msg_controllen = sizeof(control);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    do {
+        bytes = sendmsg(socket_fd, &msg, MSG_NOSIGNAL);
+    } while ((bytes < 0) && (errno == EINTR));
+    if (bytes != (ssize_t)sizeof(side)) {
+        return error_shm_transfer;
+    }
+    /* 描述符已复制到对方进程 */
+    shm_destroy(shm);
+    return error_ok;
+}
+
+shm_t* shm_recv(socket_t socket_fd) {
+    struct msghdr   msg;
+    struct iovec    iov;
+    struct cmsghdr* cmsg  = 0;
+    uint32_t        side  = 0;
+    int             count = 0;
+    int             i     = 0;
+    int             fds[3];
+    char            control[CMSG_SPACE(sizeof(fds))];
+    ssize_t         bytes = 0;
+    shm_t*          shm   = 0;
+    memset(&msg, 0, sizeof(msg));
+    memset(control, 0, sizeof(control));
+    iov.iov_base = &side;
+    iov.iov_len  = sizeof(side);
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control;
+    msg.msg_controllen = sizeof(control);
+    do {
+        bytes = recvmsg(socket_fd, &msg, MSG_CMSG_CLOEXEC);
+    } while ((bytes < 0) && (errno == EINTR));
+    if (bytes < 0) {
+        return 0;
+    }
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS)) {
+            count = (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            count = min(count, 3);
+            memcpy(fds, CMSG_DATA(cmsg), count * sizeof(int));
+            break;
+        }
+    }
+    if ((bytes == (ssize_t)sizeof(side)) && (count == 3) && (side < 2) && !(msg.msg_flags & MSG_CTRUNC)) {
+        shm = shm_attach(fds[0], (int)side, fds[1], fds[2]);
+    }
+    if (!shm) {
+        for (i = 0; i < count; i++) {
+            close(fds[i]);
+        }
+    }
+    return shm;
+}
+
+void shm_destroy(shm_t* shm) {
+    assert(shm);
+    if (shm->fd >= 0) {
+        shm_close_fd(shm->fd);
+        shm_close_fd(shm->peer_fd);
+    }
+    munmap(shm->header, shm->map_size);
+    close(shm->memfd);
+    destroy(shm);
+}
+
+void shm_set_spin(shm_t* shm, uint32_t spin) {
+    assert(shm);
+    shm->spin = spin;
+    shm->idle = 0;
+}
+
+socket_t shm_get_fd(shm_t* shm) {
+    assert(shm);
+    return shm->fd;
+}
+
+int shm_check_polling(shm_t* shm) {
+    assert(shm);
+    return shm->polling;
+}
+
+int shm_read_segments(shm_t* shm, char* ptr[], uint32_t size[], int count) {
+    shm_ring_t* ring   = 0;
+    uint32_t    head   = 0;
+    uint32_t    avail  = 0;
+    uint32_t    offset = 0;
+    uint32_t    first  = 0;
+    uint32_t    n      = 0;
+    uint32_t    bytes  = 0;
+    int         i      = 0;
+    int         sleep  = 0;
+    eventfd_t   value  = 0;
+    assert(shm);
+    assert(ptr);
+    assert(size);
+    ring = shm->in;
+    head = ring->head;
+    for (;;) {
+        avail = ring->tail - head;
+        /* 读取写位置之后才能读取数据 */
+        shm_barrier();
+        for (; avail && (i < count); avail -= n) {
+            n = min(avail, size[i] - offset);
+            first = min(n, shm->mask + 1 - (head & shm->mask));
+            memcpy(ptr[i] + offset, shm->in_data + (head & shm->mask), first);
+            memcpy(ptr[i] + offset + first, shm->in_data, n - first);
+            head   += n;
+            bytes  += n;
+            offset += n;
+            if (offset == size[i]) {
+                i++;
+                offset = 0;
+            }
+        }
+        if (head != ring->head) {
+            /* 数据读取完毕后才能更新读位置 */
+            shm_barrier();
+            ring->head = head;
+        }
+        if ((i >= count) || sleep) {
+            break;
+        }
+        if (shm->spin) {
+            shm->idle = bytes ? 0 : (shm->idle + 1);
+            if (shm->idle <= shm->spin) {
+                /* 轮询中，不等待门铃，由调用者下次循环继续读取 */
+                shm->polling = 1;
+                break;
+            }
+        }
+        shm->polling = 0;
+        /* 已读空，清除门铃后通知生产者下次写入时敲门铃，再检查一次避免遗漏通知前写入的数据 */
+        eventfd_read(shm->fd, &value);
+        ring->sleeping = 1;
+        sleep = 1;
+        shm_barrier();
+    }
+    if (bytes) {
+        shm_barrier();
+        if (ring->blocked && __sync_lock_test_and_set(&ring->blocked, 0)) {
+            /* 生产者在等待空间 */
+            eventfd_write(shm->peer_fd, 1);
+        }
+        if (sleep && ring->closed) {
+            /* 关闭时敲响的门铃可能已被清除，重新敲响本端门铃，下次读取时返回关闭 */
+            eventfd_write(shm->fd, 1);
+        }
+        return (int)bytes;
+    }
+    if (ring->closed) {
+        /* 关闭标志在最后一次写入之后设置 */
+        shm_barrier();
+        if (ring->tail == head) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int shm_write_segments(shm_t* shm, const char* ptr[], uint32_t size[], int count) {
+    shm_ring_t* ring   = 0;
+    uint32_t    tail   = 0;
+    uint32_t    space  = 0;
+    uint32_t    offset = 0;
+    uint32_t    first  = 0;
+    uint32_t    n      = 0;
+    uint32_t    bytes  = 0;
+    int         i      = 0;
+    int         block  = 0;
+    assert(shm);
+    assert(ptr);
+    assert(size);
+    if (shm->in->closed) {
+        /* 对端已关闭 */
+        return -1;
+    }
+    ring = shm->out;
+    tail = ring->tail;
+    for (;;) {
+        space = shm->mask + 1 - (tail - ring->head);
+        /* 读取读位置之后才能覆盖数据 */
+        shm_barrier();
+        for (; space && (i < count); space -= n) {
+            n = min(space, size[i] - offset);
+            first = min(n, shm->mask + 1 - (tail & shm->mask));
+            memcpy(shm->out_data + (tail & shm->mask), ptr[i] + offset, first);
+            memcpy(shm->out_data, ptr[i] + offset + first, n - first);
+            tail   += n;
+            bytes  += n;
+            offset += n;
+            if (offset == size[i]) {
+                i++;
+                offset = 0;
+            }
+        }
+        if (tail != ring->tail) {
+            /* 数据写入完毕后才能更新写位置 */
+            shm_barrier();
+            ring->tail = tail;
+        }
+        if (i >= count) {
+            if (block) {
+                ring->blocked = 0;
+            }
+            break;
+        }
+        if (block) {
+            break;
+        }
+        /* 写环已满，通知消费者读取后敲门铃，再检查一次避免遗漏通知前释放的空间 */
+        ring->blocked = 1;
+        block = 1;
+        shm_barrier();
+    }
+    if (bytes) {
+        shm_barrier();
+        if (ring->sleeping && __sync_lock_test_and_set(&ring->sleeping, 0)) {
+            /* 消费者已读空，在等待门铃 */
+            eventfd_write(shm->peer_fd, 1);
+        }
+    }
+    return (int)bytes;
+}
+
+void shm_notify(shm_t* shm) {
+    assert(shm);
+    if (shm->fd >= 0) {
+        eventfd_write(shm->fd, 1);
+    }
+}
+
+void shm_close(shm_t* shm) {
+    assert(shm);
+    if (shm->fd < 0) {
+        return;
+    }
+    /* 对端读完剩余数据后关闭 */
+    shm_barrier();
+    shm->out->closed = 1;
+    shm_barrier();
+    eventfd_write(shm->peer_fd, 1);
+    shm_close_fd(shm->fd);
+    shm_close_fd(shm->peer_fd);
+    shm->fd      = -1;
+    shm->peer_fd = -1;
+}
+
+#else
+
+int shm_create_pair(uint32_t ring_size, shm_t* pair[2]) {
+    ring_size;
+    assert(pair);
+    pair[0] = 0;
+    pair[1] = 0;
+    return error_shm_create;
+}
+
+int shm_send(shm_t* shm, socket_t socket_fd) {
+    shm;
+    socket_fd;
+    return error_shm_transfer;
+}
+
+shm_t* shm_recv(socket_t socket_fd) {
+    socket_fd;
+    return 0;
+}
+
+void shm_destroy(shm_t* shm) {
+    shm;
+}
+
+void shm_set_spin(shm_t* shm, uint32_t spin) {
+    shm;
+    spin;
+}
+
+socket_t shm_get_fd(shm_t* shm) {
+    shm;
+    return 0;
+}
+
+int shm_check_polling(shm_t* shm) {
+    shm;
+    return 0;
+}
+
+int shm_read_segments(shm_t* shm, char* ptr[], uint32_t size[], int count) {
+    shm;
+    ptr;
+    size;
+    count;
+    return -1;
+}
+
+int shm_write_segments(shm_t* shm, const char* ptr[], uint32_t size[], int count) {
+    shm;
+    ptr;
+    size;
+    count;
+    return -1;
+}
+
+void shm_notify(shm_t* shm) {
+    shm;
+}
+
+void shm_close(shm_t* shm) {
+    shm;
+}
+
+#endif /* defined(__linux__) */
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SHM_H
+#define SHM_H
+
+#include "config.h"
+#include "shm_api.h"
+
+/*
+ * 取得本端门铃，作为管道套接字注册到选取器
+ * @param shm shm_t实例
+ * @return 门铃（eventfd）
+ */
+socket_t shm_get_fd(shm_t* shm);
+
+/*
+ * 检查读空后是否仍在轮询
+ * @param shm shm_t实例
+ * @retval 0 已等待门铃
+ * @retval 非零 未等待门铃，需要下次循环继续读取
+ */
+int shm_check_polling(shm_t* shm);
+
+/*
+ * 从读环读取到多个区域
+ * 读空后（轮询模式下连续读空超过轮询次数后）通知生产者下次写入时敲门铃，读取后生产者等待空间时敲对端门铃
+ * @param shm shm_t实例
+ * @param ptr 区域起始指针数组
+ * @param size 区域长度数组
+ * @param count 区域数量
+ * @retval >0 读取的字节数
+ * @retval 0 读环为空
+ * @retval <0 对端已关闭且读环为空
+ */
+int shm_read_segments(shm_t* shm, char* ptr[], uint32_t size[], int count);
+
+/*
+ * 将多个区域写入写环
+ * 写环空间不足时只写入能容纳的部分，并通知对端读取后敲门铃
+ * @param shm shm_t实例
+ * @param ptr 区域起始指针数组
+ * @param size 区域长度数组
+ * @param count 区域数量
+ * @retval >=0 写入的字节数
+ * @retval <0 对端已关闭
+ */
+int shm_write_segments(shm_t* shm, const char* ptr[], uint32_t size[], int count);
+
+/*
+ * 敲本端门铃，读环内已有数据但未触发门铃时使用
+ * @param shm shm_t实例
+ */
+void shm_notify(shm_t* shm);
+
+/*
+ * 关闭本端，通知对端读取剩余数据后关闭，并关闭门铃
+ * @param shm shm_t实例
+ */
+void shm_close(shm_t* shm);
+
+#endif /* SHM_H */
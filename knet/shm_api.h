@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SHM_API_H
+#define SHM_API_H
+
+#include "config.h"
+
+/*
+ * 创建共享内存管道的两端
+ * 共享内存段（memfd）内包含两个方向的单生产者单消费者无锁环，每端各有一个门铃（eventfd），
+ * 只在消费者读空后等待或生产者等待空间时才敲门铃. 两端分别通过loop_create_shm_channel创建管道，
+ * 也可以通过shm_send将其中一端传递给其他进程. 只支持Linux
+ * @param ring_size 每个方向环的长度，向上取整为2的幂，最小4096
+ * @param pair 两端的shm_t实例
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int shm_create_pair(uint32_t ring_size, shm_t* pair[2]);
+
+/*
+ * 通过已连接的UNIX域套接字将一端传递给其他进程（SCM_RIGHTS），阻塞直至发送完毕
+ * 成功后本地shm_t实例被销毁
+ * @param shm shm_t实例，未创建管道
+ * @param socket_fd 已连接的UNIX域套接字
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int shm_send(shm_t* shm, socket_t socket_fd);
+
+/*
+ * 通过已连接的UNIX域套接字接收其他进程传递的一端，阻塞直至接收完毕
+ * @param socket_fd 已连接的UNIX域套接字
+ * @return shm_t实例，失败返回0
+ */
+shm_t* shm_recv(socket_t socket_fd);
+
+/*
+ * 设置读空后继续轮询的次数
+ * 轮询期间管道留在loop就绪链表内，loop不再阻塞等待，对端写入时不需要敲门铃，
+ * 以独占一个CPU为代价换取更低的延迟. 连续读空超过轮询次数后恢复等待门铃
+ * @param shm shm_t实例
+ * @param spin 连续读空的loop循环次数，0为不轮询（默认）
+ */
+void shm_set_spin(shm_t* shm, uint32_t spin);
+
+/*
+ * 销毁未创建管道的shm_t实例，已创建管道的实例由管道销毁
+ * @param shm shm_t实例
+ */
+void shm_destroy(shm_t* shm);
+
+#endif /* SHM_API_H */
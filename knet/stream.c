@@ -51,15 +51,20 @@ int stream_available(stream_t* stream) {
 }
 
 int stream_pop(stream_t* stream, char* buffer, int size) {
+    int bytes = 0;
     assert(stream);
     assert(buffer);
     assert(size);
-    return ringbuffer_read(channel_ref_get_ringbuffer(stream->channel_ref), buffer, size);
+    bytes = ringbuffer_read(channel_ref_get_ringbuffer(stream->channel_ref), buffer, size);
+    /* 读缓冲区有空间后恢复读事件 */
+    channel_ref_resume_recv(stream->channel_ref);
+    return bytes;
 }
 
 void stream_eat(stream_t* stream) {
     assert(stream);
     ringbuffer_eat(channel_ref_get_ringbuffer(stream->channel_ref));
+    channel_ref_resume_recv(stream->channel_ref);
 }
 
 int stream_push(stream_t* stream, char* buffer, int size) {
@@ -75,3 +80,10 @@ int stream_copy(stream_t* stream, char* buffer, int size) {
     assert(size);
     return ringbuffer_copy(channel_ref_get_ringbuffer(stream->channel_ref), buffer, size);
 }
+
+int stream_find(stream_t* stream, const char* delim, int size) {
+    assert(stream);
+    assert(delim);
+    assert(size);
+    return ringbuffer_find(channel_ref_get_ringbuffer(stream->channel_ref), delim, (uint32_t)size);
+}
@@ -28,43 +28,54 @@
 #include "config.h"
 
 /*
- * ȡڿɶֽ
- * @param stream stream_tʵ
- * @return ɶֽ
+ * 取得数据流内可读字节数
+ * @param stream stream_t实例
+ * @return 可读字节数
  */
 int stream_available(stream_t* stream);
 
 /*
- * 
- * @param stream stream_tʵ
+ * 清空数据流
+ * @param stream stream_t实例
  */
 void stream_eat(stream_t* stream);
 
 /*
- * ڶȡݲ
- * @param stream stream_tʵ
- * @param buffer 
- * @param size С
- * @return ֽ
+ * 从数据流内读取数据并清除数据
+ * @param stream stream_t实例
+ * @param buffer 缓冲区
+ * @param size 缓冲区大小
+ * @return 读到的字节数
  */
 int stream_pop(stream_t* stream, char* buffer, int size);
 
 /*
- * д
- * @param stream stream_tʵ
- * @param buffer 
- * @param size С
- * @return дֽ
+ * 向数据流内写数据
+ * @param stream stream_t实例
+ * @param buffer 缓冲区
+ * @param size 缓冲区大小
+ * @return 写入的字节数
  */
 int stream_push(stream_t* stream, char* buffer, int size);
 
 /*
- * ڿݣ
- * @param stream stream_tʵ
- * @param buffer 
- * @param size С
- * @return ֽ
+ * 从数据流内拷贝数据，但不清除数据流内数据
+ * @param stream stream_t实例
+ * @param buffer 缓冲区
+ * @param size 缓冲区大小
+ * @return 拷贝的字节数
  */
 int stream_copy(stream_t* stream, char* buffer, int size);
 
+/*
+ * 在数据流内查找分隔符，不拷贝也不清除数据流内数据
+ * 可用于按行、按\r\n\r\n等分隔的文本协议，找到后再调用stream_pop取出
+ * @param stream stream_t实例
+ * @param delim 分隔符
+ * @param size 分隔符长度
+ * @retval -1 未找到
+ * @retval >=0 分隔符起始位置的偏移
+ */
+int stream_find(stream_t* stream, const char* delim, int size);
+
 #endif /* STREAM_API_H */
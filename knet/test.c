@@ -25,10 +25,74 @@
 #include "config.h"
 
 #ifdef TEST
+    #include "test.h"
     #if TEST_ONE_LOOP
         #include "test_one_loop.c"
     #endif /* TEST_ONE_LOOP */
     #if TEST_MULTI_THREAD
         #include "test_multi_thread.c"
     #endif /* TEST_MULTI_THREAD */
+    #if TEST_HTTP
+        #include "test_http.c"
+    #endif /* TEST_HTTP */
+    #if TEST_RESP
+        #include "test_resp.c"
+    #endif /* TEST_RESP */
+    #if TEST_UDP
+        #include "test_udp.c"
+    #endif /* TEST_UDP */
+    #if TEST_POOL
+        #include "test_pool.c"
+    #endif /* TEST_POOL */
+    #if TEST_BALANCER
+        #include "test_balancer.c"
+    #endif /* TEST_BALANCER */
+    #if TEST_MIGRATE
+        #include "test_migrate.c"
+    #endif /* TEST_MIGRATE */
+    #if TEST_AFFINITY
+        #include "test_affinity.c"
+    #endif /* TEST_AFFINITY */
+    #if TEST_GROUP
+        #include "test_group.c"
+    #endif /* TEST_GROUP */
+    #if TEST_RESOLVER
+        #include "test_resolver.c"
+    #endif /* TEST_RESOLVER */
+    #if TEST_WS
+        #include "test_ws.c"
+    #endif /* TEST_WS */
+    #if TEST_UNIX
+        #include "test_unix.c"
+    #endif /* TEST_UNIX */
+    #if TEST_SHM
+        #include "test_shm.c"
+    #endif /* TEST_SHM */
+    #if TEST_INPROC
+        #include "test_inproc.c"
+    #endif /* TEST_INPROC */
+    #if TEST_FILTER
+        #include "test_filter.c"
+    #endif /* TEST_FILTER */
+    #if TEST_FRAME
+        #include "test_frame.c"
+    #endif /* TEST_FRAME */
+    #if TEST_CRC32C
+        #include "test_crc32c.c"
+    #endif /* TEST_CRC32C */
+    #if TEST_IPV6
+        #include "test_ipv6.c"
+    #endif /* TEST_IPV6 */
+    #if TEST_FASTOPEN
+        #include "test_fastopen.c"
+    #endif /* TEST_FASTOPEN */
+    #if TEST_BUDGET
+        #include "test_budget.c"
+    #endif /* TEST_BUDGET */
+    #if TEST_LOWAT
+        #include "test_lowat.c"
+    #endif /* TEST_LOWAT */
+    #if TEST_FIND
+        #include "test_find.c"
+    #endif /* TEST_FIND */
 #endif
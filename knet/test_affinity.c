@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_AFFINITY
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#define MAX_LOOP 4        /* 参与负载均衡的loop_t数量 */
+#define KEYS 8            /* 应用键数量 */
+#define CONNECTIONS 64    /* 连接数，每个键CONNECTIONS/KEYS个连接 */
+#define KEY_SIZE 8        /* 首个消息为键，格式为key:NNNN */
+#define MAX_FD 65536
+#define PORT 7800
+
+loop_t*           loops[MAX_LOOP];
+int               fd_key[MAX_FD];  /* 服务端管道已解析的键+1 */
+int               fd_loop[MAX_FD]; /* 服务端管道处理消息时所在loop_t */
+int               accept_loop[MAX_LOOP];
+atomic_counter_t  rebind_count = 0;
+atomic_counter_t  served = 0;
+volatile int      replies = 0;
+int               client_seq = 0;
+socket_t          connect_fd[2];        /* 分别以IP字符串和二进制地址发起的连接 */
+volatile int      connect_loop[2] = {-1, -1};
+
+int loop_index(loop_t* loop) {
+    int i = 0;
+    for (; i < MAX_LOOP; i++) {
+        if (loops[i] == loop) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void server_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      key[KEY_SIZE + 1] = {0};
+    int       fd     = (int)channel_ref_get_socket_fd(channel);
+    stream_t* stream = channel_ref_get_stream(channel);
+    if (e & channel_cb_event_accept) {
+        /* 同一主机的连接按对端IP选取同一个loop_t */
+        accept_loop[loop_index(channel_ref_get_loop(channel))] = 1;
+        channel_ref_set_cb(channel, server_cb);
+        return;
+    }
+    if (!(e & channel_cb_event_recv) || (stream_available(stream) < KEY_SIZE)) {
+        return;
+    }
+    if (!fd_key[fd]) {
+        /* 首个消息解析出键后延迟绑定，数据留在读缓冲区内，由最终所属的loop_t再次回调 */
+        stream_copy(stream, key, KEY_SIZE);
+        fd_key[fd] = atoi(key + 4) + 1;
+        atomic_counter_inc(&rebind_count);
+        if (error_ok != channel_ref_rebind(channel, key, KEY_SIZE)) {
+            printf("channel_ref_rebind failed\n");
+        }
+        return;
+    }
+    stream_pop(stream, key, KEY_SIZE);
+    fd_loop[fd] = loop_index(channel_ref_get_loop(channel));
+    atomic_counter_inc(&served);
+    stream_push(stream, "ok", 2);
+}
+
+void client_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      key[KEY_SIZE + 1];
+    stream_t* stream = channel_ref_get_stream(channel);
+    if (e & channel_cb_event_connect) {
+        snprintf(key, sizeof(key), "key:%04d", client_seq++ % KEYS);
+        stream_push(stream, key, KEY_SIZE);
+    } else if (e & channel_cb_event_recv) {
+        stream_eat(stream);
+        replies++;
+    }
+}
+
+void connect_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    int i = 0;
+    if (e & channel_cb_event_connect) {
+        for (; i < 2; i++) {
+            if (channel_ref_get_socket_fd(channel) == connect_fd[i]) {
+                connect_loop[i] = loop_index(channel_ref_get_loop(channel));
+            }
+        }
+    }
+}
+
+int main() {
+    int              i           = 0;
+    int              k           = 0;
+    int              fd          = 0;
+    int              wrong       = 0;
+    int              used        = 0;
+    int              accepted    = 0;
+    int              key_loop[KEYS];
+    int              loop_used[MAX_LOOP] = {0};
+    loop_balancer_t* balancer    = 0;
+    loop_t*          client_loop = 0;
+    channel_ref_t*   acceptor    = 0;
+    channel_ref_t*   connector   = 0;
+    thread_runner_t* runner[MAX_LOOP] = {0};
+    uint32_t         start       = 0;
+    socket_address_t addr;
+    socket_len_t     len         = 0;
+
+    balancer = loop_balancer_create();
+    loop_balancer_set_strategy(balancer, loop_balancer_strategy_affinity);
+    for (i = 0; i < MAX_LOOP; i++) {
+        loops[i] = loop_create();
+        loop_balancer_attach(balancer, loops[i]);
+    }
+    /* loops[0]与客户端在主线程运行 */
+    for (i = 1; i < MAX_LOOP; i++) {
+        runner[i] = thread_runner_create(0, 0);
+        thread_runner_start_loop(runner[i], loops[i], 0);
+    }
+    acceptor = loop_create_channel(loops[0], 8, 1024);
+    channel_ref_set_cb(acceptor, server_cb);
+    if (error_ok != channel_ref_accept(acceptor, "127.0.0.1", PORT, 1024)) {
+        printf("channel_ref_accept failed\n");
+        return 1;
+    }
+    /* 客户端loop_t不参与负载均衡 */
+    client_loop = loop_create();
+    for (i = 0; i < CONNECTIONS; i++) {
+        connector = loop_create_channel(client_loop, 8, 1024);
+        channel_ref_set_cb(connector, client_cb);
+        channel_ref_connect(connector, "127.0.0.1", PORT, 2);
+    }
+    start = time_get_milliseconds();
+    while ((replies < CONNECTIONS) && (time_get_milliseconds() - start < 10000)) {
+        loop_run_once(loops[0]);
+        loop_run_once(client_loop);
+    }
+    /* 同一目的地址无论以哪种方式连接都选取同一个loop_t */
+    for (i = 0; i < 2; i++) {
+        connector = loop_create_channel(loops[0], 8, 1024);
+        channel_ref_set_cb(connector, connect_cb);
+        connect_fd[i] = channel_ref_get_socket_fd(connector);
+        if (!i) {
+            channel_ref_connect(connector, "127.0.0.1", PORT, 2);
+        } else {
+            len = socket_make_address("127.0.0.1", PORT, &addr);
+            channel_ref_connect_addr(connector, &addr.sa, (int)len, 2);
+        }
+    }
+    start = time_get_milliseconds();
+    while (((connect_loop[0] < 0) || (connect_loop[1] < 0)) && (time_get_milliseconds() - start < 2000)) {
+        loop_run_once(loops[0]);
+    }
+    /* 相同键的连接必须在同一个loop_t内处理 */
+    for (k = 0; k < KEYS; k++) {
+        key_loop[k] = -1;
+    }
+    for (fd = 0; fd < MAX_FD; fd++) {
+        if (!fd_key[fd]) {
+            continue;
+        }
+        k = fd_key[fd] - 1;
+        if (key_loop[k] < 0) {
+            key_loop[k] = fd_loop[fd];
+            loop_used[fd_loop[fd]] = 1;
+        } else if (key_loop[k] != fd_loop[fd]) {
+            wrong++;
+        }
+    }
+    for (i = 0; i < MAX_LOOP; i++) {
+        used += loop_used[i];
+        accepted += accept_loop[i];
+    }
+    printf("replies:%d/%d rebind:%d served:%d wrong loop:%d loops used by keys:%d loops accepted on:%d\n",
+        replies, CONNECTIONS, (int)rebind_count, (int)served, wrong, used, accepted);
+    printf("connect loop:%d connect_addr loop:%d\n", connect_loop[0], connect_loop[1]);
+    if ((connect_loop[0] < 0) || (connect_loop[0] != connect_loop[1])) {
+        wrong++;
+    }
+
+    for (i = 1; i < MAX_LOOP; i++) {
+        thread_runner_stop(runner[i]);
+        thread_runner_join(runner[i]);
+        thread_runner_destroy(runner[i]);
+    }
+    for (i = 0; i < MAX_LOOP; i++) {
+        loop_destroy(loops[i]);
+    }
+    loop_destroy(client_loop);
+    loop_balancer_destroy(balancer);
+    return ((replies == CONNECTIONS) && !wrong) ? 0 : 1;
+}
+
+#endif /* TEST_AFFINITY */
+#endif
@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_BALANCER
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+#include "loop.h"
+
+#define MAX_LOOP 4            /* 参与负载均衡的loop_t数量 */
+#define CONNECTIONS 400       /* 每种策略建立的空闲连接数 */
+#define HOT_BURN_US 2000      /* 热点连接每次应答消耗的CPU时间（微秒） */
+#define CONNECTS 200          /* 连接分布测试的主动连接数 */
+#define PORT 7780
+
+loop_t*          loops[MAX_LOOP];
+atomic_counter_t accept_count[MAX_LOOP];
+int              hot_index = -1;
+atomic_counter_t hot_ready = 0;
+atomic_counter_t connect_count[MAX_LOOP];
+atomic_counter_t wrong_thread = 0;
+
+void burn(uint64_t us) {
+    uint64_t start = time_get_microseconds();
+    while (time_get_microseconds() - start < us);
+}
+
+int loop_index(loop_t* loop) {
+    int i = 0;
+    for (; i < MAX_LOOP; i++) {
+        if (loops[i] == loop) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void hot_server_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      buffer[16];
+    stream_t* stream = 0;
+    int       size   = 0;
+    if (e & channel_cb_event_recv) {
+        /* 模拟繁忙的连接，每次应答消耗CPU */
+        stream = channel_ref_get_stream(channel);
+        size = min(stream_available(stream), (int)sizeof(buffer));
+        stream_pop(stream, buffer, size);
+        burn(HOT_BURN_US);
+        stream_push(stream, buffer, size);
+    }
+}
+
+void acceptor_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    int index = 0;
+    if (e & channel_cb_event_accept) {
+        index = loop_index(channel_ref_get_loop(channel));
+        if (atomic_counter_inc(&hot_ready) == 1) {
+            /* 第一个连接作为热点连接 */
+            hot_index = index;
+            channel_ref_set_cb(channel, hot_server_cb);
+            return;
+        }
+        atomic_counter_inc(&accept_count[index]);
+    }
+}
+
+void hot_client_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    stream_t* stream = channel_ref_get_stream(channel);
+    if (e & channel_cb_event_connect) {
+        stream_push(stream, "ping", 4);
+    } else if (e & channel_cb_event_recv) {
+        /* 不停地往返 */
+        stream_eat(stream);
+        stream_push(stream, "ping", 4);
+    }
+}
+
+void spread_client_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    loop_t* loop = 0;
+    if (e & channel_cb_event_connect) {
+        loop = channel_ref_get_loop(channel);
+        if (loop_get_thread_id(loop) != thread_get_self_id()) {
+            /* 连接完成必须在所属loop_t的线程内回调 */
+            atomic_counter_inc(&wrong_thread);
+        }
+        atomic_counter_inc(&connect_count[loop_index(loop)]);
+    }
+}
+
+void run_loops(loop_t* client_loop, uint32_t ms) {
+    uint32_t start = time_get_milliseconds();
+    while (time_get_milliseconds() - start < ms) {
+        loop_run_once(loops[0]);
+        loop_run_once(client_loop);
+    }
+}
+
+void test_strategy(loop_balancer_strategy_e strategy, const char* name, int port) {
+    int              i           = 0;
+    int              total       = 0;
+    loop_balancer_t* balancer    = 0;
+    loop_t*          client_loop = 0;
+    channel_ref_t*   acceptor    = 0;
+    channel_ref_t*   connector   = 0;
+    thread_runner_t* runner[MAX_LOOP] = {0};
+    uint32_t         start       = 0;
+
+    hot_index = -1;
+    hot_ready = 0;
+    balancer = loop_balancer_create();
+    loop_balancer_set_strategy(balancer, strategy);
+    for (i = 0; i < MAX_LOOP; i++) {
+        accept_count[i] = 0;
+        loops[i] = loop_create();
+        loop_balancer_attach(balancer, loops[i]);
+        /* 权重1,2,3,4 */
+        loop_balancer_set_weight(balancer, loops[i], i + 1);
+    }
+    /* loops[0]与客户端在主线程运行 */
+    for (i = 1; i < MAX_LOOP; i++) {
+        runner[i] = thread_runner_create(0, 0);
+        thread_runner_start_loop(runner[i], loops[i], 0);
+    }
+    acceptor = loop_create_channel(loops[0], 8, 1024);
+    channel_ref_set_cb(acceptor, acceptor_cb);
+    if (error_ok != channel_ref_accept(acceptor, "127.0.0.1", port, 1024)) {
+        printf("channel_ref_accept failed\n");
+        return;
+    }
+    /* 客户端loop_t不参与负载均衡 */
+    client_loop = loop_create();
+    connector = loop_create_channel(client_loop, 8, 1024);
+    channel_ref_set_cb(connector, hot_client_cb);
+    channel_ref_connect(connector, "127.0.0.1", port, 2);
+    /* 等待繁忙程度的EWMA收敛 */
+    run_loops(client_loop, 1000);
+    start = time_get_milliseconds();
+    for (i = 0; i < CONNECTIONS; i++) {
+        connector = loop_create_channel(client_loop, 8, 1024);
+        channel_ref_connect(connector, "127.0.0.1", port, 2);
+        run_loops(client_loop, 2);
+    }
+    while (total < CONNECTIONS && (time_get_milliseconds() - start < 10000)) {
+        run_loops(client_loop, 10);
+        for (total = 0, i = 0; i < MAX_LOOP; i++) {
+            total += accept_count[i];
+        }
+    }
+    printf("%-12s", name);
+    for (i = 0; i < MAX_LOOP; i++) {
+        printf(" loop%d%s:%4d busy:%4d", i, (i == hot_index) ? "(hot)" : "     ",
+            (int)accept_count[i], loop_get_busy(loops[i]));
+    }
+    printf("\n");
+
+    for (i = 1; i < MAX_LOOP; i++) {
+        thread_runner_stop(runner[i]);
+        thread_runner_join(runner[i]);
+        thread_runner_destroy(runner[i]);
+    }
+    for (i = 0; i < MAX_LOOP; i++) {
+        loop_destroy(loops[i]);
+    }
+    loop_destroy(client_loop);
+    loop_balancer_destroy(balancer);
+}
+
+/*
+ * 从同一个loop_t发起的连接经过负载均衡分布到所有loop_t，连接完成在选中的loop_t内回调
+ */
+int test_connect_spread(int port) {
+    int              i           = 0;
+    int              total       = 0;
+    int              error       = 0;
+    int              spread      = 1;
+    loop_balancer_t* balancer    = 0;
+    loop_t*          server_loop = 0;
+    channel_ref_t*   acceptor    = 0;
+    channel_ref_t*   connector   = 0;
+    thread_runner_t* runner[MAX_LOOP] = {0};
+    uint32_t         start       = 0;
+
+    wrong_thread = 0;
+    balancer = loop_balancer_create();
+    loop_balancer_set_strategy(balancer, loop_balancer_strategy_round_robin);
+    for (i = 0; i < MAX_LOOP; i++) {
+        connect_count[i] = 0;
+        loops[i] = loop_create();
+        loop_balancer_attach(balancer, loops[i]);
+    }
+    for (i = 1; i < MAX_LOOP; i++) {
+        runner[i] = thread_runner_create(0, 0);
+        thread_runner_start_loop(runner[i], loops[i], 0);
+    }
+    /* 服务端loop_t不参与负载均衡，与loops[0]在主线程运行 */
+    server_loop = loop_create();
+    acceptor = loop_create_channel(server_loop, 8, 1024);
+    error += check(error_ok == channel_ref_accept(acceptor, "127.0.0.1", port, 1024), "connect spread listen");
+    /* 全部在loops[0]创建并发起连接，loops[0]运行后才参与选取 */
+    loop_run_once(loops[0]);
+    for (i = 0; i < CONNECTS; i++) {
+        connector = loop_create_channel(loops[0], 8, 1024);
+        channel_ref_set_cb(connector, spread_client_cb);
+        channel_ref_connect(connector, "127.0.0.1", port, 2);
+    }
+    start = time_get_milliseconds();
+    while ((total < CONNECTS) && (time_get_milliseconds() - start < 10000)) {
+        loop_run_once(loops[0]);
+        loop_run_once(server_loop);
+        for (total = 0, i = 0; i < MAX_LOOP; i++) {
+            total += connect_count[i];
+        }
+    }
+    printf("%-12s", "connect");
+    for (i = 0; i < MAX_LOOP; i++) {
+        printf(" loop%d:%4d", i, (int)connect_count[i]);
+        if (connect_count[i] < CONNECTS / MAX_LOOP / 2) {
+            spread = 0;
+        }
+    }
+    printf("\n");
+    error += check(total == CONNECTS, "all outbound connects completed");
+    error += check(spread, "outbound connects spread over loops");
+    error += check(!wrong_thread, "connect reported on the chosen loop");
+
+    for (i = 1; i < MAX_LOOP; i++) {
+        thread_runner_stop(runner[i]);
+        thread_runner_join(runner[i]);
+        thread_runner_destroy(runner[i]);
+    }
+    for (i = 0; i < MAX_LOOP; i++) {
+        loop_destroy(loops[i]);
+    }
+    loop_destroy(server_loop);
+    loop_balancer_destroy(balancer);
+    return error;
+}
+
+/*
+ * 先占满CPU使繁忙程度升高，之后每次循环间休眠，繁忙程度应衰减到0
+ */
+int test_busy_decay() {
+    int      error  = 0;
+    int      peak   = 0;
+    loop_t*  loop   = loop_create();
+    uint32_t start  = time_get_milliseconds();
+    while (time_get_milliseconds() - start < 1000) {
+        loop_run_once(loop);
+        burn(5000);
+    }
+    peak  = loop_get_busy(loop);
+    start = time_get_milliseconds();
+    while (loop_get_busy(loop) && (time_get_milliseconds() - start < 10000)) {
+        loop_run_once(loop);
+        thread_sleep_ms(50);
+    }
+    printf("%-12s peak:%4d idle:%4d after %u ms\n", "busy", peak, loop_get_busy(loop), time_get_milliseconds() - start);
+    error += check(peak > 500, "busy rises on a saturated loop");
+    error += check(!loop_get_busy(loop), "busy decays to 0 on an idle loop");
+    loop_destroy(loop);
+    return error;
+}
+
+int main() {
+    int error = 0;
+    /* 一个热点连接占满所在loop_t的CPU，观察其余空闲连接的分布 */
+    test_strategy(loop_balancer_strategy_least_load, "least_load", PORT);
+    test_strategy(loop_balancer_strategy_p2c, "p2c", PORT + 1);
+    test_strategy(loop_balancer_strategy_ewma, "ewma", PORT + 2);
+    test_strategy(loop_balancer_strategy_weight, "weight", PORT + 3);
+    test_strategy(loop_balancer_strategy_round_robin, "round_robin", PORT + 4);
+    /* 连接来自同一IP，全部选取同一个loop_t */
+    test_strategy(loop_balancer_strategy_affinity, "affinity", PORT + 5);
+    error += test_connect_spread(PORT + 6);
+    error += test_busy_decay();
+    return error ? 1 : 0;
+}
+
+#endif /* TEST_BALANCER */
+#endif
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_BUDGET
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#define BULK_PORT 7890
+#define PING_PORT 7891
+#define BUDGET (16 * 1024)   /* 每次读事件最多读取的字节数 */
+#define CHUNK (64 * 1024)    /* 大流量连接每次发送的长度 */
+#define RUN_MS 1000          /* 每轮测量时间 */
+#define MAX_SAMPLES 200000
+
+volatile int running      = 0;
+int          bulk_port    = 0;
+uint32_t     iter_bytes   = 0; /* 本次循环大流量连接读取的字节数 */
+uint32_t     bulk_total   = 0;
+uint64_t     ping_start   = 0;
+uint32_t     samples[MAX_SAMPLES];
+int          sample_count = 0;
+
+/*
+ * 阻塞套接字不停发送，模拟大流量连接
+ */
+void bulk_thread(thread_runner_t* runner) {
+    static char buffer[CHUNK];
+    socket_t    socket_fd = socket_create();
+    if (!socket_fd || (error_ok != socket_connect(socket_fd, "127.0.0.1", bulk_port))) {
+        return;
+    }
+    while (running) {
+        if (send(socket_fd, buffer, sizeof(buffer), 0) <= 0) {
+            break;
+        }
+    }
+    socket_close(socket_fd);
+}
+
+void bulk_server_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    stream_t* stream = channel_ref_get_stream(channel);
+    int       size   = 0;
+    if (e & channel_cb_event_recv) {
+        size = stream_available(stream);
+        iter_bytes += size;
+        bulk_total += size;
+        stream_eat(stream);
+    }
+}
+
+void ping_server_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      buffer[16];
+    stream_t* stream = channel_ref_get_stream(channel);
+    if (e & channel_cb_event_recv) {
+        while (stream_available(stream) >= (int)sizeof(buffer)) {
+            stream_pop(stream, buffer, sizeof(buffer));
+            stream_push(stream, buffer, sizeof(buffer));
+        }
+    }
+}
+
+void ping_client_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      buffer[16] = {0};
+    stream_t* stream     = channel_ref_get_stream(channel);
+    if (e & channel_cb_event_connect) {
+        ping_start = time_get_microseconds();
+        stream_push(stream, buffer, sizeof(buffer));
+    } else if (e & channel_cb_event_recv) {
+        while (stream_available(stream) >= (int)sizeof(buffer)) {
+            stream_pop(stream, buffer, sizeof(buffer));
+            if (sample_count < MAX_SAMPLES) {
+                samples[sample_count++] = (uint32_t)(time_get_microseconds() - ping_start);
+            }
+            ping_start = time_get_microseconds();
+            stream_push(stream, buffer, sizeof(buffer));
+        }
+    }
+}
+
+int compare_sample(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+/*
+ * 大流量连接与ping-pong连接共用一个loop_t，返回大流量连接单次循环读取的最大字节数
+ */
+uint32_t run(uint32_t budget, int port_offset, uint32_t* p99, int* hits) {
+    loop_t*          loop      = loop_create();
+    channel_ref_t*   bulk      = 0;
+    channel_ref_t*   ping      = 0;
+    channel_ref_t*   connector = 0;
+    thread_runner_t* runner    = 0;
+    uint32_t         start     = 0;
+    uint32_t         max_bytes = 0;
+
+    bulk = loop_create_channel(loop, 8, 1024 * 1024);
+    channel_ref_set_cb(bulk, bulk_server_cb);
+    channel_ref_set_recv_budget(bulk, budget);
+    channel_ref_accept(bulk, "127.0.0.1", BULK_PORT + port_offset, 16);
+    ping = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(ping, ping_server_cb);
+    channel_ref_set_recv_budget(ping, budget);
+    channel_ref_accept(ping, "127.0.0.1", PING_PORT + port_offset, 16);
+
+    running      = 1;
+    bulk_port    = BULK_PORT + port_offset;
+    bulk_total   = 0;
+    sample_count = 0;
+    *hits        = 0;
+    runner = thread_runner_create(bulk_thread, 0);
+    thread_runner_start(runner, 0);
+    connector = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(connector, ping_client_cb);
+    channel_ref_connect(connector, "127.0.0.1", PING_PORT + port_offset, 2);
+
+    start = time_get_milliseconds();
+    while (time_get_milliseconds() - start < RUN_MS) {
+        iter_bytes = 0;
+        loop_run_once(loop);
+        max_bytes = max(max_bytes, iter_bytes);
+        *hits += (budget && (iter_bytes == budget));
+    }
+    running = 0;
+    /* 读空套接字，发送线程退出 */
+    channel_ref_close(bulk);
+    channel_ref_close(ping);
+    loop_destroy(loop);
+    thread_runner_join(runner);
+    thread_runner_destroy(runner);
+
+    qsort(samples, sample_count, sizeof(uint32_t), compare_sample);
+    *p99 = sample_count ? samples[sample_count * 99 / 100] : 0;
+    printf("budget %6u: bulk %4u MB, max %7u bytes/iteration, %6d pings, p99 %6uus\n",
+        budget, bulk_total >> 20, max_bytes, sample_count, *p99);
+    return max_bytes;
+}
+
+int main() {
+    int      error      = 0;
+    int      hits       = 0;
+    int      pings      = 0;
+    uint32_t p99_free   = 0;
+    uint32_t p99_budget = 0;
+    uint32_t max_bytes  = 0;
+
+    run(0, 0, &p99_free, &hits);
+    max_bytes = run(BUDGET, 2, &p99_budget, &hits);
+    pings     = sample_count;
+    error += check(hits > 0, "bulk channel reached its budget");
+    /* 就绪链表与选取器在同一次循环内只给一次预算 */
+    error += check(max_bytes <= BUDGET, "at most one budget per iteration");
+    error += check(pings > 1000, "small channel keeps being served");
+    error += check(p99_budget <= max(p99_free, 1000), "budget does not worsen p99");
+    return error ? 1 : 0;
+}
+
+#endif /* TEST_BUDGET */
+#endif
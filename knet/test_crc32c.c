@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_CRC32C
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+#include "crc32c.h"
+#include "ringbuffer.h"
+
+/* RFC 3720 B.4及常用的校验向量 */
+typedef struct _vector_t {
+    const char* name;
+    char        data[32];
+    uint32_t    size;
+    uint32_t    crc;
+} vector_t;
+
+/*
+ * 当前实现计算已知向量，逐字节增量及从不同对齐位置开始计算的结果一致
+ */
+int check_vectors(vector_t* vectors, int count, const char* impl) {
+    char     buffer[64];
+    char     name[64];
+    int      error = 0;
+    int      ok    = 0;
+    int      i     = 0;
+    uint32_t j     = 0;
+    uint32_t crc   = 0;
+    for (; i < count; i++) {
+        sprintf(name, "%s %s", impl, vectors[i].name);
+        ok = (crc32c_update(0, vectors[i].data, vectors[i].size) == vectors[i].crc);
+        /* 任意位置分为两段 */
+        for (j = 0; j <= vectors[i].size; j++) {
+            crc = crc32c_update(crc32c_update(0, vectors[i].data, j), vectors[i].data + j, vectors[i].size - j);
+            ok = ok && (crc == vectors[i].crc);
+        }
+        /* 非8字节对齐的起始地址 */
+        for (j = 0; j < 8; j++) {
+            memcpy(buffer + j, vectors[i].data, vectors[i].size);
+            ok = ok && (crc32c_update(0, buffer + j, vectors[i].size) == vectors[i].crc);
+        }
+        error += check(ok, name);
+    }
+    return error;
+}
+
+int main() {
+    vector_t      vectors[] = {
+        {"\"123456789\"", "123456789", 9, 0xe3069283},
+        {"32 zero bytes", {0}, 32, 0x8a9136aa},
+        {"32 0xff bytes", {0}, 32, 0x62a8ab43},
+        {"32 ascending bytes", {0}, 32, 0x46dd794e},
+        {"32 descending bytes", {0}, 32, 0x113fdb5c},
+    };
+    int           count     = (int)(sizeof(vectors) / sizeof(vectors[0]));
+    int           error     = 0;
+    int           ok        = 1;
+    int           i         = 0;
+    int           j         = 0;
+    uint32_t      soft      = 0;
+    uint32_t      hard      = 0;
+    char          data[4096];
+    buffer_t*     chain     = 0;
+    buffer_t*     last      = 0;
+    buffer_t*     buffer    = 0;
+    ringbuffer_t* rb        = 0;
+    char*         ptr[2]    = {0};
+    uint32_t      size[2]   = {0};
+    uint32_t      sizes[]   = {0, 1, 3, 0, 5};  /* "123456789"分为5个缓冲区，包含空缓冲区 */
+    uint32_t      offset    = 0;
+    int           segments  = 0;
+
+    for (i = 0; i < 32; i++) {
+        vectors[2].data[i] = (char)0xff;
+        vectors[3].data[i] = (char)i;
+        vectors[4].data[i] = (char)(31 - i);
+    }
+    for (i = 0; i < (int)sizeof(data); i++) {
+        data[i] = (char)(i * 131 + (i >> 3));
+    }
+
+    /* 1. 查表实现 */
+    crc32c_force_soft(1);
+    error += check_vectors(vectors, count, "table");
+
+    /* 2. 硬件指令实现，与查表实现逐个长度及对齐位置对比 */
+    crc32c_force_soft(0);
+    if (crc32c_check_hardware()) {
+        error += check_vectors(vectors, count, "hardware");
+        for (i = 0; i < 8; i++) {
+            for (j = 0; j < 300; j++) {
+                hard = crc32c_update(0, data + i, j);
+                crc32c_force_soft(1);
+                soft = crc32c_update(0, data + i, j);
+                crc32c_force_soft(0);
+                ok = ok && (soft == hard);
+            }
+        }
+        error += check(ok, "hardware matches table");
+    } else {
+        printf("%-40s %s\n", "hardware crc32c", "not supported");
+    }
+
+    /* 3. 缓冲区链表 */
+    for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        buffer = buffer_create(8);
+        if (sizes[i]) {
+            buffer_put(buffer, vectors[0].data + offset, sizes[i]);
+            offset += sizes[i];
+        }
+        if (last) {
+            buffer_set_next(last, buffer);
+        } else {
+            chain = buffer;
+        }
+        last = buffer;
+    }
+    error += check(crc32c_update_buffer_chain(0, chain) == 0xe3069283, "buffer chain");
+    buffer_chain_destroy(chain);
+
+    /* 4. 跨越绕回点的环形缓冲区 */
+    rb = ringbuffer_create(16);
+    ringbuffer_write_lock_segments(rb, ptr, size);
+    ringbuffer_write_commit(rb, 12);
+    ringbuffer_read_lock_size(rb);
+    ringbuffer_read_commit(rb, 12);
+    segments = ringbuffer_write_lock_segments(rb, ptr, size);
+    memcpy(ptr[0], vectors[0].data, min(size[0], 9));
+    if (size[0] < 9) {
+        memcpy(ptr[1], vectors[0].data + size[0], 9 - size[0]);
+    }
+    ringbuffer_write_commit(rb, 9);
+    error += check((segments == 2) && (crc32c_update_ringbuffer(0, rb, 0, 9) == 0xe3069283),
+        "ring buffer across wrap point");
+    ringbuffer_destroy(rb);
+
+    return error ? 1 : 0;
+}
+
+#endif /* TEST_CRC32C */
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_FASTOPEN
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#if defined(WIN32) || defined(WIN64)
+    #define strtok_r strtok_s
+#endif /* defined(WIN32) || defined(WIN64) */
+
+#define PORT 7880
+#define CONNECTIONS 8 /* 依次建立的短连接数，第一个连接取得cookie */
+
+int echoed = 0;
+int closed = 0;
+
+void server_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    stream_t* stream = channel_ref_get_stream(channel);
+    char      buffer[16];
+    int       size   = 0;
+    if (e & channel_cb_event_recv) {
+        size = min(stream_available(stream), (int)sizeof(buffer));
+        stream_pop(stream, buffer, size);
+        stream_push(stream, buffer, size);
+    }
+}
+
+void client_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    stream_t* stream      = channel_ref_get_stream(channel);
+    char      buffer[16] = {0};
+    if (e & channel_cb_event_connect) {
+        /* 握手完成前写入，随SYN发送 */
+        stream_push(stream, "hello", 5);
+    } else if (e & channel_cb_event_recv) {
+        if (stream_available(stream) >= 5) {
+            stream_pop(stream, buffer, 5);
+            echoed += !memcmp(buffer, "hello", 5);
+            channel_ref_close(channel);
+        }
+    } else if (e & channel_cb_event_close) {
+        closed++;
+    }
+}
+
+/*
+ * 读取/proc/net/netstat内TcpExt的计数，没有时返回-1
+ */
+long netstat_get(const char* name) {
+    char  names[4096]  = {0};
+    char  values[4096] = {0};
+    char* save_name    = 0;
+    char* save_value   = 0;
+    char* n            = 0;
+    char* v            = 0;
+    long  result       = -1;
+    FILE* fp           = fopen("/proc/net/netstat", "r");
+    if (!fp) {
+        return -1;
+    }
+    while (fgets(names, sizeof(names), fp) && fgets(values, sizeof(values), fp)) {
+        if (strncmp(names, "TcpExt:", 7)) {
+            continue;
+        }
+        n = strtok_r(names, " \n", &save_name);
+        v = strtok_r(values, " \n", &save_value);
+        for (; n && v; n = strtok_r(0, " \n", &save_name), v = strtok_r(0, " \n", &save_value)) {
+            if (!strcmp(n, name)) {
+                result = atol(v);
+                break;
+            }
+        }
+        break;
+    }
+    fclose(fp);
+    return result;
+}
+
+/*
+ * 客户端和服务端都开启时返回非零
+ */
+int fastopen_enabled() {
+    int   mode = 0;
+    FILE* fp   = fopen("/proc/sys/net/ipv4/tcp_fastopen", "r");
+    if (!fp) {
+        return 0;
+    }
+    if (fscanf(fp, "%d", &mode) != 1) {
+        mode = 0;
+    }
+    fclose(fp);
+    return ((mode & 3) == 3);
+}
+
+int main() {
+    int            i         = 0;
+    int            error     = 0;
+    int            enabled   = 0;
+    long           passive   = 0;
+    uint32_t       deadline  = 0;
+    loop_t*        loop      = loop_create();
+    channel_ref_t* acceptor  = 0;
+    channel_ref_t* connector = 0;
+
+#if defined(__linux__) && defined(TCP_FASTOPEN_CONNECT)
+    enabled = fastopen_enabled();
+#endif /* defined(__linux__) && defined(TCP_FASTOPEN_CONNECT) */
+    passive = netstat_get("TCPFastOpenPassive");
+
+    acceptor = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(acceptor, server_cb);
+    channel_ref_set_fastopen(acceptor, 16);
+    error += check(error_ok == channel_ref_accept(acceptor, "127.0.0.1", PORT, 16), "listen with fastopen");
+    /* 不支持时为普通连接，回显必须成功 */
+    for (i = 0; i < CONNECTIONS; i++) {
+        connector = loop_create_channel(loop, 8, 1024);
+        channel_ref_set_cb(connector, client_cb);
+        channel_ref_set_fastopen(connector, 1);
+        channel_ref_connect(connector, "127.0.0.1", PORT, 2);
+        deadline = time_get_milliseconds() + 2000;
+        while ((closed <= i) && (time_get_milliseconds() < deadline)) {
+            loop_run_once(loop);
+        }
+    }
+    error += check(echoed == CONNECTIONS, "fastopen echo on every connection");
+
+    if (!enabled || (passive < 0)) {
+        printf("TCP Fast Open unavailable (net.ipv4.tcp_fastopen needs 3), SYN data skipped\n");
+    } else {
+        passive = netstat_get("TCPFastOpenPassive") - passive;
+        printf("%ld of %d connections accepted data in the SYN\n", passive, CONNECTIONS);
+        error += check(passive >= CONNECTIONS - 1, "data carried in the SYN");
+    }
+
+    channel_ref_close(acceptor);
+    loop_run_once(loop);
+    loop_destroy(loop);
+    return error ? 1 : 0;
+}
+
+#endif /* TEST_FASTOPEN */
+#endif
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_FILTER
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+#include "loop.h"
+
+#define MESSAGE_SIZE 256      /* 消息长度 */
+#define MESSAGES 200000       /* 每种配置发送的消息数 */
+#define BATCH 100             /* 每次循环前写入的消息数 */
+#define MAX_SIZE 1024         /* 分帧最大长度 */
+#define THREAD_MESSAGES 10000 /* 其他线程写入的消息数 */
+
+/* 过滤阶段 */
+typedef struct _stage_t {
+    const char*   name;
+    filter_func_t out;  /* 写方向 */
+    filter_func_t in;   /* 读方向 */
+} stage_t;
+
+int received = 0;  /* 收到的消息数 */
+int corrupt  = 0;  /* 内容错误的消息数 */
+int once     = 0;  /* once过滤器被调用的次数 */
+int off_loop = 0;  /* 在loop_t线程外运行的过滤次数 */
+
+/* 原地异或，模拟加密，不拷贝 */
+int xor_filter(filter_t* filter, channel_ref_t* channel, buffer_t* chain) {
+    buffer_t* buffer = chain;
+    char*     ptr    = 0;
+    uint32_t  i      = 0;
+    for (; buffer; buffer = buffer_get_next(buffer)) {
+        ptr = buffer_get_ptr(buffer);
+        for (i = 0; i < buffer_get_length(buffer); i++) {
+            ptr[i] ^= 0x5a;
+        }
+    }
+    return filter_emit(filter, channel, chain);
+}
+
+/* 在消息前附加CRC32C，只增加一个4字节的缓冲区 */
+int crc_out_filter(filter_t* filter, channel_ref_t* channel, buffer_t* chain) {
+    uint32_t  crc    = crc32c_update_buffer_chain(0, chain);
+    buffer_t* header = buffer_create(sizeof(crc));
+    buffer_put(header, (const char*)&crc, sizeof(crc));
+    buffer_set_next(header, chain);
+    return filter_emit(filter, channel, header);
+}
+
+int crc_in_filter(filter_t* filter, channel_ref_t* channel, buffer_t* chain) {
+    uint32_t crc = 0;
+    if (buffer_get_length(chain) < sizeof(crc)) {
+        buffer_chain_destroy(chain);
+        return error_filter_fail;
+    }
+    memcpy(&crc, buffer_get_ptr(chain), sizeof(crc));
+    buffer_adjust(chain, sizeof(crc));
+    if (crc != crc32c_update_buffer_chain(0, chain)) {
+        buffer_chain_destroy(chain);
+        return error_filter_fail;
+    }
+    return filter_emit(filter, channel, chain);
+}
+
+/* 拷贝到新的缓冲区，模拟压缩等输出新缓冲区的阶段 */
+int copy_filter(filter_t* filter, channel_ref_t* channel, buffer_t* chain) {
+    buffer_t* copy   = buffer_create(buffer_chain_get_length(chain));
+    buffer_t* buffer = chain;
+    for (; buffer; buffer = buffer_get_next(buffer)) {
+        buffer_put(copy, buffer_get_ptr(buffer), buffer_get_length(buffer));
+    }
+    buffer_chain_destroy(chain);
+    return filter_emit(filter, channel, copy);
+}
+
+/* 第一次调用时删除自身后继续传递 */
+int once_filter(filter_t* filter, channel_ref_t* channel, buffer_t* chain) {
+    once++;
+    channel_ref_remove_filter(channel, filter_dir_in, filter_get_name(filter));
+    return filter_emit(filter, channel, chain);
+}
+
+/* 传递后仍访问自身 */
+int count_filter(filter_t* filter, channel_ref_t* channel, buffer_t* chain) {
+    int error = filter_emit(filter, channel, chain);
+    filter_get_calls(filter);
+    return error;
+}
+
+/* 记录是否在管道所在loop_t的线程内运行 */
+int thread_filter(filter_t* filter, channel_ref_t* channel, buffer_t* chain) {
+    if (loop_get_thread_id(channel_ref_get_loop(channel)) != thread_get_self_id()) {
+        off_loop++;
+    }
+    return filter_emit(filter, channel, chain);
+}
+
+/* 在其他线程写入消息 */
+void writer_thread(thread_runner_t* runner) {
+    channel_ref_t* channel = (channel_ref_t*)thread_runner_get_params(runner);
+    char           message[MESSAGE_SIZE];
+    int            i       = 0;
+    memset(message, 0xa5, sizeof(message));
+    for (; i < THREAD_MESSAGES; i++) {
+        channel_ref_write_frame(channel, message, MESSAGE_SIZE);
+    }
+}
+
+void frame_cb(channel_ref_t* channel, const char* data, uint32_t size) {
+    if ((size != MESSAGE_SIZE) || (data[0] != (char)0xa5) || (data[size - 1] != (char)0xa5)) {
+        corrupt++;
+    }
+    received++;
+}
+
+/* 删除正在调用栈上的count过滤器 */
+void remove_cb(channel_ref_t* channel, const char* data, uint32_t size) {
+    frame_cb(channel, data, size);
+    channel_ref_remove_filter(channel, filter_dir_in, "count");
+}
+
+/*
+ * 创建分帧的进程内管道对，pair[0]写入，pair[1]读取
+ */
+void create_pair(loop_t* loop, channel_ref_t* pair[2], channel_ref_frame_cb_t cb) {
+    loop_create_channel_pair(loop, loop, 8, MAX_SIZE * 4, pair);
+    channel_ref_set_frame(pair[0], frame_type_4, 1, MAX_SIZE, frame_cb);
+    channel_ref_set_frame(pair[1], frame_type_4, 1, MAX_SIZE, cb);
+    loop_run_once(loop);
+}
+
+/*
+ * 发送count个消息，返回收到全部消息所用的微秒数
+ */
+uint64_t send_messages(loop_t* loop, channel_ref_t* pair[2], int count) {
+    char     message[MESSAGE_SIZE];
+    uint64_t start    = time_get_microseconds();
+    uint32_t deadline = time_get_milliseconds() + 60000;
+    int      i        = 0;
+    memset(message, 0xa5, sizeof(message));
+    received = 0;
+    corrupt  = 0;
+    for (; i < count; i++) {
+        channel_ref_write_frame(pair[0], message, MESSAGE_SIZE);
+        if (!((i + 1) % BATCH)) {
+            loop_run_once(loop);
+        }
+    }
+    while ((received < count) && (time_get_milliseconds() < deadline)) {
+        loop_run_once(loop);
+    }
+    return time_get_microseconds() - start;
+}
+
+/*
+ * 只使用给定的阶段，写方向按顺序添加，读方向按相反顺序添加
+ */
+uint64_t run_stages(loop_t* loop, stage_t* stages[], int count) {
+    channel_ref_t* pair[2] = {0};
+    uint64_t       elapsed = 0;
+    int            i       = 0;
+    create_pair(loop, pair, frame_cb);
+    for (i = 0; i < count; i++) {
+        channel_ref_add_filter(pair[0], filter_dir_out, stages[i]->name, stages[i]->out, 0);
+    }
+    for (i = count - 1; i >= 0; i--) {
+        channel_ref_add_filter(pair[1], filter_dir_in, stages[i]->name, stages[i]->in, 0);
+    }
+    elapsed = send_messages(loop, pair, MESSAGES);
+    channel_ref_close(pair[0]);
+    channel_ref_close(pair[1]);
+    loop_run_once(loop);
+    if ((received != MESSAGES) || corrupt) {
+        return 0;
+    }
+    return elapsed;
+}
+
+int main() {
+    stage_t          stages[] = {
+        {"xor", xor_filter, xor_filter},
+        {"crc", crc_out_filter, crc_in_filter},
+        {"copy", copy_filter, copy_filter},
+    };
+    stage_t*         chain[3]  = {&stages[0], &stages[1], &stages[2]};
+    int              error     = 0;
+    int              i         = 0;
+    uint64_t         baseline  = 0;
+    uint64_t         elapsed   = 0;
+    uint32_t         deadline  = 0;
+    channel_ref_t*   pair[2]   = {0};
+    thread_runner_t* runner    = 0;
+    loop_t*          loop      = loop_create();
+
+    /* 1. 基准及每个阶段单独运行，差值为该阶段两个方向的开销 */
+    baseline = run_stages(loop, 0, 0);
+    error += check(baseline > 0, "no filter");
+    printf("%d x %d bytes: no filter %.0f ns/message\n", MESSAGES, MESSAGE_SIZE, baseline * 1000.0 / MESSAGES);
+    for (i = 0; i < 3; i++) {
+        elapsed = run_stages(loop, &chain[i], 1);
+        error += check(elapsed > 0, stages[i].name);
+        printf("stage %-4s +%.0f ns/message\n", stages[i].name, ((double)elapsed - (double)baseline) * 1000.0 / MESSAGES);
+    }
+    elapsed = run_stages(loop, chain, 3);
+    error += check(elapsed > 0, "xor+crc+copy");
+    printf("all stages +%.0f ns/message\n", ((double)elapsed - (double)baseline) * 1000.0 / MESSAGES);
+
+    /* 2. 过滤函数内删除自身 */
+    create_pair(loop, pair, frame_cb);
+    channel_ref_add_filter(pair[1], filter_dir_in, "once", once_filter, 0);
+    channel_ref_add_filter(pair[1], filter_dir_in, "xor", xor_filter, 0);
+    channel_ref_add_filter(pair[0], filter_dir_out, "xor", xor_filter, 0);
+    send_messages(loop, pair, 3);
+    error += check((once == 1) && (received == 3) && !corrupt, "filter removes itself");
+    channel_ref_close(pair[0]);
+    channel_ref_close(pair[1]);
+
+    /* 3. 分帧回调内删除正在调用栈上的过滤器 */
+    create_pair(loop, pair, remove_cb);
+    channel_ref_add_filter(pair[1], filter_dir_in, "count", count_filter, 0);
+    send_messages(loop, pair, 3);
+    error += check((received == 3) && !corrupt, "frame callback removes running filter");
+    error += check(error_ok != channel_ref_remove_filter(pair[1], filter_dir_in, "count"), "removed filter is gone");
+    channel_ref_close(pair[0]);
+    channel_ref_close(pair[1]);
+
+    /* 4. 其他线程写入，写方向过滤器仍在loop_t线程内运行 */
+    create_pair(loop, pair, frame_cb);
+    channel_ref_add_filter(pair[0], filter_dir_out, "thread", thread_filter, 0);
+    channel_ref_add_filter(pair[0], filter_dir_out, "xor", xor_filter, 0);
+    channel_ref_add_filter(pair[1], filter_dir_in, "xor", xor_filter, 0);
+    channel_ref_add_filter(pair[1], filter_dir_in, "thread", thread_filter, 0);
+    received = 0;
+    corrupt  = 0;
+    runner   = thread_runner_create(writer_thread, pair[0]);
+    thread_runner_start(runner, 0);
+    deadline = time_get_milliseconds() + 10000;
+    while ((received < THREAD_MESSAGES) && (time_get_milliseconds() < deadline)) {
+        loop_run_once(loop);
+    }
+    thread_runner_join(runner);
+    thread_runner_destroy(runner);
+    error += check((received == THREAD_MESSAGES) && !corrupt, "messages written from another thread");
+    error += check(!off_loop, "filters run on the loop thread");
+    channel_ref_close(pair[0]);
+    channel_ref_close(pair[1]);
+
+    loop_destroy(loop);
+    return error ? 1 : 0;
+}
+
+#endif /* TEST_FILTER */
+#endif
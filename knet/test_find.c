@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_FIND
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+#include "ringbuffer.h"
+
+#define PORT 7910
+#define MAX_RING 160          /* 随机测试的最大环长度 */
+#define ROUNDS 200            /* 每种环长度的随机轮数 */
+#define BENCH_SIZE (1 << 20)  /* 吞吐测试的数据长度 */
+#define BENCH_ROUNDS 200
+
+int found_line = -1;
+
+/*
+ * 写入环形缓冲区，绕回时分两段拷贝
+ */
+void ring_write(ringbuffer_t* rb, const char* data, uint32_t size) {
+    char*    ptr[2] = {0};
+    uint32_t len[2] = {0};
+    int      count  = ringbuffer_write_lock_segments(rb, ptr, len);
+    uint32_t first  = min(size, len[0]);
+    memcpy(ptr[0], data, first);
+    if ((count > 1) && (size > first)) {
+        memcpy(ptr[1], data + first, size - first);
+    }
+    ringbuffer_write_commit(rb, size);
+}
+
+/*
+ * 逐字节比较的参照实现
+ */
+int naive_find(const char* data, uint32_t length, uint32_t offset, const char* delim, uint32_t size) {
+    uint32_t i = offset;
+    if (!size) {
+        return -1;
+    }
+    for (; i + size <= length; i++) {
+        if (!memcmp(data + i, delim, size)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * 随机环长度、读写位置及内容，与参照实现比较
+ */
+int random_compare() {
+    static const char* delims[] = {"\n", "\r\n", "\r\n\r\n", "ab", "\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n"};
+    static const char  alphabet[] = "\r\n\r\nab";
+    char               data[MAX_RING];
+    char               linear[MAX_RING];
+    ringbuffer_t*      rb      = 0;
+    uint32_t           max     = 0;
+    uint32_t           shift   = 0;
+    uint32_t           count   = 0;
+    uint32_t           offset  = 0;
+    uint32_t           i       = 0;
+    int                d       = 0;
+    int                r       = 0;
+    int                errors  = 0;
+    memset(data, 0, sizeof(data));
+    srand(1);
+    for (max = 1; max <= MAX_RING; max++) {
+        rb = ringbuffer_create(max);
+        for (r = 0; r < ROUNDS; r++) {
+            /* 移动读写位置，使数据从随机位置开始并可能绕回 */
+            ringbuffer_eat(rb);
+            shift = (uint32_t)rand() % max;
+            ring_write(rb, data, shift);
+            ringbuffer_read_lock_size(rb);
+            ringbuffer_read_commit(rb, shift);
+            count = (uint32_t)rand() % (max + 1);
+            for (i = 0; i < count; i++) {
+                /* 分隔符字符密集，制造大量部分匹配 */
+                data[i] = ((rand() % 4) == 0) ? 'x' : alphabet[rand() % (sizeof(alphabet) - 1)];
+            }
+            ring_write(rb, data, count);
+            ringbuffer_copy(rb, linear, count);
+            offset = count ? (uint32_t)rand() % count : 0;
+            for (d = 0; d < (int)(sizeof(delims) / sizeof(delims[0])); d++) {
+                if (ringbuffer_find_offset(rb, offset, delims[d], (uint32_t)strlen(delims[d])) !=
+                    naive_find(linear, count, offset, delims[d], (uint32_t)strlen(delims[d]))) {
+                    errors++;
+                }
+            }
+        }
+        ringbuffer_destroy(rb);
+    }
+    return errors;
+}
+
+/*
+ * 分隔符正好跨越绕回点的每一个位置
+ */
+int wrap_positions() {
+    ringbuffer_t* rb     = 0;
+    char          data[64];
+    int           split  = 0;
+    int           errors = 0;
+    for (split = 0; split <= 4; split++) {
+        memset(data, 'x', sizeof(data));
+        memcpy(data + 40 - split, "\r\n\r\n", 4);
+        /* 读位置移动到24，数据第40字节处绕回，分隔符前split字节位于绕回点之前 */
+        rb = ringbuffer_create(64);
+        ring_write(rb, data, 24);
+        ringbuffer_read_lock_size(rb);
+        ringbuffer_read_commit(rb, 24);
+        ring_write(rb, data, 64);
+        errors += (ringbuffer_find(rb, "\r\n\r\n", 4) != 40 - split);
+        ringbuffer_destroy(rb);
+    }
+    return errors;
+}
+
+void server_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    if (e & channel_cb_event_recv) {
+        found_line = stream_find(channel_ref_get_stream(channel), "\r\n", 2);
+    }
+}
+
+/*
+ * 1MB无分隔符数据的查找吞吐，与逐字节查找比较
+ */
+void bench() {
+    ringbuffer_t* rb     = ringbuffer_create(BENCH_SIZE);
+    char*         data   = (char*)malloc(BENCH_SIZE);
+    uint64_t      start  = 0;
+    uint64_t      simd   = 0;
+    uint64_t      naive  = 0;
+    int           i      = 0;
+    int           result = 0;
+    memset(data, 'x', BENCH_SIZE);
+    ring_write(rb, data, BENCH_SIZE);
+    start = time_get_microseconds();
+    for (i = 0; i < BENCH_ROUNDS; i++) {
+        result += ringbuffer_find(rb, "\r\n", 2);
+    }
+    simd  = time_get_microseconds() - start;
+    start = time_get_microseconds();
+    for (i = 0; i < BENCH_ROUNDS; i++) {
+        result += naive_find(data, BENCH_SIZE, 0, "\r\n", 2);
+    }
+    naive = time_get_microseconds() - start;
+    printf("find in 1MB: ring %.2f GB/s, byte loop %.2f GB/s (%d)\n",
+        simd ? BENCH_ROUNDS * (double)BENCH_SIZE / simd / 1000.0 : 0.0,
+        naive ? BENCH_ROUNDS * (double)BENCH_SIZE / naive / 1000.0 : 0.0, result);
+    ringbuffer_destroy(rb);
+    free(data);
+}
+
+int main() {
+    int            error     = 0;
+    uint32_t       deadline  = 0;
+    loop_t*        loop      = loop_create();
+    channel_ref_t* acceptor  = 0;
+    channel_ref_t* connector = 0;
+
+    error += check(!random_compare(), "random rings match byte-by-byte search");
+    error += check(!wrap_positions(), "delimiter split at every wrap position");
+
+    /* 数据流上的查找不取走数据 */
+    acceptor = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(acceptor, server_cb);
+    channel_ref_accept(acceptor, "127.0.0.1", PORT, 16);
+    connector = loop_create_channel(loop, 8, 1024);
+    channel_ref_connect(connector, "127.0.0.1", PORT, 2);
+    loop_run_once(loop);
+    stream_push(channel_ref_get_stream(connector), "hello\r\nworld\r\n", 14);
+    deadline = time_get_milliseconds() + 2000;
+    while ((found_line < 0) && (time_get_milliseconds() < deadline)) {
+        loop_run_once(loop);
+    }
+    error += check(found_line == 5, "stream_find on a channel");
+    channel_ref_close(connector);
+    channel_ref_close(acceptor);
+    loop_run_once(loop);
+    loop_destroy(loop);
+
+    bench();
+    return error ? 1 : 0;
+}
+
+#endif /* TEST_FIND */
+#endif
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_FRAME
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#define PORT 7850
+#define MAX_SIZE 20000  /* 消息体最大长度，远大于读缓冲区初始长度，消息会跨越绕回点 */
+
+/* 覆盖varint长度头的字节数边界及2字节长度头的上限 */
+uint32_t sizes[] = {0, 1, 127, 128, 300, 1000, 16383, 16384, MAX_SIZE};
+#define SIZES (int)(sizeof(sizes) / sizeof(sizes[0]))
+
+int          next    = 0;  /* 期望收到的下一个消息 */
+int          corrupt = 0;  /* 内容错误的消息数 */
+volatile int closed  = 0;
+
+char pattern(uint32_t i, uint32_t size) {
+    return (char)(i * 31 + size);
+}
+
+void echo_cb(channel_ref_t* channel, const char* data, uint32_t size) {
+    channel_ref_write_frame(channel, data, size);
+}
+
+void client_cb(channel_ref_t* channel, const char* data, uint32_t size) {
+    uint32_t i = 0;
+    if ((next >= SIZES) || (size != sizes[next])) {
+        corrupt++;
+    } else {
+        for (; i < size; i++) {
+            if (data[i] != pattern(i, size)) {
+                corrupt++;
+                break;
+            }
+        }
+    }
+    next++;
+}
+
+void event_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    if (e & channel_cb_event_close) {
+        closed++;
+    }
+}
+
+/* 运行loop_t直到条件满足或超时 */
+int run_until(loop_t* loop, volatile int* value, int expect, uint32_t ms) {
+    uint32_t start = time_get_milliseconds();
+    while ((*value < expect) && (time_get_milliseconds() - start < ms)) {
+        loop_run_once(loop);
+    }
+    return (*value >= expect);
+}
+
+/*
+ * 按给定的长度头和校验和设置经TCP回显所有长度的消息
+ */
+int round_trip(loop_t* loop, int port, frame_type_e type, int big_endian, int checksum) {
+    channel_ref_t* acceptor  = 0;
+    channel_ref_t* connector = 0;
+    char           message[MAX_SIZE];
+    char           name[64];
+    uint32_t       i         = 0;
+    int            j         = 0;
+    acceptor = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_frame(acceptor, type, big_endian, MAX_SIZE, echo_cb);
+    channel_ref_set_frame_checksum(acceptor, checksum);
+    if (error_ok != channel_ref_accept(acceptor, "127.0.0.1", port, 16)) {
+        return 1;
+    }
+    connector = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(connector, event_cb);
+    channel_ref_set_frame(connector, type, big_endian, MAX_SIZE, client_cb);
+    channel_ref_set_frame_checksum(connector, checksum);
+    channel_ref_connect(connector, "127.0.0.1", port, 2);
+    next    = 0;
+    corrupt = 0;
+    for (j = 0; j < SIZES; j++) {
+        for (i = 0; i < sizes[j]; i++) {
+            message[i] = pattern(i, sizes[j]);
+        }
+        channel_ref_write_frame(connector, message, sizes[j]);
+    }
+    run_until(loop, &next, SIZES, 5000);
+    channel_ref_close(connector);
+    channel_ref_close(acceptor);
+    loop_run_once(loop);
+    if (type == frame_type_varint) {
+        sprintf(name, "varint%s round trip", checksum ? " crc32c" : "");
+    } else {
+        sprintf(name, "%d-byte%s%s round trip", (int)type, big_endian ? " big-endian" : "",
+            checksum ? " crc32c" : "");
+    }
+    return check((next == SIZES) && !corrupt, name);
+}
+
+int main() {
+    frame_type_e   types[]   = {frame_type_2, frame_type_4, frame_type_8, frame_type_varint};
+    int            error     = 0;
+    int            port      = PORT;
+    int            i         = 0;
+    int            j         = 0;
+    loop_t*        loop      = loop_create();
+    channel_ref_t* channel   = 0;
+    channel_ref_t* acceptor  = 0;
+    char           header[4] = {0x7f, (char)0xff, (char)0xff, (char)0xff};
+    char           message[MAX_SIZE + 1] = {0};
+
+    /* 1. 所有长度头类型、字节序及校验和组合 */
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 4; j++) {
+            if ((types[i] == frame_type_varint) && (j & 1)) {
+                /* varint不区分字节序 */
+                continue;
+            }
+            error += round_trip(loop, port++, types[i], j & 1, j & 2);
+        }
+    }
+
+    /* 2. 最大长度的校验 */
+    acceptor = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(acceptor, event_cb);
+    error += check(error_frame_too_large == channel_ref_set_frame(acceptor, frame_type_4, 1, 0xfffffff2, echo_cb),
+        "max_size overflowing uint32 rejected");
+    error += check(error_frame_too_large == channel_ref_set_frame(acceptor, frame_type_2, 1, 0x10000, echo_cb),
+        "max_size beyond 2-byte header rejected");
+    error += check(error_ok == channel_ref_set_frame(acceptor, frame_type_2, 1, 0xffff, echo_cb),
+        "max_size 65535 with 2-byte header");
+    error += check(error_ok == channel_ref_set_frame(acceptor, frame_type_4, 1, MAX_SIZE, echo_cb),
+        "set_frame");
+    error += check(channel_ref_get_max_recv_ring_len(acceptor) >= MAX_SIZE + 14, "read ring raised to fit a message");
+    error += check(error_frame_too_large == channel_ref_write_frame(acceptor, message, MAX_SIZE + 1),
+        "oversized write rejected");
+
+    /* 3. 对端声明的长度超过最大长度时关闭 */
+    channel_ref_accept(acceptor, "127.0.0.1", port, 16);
+    channel = loop_create_channel(loop, 8, 1024);
+    channel_ref_connect(channel, "127.0.0.1", port, 2);
+    loop_run_once(loop);
+    stream_push(channel_ref_get_stream(channel), header, sizeof(header));
+    closed = 0;
+    error += check(run_until(loop, &closed, 1, 5000), "oversized frame closes the channel");
+
+    loop_destroy(loop);
+    return error ? 1 : 0;
+}
+
+#endif /* TEST_FRAME */
+#endif
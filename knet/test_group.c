@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_GROUP
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#define MIN_LOOP 1         /* 最少loop_t数量 */
+#define MAX_LOOP 4         /* 最多loop_t数量 */
+#define CONNECTIONS 8      /* 连接数 */
+#define HOT_BURN_US 5000   /* 繁忙阶段服务端每次应答消耗的CPU时间（微秒） */
+#define PORT 7810
+
+volatile int     hot = 1;
+atomic_counter_t replies = 0;
+int              closed = 0;
+channel_ref_t*   clients[CONNECTIONS];
+
+void burn(uint64_t us) {
+    uint64_t start = time_get_microseconds();
+    while (time_get_microseconds() - start < us);
+}
+
+void server_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      buffer[4];
+    stream_t* stream = channel_ref_get_stream(channel);
+    if (e & channel_cb_event_recv) {
+        stream_pop(stream, buffer, sizeof(buffer));
+        if (hot) {
+            burn(HOT_BURN_US);
+        }
+        stream_push(stream, buffer, sizeof(buffer));
+    }
+}
+
+void client_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    stream_t* stream = channel_ref_get_stream(channel);
+    if (e & channel_cb_event_connect) {
+        stream_push(stream, "ping", 4);
+    } else if (e & channel_cb_event_recv) {
+        stream_eat(stream);
+        atomic_counter_inc(&replies);
+        if (hot) {
+            /* 繁忙阶段不停地往返 */
+            stream_push(stream, "ping", 4);
+        }
+    } else if (e & channel_cb_event_close) {
+        closed++;
+    }
+}
+
+void run_loops(loop_t* loop, loop_t* client_loop, uint32_t ms) {
+    uint32_t start = time_get_milliseconds();
+    while (time_get_milliseconds() - start < ms) {
+        loop_run_once(loop);
+        loop_run_once(client_loop);
+    }
+}
+
+int main() {
+    int            i           = 0;
+    int            peak        = 0;
+    int            final       = 0;
+    int            ok          = 0;
+    loop_group_t*  group       = 0;
+    loop_t*        loop        = 0;
+    loop_t*        client_loop = 0;
+    channel_ref_t* acceptor    = 0;
+    uint32_t       start       = 0;
+
+    group = loop_group_create(MIN_LOOP, MAX_LOOP);
+    loop_group_set_shrink(group, 200, 2000);
+    /* 扩容后将已有的繁忙连接迁移到新的loop_t */
+    loop_balancer_set_rebalance(loop_group_get_balancer(group), 500);
+    if (error_ok != loop_group_start(group)) {
+        printf("loop_group_start failed\n");
+        return 1;
+    }
+    /* 监听所在loop_t在主线程运行，不参与分配 */
+    loop = loop_create();
+    loop_group_bind(group, loop);
+    acceptor = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(acceptor, server_cb);
+    if (error_ok != channel_ref_accept(acceptor, "127.0.0.1", PORT, 1024)) {
+        printf("channel_ref_accept failed\n");
+        return 1;
+    }
+    client_loop = loop_create();
+    for (i = 0; i < CONNECTIONS; i++) {
+        clients[i] = loop_create_channel(client_loop, 8, 1024);
+        channel_ref_set_cb(clients[i], client_cb);
+        channel_ref_connect(clients[i], "127.0.0.1", PORT, 2);
+    }
+    /* 繁忙阶段：loop_t数量增加，增加到多少取决于可用的CPU核数，最多MAX_LOOP */
+    start = time_get_milliseconds();
+    while (time_get_milliseconds() - start < 8000) {
+        run_loops(loop, client_loop, 1000);
+        peak = max(peak, loop_group_get_count(group));
+        printf("hot  loops:%d replies:%d\n", loop_group_get_count(group), (int)replies);
+    }
+    /* 空闲阶段：连接保持，loop_t回收到下限，管道迁移到剩余的loop_t */
+    hot = 0;
+    start = time_get_milliseconds();
+    while ((time_get_milliseconds() - start < 20000) && (loop_group_get_count(group) > MIN_LOOP)) {
+        run_loops(loop, client_loop, 1000);
+        printf("idle loops:%d\n", loop_group_get_count(group));
+    }
+    /* 等待最后回收的loop_t排空销毁后，所有连接仍可往返 */
+    run_loops(loop, client_loop, 3000);
+    replies = 0;
+    for (i = 0; i < CONNECTIONS; i++) {
+        stream_push(channel_ref_get_stream(clients[i]), "ping", 4);
+    }
+    start = time_get_milliseconds();
+    while (((int)replies < CONNECTIONS) && (time_get_milliseconds() - start < 5000)) {
+        run_loops(loop, client_loop, 10);
+    }
+    final = loop_group_get_count(group);
+    printf("peak loops:%d final loops:%d replies:%d/%d closed:%d\n", peak, final, (int)replies, CONNECTIONS, closed);
+    /* 回收过程中连接不能断开 */
+    ok = (peak > MIN_LOOP) && (final == MIN_LOOP) && ((int)replies == CONNECTIONS) && !closed;
+
+    loop_destroy(loop);
+    loop_destroy(client_loop);
+    loop_group_destroy(group);
+    return ok ? 0 : 1;
+}
+
+#endif /* TEST_GROUP */
+#endif
@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_HTTP
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#define PORT 7870
+#define BENCH_PORT 7871
+#define MAX_LOOP 4         /* 吞吐测试服务端loop数量 */
+#define MAX_CLIENT 64      /* 吞吐测试客户端连接数 */
+#define PIPELINE_DEPTH 16  /* 每个连接同时发出的请求数 */
+#define TEST_REQUESTS 1000000
+
+const char request[] = "GET /health HTTP/1.1\r\nHost: localhost\r\n\r\n";
+int sent_count = 0;
+int recv_count = 0;
+
+const char*     pending      = 0;    /* 连接完成后发送的请求 */
+char            reply[8192]  = {0};  /* 收到的应答 */
+int             reply_size   = 0;
+int             closed       = 0;
+http_request_t* deferred     = 0;    /* 回调内未应答的请求 */
+int             thread_error = 0;    /* 其他线程应答的返回值 */
+
+void request_cb(channel_ref_t* channel, http_request_t* req) {
+    const char* data     = 0;
+    uint32_t    size     = 0;
+    char        body[64] = {0};
+    if (http_request_check_method(req, "POST")) {
+        data = http_request_get_body(req, &size);
+        http_response_write(req, 200, "text/plain", data, size);
+        return;
+    }
+    data = http_request_get_uri(req, &size);
+    if ((size == 5) && !memcmp(data, "/keep", 5)) {
+        sprintf(body, "%d", http_request_check_keep_alive(req));
+    } else if ((size == 6) && !memcmp(data, "/token", 6)) {
+        sprintf(body, "%d%d", http_request_check_header_token(req, "X-List", "upgrade"),
+            http_request_check_header_token(req, "X-List", "grade"));
+    } else if ((size == 8) && !memcmp(data, "/chunked", 8)) {
+        http_response_begin_chunked(req, 200, "text/plain");
+        http_response_write_chunk(req, "abc", 3);
+        http_response_write_chunk(req, "defg", 4);
+        http_response_end_chunked(req);
+        return;
+    } else if ((size == 6) && !memcmp(data, "/defer", 6)) {
+        deferred = req;
+        return;
+    } else {
+        memcpy(body, data, min(size, sizeof(body) - 1));
+    }
+    http_response_write(req, 200, "text/plain", body, (uint32_t)strlen(body));
+}
+
+void client_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    stream_t* stream = channel_ref_get_stream(channel);
+    int       size   = 0;
+    if (e & channel_cb_event_connect) {
+        stream_push(stream, (void*)pending, (int)strlen(pending));
+    } else if (e & channel_cb_event_recv) {
+        size = min(stream_available(stream), (int)sizeof(reply) - 1 - reply_size);
+        stream_pop(stream, reply + reply_size, size);
+        reply_size += size;
+        reply[reply_size] = 0;
+    } else if (e & channel_cb_event_close) {
+        closed = 1;
+    }
+}
+
+/*
+ * 发送请求，直到应答内出现until、连接关闭或请求被挂起，until为0时等待连接关闭
+ */
+channel_ref_t* exchange(loop_t* loop, const char* req, const char* until) {
+    channel_ref_t* connector = loop_create_channel(loop, 8, 8192);
+    uint32_t       deadline  = time_get_milliseconds() + 2000;
+    pending    = req;
+    reply[0]   = 0;
+    reply_size = 0;
+    closed     = 0;
+    channel_ref_set_cb(connector, client_cb);
+    channel_ref_connect(connector, "127.0.0.1", PORT, 2);
+    while (!closed && !deferred && (!until || !strstr(reply, until)) && (time_get_milliseconds() < deadline)) {
+        loop_run_once(loop);
+    }
+    return connector;
+}
+
+void finish(loop_t* loop, channel_ref_t* connector) {
+    if (!closed) {
+        channel_ref_close(connector);
+    }
+    loop_run_once(loop);
+}
+
+void respond_thread(thread_runner_t* runner) {
+    thread_error = http_response_write((http_request_t*)thread_runner_get_params(runner), 200, 0, "x", 1);
+}
+
+/*
+ * 管线化吞吐测试
+ */
+void send_requests(channel_ref_t* channel, int count) {
+    char buffer[sizeof(request) * PIPELINE_DEPTH];
+    int  size = 0;
+    for (; (count > 0) && (sent_count < TEST_REQUESTS); count--, sent_count++) {
+        memcpy(buffer + size, request, sizeof(request) - 1);
+        size += sizeof(request) - 1;
+    }
+    if (size) {
+        /* 一次写入多个请求 */
+        stream_push(channel_ref_get_stream(channel), buffer, size);
+    }
+}
+
+void health_cb(channel_ref_t* channel, http_request_t* req) {
+    http_response_write(req, 200, "text/plain", "ok", 2);
+}
+
+void connector_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      buffer[256] = {0};
+    stream_t* stream      = 0;
+    int       pos         = 0;
+    int       responses   = 0;
+    if (e & channel_cb_event_connect) {
+        send_requests(channel, PIPELINE_DEPTH);
+    } else if (e & channel_cb_event_recv) {
+        stream = channel_ref_get_stream(channel);
+        /* 应答头之后是2字节的消息体 */
+        while ((pos = stream_find(stream, "\r\n\r\n", 4)) >= 0) {
+            if (stream_available(stream) < pos + 6) {
+                break;
+            }
+            stream_pop(stream, buffer, pos + 6);
+            responses++;
+        }
+        recv_count += responses;
+        send_requests(channel, responses);
+    }
+}
+
+int bench() {
+    int              i         = 0;
+    loop_t*          main_loop = 0;
+    loop_t*          sub_loop[MAX_LOOP] = {0};
+    thread_runner_t* runner[MAX_LOOP]   = {0};
+    channel_ref_t*   acceptor  = 0;
+    channel_ref_t*   connector = 0;
+    loop_balancer_t* balancer  = 0;
+    uint32_t         start     = 0;
+    uint32_t         elapsed   = 0;
+
+    balancer = loop_balancer_create();
+    for (i = 0; i < MAX_LOOP; i++) {
+        sub_loop[i] = loop_create();
+        loop_balancer_attach(balancer, sub_loop[i]);
+        runner[i] = thread_runner_create(0, 0);
+        thread_runner_start_loop(runner[i], sub_loop[i], 0);
+    }
+    main_loop = loop_create();
+    acceptor = loop_create_channel(main_loop, 8, 1024 * 8);
+    channel_ref_set_http(acceptor, health_cb);
+    if (error_ok == channel_ref_accept(acceptor, "127.0.0.1", BENCH_PORT, 5000)) {
+        /* 监听管道接受的连接分配到其他loop */
+        loop_balancer_attach(balancer, main_loop);
+        start = time_get_milliseconds();
+        for (i = 0; i < MAX_CLIENT; i++) {
+            connector = loop_create_channel(main_loop, 8, 1024 * 8);
+            channel_ref_set_cb(connector, connector_cb);
+            channel_ref_connect(connector, "127.0.0.1", BENCH_PORT, 2);
+        }
+        while ((recv_count < TEST_REQUESTS) && (time_get_milliseconds() - start < 60000)) {
+            loop_run_once(main_loop);
+        }
+        elapsed = time_get_milliseconds() - start;
+        printf("%d requests, %d connections, pipeline depth %d, %u ms, %.0f requests/s\n",
+            recv_count, MAX_CLIENT, PIPELINE_DEPTH, elapsed, elapsed ? recv_count * 1000.0 / elapsed : 0.0);
+    }
+
+    for (i = 0; i < MAX_LOOP; i++) {
+        thread_runner_stop(runner[i]);
+        thread_runner_join(runner[i]);
+        thread_runner_destroy(runner[i]);
+    }
+    for (i = 0; i < MAX_LOOP; i++) {
+        loop_destroy(sub_loop[i]);
+    }
+    loop_destroy(main_loop);
+    loop_balancer_destroy(balancer);
+    return (recv_count >= TEST_REQUESTS);
+}
+
+int main() {
+    int              error     = 0;
+    loop_t*          loop      = loop_create();
+    channel_ref_t*   acceptor  = 0;
+    channel_ref_t*   connector = 0;
+    thread_runner_t* runner    = 0;
+
+    acceptor = loop_create_channel(loop, 8, 8192);
+    channel_ref_set_http(acceptor, request_cb);
+    error += check(error_ok == channel_ref_accept(acceptor, "127.0.0.1", PORT, 16), "listen");
+
+    connector = exchange(loop, "GET /hello HTTP/1.1\r\nHost: a\r\n\r\n", "/hello");
+    error += check(!strncmp(reply, "HTTP/1.1 200 OK\r\n", 17) && strstr(reply, "Content-Length: 6\r\n") &&
+        strstr(reply, "Connection: keep-alive\r\n") && strstr(reply, "\r\n\r\n/hello"), "GET response");
+    finish(loop, connector);
+
+    /* 一次写入的多个请求按顺序应答 */
+    connector = exchange(loop, "GET /a HTTP/1.1\r\n\r\nGET /bb HTTP/1.1\r\n\r\nGET /ccc HTTP/1.1\r\n\r\n", "/ccc");
+    error += check(strstr(reply, "/a") && strstr(reply, "/bb") && (strstr(reply, "/a") < strstr(reply, "/bb")) &&
+        (strstr(reply, "/bb") < strstr(reply, "/ccc")), "pipelined responses in order");
+    finish(loop, connector);
+
+    connector = exchange(loop, "POST /echo HTTP/1.1\r\nContent-Length: 11\r\n\r\nhello world", "hello world");
+    error += check(strstr(reply, "Content-Length: 11\r\n") && strstr(reply, "\r\n\r\nhello world"), "POST body echoed");
+    finish(loop, connector);
+
+    /* Connection按token列表解析 */
+    connector = exchange(loop, "GET /keep HTTP/1.0\r\nConnection: keep-alive, Upgrade\r\n\r\n", "\r\n\r\n1");
+    error += check(strstr(reply, "\r\n\r\n1") && !closed, "HTTP/1.0 'keep-alive, Upgrade' keeps");
+    finish(loop, connector);
+    connector = exchange(loop, "GET /keep HTTP/1.1\r\nConnection: Upgrade , close\r\n\r\n", 0);
+    error += check(strstr(reply, "Connection: close\r\n") && strstr(reply, "\r\n\r\n0") && closed,
+        "HTTP/1.1 'Upgrade , close' closes");
+    finish(loop, connector);
+    connector = exchange(loop, "GET /keep HTTP/1.1\r\nConnection: keep-alive\r\nConnection: close\r\n\r\n", 0);
+    error += check(strstr(reply, "\r\n\r\n0") && closed, "close wins over keep-alive");
+    finish(loop, connector);
+    connector = exchange(loop, "GET /token HTTP/1.1\r\nX-List: a,\tUpgrade ,b\r\n\r\n", "\r\n\r\n10");
+    error += check(strstr(reply, "\r\n\r\n10") != 0, "header token match is exact");
+    finish(loop, connector);
+
+    connector = exchange(loop, "GET /chunked HTTP/1.1\r\n\r\n", "0\r\n\r\n");
+    error += check(strstr(reply, "Transfer-Encoding: chunked\r\n") &&
+        strstr(reply, "\r\n\r\n3\r\nabc\r\n4\r\ndefg\r\n0\r\n\r\n"), "chunked response");
+    finish(loop, connector);
+
+    connector = exchange(loop, "BROKEN\r\n\r\n", 0);
+    error += check(!strncmp(reply, "HTTP/1.1 400 ", 13) && closed, "malformed request gets 400");
+    finish(loop, connector);
+
+    /* 重复的Content-Length，无论值是否相同都拒绝 */
+    connector = exchange(loop, "POST /echo HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 11\r\n\r\nhello world", 0);
+    error += check(!strncmp(reply, "HTTP/1.1 400 ", 13) && closed, "differing Content-Length gets 400");
+    finish(loop, connector);
+    connector = exchange(loop, "POST /echo HTTP/1.1\r\nContent-Length: 5\r\ncontent-length: 5\r\n\r\nhello", 0);
+    error += check(!strncmp(reply, "HTTP/1.1 400 ", 13) && closed, "repeated Content-Length gets 400");
+    finish(loop, connector);
+
+    /* 其他线程应答被拒绝，回到管道所在线程后应答成功 */
+    deferred  = 0;
+    connector = exchange(loop, "GET /defer HTTP/1.1\r\n\r\n", 0);
+    error += check(deferred != 0, "request deferred");
+    if (deferred) {
+        runner = thread_runner_create(respond_thread, deferred);
+        thread_runner_start(runner, 0);
+        thread_runner_join(runner);
+        thread_runner_destroy(runner);
+        error += check(thread_error == error_http_thread, "response from other thread rejected");
+        error += check(http_response_write(deferred, 200, 0, "late", 4) == error_ok, "response from loop thread");
+        deferred = 0;
+        while (!strstr(reply, "late") && !closed) {
+            loop_run_once(loop);
+        }
+        error += check(strstr(reply, "\r\n\r\nlate") != 0, "deferred response delivered");
+    }
+    finish(loop, connector);
+
+    channel_ref_close(acceptor);
+    loop_run_once(loop);
+    loop_destroy(loop);
+
+    error += check(bench(), "pipelined throughput run completed");
+    return error ? 1 : 0;
+}
+
+#endif /* TEST_HTTP */
+#endif
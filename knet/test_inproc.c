@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_INPROC
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#define MESSAGE_SIZE 4            /* ping-pong消息长度 */
+#define ROUNDS 100000             /* 每次测量的往返次数 */
+#define RING_SIZE 1024            /* 传输测试读端的环形缓冲区长度 */
+#define CHUNK_SIZE 1000           /* 传输测试每次写入的长度 */
+#define CHUNKS 20000              /* 共传输20MB */
+
+int           rounds   = 0;
+volatile int  closed   = 0;
+volatile int  received = 0;  /* 传输测试已收到的字节数 */
+volatile int  corrupt  = 0;  /* 传输测试收到的错误字节数 */
+volatile int  early    = 0;  /* 收齐数据前收到关闭 */
+unsigned char expect   = 0;
+
+void echo_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      buffer[MESSAGE_SIZE];
+    stream_t* stream = channel_ref_get_stream(channel);
+    if (e & channel_cb_event_recv) {
+        while (stream_available(stream) >= MESSAGE_SIZE) {
+            stream_pop(stream, buffer, MESSAGE_SIZE);
+            stream_push(stream, buffer, MESSAGE_SIZE);
+        }
+    }
+}
+
+void ping_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      buffer[MESSAGE_SIZE];
+    stream_t* stream = channel_ref_get_stream(channel);
+    if (e & channel_cb_event_recv) {
+        while (stream_available(stream) >= MESSAGE_SIZE) {
+            stream_pop(stream, buffer, MESSAGE_SIZE);
+            if (++rounds < ROUNDS) {
+                stream_push(stream, buffer, MESSAGE_SIZE);
+            } else {
+                channel_ref_close(channel);
+            }
+        }
+    }
+    if (e & channel_cb_event_close) {
+        closed = 1;
+    }
+}
+
+void reader_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      buffer[CHUNK_SIZE];
+    stream_t* stream = channel_ref_get_stream(channel);
+    int       size   = 0;
+    int       i      = 0;
+    if (e & channel_cb_event_recv) {
+        while ((size = stream_available(stream)) > 0) {
+            size = min(size, CHUNK_SIZE);
+            stream_pop(stream, buffer, size);
+            for (i = 0; i < size; i++) {
+                if ((unsigned char)buffer[i] != expect++) {
+                    corrupt++;
+                }
+            }
+            received += size;
+        }
+    }
+    if (e & channel_cb_event_close) {
+        if (received < CHUNKS * CHUNK_SIZE) {
+            early = 1;
+        }
+        closed = 1;
+    }
+}
+
+/*
+ * pair[0]在loop_a内发起ping-pong，pair[1]在loop_b内回显，返回每次往返的微秒数，失败返回0
+ * loop_b不为loop_a时在其他线程内运行
+ */
+double ping_pong(loop_t* loop_a, loop_t* loop_b) {
+    channel_ref_t*   pair[2]  = {0};
+    thread_runner_t* runner   = 0;
+    char             buffer[MESSAGE_SIZE] = {0};
+    uint64_t         start    = 0;
+    uint32_t         deadline = 0;
+    loop_create_channel_pair(loop_a, loop_b, 8, 1024, pair);
+    channel_ref_set_cb(pair[0], ping_cb);
+    channel_ref_set_cb(pair[1], echo_cb);
+    if (loop_b != loop_a) {
+        runner = thread_runner_create(0, 0);
+        thread_runner_start_loop(runner, loop_b, 0);
+    }
+    rounds = 0;
+    closed = 0;
+    /* 管道在下次循环时加入活跃链表 */
+    loop_run_once(loop_a);
+    start    = time_get_microseconds();
+    deadline = time_get_milliseconds() + 60000;
+    stream_push(channel_ref_get_stream(pair[0]), buffer, MESSAGE_SIZE);
+    while (!closed && (time_get_milliseconds() < deadline)) {
+        loop_run_once(loop_a);
+    }
+    if (runner) {
+        thread_runner_stop(runner);
+        thread_runner_join(runner);
+        thread_runner_destroy(runner);
+    }
+    if (rounds < ROUNDS) {
+        return 0;
+    }
+    return (double)(time_get_microseconds() - start) / rounds;
+}
+
+/*
+ * 向另一个线程单向传输，读端环形缓冲区远小于传输量，检查顺序及关闭时机
+ */
+int transfer(loop_t* loop, loop_t* reader_loop) {
+    channel_ref_t*   pair[2]  = {0};
+    thread_runner_t* runner   = 0;
+    char             chunk[CHUNK_SIZE];
+    unsigned char    value    = 0;
+    uint32_t         deadline = 0;
+    int              i        = 0;
+    int              j        = 0;
+    int              error    = error_ok;
+    loop_create_channel_pair(loop, reader_loop, 8, RING_SIZE, pair);
+    channel_ref_set_max_recv_ring_len(pair[1], RING_SIZE);
+    channel_ref_set_cb(pair[1], reader_cb);
+    closed   = 0;
+    received = 0;
+    corrupt  = 0;
+    early    = 0;
+    expect   = 0;
+    runner = thread_runner_create(0, 0);
+    thread_runner_start_loop(runner, reader_loop, 0);
+    loop_run_once(loop);
+    for (i = 0; i < CHUNKS; i++) {
+        for (j = 0; j < CHUNK_SIZE; j++) {
+            chunk[j] = (char)value++;
+        }
+        error = stream_push(channel_ref_get_stream(pair[0]), chunk, CHUNK_SIZE);
+        if ((error != error_ok) && (error != error_send_patial)) {
+            break;
+        }
+        if (!(i % 100)) {
+            loop_run_once(loop);
+        }
+    }
+    channel_ref_close(pair[0]);
+    deadline = time_get_milliseconds() + 60000;
+    while (!closed && (time_get_milliseconds() < deadline)) {
+        loop_run_once(loop);
+    }
+    thread_runner_stop(runner);
+    thread_runner_join(runner);
+    thread_runner_destroy(runner);
+    return closed && !early && (received == CHUNKS * CHUNK_SIZE) && !corrupt;
+}
+
+int main() {
+    int     error   = 0;
+    double  single  = 0;
+    double  threads = 0;
+    loop_t* loop    = loop_create();
+    loop_t* other   = loop_create();
+
+    single = ping_pong(loop, loop);
+    error += check(single > 0, "same-loop ping-pong");
+    threads = ping_pong(loop, other);
+    error += check(threads > 0, "cross-thread ping-pong");
+    error += check(transfer(loop, other), "20MB transfer into 1KB ring");
+    printf("%d byte round trip: same loop %.2fus, cross-thread %.2fus\n", MESSAGE_SIZE, single, threads);
+
+    loop_destroy(other);
+    loop_destroy(loop);
+    return error ? 1 : 0;
+}
+
+#endif /* TEST_INPROC */
+#endif
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_IPV6
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#define TCP_PORT 7860
+#define UDP_PORT 7861
+
+int  connected     = 0;
+int  accepted      = 0;
+int  received      = 0;
+char peer[64]      = {0}; /* 服务端看到的对端IP */
+char udp_peer[64]  = {0}; /* UDP服务端看到的对端IP */
+char udp_reply[64] = {0}; /* UDP客户端收到的应答来源IP */
+
+void acceptor_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    if (e & channel_cb_event_accept) {
+        strcpy(peer, address_get_ip(channel_ref_get_peer_address(channel)));
+        accepted++;
+    }
+}
+
+void connector_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    if (e & channel_cb_event_connect) {
+        connected++;
+    }
+}
+
+void udp_server_cb(channel_ref_t* channel, const char* data, uint32_t size, address_t* address) {
+    strcpy(udp_peer, address_get_ip(address));
+    channel_ref_sendto(channel, data, size, address_get_ip(address), address_get_port(address));
+}
+
+void udp_client_cb(channel_ref_t* channel, const char* data, uint32_t size, address_t* address) {
+    strcpy(udp_reply, address_get_ip(address));
+    received++;
+}
+
+void run_until(loop_t* loop, int* var, int expect) {
+    uint32_t deadline = time_get_milliseconds() + 2000;
+    while ((*var < expect) && (time_get_milliseconds() < deadline)) {
+        loop_run_once(loop);
+    }
+}
+
+/*
+ * 连接到双栈监听器，返回服务端看到的对端IP是否为expect
+ */
+int tcp_connect(loop_t* loop, const char* ip, const char* expect) {
+    channel_ref_t* connector = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(connector, connector_cb);
+    connected = 0;
+    accepted  = 0;
+    peer[0]   = 0;
+    if (error_ok != channel_ref_connect(connector, ip, TCP_PORT, 2)) {
+        return 0;
+    }
+    run_until(loop, &connected, 1);
+    run_until(loop, &accepted, 1);
+    channel_ref_close(connector);
+    return (connected && accepted && !strcmp(peer, expect));
+}
+
+/*
+ * UDP客户端发送一个数据报并等待应答，返回双方看到的IP是否为expect
+ */
+int udp_echo(loop_t* loop, const char* bind_ip, const char* ip, const char* expect) {
+    channel_ref_t* client = loop_create_udp_channel(loop, 1500, 16, udp_client_cb);
+    int            ok     = 0;
+    received     = 0;
+    udp_peer[0]  = 0;
+    udp_reply[0] = 0;
+    if ((error_ok == channel_ref_bind(client, bind_ip, 0)) &&
+        (error_ok == channel_ref_sendto(client, "ping", 4, ip, UDP_PORT))) {
+        run_until(loop, &received, 1);
+        ok = (received && !strcmp(udp_peer, expect) && !strcmp(udp_reply, ip));
+    }
+    channel_ref_close(client);
+    loop_run_once(loop);
+    return ok;
+}
+
+int main() {
+    int                 error     = 0;
+    loop_t*             loop      = loop_create();
+    channel_ref_t*      acceptor  = 0;
+    channel_ref_t*      connector = 0;
+    channel_ref_t*      server    = 0;
+    channel_ref_t*      client    = 0;
+    socket_t            probe     = socket_create_udp_ipv6();
+    struct sockaddr_in6 sa;
+
+    if (!probe) {
+        printf("IPv6 not available, skipped\n");
+        loop_destroy(loop);
+        return 0;
+    }
+    socket_close(probe);
+
+    /* 监听"::"同时接受IPv4和IPv6连接 */
+    acceptor = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(acceptor, acceptor_cb);
+    error += check(error_ok == channel_ref_accept(acceptor, "::", TCP_PORT, 16), "TCP listen on ::");
+    error += check(tcp_connect(loop, "::1", "::1"), "TCP IPv6 peer is ::1");
+    error += check(tcp_connect(loop, "127.0.0.1", "127.0.0.1"), "TCP IPv4 peer on dual-stack is dotted");
+
+    /* 已解析的地址直接连接 */
+    memset(&sa, 0, sizeof(sa));
+    sa.sin6_family = AF_INET6;
+    sa.sin6_port   = htons(TCP_PORT);
+    sa.sin6_addr   = in6addr_loopback;
+    connector = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(connector, connector_cb);
+    connected = 0;
+    accepted  = 0;
+    error += check(error_ok == channel_ref_connect_addr(connector, (struct sockaddr*)&sa, sizeof(sa), 2),
+        "connect_addr with sockaddr_in6");
+    run_until(loop, &connected, 1);
+    run_until(loop, &accepted, 1);
+    error += check(connected && accepted && !strcmp(peer, "::1"), "connect_addr reaches listener");
+    error += check(!strcmp(address_get_ip(channel_ref_get_peer_address(connector)), "::1"),
+        "connect_addr records peer address");
+    channel_ref_close(connector);
+    channel_ref_close(acceptor);
+    loop_run_once(loop);
+
+    /* 双栈UDP */
+    server = loop_create_udp_channel(loop, 1500, 16, udp_server_cb);
+    error += check(error_ok == channel_ref_bind(server, "::", UDP_PORT), "UDP bind on ::");
+    error += check(udp_echo(loop, "::1", "::1", "::1"), "UDP IPv6 echo");
+    error += check(udp_echo(loop, "127.0.0.1", "127.0.0.1", "127.0.0.1"), "UDP IPv4 echo on dual-stack");
+    channel_ref_close(server);
+    loop_run_once(loop);
+
+    /* IPv4管道不能发往IPv6地址 */
+    client = loop_create_udp_channel(loop, 1500, 16, udp_client_cb);
+    channel_ref_bind(client, "127.0.0.1", 0);
+    error += check(error_udp_address == channel_ref_sendto(client, "ping", 4, "::1", UDP_PORT),
+        "IPv4 channel rejects IPv6 target");
+    error += check(error_udp_address == channel_ref_sendto(client, "ping", 4, "not-an-ip", UDP_PORT),
+        "invalid target is rejected");
+    channel_ref_close(client);
+    loop_run_once(loop);
+
+    loop_destroy(loop);
+    return error ? 1 : 0;
+}
+
+#endif /* TEST_IPV6 */
+#endif
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_LOWAT
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#define PORT 7900
+#define MESSAGES 200      /* 每轮发送的消息数 */
+#define MESSAGE_SIZE 8192 /* 消息体长度，头部为4字节长度 */
+#define PIECE 512         /* 每次循环写入的长度，模拟分多次到达 */
+#define SMALL_RING 4096   /* 读缓冲区已满测试的最大长度 */
+
+int            use_lowat  = 0;
+int            callbacks  = 0;
+int            messages   = 0;
+int            corrupted  = 0;
+int            early      = 0;   /* 未达到低水位的回调次数 */
+int            forced     = 0;   /* 读缓冲区满时的回调字节数 */
+int            accepted   = 0;
+channel_ref_t* server     = 0;
+char           message[4 + MESSAGE_SIZE];
+
+/*
+ * 4字节长度头的消息解码，开启低水位时先等头部，再等整个消息
+ */
+void server_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      body[MESSAGE_SIZE];
+    stream_t* stream = channel_ref_get_stream(channel);
+    uint32_t  length = 0;
+    int       i      = 0;
+    if (e & channel_cb_event_accept) {
+        server = channel;
+        accepted++;
+        if (use_lowat) {
+            channel_ref_set_recv_lowat(channel, 4);
+        }
+    } else if (e & channel_cb_event_recv) {
+        callbacks++;
+        if ((uint32_t)stream_available(stream) < channel_ref_get_recv_lowat(channel)) {
+            early++;
+        }
+        while (stream_available(stream) >= 4) {
+            stream_copy(stream, (char*)&length, 4);
+            if (stream_available(stream) < (int)(4 + length)) {
+                if (use_lowat) {
+                    /* 已知消息长度，收齐前不再回调 */
+                    channel_ref_set_recv_lowat(channel, 4 + length);
+                }
+                return;
+            }
+            stream_pop(stream, (char*)&length, 4);
+            stream_pop(stream, body, length);
+            for (i = 0; i < (int)length; i++) {
+                if (body[i] != (char)(messages + i)) {
+                    corrupted++;
+                    break;
+                }
+            }
+            messages++;
+            if (use_lowat) {
+                channel_ref_set_recv_lowat(channel, 4);
+            }
+        }
+    }
+}
+
+void full_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    stream_t* stream = channel_ref_get_stream(channel);
+    if (e & channel_cb_event_accept) {
+        /* 低水位超过读缓冲区最大长度 */
+        channel_ref_set_recv_lowat(channel, SMALL_RING * 4);
+    } else if (e & channel_cb_event_recv) {
+        forced = stream_available(stream);
+        stream_eat(stream);
+    }
+}
+
+void run_until(loop_t* loop, int* var, int expect) {
+    uint32_t deadline = time_get_milliseconds() + 5000;
+    while ((*var < expect) && (time_get_milliseconds() < deadline)) {
+        loop_run_once(loop);
+    }
+}
+
+void make_message(int index) {
+    uint32_t length = MESSAGE_SIZE;
+    int      i      = 0;
+    memcpy(message, &length, 4);
+    for (i = 0; i < MESSAGE_SIZE; i++) {
+        message[4 + i] = (char)(index + i);
+    }
+}
+
+/*
+ * 每条消息分成多段在不同循环内写入，返回回调次数
+ */
+int run(loop_t* loop, int lowat, int port) {
+    channel_ref_t* acceptor  = loop_create_channel(loop, 8, 1024 * 64);
+    channel_ref_t* connector = loop_create_channel(loop, 1024, 1024 * 64);
+    stream_t*      stream    = 0;
+    int            i         = 0;
+    int            offset    = 0;
+    use_lowat = lowat;
+    callbacks = 0;
+    messages  = 0;
+    corrupted = 0;
+    early     = 0;
+    server    = 0;
+    accepted  = 0;
+    channel_ref_set_cb(acceptor, server_cb);
+    channel_ref_accept(acceptor, "127.0.0.1", port, 16);
+    channel_ref_connect(connector, "127.0.0.1", port, 2);
+    run_until(loop, &accepted, 1);
+    stream = channel_ref_get_stream(connector);
+    for (i = 0; i < MESSAGES; i++) {
+        make_message(i);
+        for (offset = 0; offset < (int)sizeof(message); offset += PIECE) {
+            stream_push(stream, message + offset, min(PIECE, (int)sizeof(message) - offset));
+            loop_run_once(loop);
+        }
+    }
+    run_until(loop, &messages, MESSAGES);
+    channel_ref_close(connector);
+    channel_ref_close(acceptor);
+    loop_run_once(loop);
+    printf("lowat %s: %d messages, %d callbacks\n", lowat ? "on " : "off", messages, callbacks);
+    return callbacks;
+}
+
+int main() {
+    int            error     = 0;
+    int            plain     = 0;
+    int            lowat     = 0;
+    int            i         = 0;
+    loop_t*        loop      = loop_create();
+    channel_ref_t* acceptor  = 0;
+    channel_ref_t* connector = 0;
+    char           batch[(4 + 16) * 10];
+    uint32_t       length    = 16;
+
+    plain = run(loop, 0, PORT);
+    error += check((messages == MESSAGES) && !corrupted, "messages intact without lowat");
+    lowat = run(loop, 1, PORT + 1);
+    error += check((messages == MESSAGES) && !corrupted, "messages intact with lowat");
+    error += check(!early, "no callback below lowat");
+    /* 每条消息一次头部回调（头部与前一条消息同时到达时合并）加一次消息回调 */
+    error += check(lowat <= MESSAGES * 2 + 1, "at most two callbacks per message");
+    error += check(lowat * 4 <= plain, "several times fewer callbacks");
+
+    /* 一次到达的多条消息在同一次读事件内全部回调，低水位随解析调整 */
+    server    = 0;
+    accepted  = 0;
+    use_lowat = 1;
+    messages  = 0;
+    acceptor  = loop_create_channel(loop, 8, 1024 * 64);
+    channel_ref_set_cb(acceptor, server_cb);
+    channel_ref_accept(acceptor, "127.0.0.1", PORT + 2, 16);
+    connector = loop_create_channel(loop, 8, 1024 * 64);
+    channel_ref_connect(connector, "127.0.0.1", PORT + 2, 2);
+    run_until(loop, &accepted, 1);
+    for (i = 0; i < 10; i++) {
+        memcpy(batch + i * 20, &length, 4);
+        for (length = 0; length < 16; length++) {
+            batch[i * 20 + 4 + length] = (char)(i + length);
+        }
+        length = 16;
+    }
+    stream_push(channel_ref_get_stream(connector), batch, sizeof(batch));
+    run_until(loop, &messages, 10);
+    error += check((messages == 10) && !corrupted, "batched messages all dispatched");
+    error += check(channel_ref_get_recv_lowat(server) == 4, "lowat reset after last message");
+    channel_ref_close(connector);
+    channel_ref_close(acceptor);
+    loop_run_once(loop);
+
+    /* 读缓冲区已满时无视低水位回调 */
+    forced    = 0;
+    acceptor  = loop_create_channel(loop, 8, SMALL_RING);
+    channel_ref_set_cb(acceptor, full_cb);
+    channel_ref_accept(acceptor, "127.0.0.1", PORT + 3, 16);
+    connector = loop_create_channel(loop, 8, 1024 * 64);
+    channel_ref_connect(connector, "127.0.0.1", PORT + 3, 2);
+    loop_run_once(loop);
+    stream_push(channel_ref_get_stream(connector), message, SMALL_RING);
+    run_until(loop, &forced, 1);
+    error += check(forced == SMALL_RING, "full ring overrides lowat");
+    channel_ref_close(connector);
+    channel_ref_close(acceptor);
+    loop_run_once(loop);
+
+    loop_destroy(loop);
+    return error ? 1 : 0;
+}
+
+#endif /* TEST_LOWAT */
+#endif
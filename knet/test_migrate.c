@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_MIGRATE
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#define MAX_LOOP 2           /* 参与迁移的loop_t数量 */
+#define MESSAGES 200000      /* 服务端跨线程写入的消息数量 */
+#define MIGRATE_EVERY 2000   /* 每写入多少条消息迁移一次 */
+#define HOT_CONNECTIONS 4    /* 自动迁移测试的繁忙连接数 */
+#define HOT_BURN_US 20000    /* 繁忙连接每次读取消耗的CPU时间（微秒） */
+#define PORT 7790
+
+loop_t*                 loops[MAX_LOOP];
+channel_ref_t* volatile server = 0;
+volatile uint32_t       client_expect = 0;
+volatile uint32_t       server_expect = 0;
+volatile int            disorder = 0;
+volatile int            wrong_thread = 0;
+thread_id_t             loop_thread[MAX_LOOP];
+channel_ref_t*          hot_server[HOT_CONNECTIONS];
+atomic_counter_t        hot_count = 0;
+
+void burn(uint64_t us) {
+    uint64_t start = time_get_microseconds();
+    while (time_get_microseconds() - start < us);
+}
+
+int loop_index(loop_t* loop) {
+    int i = 0;
+    for (; i < MAX_LOOP; i++) {
+        if (loops[i] == loop) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void server_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    uint32_t  seq    = 0;
+    int       index  = 0;
+    stream_t* stream = channel_ref_get_stream(channel);
+    if (e & channel_cb_event_recv) {
+        /* 迁移后回调必须在新的loop_t线程内 */
+        index = loop_index(channel_ref_get_loop(channel));
+        if (!loop_thread[index]) {
+            loop_thread[index] = thread_get_self_id();
+        } else if (loop_thread[index] != thread_get_self_id()) {
+            wrong_thread++;
+        }
+        while (stream_available(stream) >= (int)sizeof(seq)) {
+            stream_pop(stream, (char*)&seq, sizeof(seq));
+            if (seq != server_expect) {
+                disorder++;
+            }
+            server_expect = seq + 1;
+        }
+    }
+}
+
+void acceptor_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    if (e & channel_cb_event_accept) {
+        channel_ref_set_cb(channel, server_cb);
+        server = channel_ref_share(channel);
+    }
+}
+
+void client_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    uint32_t  seq    = 0;
+    stream_t* stream = channel_ref_get_stream(channel);
+    if (e & channel_cb_event_recv) {
+        while (stream_available(stream) >= (int)sizeof(seq)) {
+            stream_pop(stream, (char*)&seq, sizeof(seq));
+            if (seq != client_expect) {
+                disorder++;
+            }
+            client_expect = seq + 1;
+            /* 原样返回，服务端检查迁移期间读到的顺序 */
+            stream_push(stream, (char*)&seq, sizeof(seq));
+        }
+    }
+}
+
+void test_order() {
+    int              i           = 0;
+    int              migrations  = 0;
+    uint32_t         seq         = 0;
+    uint32_t         start       = 0;
+    loop_t*          client_loop = 0;
+    channel_ref_t*   acceptor    = 0;
+    channel_ref_t*   connector   = 0;
+    thread_runner_t* runner[MAX_LOOP + 1] = {0};
+
+    for (i = 0; i < MAX_LOOP; i++) {
+        loops[i] = loop_create();
+    }
+    client_loop = loop_create();
+    acceptor = loop_create_channel(loops[0], 8, 1024);
+    channel_ref_set_cb(acceptor, acceptor_cb);
+    if (error_ok != channel_ref_accept(acceptor, "127.0.0.1", PORT, 16)) {
+        printf("channel_ref_accept failed\n");
+        return;
+    }
+    connector = loop_create_channel(client_loop, 0, 1024 * 1024);
+    channel_ref_set_cb(connector, client_cb);
+    channel_ref_connect(connector, "127.0.0.1", PORT, 2);
+    for (i = 0; i < MAX_LOOP; i++) {
+        runner[i] = thread_runner_create(0, 0);
+        thread_runner_start_loop(runner[i], loops[i], 0);
+    }
+    runner[MAX_LOOP] = thread_runner_create(0, 0);
+    thread_runner_start_loop(runner[MAX_LOOP], client_loop, 0);
+    while (!server) {
+        thread_sleep_ms(1);
+    }
+    /* 主线程不停地写入，同时在两个loop_t之间来回迁移 */
+    for (seq = 0; seq < MESSAGES; seq++) {
+        stream_push(channel_ref_get_stream(server), (char*)&seq, sizeof(seq));
+        if (seq % MIGRATE_EVERY == 0) {
+            if (error_ok == channel_ref_migrate(server, loops[(seq / MIGRATE_EVERY) % MAX_LOOP])) {
+                migrations++;
+            }
+        }
+    }
+    start = time_get_milliseconds();
+    while (((client_expect < MESSAGES) || (server_expect < MESSAGES)) && (time_get_milliseconds() - start < 10000)) {
+        thread_sleep_ms(10);
+    }
+    printf("order: migrations %d, client %u/%d, server %u/%d, disorder %d, wrong thread %d, on loop%d\n",
+        migrations, client_expect, MESSAGES, server_expect, MESSAGES, disorder, wrong_thread,
+        loop_index(channel_ref_get_loop(server)));
+
+    for (i = 0; i <= MAX_LOOP; i++) {
+        thread_runner_stop(runner[i]);
+        thread_runner_join(runner[i]);
+        thread_runner_destroy(runner[i]);
+    }
+    channel_ref_leave(server);
+    for (i = 0; i < MAX_LOOP; i++) {
+        loop_destroy(loops[i]);
+    }
+    loop_destroy(client_loop);
+}
+
+void hot_server_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    if (e & channel_cb_event_recv) {
+        stream_eat(channel_ref_get_stream(channel));
+        burn(HOT_BURN_US);
+    }
+}
+
+void hot_acceptor_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    if (e & channel_cb_event_accept) {
+        channel_ref_set_cb(channel, hot_server_cb);
+        hot_server[atomic_counter_inc(&hot_count) - 1] = channel_ref_share(channel);
+    }
+}
+
+int hot_count_in_loop(int index) {
+    int i     = 0;
+    int count = 0;
+    for (; i < HOT_CONNECTIONS; i++) {
+        if (hot_server[i] && (channel_ref_get_loop(hot_server[i]) == loops[index])) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void test_rebalance() {
+    int              i           = 0;
+    int              j           = 0;
+    loop_balancer_t* balancer    = 0;
+    loop_t*          client_loop = 0;
+    channel_ref_t*   acceptor    = 0;
+    channel_ref_t*   connector[HOT_CONNECTIONS] = {0};
+    thread_runner_t* runner[MAX_LOOP + 1] = {0};
+
+    for (i = 0; i < MAX_LOOP; i++) {
+        loops[i] = loop_create();
+    }
+    client_loop = loop_create();
+    acceptor = loop_create_channel(loops[0], 8, 1024);
+    channel_ref_set_cb(acceptor, hot_acceptor_cb);
+    if (error_ok != channel_ref_accept(acceptor, "127.0.0.1", PORT + 1, 16)) {
+        printf("channel_ref_accept failed\n");
+        return;
+    }
+    for (i = 0; i < HOT_CONNECTIONS; i++) {
+        connector[i] = loop_create_channel(client_loop, 8, 1024);
+        channel_ref_connect(connector[i], "127.0.0.1", PORT + 1, 2);
+    }
+    for (i = 0; i < MAX_LOOP; i++) {
+        runner[i] = thread_runner_create(0, 0);
+        thread_runner_start_loop(runner[i], loops[i], 0);
+    }
+    runner[MAX_LOOP] = thread_runner_create(0, 0);
+    thread_runner_start_loop(runner[MAX_LOOP], client_loop, 0);
+    thread_sleep_ms(500);
+    /* 连接都已在loops[0]，之后开启自动迁移 */
+    balancer = loop_balancer_create();
+    for (i = 0; i < MAX_LOOP; i++) {
+        loop_balancer_attach(balancer, loops[i]);
+    }
+    loop_balancer_set_rebalance(balancer, 300);
+    for (j = 1; j <= 50; j++) {
+        for (i = 0; i < HOT_CONNECTIONS; i++) {
+            stream_push(channel_ref_get_stream(connector[i]), "ping", 4);
+        }
+        thread_sleep_ms(100);
+        if (j % 10 == 0) {
+            printf("rebalance: %.1fs loop0 connections:%d busy:%4d loop1 connections:%d busy:%4d\n", j / 10.0,
+                hot_count_in_loop(0), loop_get_busy(loops[0]), hot_count_in_loop(1), loop_get_busy(loops[1]));
+        }
+    }
+
+    for (i = 0; i <= MAX_LOOP; i++) {
+        thread_runner_stop(runner[i]);
+        thread_runner_join(runner[i]);
+        thread_runner_destroy(runner[i]);
+    }
+    for (i = 0; i < HOT_CONNECTIONS; i++) {
+        if (hot_server[i]) {
+            channel_ref_leave(hot_server[i]);
+        }
+    }
+    for (i = 0; i < MAX_LOOP; i++) {
+        loop_balancer_detach(balancer, loops[i]);
+        loop_destroy(loops[i]);
+    }
+    loop_destroy(client_loop);
+    loop_balancer_destroy(balancer);
+}
+
+int main() {
+    /* 迁移期间跨线程写入的数据不丢失、不乱序 */
+    test_order();
+    /* 繁忙的loop_t将连接迁移到空闲的loop_t */
+    test_rebalance();
+    return 0;
+}
+
+#endif /* TEST_MIGRATE */
+#endif
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_POOL
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#define WARM 8                /* 每个loop_t的预热连接数 */
+#define MAX_CONNECTING 16     /* 同时发起连接的最大数量 */
+#define CONCURRENCY 64        /* 同时在途的请求数 */
+#define TEST_REQUESTS 1000000
+
+char request[] = "GET";
+int accept_count = 0;
+int sent_count   = 0;
+int recv_count   = 0;
+int fail_count   = 0;
+pool_t* pool     = 0;
+
+void server_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      buffer[(sizeof(request) - 1) * 64];
+    stream_t* stream = 0;
+    int       size   = 0;
+    if (e & channel_cb_event_recv) {
+        /* 模拟后端，原样应答 */
+        stream = channel_ref_get_stream(channel);
+        while ((size = min(stream_available(stream), (int)sizeof(buffer))) > 0) {
+            stream_pop(stream, buffer, size);
+            stream_push(stream, buffer, size);
+        }
+    }
+}
+
+void acceptor_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    if (e & channel_cb_event_accept) {
+        accept_count++;
+        channel_ref_set_cb(channel, server_cb);
+    }
+}
+
+void lease_cb(channel_ref_t* channel, void* data);
+
+void send_request() {
+    if (sent_count < TEST_REQUESTS) {
+        sent_count++;
+        pool_lease(pool, "127.0.0.1", 7778, lease_cb, 0);
+    }
+}
+
+void client_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      buffer[sizeof(request)];
+    stream_t* stream = channel_ref_get_stream(channel);
+    if (e & channel_cb_event_recv) {
+        if (stream_available(stream) < (int)sizeof(request) - 1) {
+            return;
+        }
+        stream_pop(stream, buffer, sizeof(request) - 1);
+        recv_count++;
+        /* 请求完成，归还连接后发起下一个请求 */
+        pool_release(channel, 1);
+        send_request();
+    } else if (e & channel_cb_event_close) {
+        fail_count++;
+        send_request();
+    }
+}
+
+void lease_cb(channel_ref_t* channel, void* data) {
+    if (!channel) {
+        fail_count++;
+        send_request();
+        return;
+    }
+    channel_ref_set_cb(channel, client_cb);
+    stream_push(channel_ref_get_stream(channel), request, sizeof(request) - 1);
+}
+
+int main() {
+    int              i         = 0;
+    loop_t*          main_loop = 0;
+    loop_t*          sub_loop  = 0;
+    thread_runner_t* runner    = 0;
+    channel_ref_t*   acceptor  = 0;
+    uint32_t         start     = 0;
+    uint32_t         elapsed   = 0;
+
+    sub_loop = loop_create();
+    acceptor = loop_create_channel(sub_loop, 8, 1024);
+    channel_ref_set_cb(acceptor, acceptor_cb);
+    if (error_ok != channel_ref_accept(acceptor, "127.0.0.1", 7778, 1024)) {
+        printf("channel_ref_accept failed\n");
+        return 1;
+    }
+    runner = thread_runner_create(0, 0);
+    thread_runner_start_loop(runner, sub_loop, 0);
+
+    main_loop = loop_create();
+    pool = pool_create(main_loop, 8, 1024, WARM, MAX_CONNECTING);
+    pool_set_health_check(pool, 1, 5);
+    pool_set_connect_timeout(pool, 2);
+    pool_set_max_idle(pool, CONCURRENCY);
+    pool_prepare(pool, "127.0.0.1", 7778);
+    start = time_get_milliseconds();
+    for (i = 0; i < CONCURRENCY; i++) {
+        send_request();
+    }
+    while ((recv_count + fail_count < TEST_REQUESTS) && (time_get_milliseconds() - start < 30000)) {
+        loop_run_once(main_loop);
+    }
+    elapsed = time_get_milliseconds() - start;
+    /* 每个请求都新建连接时accepted与请求数相同 */
+    printf("%d requests, %d failed, %d connections accepted, %u ms, %.0f requests/s\n",
+        recv_count, fail_count, accept_count, elapsed, elapsed ? recv_count * 1000.0 / elapsed : 0.0);
+
+    pool_destroy(pool);
+    thread_runner_stop(runner);
+    thread_runner_join(runner);
+    thread_runner_destroy(runner);
+    loop_destroy(sub_loop);
+    loop_destroy(main_loop);
+    return 0;
+}
+
+#endif /* TEST_POOL */
+#endif
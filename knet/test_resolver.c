@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_RESOLVER
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#define HOST "localhost"                 /* 由/etc/hosts解析 */
+#define BAD_HOST "no-such-host.invalid"  /* .invalid保证不能解析（RFC 6761） */
+#define TTL 1                            /* 缓存有效期（秒） */
+#define PORT 7820
+
+int accepted  = 0;
+int connected = 0;
+int closed    = 0;
+int resolved  = 0;  /* resolver_resolve回调次数 */
+int failed    = 0;  /* 解析失败次数 */
+
+void acceptor_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    if (e & channel_cb_event_accept) {
+        accepted++;
+    }
+}
+
+void connector_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    if (e & channel_cb_event_connect) {
+        connected++;
+    } else if (e & channel_cb_event_close) {
+        closed++;
+    }
+}
+
+void resolve_cb(const struct sockaddr* addr, int len, void* data) {
+    resolved++;
+    if (!addr) {
+        failed++;
+    }
+}
+
+/* 运行loop_t直到条件满足或超时 */
+int run_until(loop_t* loop, volatile int* value, int expect, uint32_t ms) {
+    uint32_t start = time_get_milliseconds();
+    while ((*value < expect) && (time_get_milliseconds() - start < ms)) {
+        loop_run_once(loop);
+    }
+    return (*value >= expect);
+}
+
+int main() {
+    int            error     = 0;
+    int            before    = 0;
+    loop_t*        loop      = 0;
+    resolver_t*    resolver  = 0;
+    channel_ref_t* acceptor  = 0;
+    channel_ref_t* connector = 0;
+    uint32_t       start     = 0;
+
+    loop = loop_create();
+    resolver = resolver_create(2, TTL);
+    if (!resolver) {
+        printf("resolver_create failed\n");
+        return 1;
+    }
+    resolver_attach(resolver, loop);
+    /* localhost可能解析为127.0.0.1或::1，两个地址都监听，不支持IPv6时忽略 */
+    acceptor = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(acceptor, acceptor_cb);
+    if (error_ok != channel_ref_accept(acceptor, "127.0.0.1", PORT, 16)) {
+        printf("channel_ref_accept failed\n");
+        return 1;
+    }
+    acceptor = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(acceptor, acceptor_cb);
+    channel_ref_accept(acceptor, "::1", PORT, 16);
+
+    /* 1. 缓存未命中，在工作线程内解析，完成后在loop_t内发起连接 */
+    connector = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(connector, connector_cb);
+    error += check(error_ok == channel_ref_connect_host(connector, HOST, PORT, 2), "connect_host returns ok");
+    /* 解析完成前不会发起连接 */
+    error += check(!channel_ref_check_state(connector, channel_state_connect), "first connect_host is asynchronous");
+    error += check(run_until(loop, &connected, 1, 5000), "async connect_host connects");
+
+    /* 2. 缓存命中，在函数内回调并立即发起连接 */
+    before = resolved;
+    resolver_resolve(resolver, loop, HOST, PORT, resolve_cb, 0);
+    error += check(resolved == before + 1, "second resolve hits cache");
+    connector = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(connector, connector_cb);
+    channel_ref_connect_host(connector, HOST, PORT, 2);
+    error += check(channel_ref_check_state(connector, channel_state_connect), "cached connect_host connects at once");
+    error += check(run_until(loop, &connected, 2, 5000), "cached connect_host connects");
+
+    /* 3. 超过有效期后重新解析 */
+    start = time_get_milliseconds();
+    while (time_get_milliseconds() - start < (TTL + 1) * 1000 + 100) {
+        loop_run_once(loop);
+    }
+    before = resolved;
+    resolver_resolve(resolver, loop, HOST, PORT, resolve_cb, 0);
+    error += check(resolved == before, "expired entry resolves asynchronously");
+    error += check(run_until(loop, &resolved, before + 1, 5000) && !failed, "expired entry resolves again");
+
+    /* 4. 解析失败以channel_cb_event_close回调 */
+    connector = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(connector, connector_cb);
+    channel_ref_connect_host(connector, BAD_HOST, PORT, 2);
+    error += check(run_until(loop, &closed, 1, 20000) && (connected == 2), "failed resolve closes channel");
+    error += check(accepted == 2, "two connections accepted");
+
+    resolver_destroy(resolver);
+    loop_destroy(loop);
+    return error ? 1 : 0;
+}
+
+#endif /* TEST_RESOLVER */
+#endif
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "config.h"
+
+#ifdef TEST
+#if TEST_RESP
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#define MAX_LOOP 4         /* 服务端loop数量 */
+#define MAX_CLIENT 64      /* 客户端连接数 */
+#define PIPELINE_DEPTH 32  /* 每个连接同时等待应答的命令数 */
+#define TEST_COMMANDS 1000000
+#define CHECK_PORT 7920    /* 格式及发送链表限制检查使用的端口 */
+#define CHECK_LIST_LEN 4   /* 检查发送链表限制时的最大长度 */
+
+const char command[] = "*1\r\n$4\r\nPING\r\n";
+const char reply[]   = "+PONG\r\n";
+int sent_count = 0;
+int recv_count = 0;
+
+const char* check_reply    = 0; /* 检查用服务端的应答，为0时不读取也不应答 */
+int         check_commands = 0; /* 连接完成后发出的命令数 */
+int         check_results[CHECK_LIST_LEN + 1];
+int         check_replies  = 0; /* 收到的应答数 */
+int         check_nulls    = 0; /* 管道关闭时以0回调的数量 */
+int         check_closed   = 0;
+int         check_bulk     = 0; /* 收到的应答是否为"abc" */
+
+void server_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      buffer[(sizeof(command) - 1) * 64];
+    char      output[(sizeof(reply) - 1) * 64];
+    stream_t* stream = 0;
+    int       count  = 0;
+    int       i      = 0;
+    if (e & channel_cb_event_recv) {
+        /* 模拟服务端，每条PING命令应答一次PONG */
+        stream = channel_ref_get_stream(channel);
+        while ((count = stream_available(stream) / (sizeof(command) - 1)) > 0) {
+            count = min(count, 64);
+            stream_pop(stream, buffer, count * (sizeof(command) - 1));
+            for (i = 0; i < count; i++) {
+                memcpy(output + i * (sizeof(reply) - 1), reply, sizeof(reply) - 1);
+            }
+            stream_push(stream, output, count * (sizeof(reply) - 1));
+        }
+    }
+}
+
+void acceptor_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    if (e & channel_cb_event_accept) {
+        channel_ref_set_cb(channel, server_cb);
+    }
+}
+
+void reply_cb(channel_ref_t* channel, resp_reply_t* reply, void* data) {
+    if (!reply) {
+        return;
+    }
+    recv_count++;
+    if (sent_count < TEST_COMMANDS) {
+        /* 每收到一个应答补发一条命令，保持管线深度 */
+        sent_count++;
+        resp_command(channel, reply_cb, 0, "PING");
+    }
+}
+
+void connector_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    int i = 0;
+    if (e & channel_cb_event_connect) {
+        /* 一次循环内发出的命令合并为一次写 */
+        for (; (i < PIPELINE_DEPTH) && (sent_count < TEST_COMMANDS); i++, sent_count++) {
+            resp_command(channel, reply_cb, 0, "PING");
+        }
+    }
+}
+
+void check_server_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    stream_t* stream = 0;
+    if ((e & channel_cb_event_recv) && check_reply) {
+        stream = channel_ref_get_stream(channel);
+        stream_eat(stream);
+        stream_push(stream, (void*)check_reply, (int)strlen(check_reply));
+    }
+}
+
+void check_acceptor_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    if (e & channel_cb_event_accept) {
+        channel_ref_set_cb(channel, check_server_cb);
+    }
+}
+
+void check_reply_cb(channel_ref_t* channel, resp_reply_t* reply, void* data) {
+    const char* str  = 0;
+    uint32_t    size = 0;
+    if (!reply) {
+        check_nulls++;
+        return;
+    }
+    check_replies++;
+    if (resp_reply_get_type(reply) == resp_type_bulk) {
+        str        = resp_reply_get_string(reply, &size);
+        check_bulk = (size == 3) && !memcmp(str, "abc", 3);
+    }
+}
+
+void check_connector_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    int i = 0;
+    if (e & channel_cb_event_connect) {
+        for (; i < check_commands; i++) {
+            check_results[i] = resp_command(channel, check_reply_cb, 0, "GET key");
+        }
+    }
+    if (e & channel_cb_event_close) {
+        check_closed = 1;
+    }
+}
+
+/*
+ * 发出check_commands条命令，等待应答或管道关闭
+ */
+channel_ref_t* check_connect(loop_t* loop, const char* reply, int commands) {
+    channel_ref_t* connector = loop_create_channel(loop, CHECK_LIST_LEN, 1024);
+    uint32_t       deadline  = time_get_milliseconds() + 2000;
+    check_reply    = reply;
+    check_commands = commands;
+    check_replies  = 0;
+    check_nulls    = 0;
+    check_closed   = 0;
+    check_bulk     = 0;
+    memset(check_results, -1, sizeof(check_results));
+    channel_ref_set_cb(connector, check_connector_cb);
+    channel_ref_set_resp(connector, 0, 0);
+    channel_ref_connect(connector, "127.0.0.1", CHECK_PORT, 2);
+    while (!check_closed && (check_replies + check_nulls < commands) && (time_get_milliseconds() < deadline)) {
+        loop_run_once(loop);
+    }
+    return connector;
+}
+
+int check_all() {
+    int            i         = 0;
+    int            errors    = 0;
+    int            queued    = 0;
+    loop_t*        loop      = loop_create();
+    channel_ref_t* acceptor  = loop_create_channel(loop, 8, 1024);
+    channel_ref_t* connector = 0;
+    channel_ref_set_cb(acceptor, check_acceptor_cb);
+    if (error_ok != channel_ref_accept(acceptor, "127.0.0.1", CHECK_PORT, 5)) {
+        printf("channel_ref_accept failed\n");
+        return 1;
+    }
+    /* 合法的批量字符串 */
+    connector = check_connect(loop, "$3\r\nabc\r\n", 1);
+    errors += check((check_replies == 1) && check_bulk, "bulk string reply");
+    channel_ref_close(connector);
+    loop_run_once(loop);
+
+    /* 数据之后不是\r\n，按格式错误关闭管道 */
+    connector = check_connect(loop, "$3\r\nabcde\r\n", 1);
+    loop_run_once(loop);
+    errors += check(!check_replies && (check_nulls == 1) && check_closed, "bulk string without CRLF rejected");
+
+    /* 对端不读取，发送链表达到限制后关闭管道 */
+    connector = check_connect(loop, 0, CHECK_LIST_LEN + 1);
+    for (i = 0; i < CHECK_LIST_LEN; i++) {
+        queued += (check_results[i] == error_ok);
+    }
+    errors += check((queued == CHECK_LIST_LEN) && (check_results[CHECK_LIST_LEN] == error_send_fail),
+        "commands beyond send list limit fail");
+    errors += check(check_closed && (check_nulls == CHECK_LIST_LEN), "channel closed at send list limit");
+
+    channel_ref_close(acceptor);
+    loop_run_once(loop);
+    loop_destroy(loop);
+    return errors;
+}
+
+int main() {
+    int              i         = 0;
+    loop_t*          main_loop = 0;
+    loop_t*          sub_loop[MAX_LOOP] = {0};
+    thread_runner_t* runner[MAX_LOOP]   = {0};
+    channel_ref_t*   acceptor  = 0;
+    channel_ref_t*   connector = 0;
+    loop_balancer_t* balancer  = 0;
+    uint32_t         start     = 0;
+    uint32_t         elapsed   = 0;
+
+    balancer = loop_balancer_create();
+    for (i = 0; i < MAX_LOOP; i++) {
+        sub_loop[i] = loop_create();
+        loop_balancer_attach(balancer, sub_loop[i]);
+        runner[i] = thread_runner_create(0, 0);
+        thread_runner_start_loop(runner[i], sub_loop[i], 0);
+    }
+    main_loop = loop_create();
+    acceptor = loop_create_channel(main_loop, 8, 1024 * 8);
+    channel_ref_set_cb(acceptor, acceptor_cb);
+    if (error_ok != channel_ref_accept(acceptor, "127.0.0.1", 6379, 5000)) {
+        printf("channel_ref_accept failed\n");
+    }
+    /* 监听管道接受的连接分配到其他loop */
+    loop_balancer_attach(balancer, main_loop);
+
+    start = time_get_milliseconds();
+    for (i = 0; i < MAX_CLIENT; i++) {
+        /* 发送链表最多同时存在PIPELINE_DEPTH条命令 */
+        connector = loop_create_channel(main_loop, PIPELINE_DEPTH, 1024 * 8);
+        channel_ref_set_cb(connector, connector_cb);
+        channel_ref_set_resp(connector, 0, 0);
+        channel_ref_connect(connector, "127.0.0.1", 6379, 2);
+    }
+    while (recv_count < TEST_COMMANDS) {
+        loop_run_once(main_loop);
+    }
+    elapsed = time_get_milliseconds() - start;
+    printf("%d commands, %d connections, pipeline depth %d, %u ms, %.0f commands/s\n",
+        recv_count, MAX_CLIENT, PIPELINE_DEPTH, elapsed, elapsed ? recv_count * 1000.0 / elapsed : 0.0);
+
+    for (i = 0; i < MAX_LOOP; i++) {
+        thread_runner_stop(runner[i]);
+        thread_runner_join(runner[i]);
+        thread_runner_destroy(runner[i]);
+    }
+    for (i = 0; i < MAX_LOOP; i++) {
+        loop_destroy(sub_loop[i]);
+    }
+    loop_destroy(main_loop);
+    loop_balancer_destroy(balancer);
+    return check_all();
+}
+
+#endif /* TEST_RESP */
+#endif
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_UDP
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#define MAX_CLIENT 16         /* 客户端管道数 */
+#define WINDOW 64             /* 每个客户端同时在途的数据报数 */
+#define DATAGRAM_SIZE 32      /* 模拟位置更新的数据报长度 */
+#define TEST_DATAGRAMS 2000000
+
+int sent_count = 0;
+int recv_count = 0;
+
+void server_cb(channel_ref_t* channel, const char* data, uint32_t size, address_t* address) {
+    /* 原样发回，同一次读事件内的应答在写事件触发时批量发送 */
+    channel_ref_sendto(channel, data, size, address_get_ip(address), address_get_port(address));
+}
+
+void client_cb(channel_ref_t* channel, const char* data, uint32_t size, address_t* address) {
+    recv_count++;
+    if (sent_count < TEST_DATAGRAMS) {
+        /* 每收到一个应答补发一个，保持在途数量 */
+        sent_count++;
+        channel_ref_sendto(channel, data, size, "127.0.0.1", 7777);
+    }
+}
+
+int main() {
+    int              i         = 0;
+    int              j         = 0;
+    loop_t*          main_loop = 0;
+    loop_t*          sub_loop  = 0;
+    thread_runner_t* runner    = 0;
+    channel_ref_t*   server    = 0;
+    channel_ref_t*   client    = 0;
+    uint32_t         start     = 0;
+    uint32_t         elapsed   = 0;
+    char             data[DATAGRAM_SIZE] = {0};
+
+    sub_loop = loop_create();
+    server = loop_create_udp_channel(sub_loop, 1500, 4096, server_cb);
+    if (error_ok != channel_ref_bind(server, "127.0.0.1", 7777)) {
+        printf("channel_ref_bind failed\n");
+        return 1;
+    }
+    runner = thread_runner_create(0, 0);
+    thread_runner_start_loop(runner, sub_loop, 0);
+
+    main_loop = loop_create();
+    start = time_get_milliseconds();
+    for (i = 0; i < MAX_CLIENT; i++) {
+        client = loop_create_udp_channel(main_loop, 1500, WINDOW, client_cb);
+        channel_ref_bind(client, "127.0.0.1", 0);
+        for (j = 0; j < WINDOW; j++, sent_count++) {
+            channel_ref_sendto(client, data, sizeof(data), "127.0.0.1", 7777);
+        }
+    }
+    /* 本机回环丢包时在途数量减少，不等待全部应答 */
+    while ((recv_count < TEST_DATAGRAMS - MAX_CLIENT * WINDOW) &&
+           (time_get_milliseconds() - start < 30000)) {
+        loop_run_once(main_loop);
+    }
+    elapsed = time_get_milliseconds() - start;
+    printf("%d round trips, %d clients, window %d, %u ms, %.0f datagrams/s\n",
+        recv_count, MAX_CLIENT, WINDOW, elapsed, elapsed ? recv_count * 2000.0 / elapsed : 0.0);
+
+    thread_runner_stop(runner);
+    thread_runner_join(runner);
+    thread_runner_destroy(runner);
+    loop_destroy(sub_loop);
+    loop_destroy(main_loop);
+    return 0;
+}
+
+#endif /* TEST_UDP */
+#endif
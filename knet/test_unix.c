@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_UNIX
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#define UNIX_PATH "/tmp/knet_test_unix.sock"
+#define ABSTRACT_NAME "@knet_test_unix"
+#define PORT 7840
+#define MESSAGE_SIZE 16   /* ping-pong消息长度 */
+#define ROUNDS 100000     /* 每次测量的往返次数 */
+
+int  rounds     = 0;
+int  closed     = 0;
+char local[128] = {0}; /* 服务端管道的本地地址 */
+
+void server_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      buffer[MESSAGE_SIZE];
+    stream_t* stream = channel_ref_get_stream(channel);
+    if (e & channel_cb_event_accept) {
+        strcpy(local, address_get_ip(channel_ref_get_local_address(channel)));
+    } else if (e & channel_cb_event_recv) {
+        while (stream_available(stream) >= MESSAGE_SIZE) {
+            stream_pop(stream, buffer, MESSAGE_SIZE);
+            stream_push(stream, buffer, MESSAGE_SIZE);
+        }
+    }
+}
+
+void client_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      buffer[MESSAGE_SIZE] = {0};
+    stream_t* stream               = channel_ref_get_stream(channel);
+    if (e & channel_cb_event_connect) {
+        stream_push(stream, buffer, MESSAGE_SIZE);
+    } else if (e & channel_cb_event_recv) {
+        while (stream_available(stream) >= MESSAGE_SIZE) {
+            stream_pop(stream, buffer, MESSAGE_SIZE);
+            if (++rounds < ROUNDS) {
+                stream_push(stream, buffer, MESSAGE_SIZE);
+            } else {
+                channel_ref_close(channel);
+            }
+        }
+    } else if (e & channel_cb_event_close) {
+        closed++;
+    }
+}
+
+/*
+ * 在同一个loop_t内ping-pong，返回每次往返的微秒数，失败返回0
+ */
+double ping_pong(loop_t* loop, const char* ip, int port) {
+    channel_ref_t* acceptor  = 0;
+    channel_ref_t* connector = 0;
+    uint64_t       start     = 0;
+    uint32_t       deadline  = 0;
+    acceptor = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(acceptor, server_cb);
+    if (error_ok != channel_ref_accept(acceptor, ip, port, 16)) {
+        channel_ref_close(acceptor);
+        return 0;
+    }
+    rounds = 0;
+    closed = 0;
+    local[0] = 0;
+    connector = loop_create_channel(loop, 8, 1024);
+    channel_ref_set_cb(connector, client_cb);
+    channel_ref_connect(connector, ip, port, 2);
+    start    = time_get_microseconds();
+    deadline = time_get_milliseconds() + 60000;
+    while (!closed && (time_get_milliseconds() < deadline)) {
+        loop_run_once(loop);
+    }
+    channel_ref_close(acceptor);
+    loop_run_once(loop);
+    if (rounds < ROUNDS) {
+        return 0;
+    }
+    return (double)(time_get_microseconds() - start) / rounds;
+}
+
+int main() {
+    int     error  = 0;
+    double  tcp    = 0;
+    double  uds    = 0;
+    double  abs_ns = 0;
+    loop_t* loop   = loop_create();
+
+    tcp = ping_pong(loop, "127.0.0.1", PORT);
+    error += check(tcp > 0, "loopback TCP ping-pong");
+    uds = ping_pong(loop, UNIX_PATH, 0);
+    error += check(uds > 0, "UNIX socket ping-pong");
+    error += check(!strcmp(local, UNIX_PATH), "UNIX socket reports its path");
+    /* 上次运行遗留的套接字文件在bind前删除 */
+    error += check(ping_pong(loop, UNIX_PATH, 0) > 0, "stale socket file is replaced");
+#if defined(__linux__)
+    abs_ns = ping_pong(loop, ABSTRACT_NAME, 0);
+    error += check(abs_ns > 0, "abstract namespace ping-pong");
+    error += check(!strcmp(local, ABSTRACT_NAME), "abstract socket reports its name");
+#endif /* defined(__linux__) */
+    printf("%d byte round trip: TCP %.2fus, UNIX %.2fus, abstract %.2fus\n", MESSAGE_SIZE, tcp, uds, abs_ns);
+
+    loop_destroy(loop);
+    return error ? 1 : 0;
+}
+
+#endif /* TEST_UNIX */
+#endif
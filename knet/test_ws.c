@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#ifdef TEST
+#if TEST_WS
+
+#include <stdio.h>
+#include "knet.h"
+#include "misc.h"
+
+#define PORT 7830
+#define MAX_SIZE 1024
+
+char handshake[] = "GET /echo HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\n"
+    "Connection: keep-alive, Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+    "Sec-WebSocket-Version: 13\r\n\r\n";
+
+/* 原始连接的测试步骤：握手后发送frames，期望收到reply */
+typedef struct _raw_case_t {
+    const char* name;
+    char        frames[256];
+    int         frames_size;
+    const char* reply;
+    int         reply_size;
+} raw_case_t;
+
+int         opened   = 0; /* 客户端握手完成 */
+int         echoed   = 0; /* 客户端收到的正确应答 */
+int         mismatch = 0; /* 客户端收到的错误应答 */
+int         upgraded = 0; /* 原始连接收到101 */
+int         done     = 0; /* 原始连接收到期望的应答 */
+int         closed   = 0;
+raw_case_t* current  = 0;
+
+void server_request_cb(channel_ref_t* channel, http_request_t* request) {
+    ws_accept(request, MAX_SIZE);
+}
+
+void server_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    const char* message = 0;
+    uint32_t    size    = 0;
+    if (e & channel_cb_event_recv) {
+        /* 原样返回 */
+        message = ws_get_message(channel, &size);
+        ws_write(channel, ws_get_opcode(channel), message, size);
+    }
+}
+
+void client_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    const char* message = 0;
+    uint32_t    size    = 0;
+    if (e & channel_cb_event_ws_open) {
+        opened++;
+        ws_write(channel, ws_opcode_text, "hello", 5);
+        ws_write(channel, ws_opcode_binary, "\x00\xff", 2);
+    } else if (e & channel_cb_event_recv) {
+        message = ws_get_message(channel, &size);
+        if (((ws_get_opcode(channel) == ws_opcode_text) && (size == 5) && !memcmp(message, "hello", 5)) ||
+            ((ws_get_opcode(channel) == ws_opcode_binary) && (size == 2) && !memcmp(message, "\x00\xff", 2))) {
+            echoed++;
+        } else {
+            mismatch++;
+        }
+        if (echoed == 2) {
+            ws_close(channel, 1000, "bye");
+        }
+    } else if (e & channel_cb_event_close) {
+        closed++;
+    }
+}
+
+/* 添加一个客户端帧，掩码固定为01 02 03 04 */
+void add_frame(raw_case_t* c, int fin, ws_opcode_e opcode, const char* data, int size) {
+    static const char key[4] = {1, 2, 3, 4};
+    char*             p      = c->frames + c->frames_size;
+    int               i      = 0;
+    p[0] = (char)((fin ? 0x80 : 0) | opcode);
+    p[1] = (char)(0x80 | size);
+    memcpy(p + 2, key, 4);
+    for (; i < size; i++) {
+        p[6 + i] = data[i] ^ key[i & 3];
+    }
+    c->frames_size += 6 + size;
+}
+
+void raw_cb(channel_ref_t* channel, channel_cb_event_e e) {
+    char      buffer[256] = {0};
+    stream_t* stream      = channel_ref_get_stream(channel);
+    int       pos         = 0;
+    if (e & channel_cb_event_connect) {
+        stream_push(stream, handshake, sizeof(handshake) - 1);
+    } else if (e & channel_cb_event_recv) {
+        if (!upgraded) {
+            pos = stream_find(stream, "\r\n\r\n", 4);
+            if (pos < 0) {
+                return;
+            }
+            stream_pop(stream, buffer, pos + 4);
+            if (memcmp(buffer, "HTTP/1.1 101", 12) || !strstr(buffer, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=")) {
+                channel_ref_close(channel);
+                return;
+            }
+            upgraded = 1;
+            stream_push(stream, current->frames, current->frames_size);
+        }
+        if (stream_available(stream) < current->reply_size) {
+            return;
+        }
+        stream_pop(stream, buffer, current->reply_size);
+        if (!memcmp(buffer, current->reply, current->reply_size)) {
+            done = 1;
+        }
+        channel_ref_close(channel);
+    } else if (e & channel_cb_event_close) {
+        closed++;
+    }
+}
+
+/* 运行loop_t直到条件满足或超时 */
+int run_until(loop_t* loop, volatile int* value, int expect, uint32_t ms) {
+    uint32_t start = time_get_milliseconds();
+    while ((*value < expect) && (time_get_milliseconds() - start < ms)) {
+        loop_run_once(loop);
+    }
+    return (*value >= expect);
+}
+
+int run_raw(loop_t* loop, raw_case_t* c) {
+    channel_ref_t* connector = loop_create_channel(loop, 8, MAX_SIZE * 4);
+    int            before    = closed;
+    current  = c;
+    upgraded = 0;
+    done     = 0;
+    channel_ref_set_cb(connector, raw_cb);
+    channel_ref_connect(connector, "127.0.0.1", PORT, 2);
+    run_until(loop, &closed, before + 1, 5000);
+    return check(done, c->name);
+}
+
+int main() {
+    int            error     = 0;
+    loop_t*        loop      = 0;
+    channel_ref_t* acceptor  = 0;
+    channel_ref_t* connector = 0;
+    raw_case_t     c;
+
+    loop = loop_create();
+    acceptor = loop_create_channel(loop, 8, MAX_SIZE * 4);
+    channel_ref_set_cb(acceptor, server_cb);
+    channel_ref_set_http(acceptor, server_request_cb);
+    if (error_ok != channel_ref_accept(acceptor, "127.0.0.1", PORT, 16)) {
+        printf("channel_ref_accept failed\n");
+        return 1;
+    }
+
+    /* 1. 客户端握手、收发文本和二进制消息，关闭握手 */
+    connector = loop_create_channel(loop, 8, MAX_SIZE * 4);
+    channel_ref_set_cb(connector, client_cb);
+    channel_ref_set_ws(connector, "localhost", "/echo", MAX_SIZE);
+    channel_ref_connect(connector, "127.0.0.1", PORT, 2);
+    run_until(loop, &closed, 1, 5000);
+    error += check(opened == 1, "client handshake");
+    error += check((echoed == 2) && !mismatch, "text and binary echo");
+    error += check(closed == 1, "close handshake");
+
+    /* 2. 分片消息中间插入ping，UTF-8编码跨越分片 */
+    memset(&c, 0, sizeof(c));
+    c.name = "fragmented message with ping";
+    add_frame(&c, 0, ws_opcode_text, "hel\xe2\x82", 5);
+    add_frame(&c, 1, ws_opcode_ping, "p", 1);
+    add_frame(&c, 1, ws_opcode_continuation, "\xaclo", 3);
+    c.reply      = "\x8a\x01p" "\x81\x08hel\xe2\x82\xaclo";
+    c.reply_size = 13;
+    error += run_raw(loop, &c);
+
+    /* 3. 非法UTF-8文本以1007关闭 */
+    memset(&c, 0, sizeof(c));
+    c.name = "invalid utf-8 fails with 1007";
+    add_frame(&c, 1, ws_opcode_text, "\xc0\xaf", 2);
+    c.reply      = "\x88\x02\x03\xef";
+    c.reply_size = 4;
+    error += run_raw(loop, &c);
+
+    /* 4. 拼接后才能发现的非法编码（代理区） */
+    memset(&c, 0, sizeof(c));
+    c.name = "invalid reassembled utf-8 fails";
+    add_frame(&c, 0, ws_opcode_text, "a\xed", 2);
+    add_frame(&c, 1, ws_opcode_continuation, "\xa0\x80", 2);
+    c.reply      = "\x88\x02\x03\xef";
+    c.reply_size = 4;
+    error += run_raw(loop, &c);
+
+    /* 5. 不能在关闭帧内出现的状态码以1002关闭 */
+    memset(&c, 0, sizeof(c));
+    c.name = "reserved close code fails with 1002";
+    add_frame(&c, 1, ws_opcode_close, "\x03\xed", 2);
+    c.reply      = "\x88\x02\x03\xea";
+    c.reply_size = 4;
+    error += run_raw(loop, &c);
+
+    /* 6. 合法的状态码原样返回 */
+    memset(&c, 0, sizeof(c));
+    c.name = "close code echoed";
+    add_frame(&c, 1, ws_opcode_close, "\x0f\xa0", 2);
+    c.reply      = "\x88\x02\x0f\xa0";
+    c.reply_size = 4;
+    error += run_raw(loop, &c);
+
+    loop_destroy(loop);
+    return error ? 1 : 0;
+}
+
+#endif /* TEST_WS */
+#endif
@@ -0,0 +1,490 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* recvmmsg/sendmmsg */
+#endif /* defined(__linux__) && !defined(_GNU_SOURCE) */
+
+#include "udp.h"
+#include "channel_ref.h"
+#include "buffer.h"
+#include "address.h"
+#include "misc.h"
+
+#if defined(__linux__)
+    #include <netinet/udp.h>
+    #define UDP_MMSG 1
+    #ifndef SOL_UDP
+        #define SOL_UDP 17
+    #endif /* SOL_UDP */
+    #ifndef UDP_SEGMENT
+        #define UDP_SEGMENT 103
+    #endif /* UDP_SEGMENT */
+    #ifndef UDP_GRO
+        #define UDP_GRO 104
+    #endif /* UDP_GRO */
+#else
+    #define UDP_MMSG 0
+#endif /* defined(__linux__) */
+
+#define UDP_GRO_SLOT_SIZE 65535 /* 开启GRO后每个接收槽的长度 */
+#define UDP_ADDR_SIZE sizeof(udp_address_t)
+
+typedef union _udp_address_t {
+    struct sockaddr     sa;   /* 通用 */
+    struct sockaddr_in  sin;  /* IPv4 */
+    struct sockaddr_in6 sin6; /* IPv6 */
+} udp_address_t;
+
+#if UDP_MMSG
+typedef union _udp_control_t {
+    char           buffer[CMSG_SPACE(sizeof(int))]; /* UDP_SEGMENT/UDP_GRO控制消息 */
+    struct cmsghdr align;                           /* 对齐 */
+} udp_control_t;
+#endif /* UDP_MMSG */
+
+struct _udp_t {
+    channel_ref_udp_cb_t cb;                         /* 数据报回调 */
+    uint32_t             max_size;                   /* 接收数据报最大长度 */
+    uint32_t             slot_size;                  /* 每个接收槽的长度 */
+    int                  batch;                      /* 每次读取的数据报数量 */
+    int                  gso;                        /* 是否合并发送 */
+    int                  gro;                        /* 是否合并接收 */
+    char*                recv_buffer;                /* batch个接收槽 */
+    int                  family;                     /* 绑定的地址族 */
+    socket_len_t         addr_len;                   /* 地址族对应的地址长度 */
+    udp_address_t        recv_addr[UDP_MAX_BATCH];   /* 接收到的对端地址 */
+    address_t*           address;                    /* 回调的对端地址 */
+    udp_address_t        peer;                       /* address对应的对端地址，对端不变时不再转换 */
+    buffer_t**           queue;                      /* 发送队列，环形数组 */
+    uint32_t             queue_size;                 /* 发送队列容量 */
+    uint32_t             head;                       /* 队首下标 */
+    uint32_t             count;                      /* 队列内数据报数量 */
+#if UDP_MMSG
+    struct mmsghdr       recv_msgs[UDP_MAX_BATCH];   /* recvmmsg消息 */
+    struct iovec         recv_iov[UDP_MAX_BATCH];    /* 接收槽 */
+    udp_control_t        recv_control[UDP_MAX_BATCH];/* GRO控制消息 */
+    struct mmsghdr       send_msgs[UDP_MAX_BATCH];   /* sendmmsg消息 */
+    struct iovec         send_iov[UDP_MAX_IOV];      /* 发送数据报 */
+    udp_control_t        send_control[UDP_MAX_BATCH];/* GSO控制消息 */
+    uint32_t             send_count[UDP_MAX_BATCH];  /* 每个消息合并的数据报数量 */
+#endif /* UDP_MMSG */
+};
+
+udp_t* udp_create(uint32_t max_size, uint32_t max_send_count, channel_ref_udp_cb_t cb) {
+    udp_t* udp = create(udp_t);
+    assert(udp);
+    assert(max_send_count);
+    memset(udp, 0, sizeof(udp_t));
+    max_size = max(1, min(max_size, UDP_MAX_PAYLOAD));
+    udp->cb          = cb;
+    udp->family      = AF_INET;
+    udp->addr_len    = sizeof(struct sockaddr_in);
+    udp->max_size    = max_size;
+    udp->slot_size   = max_size;
+    udp->batch       = UDP_MAX_BATCH;
+    udp->recv_buffer = create_raw(udp->slot_size * udp->batch);
+    assert(udp->recv_buffer);
+    udp->address     = address_create();
+    udp->queue       = create_type(buffer_t*, sizeof(buffer_t*) * max_send_count);
+    assert(udp->queue);
+    udp->queue_size  = max_send_count;
+    return udp;
+}
+
+static void udp_pop(udp_t* udp, uint32_t count) {
+    for (; count && udp->count; count--) {
+        buffer_destroy(udp->queue[udp->head]);
+        udp->head = (udp->head + 1) % udp->queue_size;
+        udp->count--;
+    }
+}
+
+void udp_destroy(udp_t* udp) {
+    assert(udp);
+    udp_pop(udp, udp->count);
+    destroy(udp->queue);
+    destroy(udp->recv_buffer);
+    address_destroy(udp->address);
+    destroy(udp);
+}
+
+void udp_set_cb(udp_t* udp, channel_ref_udp_cb_t cb) {
+    assert(udp);
+    udp->cb = cb;
+}
+
+int udp_set_offload(udp_t* udp, socket_t socket_fd, int gso, int gro) {
+#if UDP_MMSG
+    int          value     = 0;
+    socket_len_t len       = sizeof(value);
+    uint32_t     slot_size = 0;
+    int          batch     = 0;
+    assert(udp);
+    /* 内核不支持UDP_SEGMENT时getsockopt失败 */
+    if (gso && (getsockopt(socket_fd, SOL_UDP, UDP_SEGMENT, &value, &len) < 0)) {
+        return error_udp_offload;
+    }
+    value = gro ? 1 : 0;
+    if ((gro || udp->gro) && (setsockopt(socket_fd, SOL_UDP, UDP_GRO, &value, sizeof(value)) < 0)) {
+        return error_udp_offload;
+    }
+    udp->gso  = gso;
+    udp->gro  = gro;
+    slot_size = gro ? UDP_GRO_SLOT_SIZE : udp->max_size;
+    batch     = gro ? UDP_GRO_BATCH : UDP_MAX_BATCH;
+    if ((slot_size != udp->slot_size) || (batch != udp->batch)) {
+        destroy(udp->recv_buffer);
+        udp->slot_size   = slot_size;
+        udp->batch       = batch;
+        udp->recv_buffer = create_raw(slot_size * batch);
+        assert(udp->recv_buffer);
+    }
+    return error_ok;
+#else
+    assert(udp);
+    if (gso || gro) {
+        return error_udp_offload;
+    }
+    return error_ok;
+#endif /* UDP_MMSG */
+}
+
+void udp_set_family(udp_t* udp, int family) {
+    assert(udp);
+    udp->family   = family;
+    udp->addr_len = (family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+}
+
+buffer_t* udp_pack(udp_t* udp, const char* data, uint32_t size, const char* ip, int port) {
+    buffer_t*        datagram = 0;
+    socket_address_t addr;
+    udp_address_t    sa;
+    assert(udp);
+    assert(ip);
+    if (!socket_make_address(ip, port, &addr)) {
+        return 0;
+    }
+    memset(&sa, 0, sizeof(sa));
+    if (addr.sa.sa_family == udp->family) {
+        memcpy(&sa, &addr, udp->addr_len);
+    } else if (udp->family == AF_INET6) {
+        /* 双栈套接字发往IPv4地址，转换为::ffff:a.b.c.d */
+        sa.sin6.sin6_family = AF_INET6;
+        sa.sin6.sin6_port   = addr.sin.sin_port;
+        sa.sin6.sin6_addr.s6_addr[10] = 0xff;
+        sa.sin6.sin6_addr.s6_addr[11] = 0xff;
+        memcpy(sa.sin6.sin6_addr.s6_addr + 12, &addr.sin.sin_addr, 4);
+    } else {
+        /* IPv4套接字不能发往IPv6地址 */
+        return 0;
+    }
+    /* 目的地址和数据报放在同一个缓冲区内，跨线程投递时不需要额外的结构 */
+    datagram = buffer_create(UDP_ADDR_SIZE + size);
+    memcpy(buffer_get_write_ptr(datagram), &sa, UDP_ADDR_SIZE);
+    if (size) {
+        memcpy(buffer_get_write_ptr(datagram) + UDP_ADDR_SIZE, data, size);
+    }
+    buffer_commit(datagram, UDP_ADDR_SIZE + size);
+    return datagram;
+}
+
+int udp_queue(udp_t* udp, buffer_t* datagram) {
+    assert(udp);
+    assert(datagram);
+    if (udp->count == udp->queue_size) {
+        buffer_destroy(datagram);
+        return error_udp_queue_full;
+    }
+    udp->queue[(udp->head + udp->count) % udp->queue_size] = datagram;
+    udp->count++;
+    return error_ok;
+}
+
+int udp_send_empty(udp_t* udp) {
+    assert(udp);
+    return !udp->count;
+}
+
+static int udp_would_block() {
+#if defined(WIN32) || defined(WIN64)
+    DWORD error = GetLastError();
+    return ((error == 0) || (error == WSAEINTR) || (error == WSAEINPROGRESS) || (error == WSAEWOULDBLOCK));
+#else
+    return ((errno == 0) || (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR));
+#endif /* defined(WIN32) || defined(WIN64) */
+}
+
+static int udp_peer_error() {
+    /* ICMP错误只影响单个数据报 */
+#if defined(WIN32) || defined(WIN64)
+    DWORD error = GetLastError();
+    return ((error == WSAECONNRESET) || (error == WSAEMSGSIZE) || (error == WSAENETUNREACH) ||
+            (error == WSAEHOSTUNREACH));
+#else
+    return ((errno == ECONNREFUSED) || (errno == EMSGSIZE) || (errno == ENETUNREACH) ||
+            (errno == EHOSTUNREACH));
+#endif /* defined(WIN32) || defined(WIN64) */
+}
+
+#if UDP_MMSG
+
+/*
+ * 从队列第index个数据报开始构建一个消息，开启GSO时合并目的地址相同、长度相同（最后一个可以更短）的连续数据报
+ * @return 合并的数据报数量
+ */
+static uint32_t udp_build_msg(udp_t* udp, int msg, uint32_t index, uint32_t iov) {
+    struct msghdr*   hdr     = &udp->send_msgs[msg].msg_hdr;
+    struct cmsghdr*  cmsg    = 0;
+    buffer_t*        first   = udp->queue[(udp->head + index) % udp->queue_size];
+    buffer_t*        next    = 0;
+    uint32_t         segment = buffer_get_length(first) - UDP_ADDR_SIZE;
+    uint32_t         total   = segment;
+    uint32_t         size    = 0;
+    uint32_t         count   = 1;
+    udp->send_iov[iov].iov_base = buffer_get_ptr(first) + UDP_ADDR_SIZE;
+    udp->send_iov[iov].iov_len  = segment;
+    while (udp->gso && segment && (index + count < udp->count) && (count < UDP_MAX_SEGMENTS) &&
+           (iov + count < UDP_MAX_IOV)) {
+        next = udp->queue[(udp->head + index + count) % udp->queue_size];
+        size = buffer_get_length(next) - UDP_ADDR_SIZE;
+        if (!size || (size > segment) || (total + size > UDP_MAX_PAYLOAD) ||
+            memcmp(buffer_get_ptr(first), buffer_get_ptr(next), UDP_ADDR_SIZE)) {
+            break;
+        }
+        udp->send_iov[iov + count].iov_base = buffer_get_ptr(next) + UDP_ADDR_SIZE;
+        udp->send_iov[iov + count].iov_len  = size;
+        total += size;
+        count++;
+        if (size < segment) {
+            /* 只有最后一个分段可以更短 */
+            break;
+        }
+    }
+    memset(hdr, 0, sizeof(struct msghdr));
+    hdr->msg_name    = buffer_get_ptr(first);
+    hdr->msg_namelen = udp->addr_len;
+    hdr->msg_iov     = &udp->send_iov[iov];
+    hdr->msg_iovlen  = count;
+    if (count > 1) {
+        hdr->msg_control    = udp->send_control[msg].buffer;
+        hdr->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+        cmsg = CMSG_FIRSTHDR(hdr);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type  = UDP_SEGMENT;
+        cmsg->cmsg_len   = CMSG_LEN(sizeof(uint16_t));
+        *(uint16_t*)CMSG_DATA(cmsg) = (uint16_t)segment;
+    }
+    udp->send_count[msg] = count;
+    return count;
+}
+
+int udp_update_send(udp_t* udp, channel_ref_t* channel_ref) {
+    socket_t socket_fd = 0;
+    uint32_t index     = 0;
+    uint32_t iov       = 0;
+    uint32_t count     = 0;
+    int      msgs      = 0;
+    int      sent      = 0;
+    int      i         = 0;
+    assert(udp);
+    assert(channel_ref);
+    socket_fd = channel_ref_get_socket_fd(channel_ref);
+    while (udp->count) {
+        for (index = 0, iov = 0, msgs = 0; (msgs < UDP_MAX_BATCH) && (index < udp->count) && (iov < UDP_MAX_IOV); msgs++) {
+            count = udp_build_msg(udp, msgs, index, iov);
+            index += count;
+            iov   += count;
+        }
+        sent = sendmmsg(socket_fd, udp->send_msgs, msgs, 0);
+        if (sent < 0) {
+            if (udp_would_block()) {
+                return error_send_patial;
+            }
+            if (udp->gso && (errno == EIO)) {
+                /* 网卡不支持分段，关闭GSO后重新发送 */
+                udp->gso = 0;
+                continue;
+            }
+            /* 丢弃第一个消息，继续发送后续数据报 */
+            udp_pop(udp, udp->send_count[0]);
+            continue;
+        }
+        for (i = 0; i < sent; i++) {
+            udp_pop(udp, udp->send_count[i]);
+        }
+    }
+    return error_ok;
+}
+
+static void udp_dispatch(udp_t* udp, channel_ref_t* channel_ref, const char* data, uint32_t size, udp_address_t* sa) {
+    if (size > udp->max_size) {
+        return;
+    }
+    if (memcmp(&udp->peer, sa, udp->addr_len)) {
+        /* 对端变化时才更新地址，IP字符串在回调取得时才转换 */
+        address_set_sockaddr(udp->address, &sa->sa, udp->addr_len);
+        memcpy(&udp->peer, sa, udp->addr_len);
+    }
+    udp->cb(channel_ref, data, size, udp->address);
+}
+
+static int udp_get_segment(struct msghdr* hdr) {
+    struct cmsghdr* cmsg = 0;
+    for (cmsg = CMSG_FIRSTHDR(hdr); cmsg; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+        if ((cmsg->cmsg_level == SOL_UDP) && (cmsg->cmsg_type == UDP_GRO)) {
+            return *(int*)CMSG_DATA(cmsg);
+        }
+    }
+    return 0;
+}
+
+int udp_update_recv(udp_t* udp, channel_ref_t* channel_ref) {
+    socket_t       socket_fd = 0;
+    struct msghdr* hdr       = 0;
+    char*          data      = 0;
+    uint32_t       size      = 0;
+    uint32_t       offset    = 0;
+    uint32_t       segment   = 0;
+    int            round     = 0;
+    int            count     = 0;
+    int            i         = 0;
+    assert(udp);
+    assert(channel_ref);
+    socket_fd = channel_ref_get_socket_fd(channel_ref);
+    for (; round < UDP_RECV_ROUNDS; round++) {
+        for (i = 0; i < udp->batch; i++) {
+            hdr = &udp->recv_msgs[i].msg_hdr;
+            udp->recv_iov[i].iov_base = udp->recv_buffer + udp->slot_size * i;
+            udp->recv_iov[i].iov_len  = udp->slot_size;
+            hdr->msg_name       = &udp->recv_addr[i];
+            hdr->msg_namelen    = udp->addr_len;
+            hdr->msg_iov        = &udp->recv_iov[i];
+            hdr->msg_iovlen     = 1;
+            hdr->msg_control    = udp->gro ? udp->recv_control[i].buffer : 0;
+            hdr->msg_controllen = udp->gro ? sizeof(udp_control_t) : 0;
+            hdr->msg_flags      = 0;
+        }
+        count = recvmmsg(socket_fd, udp->recv_msgs, udp->batch, MSG_DONTWAIT, 0);
+        if (count < 0) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                return error_ok;
+            }
+            if ((errno == EINTR) || udp_peer_error()) {
+                continue;
+            }
+            return error_recv_fail;
+        }
+        for (i = 0; i < count; i++) {
+            hdr  = &udp->recv_msgs[i].msg_hdr;
+            data = (char*)udp->recv_iov[i].iov_base;
+            size = udp->recv_msgs[i].msg_len;
+            if (hdr->msg_flags & MSG_TRUNC) {
+                /* 超过最大长度，丢弃 */
+                continue;
+            }
+            segment = udp->gro ? (uint32_t)udp_get_segment(hdr) : 0;
+            if (!segment || (segment >= size)) {
+                udp_dispatch(udp, channel_ref, data, size, &udp->recv_addr[i]);
+            } else {
+                /* 内核合并的数据报按分段长度拆分 */
+                for (offset = 0; (offset < size) && !channel_ref_check_state(channel_ref, channel_state_close); offset += segment) {
+                    udp_dispatch(udp, channel_ref, data + offset, min(segment, size - offset), &udp->recv_addr[i]);
+                }
+            }
+            if (channel_ref_check_state(channel_ref, channel_state_close)) {
+                return error_ok;
+            }
+        }
+        if (count < udp->batch) {
+            /* 套接字内已无数据 */
+            return error_ok;
+        }
+    }
+    return error_recv_budget;
+}
+
+#else
+
+int udp_update_send(udp_t* udp, channel_ref_t* channel_ref) {
+    socket_t  socket_fd = 0;
+    buffer_t* datagram  = 0;
+    int       bytes     = 0;
+    assert(udp);
+    assert(channel_ref);
+    socket_fd = channel_ref_get_socket_fd(channel_ref);
+    while (udp->count) {
+        datagram = udp->queue[udp->head];
+        bytes = sendto(socket_fd, buffer_get_ptr(datagram) + UDP_ADDR_SIZE, (int)(buffer_get_length(datagram) - UDP_ADDR_SIZE),
+            0, (struct sockaddr*)buffer_get_ptr(datagram), udp->addr_len);
+        if ((bytes < 0) && udp_would_block()) {
+            return error_send_patial;
+        }
+        /* 失败的数据报直接丢弃 */
+        udp_pop(udp, 1);
+    }
+    return error_ok;
+}
+
+static void udp_dispatch(udp_t* udp, channel_ref_t* channel_ref, const char* data, uint32_t size, udp_address_t* sa) {
+    if (size > udp->max_size) {
+        return;
+    }
+    if (memcmp(&udp->peer, sa, udp->addr_len)) {
+        /* 对端变化时才更新地址，IP字符串在回调取得时才转换 */
+        address_set_sockaddr(udp->address, &sa->sa, udp->addr_len);
+        memcpy(&udp->peer, sa, udp->addr_len);
+    }
+    udp->cb(channel_ref, data, size, udp->address);
+}
+
+int udp_update_recv(udp_t* udp, channel_ref_t* channel_ref) {
+    socket_t     socket_fd = 0;
+    socket_len_t len       = 0;
+    int          bytes     = 0;
+    int          i         = 0;
+    assert(udp);
+    assert(channel_ref);
+    socket_fd = channel_ref_get_socket_fd(channel_ref);
+    for (; i < UDP_RECV_ROUNDS * UDP_MAX_BATCH; i++) {
+        len   = udp->addr_len;
+        bytes = recvfrom(socket_fd, udp->recv_buffer, (int)udp->slot_size, 0, &udp->recv_addr[0].sa, &len);
+        if (bytes < 0) {
+            if (udp_peer_error()) {
+                continue;
+            }
+            if (udp_would_block()) {
+                return error_ok;
+            }
+            return error_recv_fail;
+        }
+        udp_dispatch(udp, channel_ref, udp->recv_buffer, (uint32_t)bytes, &udp->recv_addr[0]);
+        if (channel_ref_check_state(channel_ref, channel_state_close)) {
+            return error_ok;
+        }
+    }
+    return error_recv_budget;
+}
+
+#endif /* UDP_MMSG */
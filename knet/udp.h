@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef UDP_H
+#define UDP_H
+
+#include "config.h"
+
+#define UDP_MAX_BATCH 64      /* 每次recvmmsg/sendmmsg最多处理的数据报数量 */
+#define UDP_GRO_BATCH 16      /* 开启GRO后每次recvmmsg的数据报数量，每个数据报最大64K */
+#define UDP_MAX_SEGMENTS 64   /* 开启GSO后每个数据报最多合并的分段数量 */
+#define UDP_MAX_IOV 1024      /* 每次sendmmsg最多使用的iovec数量 */
+#define UDP_MAX_PAYLOAD 65507 /* IPv4 UDP数据报最大长度 */
+#define UDP_RECV_ROUNDS 8     /* 每次读事件最多调用recvmmsg的次数，超过后放入就绪链表 */
+
+/*
+ * 创建数据报收发器
+ * @param max_size 接收数据报最大长度，超过的数据报被丢弃
+ * @param max_send_count 发送队列最多容纳的数据报数量
+ * @param cb 数据报回调
+ * @return udp_t实例
+ */
+udp_t* udp_create(uint32_t max_size, uint32_t max_send_count, channel_ref_udp_cb_t cb);
+
+/*
+ * 销毁数据报收发器，未发送的数据报一并销毁
+ * @param udp udp_t实例
+ */
+void udp_destroy(udp_t* udp);
+
+/*
+ * 设置数据报回调
+ * @param udp udp_t实例
+ * @param cb 数据报回调
+ */
+void udp_set_cb(udp_t* udp, channel_ref_udp_cb_t cb);
+
+/*
+ * 开启或关闭UDP GSO/GRO（Linux 4.18/5.0以上）
+ * @param udp udp_t实例
+ * @param socket_fd 套接字
+ * @param gso 非零时发送队列内目的地址和长度相同的连续数据报合并为一次发送，由内核分段
+ * @param gro 非零时由内核合并接收，回调前拆分
+ * @retval error_ok 成功
+ * @retval error_udp_offload 系统不支持
+ */
+int udp_set_offload(udp_t* udp, socket_t socket_fd, int gso, int gro);
+
+/*
+ * 设置绑定的地址族，在绑定成功后调用
+ * @param udp udp_t实例
+ * @param family AF_INET或AF_INET6
+ */
+void udp_set_family(udp_t* udp, int family);
+
+/*
+ * 将数据报打包为发送缓冲区，缓冲区头部为目的地址
+ * IPv6套接字发往IPv4地址时转换为IPv4映射地址
+ * @param udp udp_t实例
+ * @param data 数据报指针
+ * @param size 数据报长度
+ * @param ip 目的IP
+ * @param port 目的端口
+ * @return buffer_t实例，IP无效或与地址族不符时返回0
+ */
+buffer_t* udp_pack(udp_t* udp, const char* data, uint32_t size, const char* ip, int port);
+
+/*
+ * 将udp_pack打包的数据报放入发送队列
+ * @param udp udp_t实例
+ * @param datagram udp_pack打包的数据报
+ * @retval error_ok 成功
+ * @retval error_udp_queue_full 发送队列已满，数据报被丢弃
+ */
+int udp_queue(udp_t* udp, buffer_t* datagram);
+
+/*
+ * 检查发送队列是否为空
+ * @param udp udp_t实例
+ * @return 非零为空
+ */
+int udp_send_empty(udp_t* udp);
+
+/*
+ * 批量发送队列内的数据报
+ * 对端不可达等单个数据报的错误只丢弃该数据报
+ * @param udp udp_t实例
+ * @param channel_ref channel_ref_t实例
+ * @retval error_ok 发送队列已清空
+ * @retval error_send_patial 套接字发送缓冲区已满，需要等待写事件
+ */
+int udp_update_send(udp_t* udp, channel_ref_t* channel_ref);
+
+/*
+ * 批量读取数据报并逐个回调
+ * @param udp udp_t实例
+ * @param channel_ref channel_ref_t实例
+ * @retval error_ok 套接字内已无数据
+ * @retval error_recv_budget 已达到本次读事件的读取次数上限
+ * @retval error_recv_fail 读取失败，需要关闭管道
+ */
+int udp_update_recv(udp_t* udp, channel_ref_t* channel_ref);
+
+#endif /* UDP_H */
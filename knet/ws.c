@@ -0,0 +1,843 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <ctype.h>
+#include "ws.h"
+#include "channel_ref.h"
+#include "ringbuffer.h"
+#include "buffer.h"
+#include "http.h"
+#include "misc.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #include <emmintrin.h>
+    #define WS_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define WS_NEON 1
+#endif /* defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) */
+
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+typedef enum _ws_state_e {
+    ws_state_handshake = 1, /* 客户端等待握手应答 */
+    ws_state_open,          /* 可以收发消息 */
+    ws_state_closed,        /* 已收到关闭帧或协议错误，不再处理帧 */
+} ws_state_e;
+
+struct _ws_t {
+    ws_state_e  state;              /* 状态 */
+    char*       host;               /* 客户端握手请求的Host，服务端为0 */
+    char*       uri;                /* 客户端握手请求的URI */
+    char        accept[32];         /* 客户端期望的Sec-WebSocket-Accept */
+    uint32_t    max_size;           /* 消息最大长度 */
+    uint32_t    seed;               /* 掩码随机数种子 */
+    int         close_sent;         /* 已发送关闭帧 */
+    const char* message;            /* 当前回调的消息 */
+    uint32_t    message_size;       /* 当前回调的消息长度 */
+    ws_opcode_e opcode;             /* 当前回调的消息类型 */
+    ws_opcode_e fragment_opcode;    /* 未完成的分片消息类型，0表示没有 */
+    char*       fragments;          /* 分片消息拼接缓冲区 */
+    uint32_t    fragments_size;     /* 已拼接的长度 */
+    uint32_t    fragments_capacity; /* 拼接缓冲区容量 */
+};
+
+static char* ws_strdup(const char* s) {
+    char* copy = create_raw(strlen(s) + 1);
+    assert(copy);
+    strcpy(copy, s);
+    return copy;
+}
+
+ws_t* ws_create(const char* host, const char* uri, uint32_t max_size) {
+    ws_t* ws = create(ws_t);
+    assert(ws);
+    memset(ws, 0, sizeof(ws_t));
+    ws->max_size = max_size;
+    ws->state    = ws_state_open;
+    if (host) {
+        assert(uri);
+        ws->host  = ws_strdup(host);
+        ws->uri   = ws_strdup(uri);
+        ws->state = ws_state_handshake;
+    }
+    /* xorshift种子不能为0 */
+    ws->seed = (uint32_t)time(0) ^ time_get_milliseconds() ^ (uint32_t)(size_t)ws;
+    if (!ws->seed) {
+        ws->seed = 0x9e3779b9;
+    }
+    return ws;
+}
+
+void ws_destroy(ws_t* ws) {
+    assert(ws);
+    if (ws->host) {
+        destroy(ws->host);
+    }
+    if (ws->uri) {
+        destroy(ws->uri);
+    }
+    if (ws->fragments) {
+        destroy(ws->fragments);
+    }
+    destroy(ws);
+}
+
+void ws_mask(char* data, uint32_t size, const char* key) {
+    uint32_t i      = 0;
+    uint32_t word   = 0;
+    uint64_t mask   = 0;
+    uint64_t value  = 0;
+#if defined(WS_SSE2)
+    __m128i  vector;
+#elif defined(WS_NEON)
+    uint8x16_t vector;
+#endif /* defined(WS_SSE2) */
+    assert(data);
+    assert(key);
+    memcpy(&word, key, 4);
+    /* 每次处理的字节数都是4的倍数，掩码不需要旋转 */
+#if defined(WS_SSE2)
+    if (size >= 16) {
+        vector = _mm_set1_epi32((int)word);
+        for (; i + 16 <= size; i += 16) {
+            _mm_storeu_si128((__m128i*)(data + i),
+                _mm_xor_si128(_mm_loadu_si128((const __m128i*)(data + i)), vector));
+        }
+    }
+#elif defined(WS_NEON)
+    if (size >= 16) {
+        vector = vreinterpretq_u8_u32(vdupq_n_u32(word));
+        for (; i + 16 <= size; i += 16) {
+            vst1q_u8((uint8_t*)(data + i), veorq_u8(vld1q_u8((const uint8_t*)(data + i)), vector));
+        }
+    }
+#endif /* defined(WS_SSE2) */
+    mask = ((uint64_t)word << 32) | word;
+    for (; i + 8 <= size; i += 8) {
+        memcpy(&value, data + i, 8);
+        value ^= mask;
+        memcpy(data + i, &value, 8);
+    }
+    for (; i < size; i++) {
+        data[i] ^= key[i & 3];
+    }
+}
+
+static uint32_t ws_random(ws_t* ws) {
+    /* xorshift32 */
+    ws->seed ^= ws->seed << 13;
+    ws->seed ^= ws->seed >> 17;
+    ws->seed ^= ws->seed << 5;
+    return ws->seed;
+}
+
+static uint32_t ws_rol(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static void ws_sha1_block(uint32_t h[5], const unsigned char* p) {
+    uint32_t w[80];
+    uint32_t a = h[0];
+    uint32_t b = h[1];
+    uint32_t c = h[2];
+    uint32_t d = h[3];
+    uint32_t e = h[4];
+    uint32_t f = 0;
+    uint32_t k = 0;
+    uint32_t t = 0;
+    int      i = 0;
+    for (; i < 16; i++) {
+        w[i] = ((uint32_t)p[i * 4] << 24) | ((uint32_t)p[i * 4 + 1] << 16) | ((uint32_t)p[i * 4 + 2] << 8) | p[i * 4 + 3];
+    }
+    for (; i < 80; i++) {
+        w[i] = ws_rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    for (i = 0; i < 80; i++) {
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+        t = ws_rol(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = ws_rol(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+static void ws_sha1(const char* data, uint32_t size, unsigned char digest[20]) {
+    uint32_t      h[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+    unsigned char block[64];
+    uint32_t      i    = 0;
+    uint32_t      rest = 0;
+    uint64_t      bits = (uint64_t)size * 8;
+    for (; i + 64 <= size; i += 64) {
+        ws_sha1_block(h, (const unsigned char*)data + i);
+    }
+    rest = size - i;
+    memset(block, 0, sizeof(block));
+    memcpy(block, data + i, rest);
+    block[rest] = 0x80;
+    if (rest >= 56) {
+        ws_sha1_block(h, block);
+        memset(block, 0, sizeof(block));
+    }
+    for (i = 0; i < 8; i++) {
+        block[63 - i] = (unsigned char)(bits >> (i * 8));
+    }
+    ws_sha1_block(h, block);
+    for (i = 0; i < 20; i++) {
+        digest[i] = (unsigned char)(h[i / 4] >> (24 - (i % 4) * 8));
+    }
+}
+
+static uint32_t ws_base64(const unsigned char* data, uint32_t size, char* output) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    uint32_t i     = 0;
+    uint32_t pos   = 0;
+    uint32_t value = 0;
+    for (; i + 3 <= size; i += 3) {
+        value = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | data[i + 2];
+        output[pos++] = table[(value >> 18) & 0x3f];
+        output[pos++] = table[(value >> 12) & 0x3f];
+        output[pos++] = table[(value >> 6) & 0x3f];
+        output[pos++] = table[value & 0x3f];
+    }
+    if (i < size) {
+        value = (uint32_t)data[i] << 16;
+        if (i + 1 < size) {
+            value |= (uint32_t)data[i + 1] << 8;
+        }
+        output[pos++] = table[(value >> 18) & 0x3f];
+        output[pos++] = table[(value >> 12) & 0x3f];
+        output[pos++] = (i + 1 < size) ? table[(value >> 6) & 0x3f] : '=';
+        output[pos++] = '=';
+    }
+    output[pos] = 0;
+    return pos;
+}
+
+/*
+ * 计算Sec-WebSocket-Accept: base64(sha1(key + GUID))
+ * @param accept 至少29字节
+ */
+static void ws_make_accept(const char* key, uint32_t size, char* accept) {
+    char          buffer[128];
+    unsigned char digest[20];
+    memcpy(buffer, key, size);
+    memcpy(buffer + size, WS_GUID, sizeof(WS_GUID) - 1);
+    ws_sha1(buffer, size + sizeof(WS_GUID) - 1, digest);
+    ws_base64(digest, sizeof(digest), accept);
+}
+
+static int ws_equal_nocase(const char* data, const char* s, uint32_t size) {
+    uint32_t i = 0;
+    for (; i < size; i++) {
+        if (tolower((unsigned char)data[i]) != tolower((unsigned char)s[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * 在应答头内查找指定名称的值（不区分大小写）
+ */
+static const char* ws_find_header(const char* head, uint32_t size, const char* name, uint32_t* value_size) {
+    const char* end    = head + size;
+    const char* line   = 0;
+    const char* next   = 0;
+    const char* value  = 0;
+    const char* tail   = 0;
+    uint32_t    length = (uint32_t)strlen(name);
+    /* 跳过状态行 */
+    line = (const char*)memchr(head, '\n', size);
+    for (; line && (++line < end); line = next) {
+        next = (const char*)memchr(line, '\n', end - line);
+        if (!next) {
+            break;
+        }
+        if (((uint32_t)(next - line) <= length) || (line[length] != ':') ||
+            !ws_equal_nocase(line, name, length)) {
+            continue;
+        }
+        value = line + length + 1;
+        tail  = next;
+        while ((value < tail) && ((*value == ' ') || (*value == '\t'))) {
+            value++;
+        }
+        while ((tail > value) && ((tail[-1] == '\r') || (tail[-1] == ' ') || (tail[-1] == '\t'))) {
+            tail--;
+        }
+        *value_size = (uint32_t)(tail - value);
+        return value;
+    }
+    return 0;
+}
+
+static char* ws_get_ptr(ringbuffer_t* rb, uint32_t size) {
+    if (ringbuffer_read_lock_size(rb) < size) {
+        /* 跨越绕回点，原地移动使其连续 */
+        ringbuffer_linearize(rb);
+        ringbuffer_read_lock_size(rb);
+    }
+    return ringbuffer_read_lock_ptr(rb);
+}
+
+/*
+ * 发送一帧
+ * 服务端帧头和数据聚合写，客户端拷贝到发送缓冲区内原地添加掩码
+ */
+static int ws_send_frame(ws_t* ws, channel_ref_t* channel_ref, ws_opcode_e opcode, const char* data, uint32_t size) {
+    char        header[WS_MAX_HEADER_SIZE];
+    uint32_t    header_size = 2;
+    uint32_t    key         = 0;
+    int         i           = 0;
+    int         error       = error_ok;
+    const char* ptr[2]      = {0};
+    uint32_t    len[2]      = {0};
+    char*       payload     = 0;
+    buffer_t*   send_buffer = 0;
+    header[0] = (char)(0x80 | opcode);
+    if (size < 126) {
+        header[1] = (char)size;
+    } else if (size <= 0xffff) {
+        header[1] = 126;
+        header[2] = (char)(size >> 8);
+        header[3] = (char)size;
+        header_size = 4;
+    } else {
+        header[1] = 127;
+        for (; i < 8; i++) {
+            header[2 + i] = (char)((uint64_t)size >> (56 - i * 8));
+        }
+        header_size = 10;
+    }
+    if (!ws->host) {
+        ptr[0] = header;
+        len[0] = header_size;
+        ptr[1] = data;
+        len[1] = size;
+        error = channel_ref_write_segments(channel_ref, ptr, len, size ? 2 : 1);
+    } else {
+        /* 客户端发送的帧必须添加掩码 */
+        header[1] |= 0x80;
+        key = ws_random(ws);
+        memcpy(header + header_size, &key, 4);
+        header_size += 4;
+        send_buffer = buffer_create(header_size + size);
+        buffer_put(send_buffer, header, header_size);
+        if (size) {
+            payload = buffer_get_write_ptr(send_buffer);
+            buffer_put(send_buffer, data, size);
+            ws_mask(payload, size, header + header_size - 4);
+        }
+        error = channel_ref_write_chain(channel_ref, send_buffer);
+    }
+    if (error == error_send_patial) {
+        return error_ok;
+    }
+    return error;
+}
+
+static int ws_send_close(ws_t* ws, channel_ref_t* channel_ref, int code, const char* reason, uint32_t size) {
+    char payload[WS_MAX_CONTROL];
+    ws->close_sent = 1;
+    if (!code) {
+        return ws_send_frame(ws, channel_ref, ws_opcode_close, 0, 0);
+    }
+    payload[0] = (char)(code >> 8);
+    payload[1] = (char)code;
+    if (size) {
+        memcpy(payload + 2, reason, size);
+    }
+    return ws_send_frame(ws, channel_ref, ws_opcode_close, payload, size + 2);
+}
+
+/*
+ * 协议错误，发送关闭帧后关闭管道
+ */
+static void ws_fail(ws_t* ws, channel_ref_t* channel_ref, int code) {
+    ws->state = ws_state_closed;
+    if (!ws->close_sent) {
+        ws_send_close(ws, channel_ref, code, 0, 0);
+    }
+    if (!channel_ref_check_state(channel_ref, channel_state_close)) {
+        channel_ref_close_after_send(channel_ref);
+    }
+}
+
+static void ws_notify(ws_t* ws, channel_ref_t* channel_ref, ws_opcode_e opcode, const char* data, uint32_t size) {
+    channel_ref_cb_t cb = channel_ref_get_cb(channel_ref);
+    ws->message      = data;
+    ws->message_size = size;
+    ws->opcode       = opcode;
+    if (cb) {
+        cb(channel_ref, channel_cb_event_recv);
+    }
+    ws->message      = 0;
+    ws->message_size = 0;
+}
+
+static void ws_append_fragment(ws_t* ws, const char* data, uint32_t size) {
+    char*    fragments = 0;
+    uint32_t capacity  = 0;
+    if (ws->fragments_size + size > ws->fragments_capacity) {
+        capacity = max(ws->fragments_capacity * 2, ws->fragments_size + size);
+        capacity = min(max(capacity, 1024), ws->max_size);
+        fragments = create_raw(capacity);
+        assert(fragments);
+        if (ws->fragments) {
+            memcpy(fragments, ws->fragments, ws->fragments_size);
+            destroy(ws->fragments);
+        }
+        ws->fragments          = fragments;
+        ws->fragments_capacity = capacity;
+    }
+    if (size) {
+        memcpy(ws->fragments + ws->fragments_size, data, size);
+        ws->fragments_size += size;
+    }
+}
+
+/*
+ * 校验UTF-8编码（RFC 3629），拒绝过长编码、代理区及超过U+10FFFF的码点
+ */
+static int ws_check_utf8(const char* data, uint32_t size) {
+    const unsigned char* p    = (const unsigned char*)data;
+    const unsigned char* end  = p + size;
+    unsigned char        c    = 0;
+    unsigned char        low  = 0x80;
+    unsigned char        high = 0xbf;
+    int                  n    = 0;
+    while (p < end) {
+        c = *p++;
+        if (c < 0x80) {
+            continue;
+        }
+        low  = 0x80;
+        high = 0xbf;
+        if ((c >= 0xc2) && (c <= 0xdf)) {
+            n = 1;
+        } else if ((c >= 0xe0) && (c <= 0xef)) {
+            n = 2;
+            if (c == 0xe0) {
+                low = 0xa0;
+            } else if (c == 0xed) {
+                high = 0x9f;
+            }
+        } else if ((c >= 0xf0) && (c <= 0xf4)) {
+            n = 3;
+            if (c == 0xf0) {
+                low = 0x90;
+            } else if (c == 0xf4) {
+                high = 0x8f;
+            }
+        } else {
+            return 0;
+        }
+        if (end - p < n) {
+            return 0;
+        }
+        /* 只有第二个字节的范围受首字节限制 */
+        if ((*p < low) || (*p > high)) {
+            return 0;
+        }
+        for (p++, n--; n > 0; n--, p++) {
+            if ((*p & 0xc0) != 0x80) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/*
+ * 检查收到的关闭状态码（RFC 6455 7.4）
+ */
+static int ws_check_close_code(int code) {
+    if ((code >= 1000) && (code <= 1003)) {
+        return 1;
+    }
+    if ((code >= 1007) && (code <= 1011)) {
+        return 1;
+    }
+    return (code >= 3000) && (code <= 4999);
+}
+
+/*
+ * 处理一个完整的帧
+ */
+static int ws_dispatch(ws_t* ws, channel_ref_t* channel_ref, int fin, ws_opcode_e opcode, const char* payload,
+    uint32_t size) {
+    int code = 0;
+    switch (opcode) {
+    case ws_opcode_ping:
+        /* 在loop线程内直接应答 */
+        if (!ws->close_sent) {
+            return ws_send_frame(ws, channel_ref, ws_opcode_pong, payload, size);
+        }
+        break;
+    case ws_opcode_pong:
+        break;
+    case ws_opcode_close:
+        if (size == 1) {
+            ws_fail(ws, channel_ref, 1002);
+            break;
+        }
+        code = size ? (((unsigned char)payload[0] << 8) | (unsigned char)payload[1]) : 0;
+        if (size && !ws_check_close_code(code)) {
+            ws_fail(ws, channel_ref, 1002);
+            break;
+        }
+        if ((size > 2) && !ws_check_utf8(payload + 2, size - 2)) {
+            ws_fail(ws, channel_ref, 1007);
+            break;
+        }
+        ws->state = ws_state_closed;
+        if (ws->close_sent) {
+            /* 关闭握手完成 */
+            channel_ref_close(channel_ref);
+            break;
+        }
+        /* 回应相同的状态码后关闭 */
+        ws_send_close(ws, channel_ref, code, 0, 0);
+        channel_ref_close_after_send(channel_ref);
+        break;
+    case ws_opcode_text:
+    case ws_opcode_binary:
+        if (ws->fragment_opcode) {
+            /* 上一个分片消息未完成 */
+            ws_fail(ws, channel_ref, 1002);
+            break;
+        }
+        if (fin) {
+            if ((opcode == ws_opcode_text) && !ws_check_utf8(payload, size)) {
+                ws_fail(ws, channel_ref, 1007);
+                break;
+            }
+            ws_notify(ws, channel_ref, opcode, payload, size);
+            break;
+        }
+        ws->fragment_opcode = opcode;
+        ws->fragments_size  = 0;
+        ws_append_fragment(ws, payload, size);
+        break;
+    case ws_opcode_continuation:
+        if (!ws->fragment_opcode) {
+            ws_fail(ws, channel_ref, 1002);
+            break;
+        }
+        if ((uint64_t)ws->fragments_size + size > ws->max_size) {
+            ws_fail(ws, channel_ref, 1009);
+            break;
+        }
+        ws_append_fragment(ws, payload, size);
+        if (fin) {
+            opcode = ws->fragment_opcode;
+            ws->fragment_opcode = 0;
+            /* 编码可能跨越分片，拼接完成后再校验 */
+            if ((opcode == ws_opcode_text) && !ws_check_utf8(ws->fragments, ws->fragments_size)) {
+                ws_fail(ws, channel_ref, 1007);
+                break;
+            }
+            ws_notify(ws, channel_ref, opcode, ws->fragments, ws->fragments_size);
+        }
+        break;
+    default:
+        ws_fail(ws, channel_ref, 1002);
+        break;
+    }
+    return error_ok;
+}
+
+/*
+ * 客户端处理握手应答
+ */
+static int ws_update_handshake(ws_t* ws, channel_ref_t* channel_ref, ringbuffer_t* rb) {
+    int              pos       = 0;
+    uint32_t         size      = 0;
+    uint32_t         available = 0;
+    const char*      head      = 0;
+    const char*      value     = 0;
+    channel_ref_cb_t cb        = 0;
+    available = ringbuffer_available(rb);
+    pos = ringbuffer_find(rb, "\r\n\r\n", 4);
+    if (pos < 0) {
+        if (available >= min(WS_MAX_HANDSHAKE, channel_ref_get_max_recv_ring_len(channel_ref))) {
+            return error_ws_handshake;
+        }
+        channel_ref_set_recv_lowat(channel_ref, available + 1);
+        return error_ok;
+    }
+    size = (uint32_t)pos + 4;
+    head = ws_get_ptr(rb, size);
+    if ((size < 12) || memcmp(head, "HTTP/1.1 101", 12)) {
+        return error_ws_handshake;
+    }
+    value = ws_find_header(head, size, "Sec-WebSocket-Accept", &size);
+    if (!value || (size != strlen(ws->accept)) || memcmp(value, ws->accept, size)) {
+        return error_ws_handshake;
+    }
+    ringbuffer_read_lock_size(rb);
+    ringbuffer_read_commit(rb, (uint32_t)pos + 4);
+    ws->state = ws_state_open;
+    cb = channel_ref_get_cb(channel_ref);
+    if (cb) {
+        cb(channel_ref, channel_cb_event_ws_open);
+    }
+    return error_ok;
+}
+
+int ws_start(ws_t* ws, channel_ref_t* channel_ref) {
+    char          request[WS_MAX_HANDSHAKE];
+    char          key[32];
+    unsigned char nonce[16];
+    int           i     = 0;
+    int           size  = 0;
+    int           error = error_ok;
+    assert(ws);
+    assert(channel_ref);
+    assert(ws->host);
+    for (; i < (int)sizeof(nonce); i++) {
+        nonce[i] = (unsigned char)ws_random(ws);
+    }
+    ws_base64(nonce, sizeof(nonce), key);
+    ws_make_accept(key, (uint32_t)strlen(key), ws->accept);
+    size = sprintf(request, "GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n", ws->uri, ws->host, key);
+    error = channel_ref_write(channel_ref, request, size);
+    if (error == error_send_patial) {
+        return error_ok;
+    }
+    return error;
+}
+
+int ws_update_recv(ws_t* ws, channel_ref_t* channel_ref) {
+    ringbuffer_t* rb          = 0;
+    char*         payload     = 0;
+    uint32_t      available   = 0;
+    uint32_t      max_size    = 0;
+    uint32_t      copied      = 0;
+    uint32_t      header_size = 0;
+    uint32_t      total       = 0;
+    uint64_t      size        = 0;
+    int           fin         = 0;
+    int           masked      = 0;
+    int           i           = 0;
+    int           error       = error_ok;
+    ws_opcode_e   opcode      = ws_opcode_continuation;
+    char          header[WS_MAX_HEADER_SIZE];
+    assert(ws);
+    assert(channel_ref);
+    rb       = channel_ref_get_ringbuffer(channel_ref);
+    max_size = channel_ref_get_max_recv_ring_len(channel_ref);
+    while (!channel_ref_check_state(channel_ref, channel_state_close) && (ws->state != ws_state_closed)) {
+        if (ws->state == ws_state_handshake) {
+            error = ws_update_handshake(ws, channel_ref, rb);
+            if ((error != error_ok) || (ws->state == ws_state_handshake)) {
+                return error;
+            }
+            continue;
+        }
+        available = ringbuffer_available(rb);
+        if (available < 2) {
+            channel_ref_set_recv_lowat(channel_ref, 2);
+            break;
+        }
+        /* 帧头（和掩码）只拷贝最多14字节 */
+        copied = ringbuffer_copy(rb, header, min(available, WS_MAX_HEADER_SIZE));
+        fin    = header[0] & 0x80;
+        opcode = (ws_opcode_e)(header[0] & 0x0f);
+        masked = header[1] & 0x80;
+        size   = header[1] & 0x7f;
+        header_size = (size == 126) ? 4 : ((size == 127) ? 10 : 2);
+        if (masked) {
+            header_size += 4;
+        }
+        if (copied < header_size) {
+            channel_ref_set_recv_lowat(channel_ref, header_size);
+            break;
+        }
+        if (size == 126) {
+            size = ((uint32_t)(unsigned char)header[2] << 8) | (unsigned char)header[3];
+        } else if (size == 127) {
+            for (size = 0, i = 2; i < 10; i++) {
+                size = (size << 8) | (unsigned char)header[i];
+            }
+        }
+        /* 没有协商扩展，RSV必须为0；客户端发送的帧必须有掩码，服务端发送的帧不能有掩码 */
+        if ((header[0] & 0x70) || (ws->host ? masked : !masked) ||
+            ((opcode & 0x08) && (!fin || (size > WS_MAX_CONTROL)))) {
+            ws_fail(ws, channel_ref, 1002);
+            break;
+        }
+        if ((size > ws->max_size) || (header_size + size > max_size)) {
+            ws_fail(ws, channel_ref, 1009);
+            break;
+        }
+        total = header_size + (uint32_t)size;
+        if (available < total) {
+            /* 帧不完整，收齐前不再回调 */
+            channel_ref_set_recv_lowat(channel_ref, total);
+            break;
+        }
+        payload = ws_get_ptr(rb, total) + header_size;
+        if (masked) {
+            /* 在读缓冲区内原地去掉掩码 */
+            ws_mask(payload, (uint32_t)size, header + header_size - 4);
+        }
+        error = ws_dispatch(ws, channel_ref, fin, opcode, payload, (uint32_t)size);
+        ringbuffer_read_lock_size(rb);
+        ringbuffer_read_commit(rb, total);
+        if (error != error_ok) {
+            return error;
+        }
+    }
+    /* 读缓冲区有空间后恢复读事件 */
+    channel_ref_resume_recv(channel_ref);
+    return error_ok;
+}
+
+int ws_accept(http_request_t* request, uint32_t max_size) {
+    channel_ref_t*   channel_ref = 0;
+    const char*      value       = 0;
+    uint32_t         size        = 0;
+    ws_t*            ws          = 0;
+    channel_ref_cb_t cb          = 0;
+    int              error       = error_ok;
+    char             accept[32];
+    assert(request);
+    channel_ref = http_request_get_channel_ref(request);
+    if (channel_ref_get_ws(channel_ref)) {
+        return error_ws_state;
+    }
+    if (!http_request_check_method(request, "GET") || !http_request_get_version(request)) {
+        error = error_ws_handshake;
+    }
+    if (!http_request_check_header_token(request, "Upgrade", "websocket") ||
+        !http_request_check_header_token(request, "Connection", "upgrade")) {
+        error = error_ws_handshake;
+    }
+    value = http_request_find_header(request, "Sec-WebSocket-Version", &size);
+    if (!value || (size != 2) || memcmp(value, "13", 2)) {
+        error = error_ws_handshake;
+    }
+    value = http_request_find_header(request, "Sec-WebSocket-Key", &size);
+    if (!value || !size || (size > 64)) {
+        error = error_ws_handshake;
+    }
+    if (error != error_ok) {
+        http_response_add_header(request, "Sec-WebSocket-Version", "13");
+        http_response_write(request, 400, 0, 0, 0);
+        return error;
+    }
+    ws_make_accept(value, size, accept);
+    error = http_response_add_header(request, "Sec-WebSocket-Accept", accept);
+    if (error == error_ok) {
+        error = http_response_switch(request, "websocket");
+    }
+    if (error != error_ok) {
+        return error;
+    }
+    /* 读缓冲区内的后续数据在请求回调返回后按帧处理 */
+    ws = ws_create(0, 0, max_size);
+    channel_ref_upgrade_ws(channel_ref, ws);
+    cb = channel_ref_get_cb(channel_ref);
+    if (cb) {
+        cb(channel_ref, channel_cb_event_ws_open);
+    }
+    return error_ok;
+}
+
+int ws_write(channel_ref_t* channel_ref, ws_opcode_e opcode, const char* data, uint32_t size) {
+    ws_t* ws = 0;
+    assert(channel_ref);
+    ws = channel_ref_get_ws(channel_ref);
+    if (!ws || (ws->state != ws_state_open) || ws->close_sent) {
+        return error_ws_state;
+    }
+    if ((opcode != ws_opcode_text) && (opcode != ws_opcode_binary) && (opcode != ws_opcode_ping)) {
+        return error_fail;
+    }
+    if ((opcode == ws_opcode_ping) && (size > WS_MAX_CONTROL)) {
+        return error_fail;
+    }
+    if (size) {
+        assert(data);
+    }
+    return ws_send_frame(ws, channel_ref, opcode, data, size);
+}
+
+int ws_close(channel_ref_t* channel_ref, int code, const char* reason) {
+    ws_t*    ws   = 0;
+    uint32_t size = 0;
+    assert(channel_ref);
+    ws = channel_ref_get_ws(channel_ref);
+    if (!ws || (ws->state != ws_state_open) || ws->close_sent) {
+        return error_ws_state;
+    }
+    if (reason) {
+        size = (uint32_t)strlen(reason);
+        if (size > WS_MAX_CONTROL - 2) {
+            return error_fail;
+        }
+    }
+    return ws_send_close(ws, channel_ref, code, reason, size);
+}
+
+const char* ws_get_message(channel_ref_t* channel_ref, uint32_t* size) {
+    ws_t* ws = 0;
+    assert(channel_ref);
+    assert(size);
+    ws = channel_ref_get_ws(channel_ref);
+    if (!ws) {
+        *size = 0;
+        return 0;
+    }
+    *size = ws->message_size;
+    return ws->message;
+}
+
+ws_opcode_e ws_get_opcode(channel_ref_t* channel_ref) {
+    ws_t* ws = 0;
+    assert(channel_ref);
+    ws = channel_ref_get_ws(channel_ref);
+    return ws ? ws->opcode : ws_opcode_continuation;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef WS_H
+#define WS_H
+
+#include "config.h"
+#include "ws_api.h"
+
+#define WS_MAX_HEADER_SIZE 14    /* 帧头最大字节数（包括掩码） */
+#define WS_MAX_HANDSHAKE 4096    /* 握手应答最大长度 */
+#define WS_MAX_CONTROL 125       /* 控制帧最大长度 */
+
+/*
+ * 创建WebSocket
+ * @param host 客户端握手请求的Host，为0时作为服务端
+ * @param uri 客户端握手请求的URI
+ * @param max_size 消息最大长度
+ * @return ws_t实例
+ */
+ws_t* ws_create(const char* host, const char* uri, uint32_t max_size);
+
+/*
+ * 销毁WebSocket
+ * @param ws ws_t实例
+ */
+void ws_destroy(ws_t* ws);
+
+/*
+ * 客户端连接完成后发送握手请求
+ * @param ws ws_t实例
+ * @param channel_ref channel_ref_t实例
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int ws_start(ws_t* ws, channel_ref_t* channel_ref);
+
+/*
+ * 处理握手应答和读缓冲区内所有完整的帧
+ * 单帧消息在读缓冲区内原地去掉掩码后回调，分片消息拼接后回调，
+ * 不完整的帧根据已解析的长度设置管道读低水位
+ * @param ws ws_t实例
+ * @param channel_ref channel_ref_t实例
+ * @retval error_ok 成功
+ * @retval 其他 失败，需要关闭管道
+ */
+int ws_update_recv(ws_t* ws, channel_ref_t* channel_ref);
+
+/*
+ * 异或掩码
+ * 添加和去掉掩码是同一个操作，使用SSE2/NEON每次处理16字节
+ * @param data 数据
+ * @param size 数据长度
+ * @param key 4字节掩码
+ */
+void ws_mask(char* data, uint32_t size, const char* key);
+
+#endif /* WS_H */
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2014-2015, dennis wang
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL dennis wang BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef WS_API_H
+#define WS_API_H
+
+/*
+ * 接受WebSocket握手请求，将HTTP连接切换为WebSocket
+ * 只能在channel_ref_set_http设置的请求回调内调用，校验失败时应答400.
+ * 成功后以channel_cb_event_ws_open回调管道回调，之后每收到一个完整消息以channel_cb_event_recv回调，
+ * 通过ws_get_message取得消息. ping由loop线程自动应答pong
+ * @param request http_request_t实例
+ * @param max_size 消息最大长度（包括分片消息拼接后的长度）
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int ws_accept(http_request_t* request, uint32_t max_size);
+
+/*
+ * 发送消息
+ * 服务端直接聚合写，客户端按协议要求添加掩码后发送，可以在任意线程调用
+ * @param channel_ref channel_ref_t实例
+ * @param opcode ws_opcode_text, ws_opcode_binary或ws_opcode_ping
+ * @param data 消息
+ * @param size 消息长度，ping不能超过125字节
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int ws_write(channel_ref_t* channel_ref, ws_opcode_e opcode, const char* data, uint32_t size);
+
+/*
+ * 发起关闭握手
+ * 发送关闭帧，收到对端的关闭帧后关闭管道
+ * @param channel_ref channel_ref_t实例
+ * @param code 状态码，例如1000
+ * @param reason 原因，可以为0，不能超过123字节
+ * @retval error_ok 成功
+ * @retval 其他 失败
+ */
+int ws_close(channel_ref_t* channel_ref, int code, const char* reason);
+
+/*
+ * 取得当前消息
+ * 只在channel_cb_event_recv回调内有效，回调返回后失效
+ * @param channel_ref channel_ref_t实例
+ * @param size 消息长度
+ * @return 消息
+ */
+const char* ws_get_message(channel_ref_t* channel_ref, uint32_t* size);
+
+/*
+ * 取得当前消息类型
+ * @param channel_ref channel_ref_t实例
+ * @return ws_opcode_text或ws_opcode_binary
+ */
+ws_opcode_e ws_get_opcode(channel_ref_t* channel_ref);
+
+#endif /* WS_API_H */